@@ -29,6 +29,7 @@
 #include <driverlib/ioc.h>
 
 #include "etx_board.h"
+#include "etx_board_idle.h"
 
 /*
  *  ========================= IO driver initialization =========================
@@ -81,7 +82,7 @@ const PINCC26XX_HWAttrs PINCC26XX_hwAttrs = {
 #endif
 const PowerCC26XX_Config PowerCC26XX_config = {
     .policyInitFxn      = NULL,
-    .policyFxn          = &PowerCC26XX_standbyPolicy,
+    .policyFxn          = &Board_Idle_policy,	/* standby policy, timed */
     .calibrateFxn       = &PowerCC26XX_calibrate,
     .enablePolicy       = TRUE,
     .calibrateRCOSC_LF  = TRUE,
@@ -292,3 +293,82 @@ const ADC_Config ADC_config[] = {
 /*
  *  ========================== ADC end =========================================
  */
+
+/*
+ *  ========================== Crypto begin ====================================
+ */
+/* Place into subsections to allow the TI linker to remove items properly */
+#if defined(__TI_COMPILER_VERSION__)
+#pragma DATA_SECTION(CryptoCC26XX_config, ".const:CryptoCC26XX_config")
+#pragma DATA_SECTION(cryptoCC26XXHWAttrs, ".const:cryptoCC26XXHWAttrs")
+#endif
+
+/* Include drivers */
+#include <ti/drivers/crypto/CryptoCC26XX.h>
+
+/* Crypto objects */
+CryptoCC26XX_Object cryptoCC26XXObjects[1];
+
+/* Crypto hardware parameter structure, the AES engine checks the beacon
+ * tags */
+const CryptoCC26XX_HWAttrs cryptoCC26XXHWAttrs[1] = {
+    {
+        .baseAddr    = CRYPTO_BASE,
+        .powerMngrId = PowerCC26XX_PERIPH_CRYPTO,
+        .intNum      = INT_CRYPTO_RESULT_AVAIL_IRQ,
+        .intPriority = ~0,
+    }
+};
+
+/* Crypto configuration structure */
+const CryptoCC26XX_Config CryptoCC26XX_config[] = {
+    {
+        .object  = &cryptoCC26XXObjects[0],
+        .hwAttrs = &cryptoCC26XXHWAttrs[0]
+    },
+    {NULL, NULL}
+};
+
+/*
+ *  ========================== Crypto end ======================================
+ */
+
+/*
+ *  ========================== Watchdog begin ==================================
+ */
+/* Place into subsections to allow the TI linker to remove items properly */
+#if defined(__TI_COMPILER_VERSION__)
+#pragma DATA_SECTION(Watchdog_config, ".const:Watchdog_config")
+#pragma DATA_SECTION(watchdogCC26XXHWAttrs, ".const:watchdogCC26XXHWAttrs")
+#endif
+
+/* Include drivers */
+#include <ti/drivers/Watchdog.h>
+#include <ti/drivers/watchdog/WatchdogCC26XX.h>
+
+/* Watchdog objects */
+WatchdogCC26XX_Object watchdogCC26XXObjects[1];
+
+/* Watchdog hardware parameter structure, the reload value is in ms, the
+ * callback runs at the first timeout and the chip resets at the second */
+const WatchdogCC26XX_HWAttrs watchdogCC26XXHWAttrs[1] = {
+    {
+        .baseAddr    = WDT_BASE,
+        .intNum      = INT_WDT_IRQ,
+        .reloadValue = Board_WATCHDOG_RELOAD
+    }
+};
+
+/* Watchdog configuration structure */
+const Watchdog_Config Watchdog_config[] = {
+    {
+        .fxnTablePtr = &WatchdogCC26XX_fxnTable,
+        .object      = &watchdogCC26XXObjects[0],
+        .hwAttrs     = &watchdogCC26XXHWAttrs[0]
+    },
+    {NULL, NULL, NULL}
+};
+
+/*
+ *  ========================== Watchdog end ====================================
+ */
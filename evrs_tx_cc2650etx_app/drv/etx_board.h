@@ -66,4 +66,13 @@ extern const PIN_Config BoardGpioInitTable[];
 #define Board_ADCVCC		1
 #define Board_BAT       	IOID_8
 
+/* Crypto, the AES engine */
+#define Board_CRYPTO		0
+
+/* Watchdog, timeout in ms */
+#define Board_WATCHDOG		0
+#ifndef Board_WATCHDOG_RELOAD
+#define Board_WATCHDOG_RELOAD	10000
+#endif
+
 #endif /* ETXBOARD_H */
@@ -35,7 +35,7 @@ void Board_Display_Print(uintptr_t fmt,	uintptr_t a0, uintptr_t a1, uintptr_t a2
 #define uout4(fmt, a0, a1, a2, a3) \
     Board_Display_Print((uintptr_t)(fmt), (uintptr_t)(a0), (uintptr_t)(a1), (uintptr_t)(a2), (uintptr_t)(a3), 0)
 
-#define uout4(fmt, a0, a1, a2, a3, a4) \
-    Board_Display_Print((uintptr_t)(fmt), (uintptr_t)(a0), (uintptr_t)(a1), (uintptr_t)(a2), (uintptr_t)(a3), (uintptr_t)(a4)
+#define uout5(fmt, a0, a1, a2, a3, a4) \
+    Board_Display_Print((uintptr_t)(fmt), (uintptr_t)(a0), (uintptr_t)(a1), (uintptr_t)(a2), (uintptr_t)(a3), (uintptr_t)(a4))
 
 #endif
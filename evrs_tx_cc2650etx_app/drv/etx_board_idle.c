@@ -0,0 +1,97 @@
+/****************************************
+ *
+ * @filename 	etx_board_idle.c
+ *
+ * @project 	evrs_tx_cc2650etx_app
+ *
+ * @brief 		Idle time of the CPU
+ *
+ * @date 		18 Oct. 2026
+ *
+ * @author		Ziyi@outlook.com.au
+ *
+ ****************************************/
+
+#include "etx_board_idle.h"
+
+#include <xdc/std.h>
+#include <xdc/runtime/Timestamp.h>
+
+#include <ti/sysbios/hal/Hwi.h>
+#include <ti/drivers/Power.h>
+#include <ti/drivers/power/PowerCC26XX.h>
+
+static int Board_Idle_CB_power(unsigned int eventType, uintptr_t eventArg,
+		uintptr_t clientArg);
+
+// Application callback
+static idleCB_t idleCB = NULL;
+static Power_NotifyObj idleNotifyObj;
+
+// Idle period in progress, it ends at the first wake seen
+static uint32_t idleBegin = 0;
+static uint32_t idleEnd = 0;
+static uint8_t isIdle = 0;
+static uint8_t isWoken = 0;
+
+// Standby in progress
+static uint32_t standbyBegin = 0;
+
+/** runs in the idle task, in place of PowerCC26XX_standbyPolicy **/
+void Board_Idle_policy(void) {
+	uint32_t begin, end;
+	UInt key;
+
+	key = Hwi_disable();
+	idleBegin = Timestamp_get32();
+	isIdle = 1;
+	isWoken = 0;
+	Hwi_restore(key);
+
+	PowerCC26XX_standbyPolicy();
+
+	key = Hwi_disable();
+	begin = idleBegin;
+	end = isWoken ? idleEnd : Timestamp_get32();
+	isIdle = 0;
+	Hwi_restore(key);
+
+	if (idleCB != NULL)
+		idleCB(BOARD_IDLE_CPU, begin, end);
+}
+
+void Board_Idle_init(idleCB_t appIdleCB) {
+	Power_registerNotify(&idleNotifyObj,
+			PowerCC26XX_ENTERING_STANDBY | PowerCC26XX_AWAKE_STANDBY,
+			(Power_NotifyFxn) Board_Idle_CB_power, 0);
+	idleCB = appIdleCB;
+}
+
+/** the first wake ends the idle period **/
+void Board_Idle_wake(void) {
+	UInt key = Hwi_disable();
+
+	if (isIdle && !isWoken) {
+		idleEnd = Timestamp_get32();
+		isWoken = 1;
+	}
+	Hwi_restore(key);
+}
+
+/** standby entry and exit, interrupts are disabled **/
+static int Board_Idle_CB_power(unsigned int eventType, uintptr_t eventArg,
+		uintptr_t clientArg) {
+	if (eventType == PowerCC26XX_ENTERING_STANDBY) {
+		standbyBegin = Timestamp_get32();
+	} else {
+		uint32_t now = Timestamp_get32();
+
+		if (isIdle && !isWoken) {
+			idleEnd = now;
+			isWoken = 1;
+		}
+		if (idleCB != NULL)
+			idleCB(BOARD_IDLE_STANDBY, standbyBegin, now);
+	}
+	return Power_NOTIFYDONE;
+}
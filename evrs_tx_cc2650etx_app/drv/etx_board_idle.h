@@ -0,0 +1,47 @@
+/****************************************
+ *
+ * @filename 	etx_board_idle.h
+ *
+ * @project 	evrs_tx_cc2650etx_app
+ *
+ * @brief 		Idle time of the CPU, measured by the power policy which
+ * 				the idle task runs
+ *
+ * @date 		18 Oct. 2026
+ *
+ * @author		Ziyi@outlook.com.au
+ *
+ ****************************************/
+
+#ifndef ETXBOARDIDLE_H
+#define ETXBOARDIDLE_H
+
+#include <stdint.h>
+
+/* Idle periods reported, times are Timestamp counts */
+#define BOARD_IDLE_CPU			0x00	// in the power policy, asleep or not
+#define BOARD_IDLE_STANDBY		0x01	// in standby, part of a BOARD_IDLE_CPU
+
+/* Called from the idle task, or from the power manager with interrupts
+ * disabled for BOARD_IDLE_STANDBY */
+typedef void (*idleCB_t)(uint8_t type, uint32_t begin, uint32_t end);
+
+/*
+ * The power policy, .policyFxn of PowerCC26XX_config. It runs
+ * PowerCC26XX_standbyPolicy and reports the time spent in it.
+ */
+void Board_Idle_policy(void);
+
+/*
+ * Start reporting idle periods.
+ */
+void Board_Idle_init(idleCB_t appIdleCB);
+
+/*
+ * The CPU is busy. The standby policy enables interrupts before it returns,
+ * so the tasks they wake run inside it; call early in a task woken from
+ * idle to end the idle period there.
+ */
+void Board_Idle_wake(void);
+
+#endif
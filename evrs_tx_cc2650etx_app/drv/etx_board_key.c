@@ -60,10 +60,15 @@
 #endif
 
 #include <inc/hw_ints.h>
+#include <inc/hw_types.h>
+#include <inc/hw_memmap.h>
+#include <inc/hw_gpio.h>
+#include <driverlib/sys_ctrl.h>
 
 #include "util.h"
 #include "etx_board_key.h"
 #include "etx_board.h"
+#include "etx_board_trace.h"
 
 /*********************************************************************
  * TYPEDEFS
@@ -86,6 +91,32 @@ static void Board_keyCallback(PIN_Handle hPin, PIN_Id pinId);
 // Value of keys Pressed
 static uint8_t keysPressed;
 
+// Key which woke the device up from shutdown, 0 if none
+static uint8_t wakeKey = 0;
+
+// Clock tick of the edge which started the debounce
+static uint32_t keyPressTick = 0;
+
+// DIO to key code mapping, used to decode the wakeup source. In the order
+// Board_keyCallback ranks keys pressed together, the highest first
+static const struct {
+    uint8_t dio;
+    uint8_t key;
+} keyDioMap[] =
+{
+    { Board_KEY11, KEY_PWR },
+    { Board_KEY10, KEY_OK },
+    { Board_KEY1,  KEY1 },
+    { Board_KEY2,  KEY2 },
+    { Board_KEY3,  KEY3 },
+    { Board_KEY4,  KEY4 },
+    { Board_KEY5,  KEY5 },
+    { Board_KEY6,  KEY6 },
+    { Board_KEY7,  KEY7 },
+    { Board_KEY8,  KEY8 },
+    { Board_KEY9,  KEY9 }
+};
+
 // Key debounce clock
 static Clock_Struct keyChangeClock;
 
@@ -148,16 +179,16 @@ void Board_initKeys(keysPressedCB_t appKeyCB)
 
 #ifdef POWER_SAVING
   //Enable wakeup
-    PIN_setConfig(hKeyPins, PINCC26XX_BM_WAKEUP, Board_KEY1  | PINCC26XX_NO_WAKEUP);
-    PIN_setConfig(hKeyPins, PINCC26XX_BM_WAKEUP, Board_KEY2  | PINCC26XX_NO_WAKEUP);
-    PIN_setConfig(hKeyPins, PINCC26XX_BM_WAKEUP, Board_KEY3  | PINCC26XX_NO_WAKEUP);
-    PIN_setConfig(hKeyPins, PINCC26XX_BM_WAKEUP, Board_KEY4  | PINCC26XX_NO_WAKEUP);
-    PIN_setConfig(hKeyPins, PINCC26XX_BM_WAKEUP, Board_KEY5  | PINCC26XX_NO_WAKEUP);
-    PIN_setConfig(hKeyPins, PINCC26XX_BM_WAKEUP, Board_KEY6  | PINCC26XX_NO_WAKEUP);
-    PIN_setConfig(hKeyPins, PINCC26XX_BM_WAKEUP, Board_KEY7  | PINCC26XX_NO_WAKEUP);
-    PIN_setConfig(hKeyPins, PINCC26XX_BM_WAKEUP, Board_KEY8  | PINCC26XX_NO_WAKEUP);
-    PIN_setConfig(hKeyPins, PINCC26XX_BM_WAKEUP, Board_KEY9  | PINCC26XX_NO_WAKEUP);
-    PIN_setConfig(hKeyPins, PINCC26XX_BM_WAKEUP, Board_KEY10 | PINCC26XX_NO_WAKEUP);
+    PIN_setConfig(hKeyPins, PINCC26XX_BM_WAKEUP, Board_KEY1  | PINCC26XX_WAKEUP_NEGEDGE);
+    PIN_setConfig(hKeyPins, PINCC26XX_BM_WAKEUP, Board_KEY2  | PINCC26XX_WAKEUP_NEGEDGE);
+    PIN_setConfig(hKeyPins, PINCC26XX_BM_WAKEUP, Board_KEY3  | PINCC26XX_WAKEUP_NEGEDGE);
+    PIN_setConfig(hKeyPins, PINCC26XX_BM_WAKEUP, Board_KEY4  | PINCC26XX_WAKEUP_NEGEDGE);
+    PIN_setConfig(hKeyPins, PINCC26XX_BM_WAKEUP, Board_KEY5  | PINCC26XX_WAKEUP_NEGEDGE);
+    PIN_setConfig(hKeyPins, PINCC26XX_BM_WAKEUP, Board_KEY6  | PINCC26XX_WAKEUP_NEGEDGE);
+    PIN_setConfig(hKeyPins, PINCC26XX_BM_WAKEUP, Board_KEY7  | PINCC26XX_WAKEUP_NEGEDGE);
+    PIN_setConfig(hKeyPins, PINCC26XX_BM_WAKEUP, Board_KEY8  | PINCC26XX_WAKEUP_NEGEDGE);
+    PIN_setConfig(hKeyPins, PINCC26XX_BM_WAKEUP, Board_KEY9  | PINCC26XX_WAKEUP_NEGEDGE);
+    PIN_setConfig(hKeyPins, PINCC26XX_BM_WAKEUP, Board_KEY10 | PINCC26XX_WAKEUP_NEGEDGE);
     PIN_setConfig(hKeyPins, PINCC26XX_BM_WAKEUP, Board_KEY11 | PINCC26XX_WAKEUP_NEGEDGE);
 #endif //POWER_SAVING
 
@@ -169,6 +200,57 @@ void Board_initKeys(keysPressedCB_t appKeyCB)
     appKeyChangeHandler = appKeyCB;
 }
 
+/*********************************************************************
+ * @fn      Board_captureWakeKey
+ *
+ * @brief   Latch the key which woke the device from shutdown. The wakeup
+ *          edge is left in the GPIO event flags, which PIN_init() clears,
+ *          so this must be called before PIN_init(). Keys pressed together
+ *          all leave a flag, the one the key ISR would report is taken.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void Board_captureWakeKey(void)
+{
+    uint32_t evFlags;
+    uint8_t i;
+
+    wakeKey = 0;
+    if (SysCtrlResetSourceGet() != RSTSRC_WAKEUP_FROM_SHUTDOWN)
+        return;
+
+    evFlags = HWREG(GPIO_BASE + GPIO_O_EVFLAGS31_0);
+    for (i = 0; i < sizeof(keyDioMap) / sizeof(keyDioMap[0]); i++)
+    {
+        if (evFlags & (1 << keyDioMap[i].dio))
+        {
+            wakeKey = keyDioMap[i].key;
+            break;
+        }
+    }
+}
+
+/*********************************************************************
+ * @fn      Board_getWakeKey
+ *
+ * @brief   Get the key latched by Board_captureWakeKey().
+ *
+ * @param   none
+ *
+ * @return  key code, 0 if the device was not woken up by a key
+ */
+uint8_t Board_getWakeKey(void)
+{
+    return wakeKey;
+}
+
+uint32_t Board_getKeyTick(void)
+{
+    return keyPressTick;
+}
+
 /*********************************************************************
  * @fn      Board_keyCallback
  *
@@ -181,6 +263,8 @@ void Board_initKeys(keysPressedCB_t appKeyCB)
 //#include "board_key.h"
 static void Board_keyCallback(PIN_Handle hPin, PIN_Id pinId)
 {
+    utrace(BOARD_TRACE_KEY_ISR, pinId);
+
     keysPressed = 0;
 
     if ( PIN_getInputValue(Board_KEY9) == 0 )
@@ -206,6 +290,10 @@ static void Board_keyCallback(PIN_Handle hPin, PIN_Id pinId)
     if ( PIN_getInputValue(Board_KEY11) == 0 )
     		keysPressed = KEY_PWR;
 
+    // bounces of the same press keep the first edge
+    if (!Util_isActive(&keyChangeClock))
+        keyPressTick = Clock_getTicks();
+
     Util_startClock(&keyChangeClock);
 }
 
@@ -220,6 +308,8 @@ static void Board_keyCallback(PIN_Handle hPin, PIN_Id pinId)
  */
 static void Board_keyChangeHandler(UArg a0)
 {
+  utrace(BOARD_TRACE_KEY, keysPressed);
+
   if (appKeyChangeHandler != NULL)
   {
     // Notify the application
@@ -103,6 +103,35 @@ typedef void (*keysPressedCB_t)(uint8_t keysPressed);
  */
 void Board_initKeys(keysPressedCB_t appKeyCB);
 
+/*********************************************************************
+ * @fn      Board_captureWakeKey
+ *
+ * @brief   Latch the key which woke the device from shutdown.
+ *          Must be called before PIN_init().
+ *
+ * @return  none
+ */
+void Board_captureWakeKey(void);
+
+/*********************************************************************
+ * @fn      Board_getWakeKey
+ *
+ * @brief   Get the key which woke the device from shutdown.
+ *
+ * @return  key code, 0 if the device was not woken up by a key
+ */
+uint8_t Board_getWakeKey(void);
+
+/*********************************************************************
+ * @fn      Board_getKeyTick
+ *
+ * @brief   Get the time the last key was pressed, the key is reported
+ *          to the application after the debounce timeout.
+ *
+ * @return  Clock tick of the key press
+ */
+uint32_t Board_getKeyTick(void);
+
 /*********************************************************************
 *********************************************************************/
 
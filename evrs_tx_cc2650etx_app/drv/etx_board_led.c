@@ -23,6 +23,7 @@
 #include "util.h"
 #include "etx_board_led.h"
 #include "etx_board.h"
+#include "etx_board_trace.h"
 
 /*********************************************************************
  * Typedefs
@@ -105,6 +106,8 @@ void Board_initLEDs(void) {
  */
 void Board_ledControl(BoardLedID_t ledID, BoardLedState_t state,
 		uint32_t period) {
+	utrace(BOARD_TRACE_LED, (state << 8) | ledID);
+
 	switch (state) {
 		case BOARD_LED_STATE_OFF:
 			PIN_setOutputValue(ledPinHandle, IDPARSER(ledID), 0);
@@ -156,6 +159,7 @@ void Board_ledControl(BoardLedID_t ledID, BoardLedState_t state,
 static void Board_ledFlashTimeoutCB(UArg ledID) {
 	ledID = (BoardLedID_t) ledID;
 	uint8_t currState = 0;
+	utrace(BOARD_TRACE_LED_FLASH, ledID);
 	currState = PIN_getOutputValue(IDPARSER(ledID));
 	PIN_setOutputValue(ledPinHandle, IDPARSER(ledID), !currState);
 
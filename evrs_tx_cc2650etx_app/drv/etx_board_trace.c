@@ -0,0 +1,125 @@
+/****************************************
+ *
+ * @filename 	etx_board_trace.c
+ *
+ * @project 	evrs_tx_cc2650etx_app
+ *
+ * @brief 		A binary event trace in RAM, built only with ETX_TRACE
+ * 				defined
+ *
+ * @date 		18 Oct. 2026
+ *
+ * @author		Ziyi@outlook.com.au
+ *
+ ****************************************/
+
+#include "etx_board_trace.h"
+
+#ifdef ETX_TRACE
+
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/hal/Hwi.h>
+#include <ti/sysbios/knl/Clock.h>
+
+#include "etx_board_display.h"
+
+// Trace record, 8 bytes
+typedef struct BoardTraceRec_t {
+	uint32_t tick;			// Clock ticks
+	uint8_t thread;			// BOARD_TRACE_HWI, _SWI, _TASK or a task added
+	uint8_t id;
+	uint16_t arg;
+} BoardTraceRec_t;
+
+// Trace ring
+static BoardTraceRec_t traceRing[BOARD_TRACE_DEPTH];
+static uint16_t traceIdx = 0;
+static uint16_t traceCount = 0;
+static uint8_t isTraceFrozen = 0;
+
+// Tasks told apart in the records
+static Task_Handle traceTasks[BOARD_TRACE_TASKS];
+static uint8_t numTraceTasks = 0;
+
+/** record an event, short enough to be called from a Hwi **/
+void Board_Trace_record(uint8_t id, uint16_t arg) {
+	BoardTraceRec_t *pRec;
+	uint8_t thread;
+	uint8_t i;
+	UInt key;
+
+	switch (BIOS_getThreadType()) {
+		case BIOS_ThreadType_Hwi:
+			thread = BOARD_TRACE_HWI;
+		break;
+
+		case BIOS_ThreadType_Swi:
+			thread = BOARD_TRACE_SWI;
+		break;
+
+		default: {
+			Task_Handle self = Task_self();
+
+			thread = BOARD_TRACE_TASK;
+			for (i = 0; i < numTraceTasks; i++) {
+				if (traceTasks[i] == self) {
+					thread = BOARD_TRACE_TASK + 1 + i;
+					break;
+				}
+			}
+		}
+		break;
+	}
+
+	key = Hwi_disable();
+	if (!isTraceFrozen) {
+		pRec = &traceRing[traceIdx];
+		pRec->tick = Clock_getTicks();
+		pRec->thread = thread;
+		pRec->id = id;
+		pRec->arg = arg;
+		if (++traceIdx >= BOARD_TRACE_DEPTH)
+			traceIdx = 0;
+		if (traceCount < BOARD_TRACE_DEPTH)
+			traceCount++;
+	}
+	Hwi_restore(key);
+}
+
+/** tell the records of a task apart from the others **/
+void Board_Trace_addTask(Task_Handle task) {
+	if (numTraceTasks < BOARD_TRACE_TASKS)
+		traceTasks[numTraceTasks++] = task;
+}
+
+/** print the records, oldest first, and start over **/
+void Board_Trace_dump(void) {
+	uint16_t i;
+	uint16_t idx;
+	UInt key;
+
+	// the printing itself is not traced
+	key = Hwi_disable();
+	isTraceFrozen = 1;
+	idx = (traceIdx + BOARD_TRACE_DEPTH - traceCount) % BOARD_TRACE_DEPTH;
+	Hwi_restore(key);
+
+	uout2("trace %d records, tick %dus", traceCount, Clock_tickPeriod);
+	for (i = 0; i < traceCount; i++) {
+		BoardTraceRec_t *pRec = &traceRing[idx];
+
+		uout4("T %08x %02x %02x %04x", pRec->tick, pRec->thread, pRec->id,
+				pRec->arg);
+		if (++idx >= BOARD_TRACE_DEPTH)
+			idx = 0;
+	}
+	uout0("trace end");
+
+	key = Hwi_disable();
+	traceIdx = 0;
+	traceCount = 0;
+	isTraceFrozen = 0;
+	Hwi_restore(key);
+}
+
+#endif // ETX_TRACE
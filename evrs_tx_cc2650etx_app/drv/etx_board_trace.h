@@ -0,0 +1,82 @@
+/****************************************
+ *
+ * @filename 	etx_board_trace.h
+ *
+ * @project 	evrs_tx_cc2650etx_app
+ *
+ * @brief 		A binary event trace in RAM, built only with ETX_TRACE
+ * 				defined, dumped over UART and turned into a Chrome trace
+ * 				by tools/etx_trace2json.py
+ *
+ * @date 		18 Oct. 2026
+ *
+ * @author		Ziyi@outlook.com.au
+ *
+ ****************************************/
+
+#ifndef ETXBOARDTRACE_H
+#define ETXBOARDTRACE_H
+
+#include <stdint.h>
+
+#include <ti/sysbios/knl/Task.h>
+
+/* Records kept, the oldest are overwritten, 8 bytes each */
+#ifndef BOARD_TRACE_DEPTH
+#define BOARD_TRACE_DEPTH		128
+#endif
+
+/* Thread of a record, registered tasks follow in the order they were added */
+#define BOARD_TRACE_HWI			0x00
+#define BOARD_TRACE_SWI			0x01
+#define BOARD_TRACE_TASK		0x02	// a task which wasn't added
+#define BOARD_TRACE_TASKS		4		// tasks which can be added
+
+/* Trace IDs, a message begins with its ID and ends with BOARD_TRACE_END */
+#define BOARD_TRACE_WAKE		0x01	// ICall_wait returned
+#define BOARD_TRACE_STACK_EVT	0x02	// BLE stack event, arg is the flags
+#define BOARD_TRACE_STACK_MSG	0x03	// BLE stack message, arg is the event
+#define BOARD_TRACE_APP_MSG		0x04	// app message, arg is state << 8 | event
+#define BOARD_TRACE_END			0x05	// end of the message
+#define BOARD_TRACE_KEY_ISR		0x10	// key edge, arg is the pin
+#define BOARD_TRACE_KEY			0x11	// debounced keys, arg is the keys
+#define BOARD_TRACE_LED			0x20	// LED control, arg is state << 8 | LED
+#define BOARD_TRACE_LED_FLASH	0x21	// LED flash toggle, arg is the LED
+#define BOARD_TRACE_ADV			0x30	// advertising enabled, arg is the
+										// interval (625us), bit 15 for high
+										// duty cycle directed
+#define BOARD_TRACE_CONN		0x31	// link up, arg is handle << 12 |
+										// interval (1.25ms), 0 interval for
+										// the link released
+#define BOARD_TRACE_SCAN		0x32	// beacon scan, arg is the duration, ms
+#define BOARD_TRACE_ADC			0x33	// ADC sample, arg is the channel
+#define BOARD_TRACE_LOAD		0x34	// a second of CPU load, arg is
+										// load % << 8 | standby %
+#define BOARD_TRACE_VOTE		0x40	// vote advertised, arg is
+										// question << 8 | seq
+#define BOARD_TRACE_QUESTION	0x41	// arg is question << 8 | open
+
+#ifdef ETX_TRACE
+
+void Board_Trace_record(uint8_t id, uint16_t arg);
+void Board_Trace_addTask(Task_Handle task);
+void Board_Trace_dump(void);
+
+#define utrace(id, arg) \
+    Board_Trace_record((uint8_t)(id), (uint16_t)(arg))
+
+#define utraceTask(task) \
+    Board_Trace_addTask(task)
+
+#define utraceDump() \
+    Board_Trace_dump()
+
+#else
+
+#define utrace(id, arg)
+#define utraceTask(task)
+#define utraceDump()
+
+#endif // ETX_TRACE
+
+#endif
@@ -0,0 +1,147 @@
+/*****************************************************************************
+ *
+ * @filepath    /evrs_tx_cc2650etx_app/src/etx_aes.c
+ *
+ * @project     evrs_tx_cc2650etx_app
+ *
+ * @brief       AES-128 encryption of one block in software, FIPS-197. Only
+ *              the forward cipher, CMAC doesn't need the inverse.
+ *
+ * @date        18 Oct. 2026
+ *
+ * @author      Ziyi@outlook.com.au
+ *
+ ****************************************************************************/
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <string.h>
+
+#include "etx_aes.h"
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static const uint8_t sbox[256] = {
+	0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5,
+	0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+	0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0,
+	0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+	0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc,
+	0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+	0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a,
+	0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+	0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0,
+	0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+	0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b,
+	0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+	0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85,
+	0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+	0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5,
+	0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+	0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17,
+	0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+	0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88,
+	0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+	0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c,
+	0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+	0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9,
+	0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+	0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6,
+	0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+	0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e,
+	0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+	0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94,
+	0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+	0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68,
+	0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/** multiply by x in GF(2^8) **/
+static uint8_t ETX_Aes_xtime(uint8_t b) {
+	return (uint8_t) ((b << 1) ^ ((b & 0x80) ? 0x1b : 0x00));
+}
+
+/*****************************************************************************
+ * @TAG Cipher
+ */
+/** key schedule of AES-128, the round keys follow the key **/
+void ETX_Aes_init(EtxAes_t *pAes, const uint8_t *pKey) {
+	uint8_t *pRk = pAes->roundKey;
+	uint8_t rcon = 0x01;
+	uint8_t i;
+
+	memcpy(pRk, pKey, 16);
+	for (i = 16; i < sizeof(pAes->roundKey); i += 4) {
+		uint8_t t[4];
+
+		memcpy(t, &pRk[i - 4], 4);
+		if ((i % 16) == 0) {
+			uint8_t t0 = t[0];
+
+			t[0] = sbox[t[1]] ^ rcon;
+			t[1] = sbox[t[2]];
+			t[2] = sbox[t[3]];
+			t[3] = sbox[t0];
+			rcon = ETX_Aes_xtime(rcon);
+		}
+		pRk[i] = pRk[i - 16] ^ t[0];
+		pRk[i + 1] = pRk[i - 15] ^ t[1];
+		pRk[i + 2] = pRk[i - 14] ^ t[2];
+		pRk[i + 3] = pRk[i - 13] ^ t[3];
+	}
+}
+
+/*********************************************************************
+ * @fn      ETX_Aes_encrypt
+ *
+ * @brief   Encrypt one block. The state is kept column by column, as the
+ *          bytes come in.
+ *
+ * @param   pAes - expanded key, EtxAes_t
+ * @param   pIn - 16 bytes of plain text
+ * @param   pOut - 16 bytes of cipher text
+ *
+ * @return  true, it doesn't fail
+ */
+bool ETX_Aes_encrypt(void *pAes, const uint8_t *pIn, uint8_t *pOut) {
+	const uint8_t *pRk = ((const EtxAes_t *) pAes)->roundKey;
+	uint8_t s[16];
+	uint8_t round, i;
+
+	for (i = 0; i < 16; i++)
+		s[i] = pIn[i] ^ pRk[i];
+
+	for (round = 1; round <= ETX_AES_ROUNDS; round++) {
+		uint8_t t[16];
+
+		// SubBytes and ShiftRows, row r moves r columns left
+		for (i = 0; i < 16; i++)
+			t[i] = sbox[s[(i + 4 * (i % 4)) % 16]];
+
+		// MixColumns, all but the last round
+		if (round < ETX_AES_ROUNDS) {
+			for (i = 0; i < 16; i += 4) {
+				uint8_t all = t[i] ^ t[i + 1] ^ t[i + 2] ^ t[i + 3];
+				uint8_t t0 = t[i];
+
+				t[i] ^= all ^ ETX_Aes_xtime(t[i] ^ t[i + 1]);
+				t[i + 1] ^= all ^ ETX_Aes_xtime(t[i + 1] ^ t[i + 2]);
+				t[i + 2] ^= all ^ ETX_Aes_xtime(t[i + 2] ^ t[i + 3]);
+				t[i + 3] ^= all ^ ETX_Aes_xtime(t[i + 3] ^ t0);
+			}
+		}
+
+		for (i = 0; i < 16; i++)
+			s[i] = t[i] ^ pRk[16 * round + i];
+	}
+
+	memcpy(pOut, s, 16);
+	return true;
+}
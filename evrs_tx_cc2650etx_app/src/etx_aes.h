@@ -0,0 +1,67 @@
+/*****************************************************************************
+ *
+ * @filepath    /evrs_tx_cc2650etx_app/src/etx_aes.h
+ *
+ * @project     evrs_tx_cc2650etx_app
+ *
+ * @brief       AES-128 encryption of one block in software. The ETX runs
+ *              the cipher on the AES engine of the CC2650, see
+ *              ETX_Crypto_aes in evrs_tx_main.c. This one is plain C, so
+ *              the host tools make and check the beacon tags with the
+ *              same etx_proto.c, see tools/etx_link
+ *
+ * @date        18 Oct. 2026
+ *
+ * @author      Ziyi@outlook.com.au
+ *
+ ****************************************************************************/
+
+#ifndef ETXAES_H
+#define ETXAES_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define ETX_AES_ROUNDS				10
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// Expanded key
+typedef struct EtxAes_t {
+	uint8_t roundKey[(ETX_AES_ROUNDS + 1) * 16];
+} EtxAes_t;
+
+/*********************************************************************
+ * FUNCTIONS
+ */
+
+/*
+ * Expand a 16 byte key.
+ */
+extern void ETX_Aes_init(EtxAes_t *pAes, const uint8_t *pKey);
+
+/*
+ * Encrypt one 16 byte block, pIn and pOut may be the same. pAes is an
+ * EtxAes_t, the arguments are those of EtxProtoAes_t in etx_proto.h.
+ */
+extern bool ETX_Aes_encrypt(void *pAes, const uint8_t *pIn, uint8_t *pOut);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ETXAES_H */
@@ -0,0 +1,258 @@
+/*****************************************************************************
+ *
+ * @filepath    /evrs_tx_cc2650etx_app/src/etx_capture.c
+ *
+ * @project     evrs_tx_cc2650etx_app
+ *
+ * @brief       capture of the messages handled by the app task, called
+ *              from the app task only
+ *
+ * @date        18 Oct. 2026
+ *
+ * @author      Ziyi@outlook.com.au
+ *
+ ****************************************************************************/
+
+#include "etx_capture.h"
+
+#ifdef ETX_CAPTURE
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <string.h>
+
+#include <xdc/runtime/Timestamp.h>
+#include <xdc/runtime/Types.h>
+
+#include <icall.h>
+#include "hci_tl.h"
+#include "gatt.h"
+#include "gap.h"
+
+#include "etx_board_display.h"
+#include "etx_diag.h"
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+// Records, a ring of bytes
+static uint8_t captureBuf[ETX_CAPTURE_SIZE];
+static uint16_t captureHead = 0;		// oldest record
+static uint16_t captureUsed = 0;
+static uint16_t captureCount = 0;
+static uint16_t captureDropped = 0;
+
+// Record of the message being handled, until ETX_Capture_end
+static uint16_t capturePos = 0;
+static uint32_t captureStart = 0;
+static uint8_t isCaptureOpen = 0;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static void ETX_Capture_put(uint16_t pos, const uint8_t *pBuf, uint8_t len);
+static uint8_t ETX_Capture_get(uint16_t pos);
+static void ETX_Capture_record(uint8_t msgClass, uint8_t event,
+		uint8_t status, const uint8_t *pSummary, uint8_t len);
+
+/*****************************************************************************
+ * @TAG Capture
+ */
+/** stack event flags **/
+void ETX_Capture_stackEvt(uint32_t flags) {
+	uint8_t summary[4];
+
+	summary[0] = (uint8_t) flags;
+	summary[1] = (uint8_t) (flags >> 8);
+	summary[2] = (uint8_t) (flags >> 16);
+	summary[3] = (uint8_t) (flags >> 24);
+	ETX_Capture_record(ETX_DIAG_MSG_STACK_EVT, 0, 0, summary,
+			sizeof(summary));
+}
+
+/*********************************************************************
+ * @fn      ETX_Capture_stackMsg
+ *
+ * @brief   Capture a BLE stack message with what its handler looks at,
+ *          the report data of a scan, the connection and method of GATT.
+ *
+ * @param   pMsg - message, an ICall_Hdr first
+ *
+ * @return  none
+ */
+void ETX_Capture_stackMsg(const void *pMsg) {
+	const ICall_Hdr *pHdr = (const ICall_Hdr *) pMsg;
+	uint8_t summary[ETX_CAPTURE_SUMMARY_LEN];
+	uint8_t len = 0;
+
+	switch (pHdr->event) {
+		case GATT_MSG_EVENT: {
+			const gattMsgEvent_t *pGatt = (const gattMsgEvent_t *) pMsg;
+
+			summary[0] = LO_UINT16(pGatt->connHandle);
+			summary[1] = HI_UINT16(pGatt->connHandle);
+			summary[2] = pGatt->method;
+			memcpy(&summary[3], &pGatt->msg, ETX_CAPTURE_GATT_MSG_LEN);
+			len = 3 + ETX_CAPTURE_GATT_MSG_LEN;
+		}
+		break;
+
+		case GAP_MSG_EVENT: {
+			const gapEventHdr_t *pGap = (const gapEventHdr_t *) pMsg;
+
+			summary[len++] = pGap->opcode;
+			if (pGap->opcode == GAP_DEVICE_INFO_EVENT) {
+				const gapDeviceInfoEvent_t *pInfo =
+						(const gapDeviceInfoEvent_t *) pMsg;
+				uint8_t dataLen = pInfo->dataLen;
+
+				if (dataLen > ETX_CAPTURE_SUMMARY_LEN - 11)
+					dataLen = ETX_CAPTURE_SUMMARY_LEN - 11;
+				summary[len++] = pInfo->eventType;
+				summary[len++] = pInfo->addrType;
+				memcpy(&summary[len], pInfo->addr, B_ADDR_LEN);
+				len += B_ADDR_LEN;
+				summary[len++] = (uint8_t) pInfo->rssi;
+				summary[len++] = dataLen;
+				memcpy(&summary[len], pInfo->pEvtData, dataLen);
+				len += dataLen;
+			}
+		}
+		break;
+
+		default:
+			// the header tells everything of the others
+		break;
+	}
+
+	ETX_Capture_record(ETX_DIAG_MSG_STACK, pHdr->event, pHdr->status, summary,
+			len);
+}
+
+/** app message, the state goes in the status **/
+void ETX_Capture_appMsg(uint8_t event, uint8_t state, uint16_t connHandle) {
+	uint8_t summary[2];
+
+	summary[0] = LO_UINT16(connHandle);
+	summary[1] = HI_UINT16(connHandle);
+	ETX_Capture_record(ETX_DIAG_MSG_APP, event, state, summary,
+			sizeof(summary));
+}
+
+/** the message is handled, fill in the duration of its record **/
+void ETX_Capture_end(void) {
+	uint32_t duration = Timestamp_get32() - captureStart;
+	uint8_t buf[4];
+
+	if (!isCaptureOpen)
+		return;
+	buf[0] = (uint8_t) duration;
+	buf[1] = (uint8_t) (duration >> 8);
+	buf[2] = (uint8_t) (duration >> 16);
+	buf[3] = (uint8_t) (duration >> 24);
+	ETX_Capture_put(capturePos + 8, buf, sizeof(buf));
+	isCaptureOpen = 0;
+}
+
+/*********************************************************************
+ * @fn      ETX_Capture_dump
+ *
+ * @brief   Print the records over UART, oldest first, and start over.
+ *          Every record is a line of C [time][duration]
+ *          [class, event, status][summary], in hex.
+ *
+ * @return  none
+ */
+void ETX_Capture_dump(void) {
+	Types_FreqHz freq;
+	char hex[2 * ETX_CAPTURE_SUMMARY_LEN + 1];
+	uint16_t pos = captureHead;
+	uint16_t i;
+
+	Timestamp_getFreq(&freq);
+	uout3("capture %d records, %d dropped, freq %d", captureCount,
+			captureDropped, freq.lo);
+	for (i = 0; i < captureCount; i++) {
+		uint8_t len = ETX_Capture_get(pos);
+		uint32_t time = 0, duration = 0;
+		uint8_t j;
+
+		for (j = 0; j < 4; j++) {
+			time |= (uint32_t) ETX_Capture_get(pos + 4 + j) << (8 * j);
+			duration |= (uint32_t) ETX_Capture_get(pos + 8 + j) << (8 * j);
+		}
+		for (j = 0; j < len - ETX_CAPTURE_HDR_LEN; j++) {
+			uint8_t byte = ETX_Capture_get(pos + ETX_CAPTURE_HDR_LEN + j);
+			hex[2 * j] = "0123456789abcdef"[byte >> 4];
+			hex[2 * j + 1] = "0123456789abcdef"[byte & 0x0F];
+		}
+		hex[2 * j] = '\0';
+
+		uout4("C %08x %08x %06x %s", time, duration,
+				((uint32_t) ETX_Capture_get(pos + 1) << 16)
+						| (ETX_Capture_get(pos + 2) << 8)
+						| ETX_Capture_get(pos + 3), hex);
+		pos = (pos + len) % ETX_CAPTURE_SIZE;
+	}
+	uout0("capture end");
+
+	// the message which asked for the dump is not captured
+	captureHead = 0;
+	captureUsed = 0;
+	captureCount = 0;
+	captureDropped = 0;
+	isCaptureOpen = 0;
+}
+
+/*****************************************************************************
+ * @TAG Ring
+ */
+/** start the record of a message, drop the oldest records to make room **/
+static void ETX_Capture_record(uint8_t msgClass, uint8_t event,
+		uint8_t status, const uint8_t *pSummary, uint8_t len) {
+	uint8_t hdr[ETX_CAPTURE_HDR_LEN];
+	uint8_t recLen = ETX_CAPTURE_HDR_LEN + len;
+
+	while (ETX_CAPTURE_SIZE - captureUsed < recLen) {
+		uint8_t oldLen = ETX_Capture_get(captureHead);
+
+		captureHead = (captureHead + oldLen) % ETX_CAPTURE_SIZE;
+		captureUsed -= oldLen;
+		captureCount--;
+		captureDropped++;
+	}
+
+	captureStart = Timestamp_get32();
+	hdr[0] = recLen;
+	hdr[1] = msgClass;
+	hdr[2] = event;
+	hdr[3] = status;
+	hdr[4] = (uint8_t) captureStart;
+	hdr[5] = (uint8_t) (captureStart >> 8);
+	hdr[6] = (uint8_t) (captureStart >> 16);
+	hdr[7] = (uint8_t) (captureStart >> 24);
+	memset(&hdr[8], 0, 4);
+
+	capturePos = (captureHead + captureUsed) % ETX_CAPTURE_SIZE;
+	ETX_Capture_put(capturePos, hdr, sizeof(hdr));
+	ETX_Capture_put(capturePos + ETX_CAPTURE_HDR_LEN, pSummary, len);
+	captureUsed += recLen;
+	captureCount++;
+	isCaptureOpen = 1;
+}
+
+static void ETX_Capture_put(uint16_t pos, const uint8_t *pBuf, uint8_t len) {
+	while (len--) {
+		captureBuf[pos % ETX_CAPTURE_SIZE] = *pBuf++;
+		pos++;
+	}
+}
+
+static uint8_t ETX_Capture_get(uint16_t pos) {
+	return captureBuf[pos % ETX_CAPTURE_SIZE];
+}
+
+#endif // ETX_CAPTURE
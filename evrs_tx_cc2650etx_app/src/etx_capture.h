@@ -0,0 +1,99 @@
+/*****************************************************************************
+ *
+ * @filepath    /evrs_tx_cc2650etx_app/src/etx_capture.h
+ *
+ * @project     evrs_tx_cc2650etx_app
+ *
+ * @brief       capture of the messages handled by the app task, built only
+ *              with ETX_CAPTURE defined, dumped over UART with the
+ *              diagnostics and replayed on a host by tools/etx_replay
+ *
+ * @date        18 Oct. 2026
+ *
+ * @author      Ziyi@outlook.com.au
+ *
+ ****************************************************************************/
+
+#ifndef ETXCAPTURE_H
+#define ETXCAPTURE_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Bytes kept, the oldest records are dropped to make room
+#ifndef ETX_CAPTURE_SIZE
+#define ETX_CAPTURE_SIZE			2048
+#endif
+
+// Record, [len][class][event][status][time, 4 bytes][duration, 4 bytes]
+// [summary...], times in Timestamp counts. The class is one of
+// ETX_DIAG_MSG_, the event and status are those of the message header,
+// the state for an app message
+#define ETX_CAPTURE_HDR_LEN			12
+#define ETX_CAPTURE_SUMMARY_LEN		42
+
+// Summary of a message
+// stack event: [event flags, 4 bytes]
+// GATT: [connHandle, 2 bytes][method][first 8 bytes of the message]
+// GAP: [opcode] and for GAP_DEVICE_INFO_EVENT [event type][address type]
+// [address, 6 bytes][rssi][data length][data...]
+// app message: [connHandle, 2 bytes]
+#define ETX_CAPTURE_GATT_MSG_LEN	8
+
+/*********************************************************************
+ * FUNCTIONS
+ */
+
+#ifdef ETX_CAPTURE
+
+void ETX_Capture_stackEvt(uint32_t flags);
+void ETX_Capture_stackMsg(const void *pMsg);
+void ETX_Capture_appMsg(uint8_t event, uint8_t state, uint16_t connHandle);
+void ETX_Capture_end(void);
+void ETX_Capture_dump(void);
+
+#define ucaptureEvt(flags) \
+    ETX_Capture_stackEvt((uint32_t)(flags))
+
+#define ucaptureMsg(pMsg) \
+    ETX_Capture_stackMsg(pMsg)
+
+#define ucaptureApp(event, state, connHandle) \
+    ETX_Capture_appMsg((uint8_t)(event), (uint8_t)(state), \
+            (uint16_t)(connHandle))
+
+#define ucaptureEnd() \
+    ETX_Capture_end()
+
+#define ucaptureDump() \
+    ETX_Capture_dump()
+
+#else
+
+#define ucaptureEvt(flags)
+#define ucaptureMsg(pMsg)
+#define ucaptureApp(event, state, connHandle)
+#define ucaptureEnd()
+#define ucaptureDump()
+
+#endif // ETX_CAPTURE
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ETXCAPTURE_H */
@@ -0,0 +1,651 @@
+/*****************************************************************************
+ *
+ * @filepath    /evrs_tx_cc2650etx_app/src/etx_diag.c
+ *
+ * @project     evrs_tx_cc2650etx_app
+ *
+ * @brief       diagnostics of the ETX firmware
+ *
+ * @date        18 Oct. 2026
+ *
+ * @author      Ziyi@outlook.com.au
+ *
+ ****************************************************************************/
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stddef.h>
+#include <string.h>
+
+#include <ti/sysbios/hal/Hwi.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/knl/Task.h>
+#include <xdc/runtime/Timestamp.h>
+#include <xdc/runtime/Types.h>
+
+#include <inc/hw_types.h>
+#include <inc/hw_memmap.h>
+#include <inc/hw_cpu_scs.h>
+#include <driverlib/sys_ctrl.h>
+
+#include <ti/drivers/Watchdog.h>
+
+#include <icall.h>
+#include "osal_snv.h"
+
+#include "etx_board.h"
+#include "etx_board_display.h"
+#include "etx_board_idle.h"
+#include "etx_board_trace.h"
+#include "etx_diag.h"
+#include "etx_load.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Same fill as TI-RTOS uses for task stacks
+#define ETX_DIAG_STACK_FILL			0xBE
+
+// Bytes below the live stack pointer left alone while painting
+#define ETX_DIAG_STACK_MARGIN		32
+
+// Marks a crash record in RAM as valid
+#define ETX_DIAG_CRASH_MAGIC		0x45435258
+
+// Active exception number in ICSR
+#define ETX_DIAG_VECTACTIVE			0x1FF
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// Monitored task stack
+typedef struct EtxDiagStack_t {
+	uint8_t *pBase;			// lowest address, stacks grow down to it
+	uint16_t size;
+	uint16_t used;			// high-water mark
+} EtxDiagStack_t;
+
+// ICall heap usage
+typedef struct EtxDiagHeap_t {
+	uint32_t memAlo;		// bytes allocated
+	uint32_t memMax;		// peak bytes allocated
+	uint32_t memUB;			// upper bound of the used heap
+	uint32_t blkCnt;		// blocks in use
+	uint32_t blkFree;		// free blocks
+	uint32_t blkMax;		// peak blocks in use
+} EtxDiagHeap_t;
+
+// Crash record, fields are aligned so there is no padding
+typedef struct EtxDiagCrash_t {
+	uint32_t magic;
+	uint8_t source;			// ETX_DIAG_CRASH_*
+	uint8_t cause;
+	uint8_t subcause;
+	uint8_t count;			// crashes since the record was cleared
+	uint8_t appState;
+	uint8_t gapState;
+	uint8_t events[2 * ETX_DIAG_EVENTS];	// event, state, oldest first
+	uint32_t pc;
+	uint32_t lr;
+	uint32_t cfsr;			// configurable fault status
+	uint32_t hfsr;			// hard fault status
+	uint32_t mmfar;			// memory manage fault address
+	uint32_t bfar;			// bus fault address
+	uint32_t ticks;			// uptime
+	uint32_t task;			// running task
+	uint32_t check;			// FNV-1a of the fields above
+} EtxDiagCrash_t;
+
+// App task loop supervision
+typedef struct EtxDiagLoop_t {
+	uint8_t msgClass;		// message being handled, ETX_DIAG_MSG_*
+	uint8_t event;
+	uint32_t beginTick;
+	uint16_t overCount;		// messages over budget
+	uint8_t overClass;		// the last one over budget
+	uint8_t overEvent;
+	uint8_t worstClass;		// the slowest one
+	uint8_t worstEvent;
+	uint32_t worstTicks;
+} EtxDiagLoop_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+// Latency histograms, in RAM only
+static uint16_t latHist[ETX_DIAG_LAT_STAGES][ETX_DIAG_LAT_BUCKETS];
+
+// Monitored stacks
+static EtxDiagStack_t stacks[ETX_DIAG_STACKS];
+static uint8_t numStacks = 0;
+
+// Latest heap usage
+static EtxDiagHeap_t heap = { 0 };
+
+// Latest app events and states
+static uint8_t events[2 * ETX_DIAG_EVENTS];
+static uint8_t eventIdx = 0;
+static uint8_t appState = 0;
+static uint8_t gapState = 0;
+
+// Crash record, left alone by the startup code so it survives the reset
+#if defined(__TI_COMPILER_VERSION__)
+#pragma NOINIT(crashRec)
+static EtxDiagCrash_t crashRec;
+#elif defined(__GNUC__)
+static EtxDiagCrash_t crashRec __attribute__((section(".noinit")));
+#else
+static EtxDiagCrash_t crashRec;
+#endif
+
+// Watchdog and app task loop supervision
+static Watchdog_Handle watchdog = NULL;
+static EtxDiagLoop_t loop = { 0 };
+
+// CPU load, updated from the idle task
+static EtxLoad_t load;
+static uint8_t isLoadOpen = 0;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static void ETX_Diag_CB_watchdog(uintptr_t handle);
+static void ETX_Diag_CB_idle(uint8_t type, uint32_t begin, uint32_t end);
+
+static uint32_t ETX_Diag_check(const EtxDiagCrash_t *pRec);
+static void ETX_Diag_putWord(uint8_t *pBuf, uint32_t word);
+
+/*****************************************************************************
+ * @TAG Latency histograms
+ */
+/** count a latency into its log2 bucket, counters saturate **/
+void ETX_Diag_latency(uint8_t stage, uint32_t fromTick, uint32_t toTick) {
+	uint32_t ticks = toTick - fromTick;
+	uint8_t bucket = 0;
+
+	if (stage >= ETX_DIAG_LAT_STAGES)
+		return;
+
+	while ((ticks >>= 1) && (bucket < ETX_DIAG_LAT_BUCKETS - 1))
+		bucket++;
+	if (latHist[stage][bucket] != 0xFFFF)
+		latHist[stage][bucket]++;
+}
+
+/*****************************************************************************
+ * @TAG Stack and heap monitor
+ */
+/*********************************************************************
+ * @fn      ETX_Diag_addStack
+ *
+ * @brief   Paint a task stack from its base up to the stack pointer. The
+ *          task switch is held off so the task can't run into the paint,
+ *          interrupts run on the system stack and don't touch it. For
+ *          the calling task the live stack pointer is used, for others
+ *          the one saved at their last switch.
+ *
+ * @param   task - task of the stack
+ *
+ * @return  none
+ */
+void ETX_Diag_addStack(Task_Handle task) {
+	Task_Stat stat;
+	EtxDiagStack_t *pStack;
+	uint8_t *pTop;
+	uint8_t *p;
+	UInt key;
+
+	if ((task == NULL) || (numStacks >= ETX_DIAG_STACKS))
+		return;
+
+	key = Task_disable();
+	Task_stat(task, &stat);
+	pTop = (task == Task_self()) ? (uint8_t *) &stat : (uint8_t *) stat.sp;
+	pTop -= ETX_DIAG_STACK_MARGIN;
+
+	// a plain loop, a call would push its frame below the live pointer
+	for (p = (uint8_t *) stat.stack; p < pTop; p++)
+		*p = ETX_DIAG_STACK_FILL;
+	Task_restore(key);
+
+	pStack = &stacks[numStacks++];
+	pStack->pBase = (uint8_t *) stat.stack;
+	pStack->size = stat.stackSize;
+	pStack->used = 0;
+}
+
+/** update the high-water marks **/
+void ETX_Diag_monitor(void) {
+	uint8_t i;
+
+	for (i = 0; i < numStacks; i++) {
+		EtxDiagStack_t *pStack = &stacks[i];
+		uint16_t untouched = 0;
+
+		while ((untouched < pStack->size)
+				&& (pStack->pBase[untouched] == ETX_DIAG_STACK_FILL))
+			untouched++;
+		if (pStack->size - untouched > pStack->used) {
+			pStack->used = pStack->size - untouched;
+			uout3("stack %d peak: %d of %d", i, pStack->used, pStack->size);
+		}
+	}
+
+#ifdef HEAPMGR_METRICS
+	{
+		uint32_t memMax = heap.memMax;
+
+		ICall_getHeapMgrGetMetrics(&heap.blkMax, &heap.blkCnt, &heap.blkFree,
+				&heap.memAlo, &heap.memMax, &heap.memUB);
+		if (heap.memMax > memMax)
+			uout3("heap peak: %d, ub %d, blocks %d", heap.memMax, heap.memUB,
+					heap.blkMax);
+	}
+#endif // HEAPMGR_METRICS
+}
+
+/*****************************************************************************
+ * @TAG Crash record
+ */
+/** remember an app event **/
+void ETX_Diag_event(uint8_t event, uint8_t state) {
+	events[eventIdx++] = event;
+	events[eventIdx++] = state;
+	if (eventIdx >= sizeof(events))
+		eventIdx = 0;
+}
+
+void ETX_Diag_setAppState(uint8_t state) {
+	appState = state;
+}
+
+void ETX_Diag_setGapState(uint8_t state) {
+	gapState = state;
+}
+
+/*********************************************************************
+ * @fn      ETX_Diag_crash
+ *
+ * @brief   Fill the crash record and reset. Nothing here may depend on
+ *          the state of the kernel or the BLE stack, the record is moved
+ *          into SNV by ETX_Diag_recover after the reset.
+ *
+ * @param   source - ETX_DIAG_CRASH_*
+ * @param   cause, subcause - of the assert or the fault
+ * @param   pc, lr - where it happened, 0 if not known
+ *
+ * @return  none, it doesn't return
+ */
+void ETX_Diag_crash(uint8_t source, uint8_t cause, uint8_t subcause,
+		uint32_t pc, uint32_t lr) {
+	uint8_t i;
+
+	Hwi_disable();
+
+	crashRec.source = source;
+	crashRec.cause = cause;
+	crashRec.subcause = subcause;
+	crashRec.appState = appState;
+	crashRec.gapState = gapState;
+	for (i = 0; i < sizeof(events); i++)
+		crashRec.events[i] = events[(eventIdx + i) % sizeof(events)];
+	crashRec.pc = pc;
+	crashRec.lr = lr;
+	crashRec.cfsr = HWREG(CPU_SCS_BASE + CPU_SCS_O_CFSR);
+	crashRec.hfsr = HWREG(CPU_SCS_BASE + CPU_SCS_O_HFSR);
+	crashRec.mmfar = HWREG(CPU_SCS_BASE + CPU_SCS_O_MMFAR);
+	crashRec.bfar = HWREG(CPU_SCS_BASE + CPU_SCS_O_BFAR);
+	crashRec.ticks = Clock_getTicks();
+	crashRec.task = (uint32_t) Task_self();
+	crashRec.count = 0;
+	crashRec.magic = ETX_DIAG_CRASH_MAGIC;
+	crashRec.check = ETX_Diag_check(&crashRec);
+
+	SysCtrlSystemReset();
+	for (;;)
+		;
+}
+
+/** exception frame is r4-r11 then r0-r3, r12, lr, pc, xpsr **/
+void ETX_Diag_fault(UInt *excStack, UInt lr) {
+	uint16_t exc = HWREG(CPU_SCS_BASE + CPU_SCS_O_ICSR) & ETX_DIAG_VECTACTIVE;
+
+	ETX_Diag_crash(ETX_DIAG_CRASH_FAULT, (uint8_t) exc, 0, excStack[14],
+			excStack[13]);
+}
+
+/** move a crash record from RAM into SNV, keep a count of them **/
+void ETX_Diag_recover(void) {
+	EtxDiagCrash_t lastRec;
+
+	// a watchdog reset which found the interrupts off leaves no record,
+	// it shows up as a warm reset
+	uout1("reset source: %d", SysCtrlResetSourceGet());
+
+	if ((crashRec.magic != ETX_DIAG_CRASH_MAGIC)
+			|| (crashRec.check != ETX_Diag_check(&crashRec)))
+		return;
+
+	if ((osal_snv_read(ETX_DIAG_CRASH_NV_ID, sizeof(lastRec),
+			(uint8 *) &lastRec) == SUCCESS)
+			&& (lastRec.magic == ETX_DIAG_CRASH_MAGIC))
+		crashRec.count = (lastRec.count < 0xFF) ? lastRec.count + 1 : 0xFF;
+	else
+		crashRec.count = 1;
+	crashRec.check = ETX_Diag_check(&crashRec);
+
+	uout4("crash %d: source %d, cause 0x%02x, pc 0x%08x", crashRec.count,
+			crashRec.source, crashRec.cause, crashRec.pc);
+	if (osal_snv_write(ETX_DIAG_CRASH_NV_ID, sizeof(crashRec),
+			(uint8 *) &crashRec) != SUCCESS)
+		uout0("Crash record not saved");
+
+	// handled, don't save it again on the next reset
+	crashRec.magic = 0;
+}
+
+/*****************************************************************************
+ * @TAG Watchdog
+ */
+/*********************************************************************
+ * @fn      ETX_Diag_watchdogOpen
+ *
+ * @brief   Start the watchdog. Its callback runs when the app task hasn't
+ *          kicked it for Board_WATCHDOG_RELOAD ms and records the message
+ *          the loop is stuck in, the hardware resets one period later if
+ *          the callback can't run. The watchdog halts in standby, so an
+ *          idle device needs no kicks and the task kicks it on each wake.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void ETX_Diag_watchdogOpen(void) {
+	Watchdog_Params params;
+
+	Watchdog_init();
+	Watchdog_Params_init(&params);
+	params.callbackFxn = ETX_Diag_CB_watchdog;
+	params.resetMode = Watchdog_RESET_ON;
+	params.debugStallMode = Watchdog_DEBUG_STALL_ON;
+	watchdog = Watchdog_open(Board_WATCHDOG, &params);
+	if (watchdog == NULL)
+		uout0("Watchdog not opened");
+}
+
+/** the app task is alive **/
+void ETX_Diag_kick(void) {
+	if (watchdog != NULL)
+		Watchdog_clear(watchdog);
+}
+
+/** a message is about to be handled **/
+void ETX_Diag_loopBegin(uint8_t msgClass, uint8_t event) {
+	Board_Idle_wake();
+	loop.msgClass = msgClass;
+	loop.event = event;
+	loop.beginTick = Clock_getTicks();
+}
+
+/** the message is handled, hold its time against the budget **/
+void ETX_Diag_loopEnd(void) {
+	uint32_t ticks = Clock_getTicks() - loop.beginTick;
+
+	if (ticks > loop.worstTicks) {
+		loop.worstTicks = ticks;
+		loop.worstClass = loop.msgClass;
+		loop.worstEvent = loop.event;
+	}
+	if (ticks > (ETX_DIAG_LOOP_BUDGET * 1000) / Clock_tickPeriod) {
+		if (loop.overCount < 0xFFFF)
+			loop.overCount++;
+		loop.overClass = loop.msgClass;
+		loop.overEvent = loop.event;
+		uout3("over budget: class %d, event 0x%02x, %d ticks", loop.msgClass,
+				loop.event, ticks);
+	}
+	loop.msgClass = ETX_DIAG_MSG_NONE;
+}
+
+/** the app task missed its kicks, record where it is stuck **/
+static void ETX_Diag_CB_watchdog(uintptr_t handle) {
+	ETX_Diag_crash(ETX_DIAG_CRASH_WATCHDOG, loop.msgClass, loop.event,
+			Clock_getTicks() - loop.beginTick, 0);
+}
+
+/*****************************************************************************
+ * @TAG CPU load
+ */
+/** count the idle time against the Timestamp counter **/
+void ETX_Diag_loadOpen(void) {
+	Types_FreqHz freq;
+
+	Timestamp_getFreq(&freq);
+	ETX_Load_init(&load, freq.lo, Timestamp_get32());
+	isLoadOpen = 1;
+	Board_Idle_init(ETX_Diag_CB_idle);
+}
+
+/** an idle period, from the idle task or the power manager **/
+static void ETX_Diag_CB_idle(uint8_t type, uint32_t begin, uint32_t end) {
+	UInt key = Hwi_disable();
+	uint8_t slot = load.slot;
+
+	if (type == BOARD_IDLE_STANDBY)
+		ETX_Load_standby(&load, begin, end);
+	else
+		ETX_Load_idle(&load, begin, end);
+
+	// a second is complete, trace it for tools/etx_energy
+	if (load.slot != slot) {
+		uint16_t standby;
+		uint16_t cpuLoad = ETX_Load_lastSecond(&load, &standby);
+
+		utrace(BOARD_TRACE_LOAD, ((cpuLoad / 10) << 8) | (standby / 10));
+	}
+	Hwi_restore(key);
+}
+
+/** FNV-1a of the record, the check itself excluded **/
+static uint32_t ETX_Diag_check(const EtxDiagCrash_t *pRec) {
+	const uint8_t *p = (const uint8_t *) pRec;
+	uint32_t hash = 2166136261u;
+	uint8_t i;
+
+	for (i = 0; i < offsetof(EtxDiagCrash_t, check); i++) {
+		hash ^= p[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static void ETX_Diag_putWord(uint8_t *pBuf, uint32_t word) {
+	pBuf[0] = (uint8_t) word;
+	pBuf[1] = (uint8_t) (word >> 8);
+	pBuf[2] = (uint8_t) (word >> 16);
+	pBuf[3] = (uint8_t) (word >> 24);
+}
+
+/*****************************************************************************
+ * @TAG Pages
+ */
+/** fill a diagnostics page, return its length **/
+uint8_t ETX_Diag_getPage(uint8_t page, uint8_t *pBuf) {
+	uint8_t len = 0;
+	uint8_t i;
+
+	pBuf[len++] = page;
+	if (page < ETX_DIAG_PAGE_LAT + ETX_DIAG_LAT_STAGES) {
+		uint8_t stage = page - ETX_DIAG_PAGE_LAT;
+
+		pBuf[len++] = stage;
+		pBuf[len++] = (uint8_t) Clock_tickPeriod;
+		pBuf[len++] = (uint8_t) (Clock_tickPeriod >> 8);
+		for (i = 0; i < ETX_DIAG_LAT_BUCKETS; i++) {
+			pBuf[len++] = (uint8_t) latHist[stage][i];
+			pBuf[len++] = (uint8_t) (latHist[stage][i] >> 8);
+		}
+		return len;
+	}
+
+	if (page == ETX_DIAG_PAGE_MEM) {
+		uint32_t heapVal[6];
+
+		ETX_Diag_monitor();
+		pBuf[len++] = numStacks;
+		for (i = 0; i < numStacks; i++) {
+			pBuf[len++] = (uint8_t) stacks[i].size;
+			pBuf[len++] = (uint8_t) (stacks[i].size >> 8);
+			pBuf[len++] = (uint8_t) stacks[i].used;
+			pBuf[len++] = (uint8_t) (stacks[i].used >> 8);
+		}
+		heapVal[0] = heap.memAlo;
+		heapVal[1] = heap.memMax;
+		heapVal[2] = heap.memUB;
+		heapVal[3] = heap.blkCnt;
+		heapVal[4] = heap.blkFree;
+		heapVal[5] = heap.blkMax;
+		for (i = 0; i < 6; i++) {
+			pBuf[len++] = (uint8_t) heapVal[i];
+			pBuf[len++] = (uint8_t) (heapVal[i] >> 8);
+		}
+		return len;
+	}
+
+	if (page == ETX_DIAG_PAGE_LOOP) {
+		pBuf[len++] = (uint8_t) ETX_DIAG_LOOP_BUDGET;
+		pBuf[len++] = (uint8_t) (ETX_DIAG_LOOP_BUDGET >> 8);
+		pBuf[len++] = (uint8_t) loop.overCount;
+		pBuf[len++] = (uint8_t) (loop.overCount >> 8);
+		pBuf[len++] = loop.worstClass;
+		pBuf[len++] = loop.worstEvent;
+		ETX_Diag_putWord(&pBuf[len], loop.worstTicks);
+		len += 4;
+		pBuf[len++] = loop.overClass;
+		pBuf[len++] = loop.overEvent;
+		return len;
+	}
+
+	if (page == ETX_DIAG_PAGE_LOAD) {
+		EtxLoadStats_t stats = { 0 };
+		UInt key;
+
+		if (isLoadOpen) {
+			key = Hwi_disable();
+			ETX_Load_get(&load, Timestamp_get32(), &stats);
+			Hwi_restore(key);
+		}
+		pBuf[len++] = (uint8_t) stats.load1s;
+		pBuf[len++] = (uint8_t) (stats.load1s >> 8);
+		pBuf[len++] = (uint8_t) stats.load10s;
+		pBuf[len++] = (uint8_t) (stats.load10s >> 8);
+		pBuf[len++] = (uint8_t) stats.peak;
+		pBuf[len++] = (uint8_t) (stats.peak >> 8);
+		pBuf[len++] = (uint8_t) stats.standbyCount;
+		pBuf[len++] = (uint8_t) (stats.standbyCount >> 8);
+		ETX_Diag_putWord(&pBuf[len], stats.standbyAvg);
+		len += 4;
+		return len;
+	}
+
+	if (page == ETX_DIAG_PAGE_CRASH) {
+		EtxDiagCrash_t rec;
+		uint32_t words[8];
+
+		if ((osal_snv_read(ETX_DIAG_CRASH_NV_ID, sizeof(rec),
+				(uint8 *) &rec) != SUCCESS)
+				|| (rec.magic != ETX_DIAG_CRASH_MAGIC))
+			return len;
+
+		pBuf[len++] = rec.source;
+		pBuf[len++] = rec.cause;
+		pBuf[len++] = rec.subcause;
+		pBuf[len++] = rec.count;
+		pBuf[len++] = rec.appState;
+		pBuf[len++] = rec.gapState;
+		memcpy(&pBuf[len], rec.events, sizeof(rec.events));
+		len += sizeof(rec.events);
+
+		words[0] = rec.pc;
+		words[1] = rec.lr;
+		words[2] = rec.cfsr;
+		words[3] = rec.hfsr;
+		words[4] = rec.mmfar;
+		words[5] = rec.bfar;
+		words[6] = rec.ticks;
+		words[7] = rec.task;
+		for (i = 0; i < 8; i++, len += 4)
+			ETX_Diag_putWord(&pBuf[len], words[i]);
+		ETX_Diag_putWord(&pBuf[len], rec.check);
+		len += 4;
+		return len;
+	}
+
+	return 0;
+}
+
+/** clear the diagnostics **/
+void ETX_Diag_reset(void) {
+	EtxDiagCrash_t rec;
+
+	memset(latHist, 0, sizeof(latHist));
+	loop.overCount = 0;
+	loop.worstTicks = 0;
+	if (isLoadOpen) {
+		UInt key = Hwi_disable();
+
+		ETX_Load_resetPeak(&load);
+		Hwi_restore(key);
+	}
+
+	memset(&rec, 0, sizeof(rec));
+	osal_snv_write(ETX_DIAG_CRASH_NV_ID, sizeof(rec), (uint8 *) &rec);
+}
+
+/** print the diagnostics over UART **/
+void ETX_Diag_dump(void) {
+	uint8_t stage, i;
+
+	ETX_Diag_monitor();
+	for (i = 0; i < numStacks; i++)
+		uout3("stack %d: %d of %d", i, stacks[i].used, stacks[i].size);
+	uout4("heap: %d, peak %d, ub %d, blocks %d", heap.memAlo, heap.memMax,
+			heap.memUB, heap.blkCnt);
+
+	{
+		uint8_t page[ETX_DIAG_PAGE_LEN];
+		uint8_t *pPc = &page[7 + 2 * ETX_DIAG_EVENTS];	// after the events
+
+		if (ETX_Diag_getPage(ETX_DIAG_PAGE_CRASH, page) > 1)
+			uout4("last crash: source %d, cause 0x%02x, count %d, pc 0x%08x",
+					page[1], page[2], page[4], pPc[0] | (pPc[1] << 8)
+							| (pPc[2] << 16) | ((uint32_t) pPc[3] << 24));
+	}
+
+	uout4("loop: %d over budget, worst class %d, event 0x%02x, %d ticks",
+			loop.overCount, loop.worstClass, loop.worstEvent, loop.worstTicks);
+
+	{
+		uint8_t page[ETX_DIAG_PAGE_LEN];
+
+		ETX_Diag_getPage(ETX_DIAG_PAGE_LOAD, page);
+		uout5("load: %d 1s, %d 10s, peak %d permille, standby %d x %dus",
+				page[1] | (page[2] << 8), page[3] | (page[4] << 8),
+				page[5] | (page[6] << 8), page[7] | (page[8] << 8),
+				page[9] | (page[10] << 8) | (page[11] << 16)
+						| ((uint32_t) page[12] << 24));
+	}
+
+	uout1("Latency histograms, tick %dus", Clock_tickPeriod);
+	for (stage = 0; stage < ETX_DIAG_LAT_STAGES; stage++) {
+		for (i = 0; i < ETX_DIAG_LAT_BUCKETS; i++) {
+			if (latHist[stage][i] != 0)
+				uout3("lat %d, 2^%d ticks: %d", stage, i, latHist[stage][i]);
+		}
+	}
+}
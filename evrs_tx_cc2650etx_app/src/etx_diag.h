@@ -0,0 +1,201 @@
+/*****************************************************************************
+ *
+ * @filepath    /evrs_tx_cc2650etx_app/src/etx_diag.h
+ *
+ * @project     evrs_tx_cc2650etx_app
+ *
+ * @brief       diagnostics of the ETX firmware, read by the BS through the
+ *              diagnostics characteristic or dumped over UART, both decoded
+ *              on a host by tools/etx_diag
+ *
+ * @date        18 Oct. 2026
+ *
+ * @author      Ziyi@outlook.com.au
+ *
+ ****************************************************************************/
+
+#ifndef ETXDIAG_H
+#define ETXDIAG_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+#include <ti/sysbios/knl/Task.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Latency stages of a vote, from the key press to its collection
+#define ETX_DIAG_LAT_DEBOUNCE		0	// key ISR to end of debounce
+#define ETX_DIAG_LAT_DISPATCH		1	// end of debounce to ETX_EVT_keyPress
+#define ETX_DIAG_LAT_ADVERTISE		2	// KEY_OK handled to advertising
+#define ETX_DIAG_LAT_CONNECT		3	// advertising to BS connected
+#define ETX_DIAG_LAT_COLLECT		4	// BS connected to vote read
+#define ETX_DIAG_LAT_TOTAL			5	// key ISR to vote collected
+#define ETX_DIAG_LAT_STAGES			6
+
+// Histogram bucket n counts latencies of [2^n, 2^(n+1)) Clock ticks,
+// the last one counts everything above
+#define ETX_DIAG_LAT_BUCKETS		20
+
+// Number of task stacks which can be monitored
+#define ETX_DIAG_STACKS				3
+
+// Number of the latest app events kept for the crash record
+#define ETX_DIAG_EVENTS				5
+
+// SNV item of the last crash record, next to the IDs of evrs_tx_main.c
+#define ETX_DIAG_CRASH_NV_ID		0x82
+
+// Crash sources
+#define ETX_DIAG_CRASH_ASSERT		0x01	// BLE stack assert
+#define ETX_DIAG_CRASH_ERROR		0x02	// TI-RTOS error
+#define ETX_DIAG_CRASH_FAULT		0x03	// CPU fault, cause is the exception
+#define ETX_DIAG_CRASH_WATCHDOG		0x04	// app task stalled, cause and
+											// subcause are the message
+
+// Message classes handled by the app task loop
+#define ETX_DIAG_MSG_NONE			0x00	// waiting, not in a message
+#define ETX_DIAG_MSG_STACK_EVT		0x01	// BLE stack event flags
+#define ETX_DIAG_MSG_STACK			0x02	// BLE stack message, by its event
+#define ETX_DIAG_MSG_APP			0x03	// app message, by its event
+
+// Longest a message may take before it is counted as over budget (ms)
+#ifndef ETX_DIAG_LOOP_BUDGET
+#define ETX_DIAG_LOOP_BUDGET		20
+#endif
+
+// Crash record as read from the crash page, after the page id
+#define ETX_DIAG_CRASH_LEN			52
+
+// Diagnostics pages, [page][data...]
+// latency page n is [page][stage][tick period, us, 2 bytes][buckets, 2 bytes each]
+// memory page is [page][stacks][size, used, 2 bytes each, per stack]
+// [heap allocated][heap peak][heap upper bound][blocks][free blocks]
+// [peak blocks], 2 bytes each, the heap fields are 0 without HEAPMGR_METRICS
+// crash page is [page][source][cause][subcause][count][app state][gap state]
+// [event, state of the latest events, oldest first][pc][lr][CFSR][HFSR]
+// [MMFAR][BFAR][uptime, ticks][task][check], 4 bytes each, little endian,
+// it is only [page] if no crash was recorded. The check is the FNV-1a of
+// the record in NV, ETX_DIAG_CRASH_MAGIC first, up to the task
+// loop page is [page][budget, ms, 2 bytes][messages over budget, 2 bytes]
+// [worst class][worst event][worst, ticks, 4 bytes]
+// [last over budget class][last over budget event]
+// load page is [page][load of the last second][load of the last 10 s]
+// [peak load of a second], permille, 2 bytes each
+// [standby entries in the last 10 s, 2 bytes][average standby, us, 4 bytes]
+#define ETX_DIAG_PAGE_LAT			0x00	// up to 0x05, one per stage
+#define ETX_DIAG_PAGE_MEM			0x10
+#define ETX_DIAG_PAGE_LOOP			0x11
+#define ETX_DIAG_PAGE_LOAD			0x12
+#define ETX_DIAG_PAGE_CRASH			0x20
+#define ETX_DIAG_PAGE_RESET			0xFE	// write only, clear the diagnostics
+#define ETX_DIAG_PAGE_DUMP			0xFF	// write only, dump over UART
+
+// Size of the largest page
+#define ETX_DIAG_PAGE_LEN			(1 + ETX_DIAG_CRASH_LEN)
+#if ETX_DIAG_PAGE_LEN < 4 + 2 * ETX_DIAG_LAT_BUCKETS
+#error "ETX_DIAG_PAGE_LEN is too small for the latency pages"
+#endif
+#if ETX_DIAG_PAGE_LEN < 2 + 4 * ETX_DIAG_STACKS + 12
+#error "ETX_DIAG_PAGE_LEN is too small for the memory page"
+#endif
+
+/*********************************************************************
+ * FUNCTIONS
+ */
+
+/*
+ * Record a latency between two Clock ticks into the histogram of a stage.
+ */
+extern void ETX_Diag_latency(uint8_t stage, uint32_t fromTick,
+		uint32_t toTick);
+
+/*
+ * Paint the unused part of a task stack so its high-water mark can be
+ * found later. Call early, while the stack has seen little use.
+ */
+extern void ETX_Diag_addStack(Task_Handle task);
+
+/*
+ * Update the stack and heap high-water marks, log the ones which grew.
+ */
+extern void ETX_Diag_monitor(void);
+
+/*
+ * Remember an app event and the current states for the crash record.
+ */
+extern void ETX_Diag_event(uint8_t event, uint8_t state);
+extern void ETX_Diag_setAppState(uint8_t state);
+extern void ETX_Diag_setGapState(uint8_t state);
+
+/*
+ * Save the crash record in RAM which survives the reset, then reset.
+ * pc and lr are the stacked ones for a fault, where it was recorded and
+ * the return address of AssertHandler for an assert, the file and line for
+ * an error, the ticks the message ran for on a watchdog timeout, 0 where they
+ * are not known.
+ */
+extern void ETX_Diag_crash(uint8_t source, uint8_t cause, uint8_t subcause,
+		uint32_t pc, uint32_t lr);
+
+/*
+ * TI-RTOS exception handler, m3Hwi.excHandlerFunc in app_ble.cfg.
+ */
+extern void ETX_Diag_fault(UInt *excStack, UInt lr);
+
+/*
+ * Start the watchdog, the app task must kick it with ETX_Diag_kick.
+ */
+extern void ETX_Diag_watchdogOpen(void);
+extern void ETX_Diag_kick(void);
+
+/*
+ * Bracket the handling of a message in the app task loop, so its time is
+ * held against the budget and a stall in it can be told after the reset.
+ */
+extern void ETX_Diag_loopBegin(uint8_t msgClass, uint8_t event);
+extern void ETX_Diag_loopEnd(void);
+
+/*
+ * Start measuring the CPU load from the idle time.
+ */
+extern void ETX_Diag_loadOpen(void);
+
+/*
+ * Move a crash record left by the last reset into SNV. Call once from the
+ * app task, after ICall_registerApp.
+ */
+extern void ETX_Diag_recover(void);
+
+/*
+ * Fill a diagnostics page, return its length, 0 for an unknown page.
+ */
+extern uint8_t ETX_Diag_getPage(uint8_t page, uint8_t *pBuf);
+
+/*
+ * Clear the diagnostics.
+ */
+extern void ETX_Diag_reset(void);
+
+/*
+ * Print the diagnostics over UART.
+ */
+extern void ETX_Diag_dump(void);
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ETXDIAG_H */
@@ -29,6 +29,8 @@
 #include <inc/hw_memmap.h>
 #include <driverlib/vims.h>
 #include <evrs_tx_main.h>
+#include "etx_board_key.h"
+#include "etx_diag.h"
 
 #ifndef USE_DEFAULT_USER_CFG
 
@@ -39,8 +41,6 @@ bleUserCfg_t user0Cfg = BLE_USER_CFG;
 
 #endif // USE_DEFAULT_USER_CFG
 
-#include <ti/mw/display/Display.h>
-
 /*******************************************************************************
  * MACROS
  */
@@ -66,8 +66,7 @@ bleUserCfg_t user0Cfg = BLE_USER_CFG;
  */
 
 extern void AssertHandler(uint8 assertCause, uint8 assertSubcause);
-
-extern Display_Handle dispHandle;
+extern void ETX_assert(uint8 assertCause, uint8 assertSubcause, uint32_t lr);
 
 /*******************************************************************************
  * @fn          Main
@@ -89,6 +88,9 @@ int main()
   /* Register Application callback to trap asserts raised in the Stack */
   RegisterAssertCback(AssertHandler);
 
+  /* Latch the wakeup key before PIN_init clears the IO event flags */
+  Board_captureWakeKey();
+
   PIN_init(BoardGpioInitTable);
 
   // Enable iCache prefetching
@@ -158,58 +160,71 @@ int main()
  *
  * @return      None.
  */
+#if defined(__TI_COMPILER_VERSION__)
+// The compiler has no intrinsic for lr and may reuse it once a C body
+// starts, so AssertHandler only hands lr, the return address into whoever
+// raised the assert, to ETX_assert as its third argument.
+__asm("        .sect   \".text:AssertHandler\"\n"
+      "        .clink\n"
+      "        .thumbfunc AssertHandler\n"
+      "        .thumb\n"
+      "        .global AssertHandler\n"
+      "AssertHandler:\n"
+      "        mov     r2, lr\n"
+      "        b       ETX_assert\n");
+#else
 void AssertHandler(uint8 assertCause, uint8 assertSubcause)
 {
-  // Open the display if the app has not already done so
-  if ( !dispHandle )
-  {
-    dispHandle = Display_open(Display_Type_LCD, NULL);
-  }
+  ETX_assert(assertCause, assertSubcause,
+             (uint32_t) __builtin_return_address(0));
+}
+#endif
 
-  Display_print0(dispHandle, 0, 0, ">>>STACK ASSERT");
+/*******************************************************************************
+ * @fn          ETX_assert
+ *
+ * @brief       The body of AssertHandler.
+ *
+ * input parameters
+ *
+ * @param       assertCause    - Assert cause as defined in hal_assert.h.
+ * @param       assertSubcause - Optional assert subcause (see hal_assert.h).
+ * @param       lr             - Return address of AssertHandler.
+ *
+ * output parameters
+ *
+ * @param       None.
+ *
+ * @return      None.
+ */
+void ETX_assert(uint8 assertCause, uint8 assertSubcause, uint32_t lr)
+{
+  uint32_t pc;
 
-  // check the assert cause
-  switch (assertCause)
+  // the stack carries on after these, the allocation or the operation
+  // simply fails
+  if ((assertCause == HAL_ASSERT_CAUSE_OUT_OF_MEMORY) ||
+      (assertCause == HAL_ASSERT_CAUSE_INTERNAL_ERROR))
   {
-    case HAL_ASSERT_CAUSE_OUT_OF_MEMORY:
-      Display_print0(dispHandle, 0, 0, "***ERROR***");
-      Display_print0(dispHandle, 2, 0, ">> OUT OF MEMORY!");
-      break;
-
-    case HAL_ASSERT_CAUSE_INTERNAL_ERROR:
-      // check the subcause
-      if (assertSubcause == HAL_ASSERT_SUBCAUSE_FW_INERNAL_ERROR)
-      {
-        Display_print0(dispHandle, 0, 0, "***ERROR***");
-        Display_print0(dispHandle, 2, 0, ">> INTERNAL FW ERROR!");
-      }
-      else
-      {
-        Display_print0(dispHandle, 0, 0, "***ERROR***");
-        Display_print0(dispHandle, 2, 0, ">> INTERNAL ERROR!");
-      }
-      break;
-
-    case HAL_ASSERT_CAUSE_ICALL_ABORT:
-      Display_print0(dispHandle, 0, 0, "***ERROR***");
-      Display_print0(dispHandle, 2, 0, ">> ICALL ABORT!");
-      HAL_ASSERT_SPINLOCK;
-      break;
-
-    default:
-      Display_print0(dispHandle, 0, 0, "***ERROR***");
-      Display_print0(dispHandle, 2, 0, ">> DEFAULT SPINLOCK!");
-      HAL_ASSERT_SPINLOCK;
+    return;
   }
 
-  return;
+#if defined(__TI_COMPILER_VERSION__)
+  pc = (uint32_t) __curpc();
+#else
+  pc = 0;
+#endif
+
+  // anything else is fatal, record it and reset rather than spin
+  ETX_Diag_crash(ETX_DIAG_CRASH_ASSERT, assertCause, assertSubcause, pc, lr);
 }
 
 
 /*******************************************************************************
  * @fn          smallErrorHook
  *
- * @brief       Error handler to be hooked into TI-RTOS.
+ * @brief       Error.raiseHook in app_ble.cfg. Records the file and line
+ *              which raised the error and resets.
  *
  * input parameters
  *
@@ -223,7 +238,10 @@ void AssertHandler(uint8 assertCause, uint8 assertSubcause)
  */
 void smallErrorHook(Error_Block *eb)
 {
-  for (;;);
+  Types_Site *site = Error_getSite(eb);
+
+  ETX_Diag_crash(ETX_DIAG_CRASH_ERROR, 0, 0, (uint32_t) site->file,
+                 site->line);
 }
 
 /*******************************************************************************
@@ -0,0 +1,130 @@
+/*****************************************************************************
+ *
+ * @filepath    /evrs_tx_cc2650etx_app/src/etx_fsm.c
+ *
+ * @project     evrs_tx_cc2650etx_app
+ *
+ * @brief       the app state machine table
+ *
+ * @date        18 Oct. 2026
+ *
+ * @author      Ziyi@outlook.com.au
+ *
+ ****************************************************************************/
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stddef.h>
+
+#include "etx_fsm.h"
+
+/*********************************************************************
+ * MACROS
+ */
+
+#define ROW(guard, action, next) \
+	{ ETX_FSM_G_##guard, ETX_FSM_A_##action, next }
+
+#define CELL1(row0)			{ 1, { row0 } }
+#define CELL2(row0, row1)	{ 2, { row0, row1 } }
+#define CELL3(row0, row1, row2) \
+	{ 3, { row0, row1, row2 } }
+#define CELL4(row0, row1, row2, row3) \
+	{ 4, { row0, row1, row2, row3 } }
+
+/*********************************************************************
+ * GLOBAL VARIABLES
+ */
+
+// State x event, an event left out is ignored in the state
+const EtxFsmCell_t ETX_Fsm_table[APP_STATES][ETX_FSM_EVTS] = {
+	[APP_STATE_INIT] = {
+		[ETX_FSM_EVT_START] = CELL4(
+				ROW(SUBMITTED, NONE, APP_STATE_SUBMIT),
+				ROW(IN_QUIZ, NONE, APP_STATE_QUIZ),
+				ROW(RESUMED, NONE, APP_STATE_IDLE),
+				ROW(NONE, NONE, APP_STATE_INIT)),
+		[ETX_FSM_EVT_NUM] = CELL1(ROW(NONE, SET_BS, ETX_FSM_STAY)),
+		[ETX_FSM_EVT_OK] = CELL1(ROW(BS_SET, JOIN, APP_STATE_IDLE)),
+		[ETX_FSM_EVT_PWR] = CELL1(ROW(NONE, NONE, APP_STATE_SLEEP)),
+		[ETX_FSM_EVT_TIMEOUT] = CELL1(ROW(NONE, NONE, APP_STATE_SLEEP)),
+		[ETX_FSM_EVT_RESET] = CELL1(ROW(NONE, NONE, APP_STATE_INIT)),
+	},
+
+	// the base station decides when votes are taken
+	[APP_STATE_IDLE] = {
+		[ETX_FSM_EVT_NUM] = CELL2(
+				ROW(LOCKED, LOCKED, ETX_FSM_STAY),
+				ROW(ANSWER, ANSWER, ETX_FSM_STAY)),
+		[ETX_FSM_EVT_OK] = CELL2(
+				ROW(LOCKED, LOCKED, ETX_FSM_STAY),
+				ROW(ANSWERED, VOTE, APP_STATE_ACTIVE)),
+		[ETX_FSM_EVT_PWR] = CELL1(ROW(NONE, NONE, APP_STATE_SLEEP)),
+		[ETX_FSM_EVT_TIMEOUT] = CELL1(ROW(NONE, NONE, APP_STATE_SLEEP)),
+		[ETX_FSM_EVT_RESET] = CELL1(ROW(NONE, NONE, APP_STATE_INIT)),
+		[ETX_FSM_EVT_QUIZ] = CELL1(ROW(NONE, QUIZ_START, APP_STATE_QUIZ)),
+	},
+
+	// keys are ignored until the vote is collected
+	[APP_STATE_ACTIVE] = {
+		[ETX_FSM_EVT_PWR] = CELL1(ROW(NONE, NONE, APP_STATE_SLEEP)),
+		[ETX_FSM_EVT_TIMEOUT] = CELL1(ROW(NONE, NONE, APP_STATE_SLEEP)),
+		[ETX_FSM_EVT_RESET] = CELL1(ROW(NONE, NONE, APP_STATE_INIT)),
+		[ETX_FSM_EVT_COLLECTED] = CELL1(ROW(NONE, COLLECTED, APP_STATE_IDLE)),
+	},
+
+	// only left by a reset, it stays if the shutdown is refused and tries
+	// again on the retry timeout or KEY_PWR
+	[APP_STATE_SLEEP] = {
+		[ETX_FSM_EVT_PWR] = CELL1(ROW(NONE, NONE, APP_STATE_SLEEP)),
+		[ETX_FSM_EVT_TIMEOUT] = CELL1(ROW(NONE, NONE, APP_STATE_SLEEP)),
+		[ETX_FSM_EVT_RESET] = CELL1(ROW(NONE, NONE, APP_STATE_INIT)),
+	},
+
+	// KEY_OK steps through the questions, on the last one of a complete
+	// sheet it submits
+	[APP_STATE_QUIZ] = {
+		[ETX_FSM_EVT_NUM] = CELL2(
+				ROW(INPUT_LOCKED, LOCKED, ETX_FSM_STAY),
+				ROW(QUIZ_ANSWER, QUIZ_ANSWER, ETX_FSM_STAY)),
+		[ETX_FSM_EVT_OK] = CELL3(
+				ROW(INPUT_LOCKED, LOCKED, ETX_FSM_STAY),
+				ROW(QUIZ_DONE, QUIZ_SUBMIT, APP_STATE_SUBMIT),
+				ROW(NONE, QUIZ_NEXT, ETX_FSM_STAY)),
+		[ETX_FSM_EVT_PWR] = CELL1(ROW(NONE, NONE, APP_STATE_SLEEP)),
+		[ETX_FSM_EVT_TIMEOUT] = CELL1(ROW(NONE, NONE, APP_STATE_SLEEP)),
+		[ETX_FSM_EVT_RESET] = CELL1(ROW(NONE, NONE, APP_STATE_INIT)),
+		[ETX_FSM_EVT_QUIZ_END] = CELL1(ROW(NONE, QUIZ_END, APP_STATE_IDLE)),
+	},
+
+	// advertising until a BS reads the sheet and ends the quiz
+	[APP_STATE_SUBMIT] = {
+		[ETX_FSM_EVT_PWR] = CELL1(ROW(NONE, NONE, APP_STATE_SLEEP)),
+		[ETX_FSM_EVT_TIMEOUT] = CELL1(ROW(NONE, NONE, APP_STATE_SLEEP)),
+		[ETX_FSM_EVT_RESET] = CELL1(ROW(NONE, NONE, APP_STATE_INIT)),
+		[ETX_FSM_EVT_QUIZ_END] = CELL1(ROW(NONE, QUIZ_END, APP_STATE_IDLE)),
+	},
+};
+
+/*****************************************************************************
+ * @TAG Dispatch
+ */
+/** row taken for an event in a state, NULL if there is none **/
+const EtxFsmRow_t *ETX_Fsm_find(uint8_t state, uint8_t event,
+		uint8_t param, EtxFsmGuard_t pfnGuard) {
+	const EtxFsmCell_t *pCell;
+	uint8_t i;
+
+	if ((state >= APP_STATES) || (event >= ETX_FSM_EVTS))
+		return NULL;
+
+	pCell = &ETX_Fsm_table[state][event];
+	for (i = 0; i < pCell->numRows; i++) {
+		const EtxFsmRow_t *pRow = &pCell->rows[i];
+
+		if ((pRow->guard == ETX_FSM_G_NONE) || pfnGuard(pRow->guard, param))
+			return pRow;
+	}
+	return NULL;
+}
@@ -0,0 +1,138 @@
+/*****************************************************************************
+ *
+ * @filepath    /evrs_tx_cc2650etx_app/src/etx_fsm.h
+ *
+ * @project     evrs_tx_cc2650etx_app
+ *
+ * @brief       the app state machine as a table of state x event ->
+ *              guard, action and next state, in flash. The guards and
+ *              actions are IDs, evrs_tx_main.c runs them. Plain C with no
+ *              TI-RTOS or BLE stack dependency, so the table is checked on
+ *              a host, see tools/etx_fsm
+ *
+ * @date        18 Oct. 2026
+ *
+ * @author      Ziyi@outlook.com.au
+ *
+ ****************************************************************************/
+
+#ifndef ETXFSM_H
+#define ETXFSM_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Events, the param of a key event is the key
+#define ETX_FSM_EVT_START			0	// GAPRole started
+#define ETX_FSM_EVT_NUM				1	// number key
+#define ETX_FSM_EVT_OK				2	// KEY_OK
+#define ETX_FSM_EVT_PWR				3	// KEY_PWR
+#define ETX_FSM_EVT_TIMEOUT			4	// inactivity timeout
+#define ETX_FSM_EVT_RESET			5	// BS command ETXCMD_RESET_INIT
+#define ETX_FSM_EVT_COLLECTED		6	// vote read by a BS or acked
+#define ETX_FSM_EVT_QUIZ			7	// BS command ETXCMD_START_QUIZ
+#define ETX_FSM_EVT_QUIZ_END		8	// BS command ETXCMD_END_QUIZ
+#define ETX_FSM_EVTS				9
+
+// Guards, ETX_FSM_G_NONE always passes
+#define ETX_FSM_G_NONE				0
+#define ETX_FSM_G_RESUMED			1	// session restored from SNV
+#define ETX_FSM_G_BS_SET			2	// destination BS picked
+#define ETX_FSM_G_LOCKED			3	// input locked or question closed
+#define ETX_FSM_G_ANSWER			4	// key is a valid answer
+#define ETX_FSM_G_ANSWERED			5	// an answer is picked
+#define ETX_FSM_G_IN_QUIZ			6	// session restored in a quiz
+#define ETX_FSM_G_SUBMITTED			7	// ... with the sheet submitted
+#define ETX_FSM_G_INPUT_LOCKED		8	// input locked
+#define ETX_FSM_G_QUIZ_ANSWER		9	// key is a valid answer of the quiz
+#define ETX_FSM_G_QUIZ_DONE			10	// sheet complete, on the last question
+#define ETX_FSM_GUARDS				11
+
+// Actions, run before the state changes, one may fail and keep the state
+#define ETX_FSM_A_NONE				0
+#define ETX_FSM_A_SET_BS			1	// pick the destination BS
+#define ETX_FSM_A_JOIN				2	// advertise to the BS, store session
+#define ETX_FSM_A_LOCKED			3	// tell the input is locked
+#define ETX_FSM_A_ANSWER			4	// pick the answer
+#define ETX_FSM_A_VOTE				5	// stamp and publish the vote
+#define ETX_FSM_A_COLLECTED			6	// vote done, next sequence number
+#define ETX_FSM_A_QUIZ_START		7	// empty sheet
+#define ETX_FSM_A_QUIZ_ANSWER		8	// answer the current question
+#define ETX_FSM_A_QUIZ_NEXT			9	// step to the next question
+#define ETX_FSM_A_QUIZ_SUBMIT		10	// close the sheet for the upload
+#define ETX_FSM_A_QUIZ_END			11	// drop the sheet
+#define ETX_FSM_ACTIONS				12
+
+// Next state of a row which keeps the state without entering it again
+#define ETX_FSM_STAY				0xFF
+
+// Rows of an event in a state, tried in order, the first one whose guard
+// passes is taken
+#define ETX_FSM_CELL_ROWS			4
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// Application state, entered through the message queue
+typedef enum AppState_t {
+	APP_STATE_INIT,
+	APP_STATE_IDLE,
+	APP_STATE_ACTIVE,
+	APP_STATE_SLEEP,		// shutting down, any key wakes it up again,
+							// retried while the shutdown is refused
+	APP_STATE_QUIZ,			// answering the questions of a quiz
+	APP_STATE_SUBMIT,		// quiz sheet waiting for the upload
+	APP_STATES
+} AppState_t;
+
+typedef struct EtxFsmRow_t {
+	uint8_t guard;			// ETX_FSM_G_
+	uint8_t action;			// ETX_FSM_A_
+	uint8_t next;			// AppState_t or ETX_FSM_STAY
+} EtxFsmRow_t;
+
+typedef struct EtxFsmCell_t {
+	uint8_t numRows;
+	EtxFsmRow_t rows[ETX_FSM_CELL_ROWS];
+} EtxFsmCell_t;
+
+// Checks a guard other than ETX_FSM_G_NONE for the param of the event
+typedef bool (*EtxFsmGuard_t)(uint8_t guard, uint8_t param);
+
+/*********************************************************************
+ * GLOBAL VARIABLES
+ */
+
+extern const EtxFsmCell_t ETX_Fsm_table[APP_STATES][ETX_FSM_EVTS];
+
+/*********************************************************************
+ * FUNCTIONS
+ */
+
+/*
+ * Row taken for an event in a state, NULL if the event is ignored there.
+ */
+extern const EtxFsmRow_t *ETX_Fsm_find(uint8_t state, uint8_t event,
+		uint8_t param, EtxFsmGuard_t pfnGuard);
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ETXFSM_H */
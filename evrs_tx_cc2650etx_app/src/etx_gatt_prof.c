@@ -17,6 +17,7 @@
  */
 #include <string.h>
 
+#include <icall.h>
 #include "bcomdef.h"
 #include "osal.h"
 #include "linkdb.h"
@@ -36,7 +37,13 @@
  * CONSTANTS
  */
 
-#define SERVAPP_NUM_ATTR_SUPPORTED        17
+#define SERVAPP_NUM_ATTR_SUPPORTED        21
+
+// Position of BS Command value in attribute array
+#define ETXPROFILE_CMD_VALUE_POS          2
+
+// Position of BS Batch value in attribute array
+#define ETXPROFILE_BATCH_VALUE_POS        9
 
 /*********************************************************************
  * TYPEDEFS
@@ -57,6 +64,22 @@ CONST uint8 ETXProfileCmdUUID[ATT_BT_UUID_SIZE] =
 CONST uint8 ETXProfileDataUUID[ATT_BT_UUID_SIZE] =
         { LO_UINT16(ETXPROFILE_DATA_UUID), HI_UINT16(ETXPROFILE_DATA_UUID) };
 
+// Command batch UUID: 0xAFF6
+CONST uint8 ETXProfileBatchUUID[ATT_BT_UUID_SIZE] =
+        { LO_UINT16(ETXPROFILE_BATCH_UUID), HI_UINT16(ETXPROFILE_BATCH_UUID) };
+
+// Vote stamp UUID: 0xAFF8
+CONST uint8 ETXProfileStampUUID[ATT_BT_UUID_SIZE] =
+        { LO_UINT16(ETXPROFILE_STAMP_UUID), HI_UINT16(ETXPROFILE_STAMP_UUID) };
+
+// Diagnostics UUID: 0xAFFA
+CONST uint8 ETXProfileDiagUUID[ATT_BT_UUID_SIZE] =
+        { LO_UINT16(ETXPROFILE_DIAG_UUID), HI_UINT16(ETXPROFILE_DIAG_UUID) };
+
+// Answer sheet UUID: 0xAFFC
+CONST uint8 ETXProfileSheetUUID[ATT_BT_UUID_SIZE] =
+        { LO_UINT16(ETXPROFILE_SHEET_UUID), HI_UINT16(ETXPROFILE_SHEET_UUID) };
+
 /*********************************************************************
  * EXTERNAL VARIABLES
  */
@@ -71,6 +94,9 @@ CONST uint8 ETXProfileDataUUID[ATT_BT_UUID_SIZE] =
 
 static ETXProfileCBs_t *ETXProfile_AppCBs = NULL;
 
+// Batches are put in by the stack and taken out by the app
+static EtxProtoBatches_t ETXProfileBatches;
+
 /*********************************************************************
  * Profile Attributes - variables
  */
@@ -80,10 +106,16 @@ static CONST gattAttrType_t ETXProfileService =
         { ATT_BT_UUID_SIZE, ETXProfileServUUID };
 
 // ETX Profile Command BS Properties
-static uint8 ETXProfileCmdProps = GATT_PROP_READ | GATT_PROP_WRITE;
+static uint8 ETXProfileCmdProps = GATT_PROP_READ | GATT_PROP_WRITE
+        | GATT_PROP_NOTIFY;
 
 // Command BS Value
-static uint8 ETXProfileCmd = 0;
+static uint8 ETXProfileCmd[ETXPROFILE_CMD_LEN] = { 0 };
+static uint8 ETXProfileCmdLen = 1;
+
+// ETX Profile BS Command Configuration Each client has its own
+// instantiation of the Client Characteristic Configuration
+static gattCharCfg_t *ETXProfileCmdConfig;
 
 // ETX Profile BS Command User Description
 static uint8 ETXProfileCmdUserDesp[11] = "BS Command";
@@ -97,6 +129,48 @@ static uint8 ETXProfileData = 0;
 // ETX Profile User Data User Description
 static uint8 ETXProfileDataUserDesp[10] = "User Data";
 
+// ETX Profile BS Batch Properties
+static uint8 ETXProfileBatchProps = GATT_PROP_WRITE_NO_RSP | GATT_PROP_NOTIFY;
+
+// BS Batch Value, the batches themselves are kept in ETXProfileBatchBuf
+static uint8 ETXProfileBatch = 0;
+
+// ETX Profile BS Batch Configuration Each client has its own
+// instantiation of the Client Characteristic Configuration
+static gattCharCfg_t *ETXProfileBatchConfig;
+
+// ETX Profile BS Batch User Description
+static uint8 ETXProfileBatchUserDesp[9] = "BS Batch";
+
+// ETX Profile Vote Stamp Properties
+static uint8 ETXProfileStampProps = GATT_PROP_READ;
+
+// Vote Stamp Value
+static uint8 ETXProfileStamp[ETXPROFILE_STAMP_LEN] = { 0 };
+
+// ETX Profile Vote Stamp User Description
+static uint8 ETXProfileStampUserDesp[11] = "Vote Stamp";
+
+// ETX Profile Diagnostics Properties
+static uint8 ETXProfileDiagProps = GATT_PROP_READ | GATT_PROP_WRITE;
+
+// Diagnostics Value
+static uint8 ETXProfileDiag[ETXPROFILE_DIAG_LEN] = { 0 };
+static uint8 ETXProfileDiagLen = 1;
+
+// ETX Profile Diagnostics User Description
+static uint8 ETXProfileDiagUserDesp[12] = "Diagnostics";
+
+// ETX Profile Answer Sheet Properties
+static uint8 ETXProfileSheetProps = GATT_PROP_READ;
+
+// Answer Sheet Value
+static uint8 ETXProfileSheet[ETXPROFILE_SHEET_LEN] = { 0 };
+static uint8 ETXProfileSheetLen = 0;
+
+// ETX Profile Answer Sheet User Description
+static uint8 ETXProfileSheetUserDesp[13] = "Answer Sheet";
+
 /*********************************************************************
  * Profile Attributes - Table
  */
@@ -115,7 +189,12 @@ static gattAttribute_t ETXProfileAttrTbl[SERVAPP_NUM_ATTR_SUPPORTED] = {
 
         // BS Command Value
         { { ATT_BT_UUID_SIZE, ETXProfileCmdUUID },
-        GATT_PERMIT_READ | GATT_PERMIT_WRITE, 0, &ETXProfileCmd },
+        GATT_PERMIT_READ | GATT_PERMIT_WRITE, 0, ETXProfileCmd },
+
+        // BS Command configuration
+        { { ATT_BT_UUID_SIZE, clientCharCfgUUID },
+        GATT_PERMIT_READ | GATT_PERMIT_WRITE, 0,
+                (uint8 *) &ETXProfileCmdConfig },
 
         // BS Command User Description
         { { ATT_BT_UUID_SIZE, charUserDescUUID },
@@ -131,7 +210,60 @@ static gattAttribute_t ETXProfileAttrTbl[SERVAPP_NUM_ATTR_SUPPORTED] = {
 
         // User Data User Description
         { { ATT_BT_UUID_SIZE, charUserDescUUID },
-        GATT_PERMIT_READ, 0, ETXProfileDataUserDesp }, };
+        GATT_PERMIT_READ, 0, ETXProfileDataUserDesp },
+
+        // BS Batch Declaration
+        { { ATT_BT_UUID_SIZE, characterUUID },
+        GATT_PERMIT_READ, 0, &ETXProfileBatchProps },
+
+        // BS Batch Value
+        { { ATT_BT_UUID_SIZE, ETXProfileBatchUUID },
+        GATT_PERMIT_WRITE, 0, &ETXProfileBatch },
+
+        // BS Batch configuration
+        { { ATT_BT_UUID_SIZE, clientCharCfgUUID },
+        GATT_PERMIT_READ | GATT_PERMIT_WRITE, 0,
+                (uint8 *) &ETXProfileBatchConfig },
+
+        // BS Batch User Description
+        { { ATT_BT_UUID_SIZE, charUserDescUUID },
+        GATT_PERMIT_READ, 0, ETXProfileBatchUserDesp },
+
+        // Vote Stamp Declaration
+        { { ATT_BT_UUID_SIZE, characterUUID },
+        GATT_PERMIT_READ, 0, &ETXProfileStampProps },
+
+        // Vote Stamp Value
+        { { ATT_BT_UUID_SIZE, ETXProfileStampUUID },
+        GATT_PERMIT_READ, 0, ETXProfileStamp },
+
+        // Vote Stamp User Description
+        { { ATT_BT_UUID_SIZE, charUserDescUUID },
+        GATT_PERMIT_READ, 0, ETXProfileStampUserDesp },
+
+        // Diagnostics Declaration
+        { { ATT_BT_UUID_SIZE, characterUUID },
+        GATT_PERMIT_READ, 0, &ETXProfileDiagProps },
+
+        // Diagnostics Value
+        { { ATT_BT_UUID_SIZE, ETXProfileDiagUUID },
+        GATT_PERMIT_READ | GATT_PERMIT_WRITE, 0, ETXProfileDiag },
+
+        // Diagnostics User Description
+        { { ATT_BT_UUID_SIZE, charUserDescUUID },
+        GATT_PERMIT_READ, 0, ETXProfileDiagUserDesp },
+
+        // Answer Sheet Declaration
+        { { ATT_BT_UUID_SIZE, characterUUID },
+        GATT_PERMIT_READ, 0, &ETXProfileSheetProps },
+
+        // Answer Sheet Value
+        { { ATT_BT_UUID_SIZE, ETXProfileSheetUUID },
+        GATT_PERMIT_READ, 0, ETXProfileSheet },
+
+        // Answer Sheet User Description
+        { { ATT_BT_UUID_SIZE, charUserDescUUID },
+        GATT_PERMIT_READ, 0, ETXProfileSheetUserDesp }, };
 
 /*********************************************************************
  * LOCAL FUNCTIONS
@@ -144,6 +276,9 @@ static bStatus_t ETXProfile_WriteAttrCB(uint16_t connHandle,
         gattAttribute_t *pAttr, uint8_t *pValue, uint16_t len, uint16_t offset,
         uint8_t method);
 
+static bStatus_t ETXProfile_Notify(uint16 connHandle, gattCharCfg_t *pConfig,
+        uint8 valuePos, uint8 len, uint8 *value);
+
 /*********************************************************************
  * PROFILE CALLBACKS
  */
@@ -180,10 +315,19 @@ CONST gattServiceCBs_t ETXProfileCBs = {
 bStatus_t ETXProfile_AddService(uint32 services) {
     uint8 status;
 
-    // Allocate Client Characteristic Configuration table
+    // Allocate Client Characteristic Configuration tables
+    ETXProfileCmdConfig = (gattCharCfg_t *) ICall_malloc(
+            sizeof(gattCharCfg_t) * linkDBNumConns);
+    ETXProfileBatchConfig = (gattCharCfg_t *) ICall_malloc(
+            sizeof(gattCharCfg_t) * linkDBNumConns);
+    if ((ETXProfileCmdConfig == NULL) || (ETXProfileBatchConfig == NULL))
+    {
+        return (bleMemAllocError);
+    }
 
     // Initialize Client Characteristic Configuration attributes
-    //GATTServApp_InitCharCfg( INVALID_CONNHANDLE, ETXProfileDataConfig );
+    GATTServApp_InitCharCfg( INVALID_CONNHANDLE, ETXProfileCmdConfig);
+    GATTServApp_InitCharCfg( INVALID_CONNHANDLE, ETXProfileBatchConfig);
 
     if (services & ETXPROFILE_SERVICE)
     {
@@ -240,9 +384,10 @@ bStatus_t ETXProfile_SetParameter(uint8 param, uint8 len, void *value) {
     switch (param)
     {
         case ETXPROFILE_CMD:
-            if (len == sizeof(uint8))
+            if ((len > 0) && (len <= ETXPROFILE_CMD_LEN))
             {
-                ETXProfileCmd = *((uint8*) value);
+                memcpy(ETXProfileCmd, value, len);
+                ETXProfileCmdLen = len;
             } else
             {
                 rtn = bleInvalidRange;
@@ -259,6 +404,38 @@ bStatus_t ETXProfile_SetParameter(uint8 param, uint8 len, void *value) {
             }
             break;
 
+        case ETXPROFILE_STAMP:
+            if (len == ETXPROFILE_STAMP_LEN)
+            {
+                memcpy(ETXProfileStamp, value, ETXPROFILE_STAMP_LEN);
+            } else
+            {
+                rtn = bleInvalidRange;
+            }
+            break;
+
+        case ETXPROFILE_DIAG:
+            if ((len > 0) && (len <= ETXPROFILE_DIAG_LEN))
+            {
+                memcpy(ETXProfileDiag, value, len);
+                ETXProfileDiagLen = len;
+            } else
+            {
+                rtn = bleInvalidRange;
+            }
+            break;
+
+        case ETXPROFILE_SHEET:
+            if (len <= ETXPROFILE_SHEET_LEN)
+            {
+                memcpy(ETXProfileSheet, value, len);
+                ETXProfileSheetLen = len;
+            } else
+            {
+                rtn = bleInvalidRange;
+            }
+            break;
+
         default:
             rtn = INVALIDPARAMETER;
             break;
@@ -285,13 +462,25 @@ bStatus_t ETXProfile_GetParameter(uint8 param, void *value) {
     switch (param)
     {
         case ETXPROFILE_CMD:
-            *((uint8*) value) = ETXProfileCmd;
+            memcpy(value, ETXProfileCmd, ETXProfileCmdLen);
             break;
 
         case ETXPROFILE_DATA:
             *((uint8*) value) = ETXProfileData;
             break;
 
+        case ETXPROFILE_STAMP:
+            memcpy(value, ETXProfileStamp, ETXPROFILE_STAMP_LEN);
+            break;
+
+        case ETXPROFILE_DIAG:
+            memcpy(value, ETXProfileDiag, ETXProfileDiagLen);
+            break;
+
+        case ETXPROFILE_SHEET:
+            memcpy(value, ETXProfileSheet, ETXProfileSheetLen);
+            break;
+
         default:
             rtn = INVALIDPARAMETER;
             break;
@@ -300,6 +489,132 @@ bStatus_t ETXProfile_GetParameter(uint8 param, void *value) {
     return (rtn);
 }
 
+/*********************************************************************
+ * @fn      ETXProfile_GetParameterLen
+ *
+ * @brief   Get the current length of a ETX Profile parameter.
+ *
+ * @param   param - Profile parameter ID
+ *
+ * @return  length in bytes, 0 if the parameter is unknown
+ */
+uint8 ETXProfile_GetParameterLen(uint8 param) {
+    switch (param)
+    {
+        case ETXPROFILE_CMD:
+            return ETXProfileCmdLen;
+
+        case ETXPROFILE_DATA:
+            return sizeof(uint8);
+
+        case ETXPROFILE_STAMP:
+            return ETXPROFILE_STAMP_LEN;
+
+        case ETXPROFILE_DIAG:
+            return ETXProfileDiagLen;
+
+        case ETXPROFILE_SHEET:
+            return ETXProfileSheetLen;
+
+        default:
+            return 0;
+    }
+}
+
+/*********************************************************************
+ * @fn      ETXProfile_GetBatch
+ *
+ * @brief   Take the oldest BS command batch out of the buffer.
+ *
+ * @param   pConnHandle - set to the connection the batch was written on
+ * @param   value - buffer of ETXPROFILE_BATCH_LEN bytes
+ *
+ * @return  length of the batch, 0 if the buffer is empty
+ */
+uint8 ETXProfile_GetBatch(uint16 *pConnHandle, uint8 *value) {
+    return ETX_Proto_batchGet(&ETXProfileBatches, pConnHandle, value);
+}
+
+/*********************************************************************
+ * @fn      ETXProfile_NotifyCmd
+ *
+ * @brief   Notify the responses of a BS command write.
+ *
+ * @param   connHandle - connection to notify
+ * @param   len - length of the responses
+ * @param   value - responses
+ *
+ * @return  SUCCESS, bleIncorrectMode if notifications are not enabled,
+ *          bleNoResources or the status of GATT_Notification
+ */
+bStatus_t ETXProfile_NotifyCmd(uint16 connHandle, uint8 len, uint8 *value) {
+    return ETXProfile_Notify(connHandle, ETXProfileCmdConfig,
+            ETXPROFILE_CMD_VALUE_POS, len, value);
+}
+
+/*********************************************************************
+ * @fn      ETXProfile_NotifyBatch
+ *
+ * @brief   Notify the result of a BS command batch.
+ *
+ * @param   connHandle - connection to notify
+ * @param   len - length of the result
+ * @param   value - result
+ *
+ * @return  SUCCESS, bleIncorrectMode if notifications are not enabled,
+ *          bleNoResources or the status of GATT_Notification
+ */
+bStatus_t ETXProfile_NotifyBatch(uint16 connHandle, uint8 len, uint8 *value) {
+    return ETXProfile_Notify(connHandle, ETXProfileBatchConfig,
+            ETXPROFILE_BATCH_VALUE_POS, len, value);
+}
+
+/*********************************************************************
+ * @fn      ETXProfile_Notify
+ *
+ * @brief   Notify a value if the client has enabled notifications.
+ *
+ * @param   connHandle - connection to notify
+ * @param   pConfig - Client Characteristic Configuration of the value
+ * @param   valuePos - position of the value in the attribute array
+ * @param   len - length of the value
+ * @param   value - value
+ *
+ * @return  SUCCESS, bleIncorrectMode if notifications are not enabled,
+ *          bleNoResources or the status of GATT_Notification
+ */
+static bStatus_t ETXProfile_Notify(uint16 connHandle, gattCharCfg_t *pConfig,
+        uint8 valuePos, uint8 len, uint8 *value) {
+    attHandleValueNoti_t noti;
+    uint16 cfg;
+    bStatus_t status;
+
+    cfg = GATTServApp_ReadCharCfg(connHandle, pConfig);
+    if (!(cfg & GATT_CLIENT_CFG_NOTIFY))
+    {
+        return (bleIncorrectMode);
+    }
+
+    noti.pValue = (uint8 *) GATT_bm_alloc(connHandle, ATT_HANDLE_VALUE_NOTI,
+            len, NULL);
+    if (noti.pValue == NULL)
+    {
+        return (bleNoResources);
+    }
+
+    noti.handle = ETXProfileAttrTbl[valuePos].handle;
+    noti.len = len;
+    memcpy(noti.pValue, value, len);
+
+    status = GATT_Notification(connHandle, &noti, FALSE);
+    if (status != SUCCESS)
+    {
+        GATT_bm_free((gattMsg_t *) &noti, ATT_HANDLE_VALUE_NOTI);
+    }
+
+    return (status);
+}
+
 /*********************************************************************
  * @fn          ETXProfile_ReadAttrCB
  *
@@ -321,8 +636,10 @@ static bStatus_t ETXProfile_ReadAttrCB(uint16_t connHandle,
     bStatus_t status = SUCCESS;
     uint8 notifyApp = 0xFF;
 
-    // Make sure it's not a blob operation (no attributes in the profile are long)
-    if (offset > 0)
+    // Make sure it's not a blob operation (only diagnostics and the
+    // answer sheet are long)
+    if ((offset > 0) && (pAttr->pValue != ETXProfileDiag)
+            && (pAttr->pValue != ETXProfileSheet))
     {
         return ( ATT_ERR_ATTR_NOT_LONG);
     }
@@ -337,10 +654,52 @@ static bStatus_t ETXProfile_ReadAttrCB(uint16_t connHandle,
             // gattserverapp handles those reads
 
             case ETXPROFILE_CMD_UUID:
+                *pLen = (ETXProfileCmdLen < maxLen) ? ETXProfileCmdLen : maxLen;
+                memcpy(pValue, pAttr->pValue, *pLen);
+                notifyApp = ETXPROFILE_CMD;
+                break;
+
             case ETXPROFILE_DATA_UUID:
                 *pLen = 1;
                 pValue[0] = *pAttr->pValue;
-                notifyApp = (uuid == ETXPROFILE_CMD_UUID)?(ETXPROFILE_CMD):(ETXPROFILE_DATA);
+                notifyApp = ETXPROFILE_DATA;
+                break;
+
+            case ETXPROFILE_STAMP_UUID:
+                // no callback, the vote is collected by the User Data read
+                *pLen = ETXPROFILE_STAMP_LEN;
+                memcpy(pValue, pAttr->pValue, ETXPROFILE_STAMP_LEN);
+                break;
+
+            case ETXPROFILE_DIAG_UUID:
+                if (offset > ETXProfileDiagLen)
+                {
+                    *pLen = 0;
+                    status = ATT_ERR_INVALID_OFFSET;
+                    break;
+                }
+                *pLen = ETXProfileDiagLen - offset;
+                if (*pLen > maxLen)
+                {
+                    *pLen = maxLen;
+                }
+                memcpy(pValue, pAttr->pValue + offset, *pLen);
+                break;
+
+            case ETXPROFILE_SHEET_UUID:
+                // no callback, the BS ends the quiz once it has the sheet
+                if (offset > ETXProfileSheetLen)
+                {
+                    *pLen = 0;
+                    status = ATT_ERR_INVALID_OFFSET;
+                    break;
+                }
+                *pLen = ETXProfileSheetLen - offset;
+                if (*pLen > maxLen)
+                {
+                    *pLen = maxLen;
+                }
+                memcpy(pValue, pAttr->pValue + offset, *pLen);
                 break;
 
             default:
@@ -360,7 +719,7 @@ static bStatus_t ETXProfile_ReadAttrCB(uint16_t connHandle,
     if ((notifyApp != 0xFF) && ETXProfile_AppCBs
             && ETXProfile_AppCBs->pfnETXProfileEnquire)
     {
-        ETXProfile_AppCBs->pfnETXProfileEnquire(notifyApp);
+        ETXProfile_AppCBs->pfnETXProfileEnquire(connHandle, notifyApp);
     }
 
     return (status);
@@ -398,7 +757,7 @@ static bStatus_t ETXProfile_WriteAttrCB(uint16_t connHandle,
                 // Make sure it's not a blob oper
                 if (offset == 0)
                 {
-                    if (len != 1)
+                    if ((len == 0) || (len > ETXPROFILE_CMD_LEN))
                     {
                         status = ATT_ERR_INVALID_VALUE_SIZE;
                     }
@@ -410,13 +769,52 @@ static bStatus_t ETXProfile_WriteAttrCB(uint16_t connHandle,
                 //Write the value
                 if (status == SUCCESS)
                 {
-                    uint8 *pCurValue = (uint8 *)pAttr->pValue;
-                    *pCurValue = pValue[0];
+                    memcpy(pAttr->pValue, pValue, len);
+                    ETXProfileCmdLen = len;
 
                     notifyApp = ETXPROFILE_CMD;
                 }
                 break;
 
+            case ETXPROFILE_BATCH_UUID:
+                // Write command, no response is sent whatever the status
+                if ((offset != 0) || (len < 2) || (len > ETXPROFILE_BATCH_LEN))
+                {
+                    status = ATT_ERR_INVALID_VALUE_SIZE;
+                } else if (!ETX_Proto_batchPut(&ETXProfileBatches, connHandle,
+                        pValue, len))
+                {
+                    // the batch is lost, the BS finds out by the missing
+                    // notification of its seq
+                    status = ATT_ERR_PREPARE_QUEUE_FULL;
+                } else
+                {
+                    notifyApp = ETXPROFILE_BATCH;
+                }
+                break;
+
+            case ETXPROFILE_DIAG_UUID:
+                // the page id, the app fills the page in
+                if (offset != 0)
+                {
+                    status = ATT_ERR_ATTR_NOT_LONG;
+                } else if (len != 1)
+                {
+                    status = ATT_ERR_INVALID_VALUE_SIZE;
+                } else
+                {
+                    ETXProfileDiag[0] = pValue[0];
+                    ETXProfileDiagLen = 1;
+
+                    notifyApp = ETXPROFILE_DIAG;
+                }
+                break;
+
+            case GATT_CLIENT_CHAR_CFG_UUID:
+                status = GATTServApp_ProcessCCCWriteReq(connHandle, pAttr,
+                        pValue, len, offset, GATT_CLIENT_CFG_NOTIFY);
+                break;
+
             case ETXPROFILE_DATA_UUID:
             default:
                 // Should never get here! (characteristics 2 and 4 do not have write permissions)
@@ -433,7 +831,7 @@ static bStatus_t ETXProfile_WriteAttrCB(uint16_t connHandle,
     if ((notifyApp != 0xFF) && ETXProfile_AppCBs
             && ETXProfile_AppCBs->pfnETXProfileChange)
     {
-        ETXProfile_AppCBs->pfnETXProfileChange(notifyApp);
+        ETXProfile_AppCBs->pfnETXProfileChange(connHandle, notifyApp);
     }
 
     return (status);
@@ -20,14 +20,46 @@
 /*********************************************************************
  * INCLUDES
  */
+#include "etx_proto.h"
 
 /*********************************************************************
  * CONSTANTS
  */
 
 // Profile Parameters
-#define ETXPROFILE_CMD         0x00  // RW uint8
+#define ETXPROFILE_CMD         0x00  // RW uint8[ETXPROFILE_CMD_LEN]
 #define ETXPROFILE_DATA        0x01  // RW uint8
+#define ETXPROFILE_BATCH       0x02  // W uint8[ETXPROFILE_BATCH_LEN]
+#define ETXPROFILE_STAMP       0x03  // R uint8[ETXPROFILE_STAMP_LEN]
+#define ETXPROFILE_DIAG        0x04  // RW uint8[ETXPROFILE_DIAG_LEN]
+#define ETXPROFILE_SHEET       0x05  // R uint8[ETXPROFILE_SHEET_LEN]
+
+// Maximum length of a BS command, fits in the default ATT MTU.
+// The write response goes out before the commands run, so a read of CMD
+// right after the write may still return the commands. The responses are
+// notified on CMD to the client which wrote them, if it has enabled
+// notifications, and then replace the commands until CMD is read, a read
+// clears it to a single 0
+#define ETXPROFILE_CMD_LEN     20
+
+// Maximum length of a BS command batch, [seq][commands...]
+#define ETXPROFILE_BATCH_LEN   ETX_PROTO_BATCH_LEN
+
+// Number of BS command batches buffered until the app picks them up
+#define ETXPROFILE_BATCH_DEPTH ETX_PROTO_BATCH_DEPTH
+
+// Vote stamp, [seq][time, ms, 4 bytes][flags]. Reading it does not collect
+// the vote, so it has to be read before the User Data
+#define ETXPROFILE_STAMP_LEN   6
+#define ETXPROFILE_STAMP_SYNCED 0x01 // time is BS time, not time since boot
+
+// Diagnostics, a write of the page id selects the page, which is read
+// back as [page id][data...] with long reads
+#define ETXPROFILE_DIAG_LEN    64
+
+// Answer sheet of a quiz, read with long reads, see etx_quiz.h for the
+// format. Reading it does not end the quiz, ETXCMD_END_QUIZ does
+#define ETXPROFILE_SHEET_LEN   37
 
 // ETX Profile Service UUID
 #define ETXPROFILE_SERV_UUID   0xAFF0
@@ -35,10 +67,16 @@
 // Key Pressed UUID
 #define ETXPROFILE_CMD_UUID    0xAFF2
 #define ETXPROFILE_DATA_UUID   0xAFF4
+#define ETXPROFILE_BATCH_UUID  0xAFF6
+#define ETXPROFILE_STAMP_UUID  0xAFF8
+#define ETXPROFILE_DIAG_UUID   0xAFFA
+#define ETXPROFILE_SHEET_UUID  0xAFFC
 
 // ETX Keys Profile Services bit fields
 #define ETXPROFILE_SERVICE     0x00000001
 
+// BS Command format, see ETXCMD_ in etx_proto.h
+
 /*********************************************************************
  * TYPEDEFS
  */
@@ -52,9 +90,10 @@
  * Profile Callbacks
  */
 
-// Callback when a characteristic value has changed or enquired
-typedef void (*ETXProfileChange_t)( uint8 paramID );
-typedef void (*ETXProfileEnquire_t)( uint8 paramID );
+// Callback when a characteristic value has changed or enquired,
+// connHandle is the connection of the client which accessed it
+typedef void (*ETXProfileChange_t)( uint16 connHandle, uint8 paramID );
+typedef void (*ETXProfileEnquire_t)( uint16 connHandle, uint8 paramID );
 
 typedef struct ETXProfileCBs_t
 {
@@ -110,6 +149,45 @@ extern bStatus_t ETXProfile_SetParameter( uint8 param, uint8 len, void *value );
  */
 extern bStatus_t ETXProfile_GetParameter( uint8 param, void *value );
 
+/*
+ * ETXProfile_GetParameterLen - Get the current length of a ETX GATT Profile
+ *          parameter.
+ *
+ *    param - Profile parameter ID
+ */
+extern uint8 ETXProfile_GetParameterLen( uint8 param );
+
+/*
+ * ETXProfile_GetBatch - Take the oldest BS command batch out of the buffer.
+ *          Returns its length, 0 if there is none.
+ *
+ *    pConnHandle - set to the connection the batch was written on
+ *    value - buffer of ETXPROFILE_BATCH_LEN bytes
+ */
+extern uint8 ETXProfile_GetBatch( uint16 *pConnHandle, uint8 *value );
+
+/*
+ * ETXProfile_NotifyCmd - Notify the responses of a BS command write, if the
+ *          client has enabled notifications.
+ *
+ *    connHandle - connection to notify
+ *    len - length of the responses
+ *    value - responses
+ */
+extern bStatus_t ETXProfile_NotifyCmd( uint16 connHandle, uint8 len,
+                                       uint8 *value );
+
+/*
+ * ETXProfile_NotifyBatch - Notify the result of a BS command batch, if the
+ *          client has enabled notifications.
+ *
+ *    connHandle - connection to notify
+ *    len - length of the result
+ *    value - result
+ */
+extern bStatus_t ETXProfile_NotifyBatch( uint16 connHandle, uint8 len,
+                                         uint8 *value );
+
 
 /*********************************************************************
 *********************************************************************/
@@ -0,0 +1,171 @@
+/*****************************************************************************
+ *
+ * @filepath    /evrs_tx_cc2650etx_app/src/etx_link.c
+ *
+ * @project     evrs_tx_cc2650etx_app
+ *
+ * @brief       links to the base station
+ *
+ * @date        18 Oct. 2026
+ *
+ * @author      Ziyi@outlook.com.au
+ *
+ ****************************************************************************/
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <string.h>
+
+#include "etx_link.h"
+#include "etx_proto.h"
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static uint32_t ETX_Link_count(const uint8_t *pField, uint8_t len,
+		uint32_t last);
+
+/*****************************************************************************
+ * @TAG Advertising
+ */
+/** directed needs the address and no link, the others fall back to open **/
+uint8_t ETX_Link_advMode(uint8_t mode, bool isAddrKnown, uint8_t numLinks) {
+	if (mode == ETX_ADV_ON)
+		mode = isAddrKnown ? ETX_ADV_DIRECTED : ETX_ADV_OPEN;
+	if ((mode == ETX_ADV_OFF) || (mode > ETX_ADV_OPEN))
+		return ETX_ADV_OFF;
+	if ((mode < ETX_ADV_OPEN) && !isAddrKnown)
+		return ETX_ADV_OPEN;
+	// directed advertising makes no sense while a link is up
+	if ((mode == ETX_ADV_DIRECTED) && (numLinks != 0))
+		return ETX_ADV_WHITELIST;
+	return mode;
+}
+
+uint8_t ETX_Link_advFallback(uint8_t mode, uint32_t *pTimeout) {
+	switch (mode) {
+		case ETX_ADV_DIRECTED:
+			*pTimeout = ETX_DIRECT_ADV_TIMEOUT;
+			return ETX_ADV_WHITELIST;
+
+		case ETX_ADV_WHITELIST:
+			*pTimeout = ETX_WHITELIST_ADV_TIMEOUT;
+			return ETX_ADV_OPEN;
+
+		default:
+			*pTimeout = 0;
+			return ETX_ADV_OFF;
+	}
+}
+
+/*****************************************************************************
+ * @TAG Base station
+ */
+/** directed and white list advertising only take the last BS **/
+bool ETX_Link_isAccepted(uint8_t mode, uint8_t bsAddrType,
+		const uint8_t *pBsAddr, uint8_t peerAddrType, const uint8_t *pPeerAddr) {
+	switch (mode) {
+		case ETX_ADV_DIRECTED:
+		case ETX_ADV_WHITELIST:
+			return (bsAddrType != ETX_LINK_ADDR_UNKNOWN)
+					&& (peerAddrType == bsAddrType)
+					&& (memcmp(pPeerAddr, pBsAddr, ETX_LINK_ADDR_LEN) == 0);
+
+		case ETX_ADV_OPEN:
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+/*********************************************************************
+ * @fn      ETX_Link_beacon
+ *
+ * @brief   Check a beacon comes from our base station and session. The
+ *          tag is an AES-CMAC with the key of the installation over the
+ *          fields before it and the counter, a beacon whose counter
+ *          didn't go up since the last one taken is a replay. A counter
+ *          shorter than 4 bytes carries the low bytes of the next count
+ *          above the last one, its tag only checks if that is the count
+ *          it was made with. The counter isn't checked while joining, a
+ *          new session is taken whatever the count of the last one.
+ *
+ * @param   pBeacon - beacon payload, NULL if none was found
+ * @param   countPos - position of the counter, tagPos if there is none
+ * @param   tagPos - position of the tag in the payload
+ * @param   pKey - key of the tag
+ * @param   destBSID - BS picked
+ * @param   pToken - session token, 0 until the first beacon
+ * @param   pCount - counter of the last beacon taken
+ *
+ * @return  ETX_LINK_BEACON_*
+ */
+uint8_t ETX_Link_beacon(const uint8_t *pBeacon, uint8_t countPos,
+		uint8_t tagPos, const EtxProtoKey_t *pKey, uint8_t destBSID,
+		uint16_t *pToken, uint32_t *pCount) {
+	uint8_t countLen = tagPos - countPos;
+	uint32_t count = 0;
+	uint16_t session;
+	uint8_t result;
+
+	if ((pBeacon == NULL) || (pBeacon[0] != destBSID))
+		return ETX_LINK_BEACON_OTHER_BS;
+	if (countLen != 0)
+		count = ETX_Link_count(&pBeacon[countPos], countLen, *pCount);
+	// turned down before the cipher runs
+	if ((countLen == 4) && (*pToken != 0) && (count <= *pCount))
+		return ETX_LINK_BEACON_REPLAYED;
+	if (!ETX_Proto_checkTag(pBeacon, tagPos, count, pKey))
+		return ETX_LINK_BEACON_BAD_TAG;
+
+	session = pBeacon[1] | (pBeacon[2] << 8);
+	if (*pToken == 0) {
+		*pToken = session;
+		result = ETX_LINK_BEACON_JOINED;
+	} else if (session == *pToken) {
+		result = ETX_LINK_BEACON_OK;
+	} else {
+		return ETX_LINK_BEACON_OTHER_SESSION;
+	}
+	if (countLen != 0)
+		*pCount = count;
+	return result;
+}
+
+/*****************************************************************************
+ * @TAG Session record
+ */
+void ETX_Link_sessionInit(EtxSession_t *pRec) {
+	memset(pRec, 0, sizeof(EtxSession_t));
+	pRec->version = ETX_SESSION_NV_VER;
+	pRec->len = sizeof(EtxSession_t);
+	pRec->bsAddrType = ETX_LINK_ADDR_UNKNOWN;
+}
+
+bool ETX_Link_sessionCheck(const EtxSession_t *pRec, uint8_t maxID) {
+	return (pRec->version == ETX_SESSION_NV_VER)
+			&& (pRec->len == sizeof(EtxSession_t))
+			&& (pRec->destBSID != 0) && (pRec->destBSID <= maxID)
+			&& (pRec->answer <= maxID);
+}
+
+/** full counter of a beacon, a short one is the next count above last **/
+static uint32_t ETX_Link_count(const uint8_t *pField, uint8_t len,
+		uint32_t last) {
+	uint32_t count = 0;
+	uint8_t i;
+
+	for (i = 0; i < len; i++)
+		count |= (uint32_t) pField[i] << (8 * i);
+	if (len < 4) {
+		uint32_t span = (uint32_t) 1 << (8 * len);
+
+		count |= last & ~(span - 1);
+		if (count <= last)
+			count += span;
+	}
+	return count;
+}
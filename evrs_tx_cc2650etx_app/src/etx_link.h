@@ -0,0 +1,150 @@
+/*****************************************************************************
+ *
+ * @filepath    /evrs_tx_cc2650etx_app/src/etx_link.h
+ *
+ * @project     evrs_tx_cc2650etx_app
+ *
+ * @brief       links to the base station, the advertising fallback towards
+ *              the last BS, which BS may connect or be listened to and the
+ *              session record kept in NV. Plain C with no TI-RTOS or BLE
+ *              stack dependency, so it is checked on a host, see
+ *              tools/etx_link
+ *
+ * @date        18 Oct. 2026
+ *
+ * @author      Ziyi@outlook.com.au
+ *
+ ****************************************************************************/
+
+#ifndef ETXLINK_H
+#define ETXLINK_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "etx_proto.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Advertising modes, the device falls back from one to the next until
+// a base station connects
+#define ETX_ADV_OFF					0	// not advertising
+#define ETX_ADV_DIRECTED			1	// directed to the last BS
+#define ETX_ADV_WHITELIST			2	// undirected, only the last BS may connect
+#define ETX_ADV_OPEN				3	// undirected, any BS may connect
+#define ETX_ADV_ON					0xFF	// best mode for what is known
+
+// Directed advertising towards the last base station falls back to
+// undirected advertising after this time (in ms). High duty cycle
+// directed advertising is limited to 1.28s by the controller.
+#ifndef ETX_DIRECT_ADV_TIMEOUT
+#define ETX_DIRECT_ADV_TIMEOUT		1500
+#endif
+
+// Undirected advertising only accepts connections from the last base
+// station for this time (in ms) before anyone is allowed to connect
+#ifndef ETX_WHITELIST_ADV_TIMEOUT
+#define ETX_WHITELIST_ADV_TIMEOUT	10000
+#endif
+
+#define ETX_LINK_ADDR_LEN			6
+
+// Address type of a BS whose address is not known
+#define ETX_LINK_ADDR_UNKNOWN		0xFF
+
+// Beacon checks, see ETX_Link_beacon
+#define ETX_LINK_BEACON_OK			0	// our BS and session
+#define ETX_LINK_BEACON_JOINED		1	// our BS, its session is taken
+#define ETX_LINK_BEACON_OTHER_BS	2	// another destBSID
+#define ETX_LINK_BEACON_BAD_TAG		3
+#define ETX_LINK_BEACON_OTHER_SESSION	4	// our BS ID, another session
+#define ETX_LINK_BEACON_REPLAYED	5	// counter didn't go up
+
+// Session record in NV starts with [version][length], one written by a
+// firmware with another layout is dropped. Bump the version on a layout
+// change, it is kept above the BS IDs so a record without the header
+// never passes
+#define ETX_SESSION_NV_VER			0xE2
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// Session record kept in NV so it survives shutdown
+typedef struct EtxSession_t {
+	uint8_t version;		// ETX_SESSION_NV_VER
+	uint8_t len;			// sizeof(EtxSession_t)
+	uint8_t destBSID;
+	uint8_t voteSeq;
+	uint16_t token;
+	uint8_t bsAddrType;		// ETX_LINK_ADDR_UNKNOWN if not known
+	uint8_t bsAddr[ETX_LINK_ADDR_LEN];
+	uint8_t question;		// question of the answer
+	uint8_t answer;			// picked but not collected, 0 if none
+	uint32_t beaconCount;	// counter of the last beacon taken
+} EtxSession_t;
+
+/*********************************************************************
+ * FUNCTIONS
+ */
+
+/*
+ * Advertising mode to run for the one asked for, ETX_ADV_ON included,
+ * with what is known of the BS and the number of links up.
+ */
+extern uint8_t ETX_Link_advMode(uint8_t mode, bool isAddrKnown,
+		uint8_t numLinks);
+
+/*
+ * Mode to fall back to once a mode timed out, ETX_ADV_OFF if it doesn't
+ * time out. The timeout of the mode goes to pTimeout, 0 if there is none.
+ */
+extern uint8_t ETX_Link_advFallback(uint8_t mode, uint32_t *pTimeout);
+
+/*
+ * Whether a central may connect in a mode, as the controller filters it
+ * with the BS address in the white list or as the direct address.
+ */
+extern bool ETX_Link_isAccepted(uint8_t mode, uint8_t bsAddrType,
+		const uint8_t *pBsAddr, uint8_t peerAddrType, const uint8_t *pPeerAddr);
+
+/*
+ * Check a beacon or ack beacon, [bsID][session lo][session hi]... with
+ * the counter from countPos up to the tag at tagPos, against the BS
+ * picked and the last counter taken, pCount. The first beacon of the BS
+ * hands out the session, it goes to pToken when that is 0. Returns
+ * ETX_LINK_BEACON_*, the beacon is for us up to ETX_LINK_BEACON_JOINED.
+ */
+extern uint8_t ETX_Link_beacon(const uint8_t *pBeacon, uint8_t countPos,
+		uint8_t tagPos, const EtxProtoKey_t *pKey, uint8_t destBSID,
+		uint16_t *pToken, uint32_t *pCount);
+
+/*
+ * Start a session record, empty but for its header.
+ */
+extern void ETX_Link_sessionInit(EtxSession_t *pRec);
+
+/*
+ * Check a session record read from NV, BS IDs and answers from 1 up to
+ * maxID.
+ */
+extern bool ETX_Link_sessionCheck(const EtxSession_t *pRec, uint8_t maxID);
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ETXLINK_H */
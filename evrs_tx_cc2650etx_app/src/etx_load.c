@@ -0,0 +1,155 @@
+/*****************************************************************************
+ *
+ * @filepath    /evrs_tx_cc2650etx_app/src/etx_load.c
+ *
+ * @project     evrs_tx_cc2650etx_app
+ *
+ * @brief       CPU load from the idle time. The caller serialises the
+ *              calls, they come from the idle task and the app task.
+ *
+ * @date        18 Oct. 2026
+ *
+ * @author      Ziyi@outlook.com.au
+ *
+ ****************************************************************************/
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <string.h>
+
+#include "etx_load.h"
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static void ETX_Load_roll(EtxLoad_t *pLoad, uint32_t now);
+static void ETX_Load_next(EtxLoad_t *pLoad);
+static uint16_t ETX_Load_permille(const EtxLoad_t *pLoad, uint64_t idle,
+		uint8_t seconds);
+
+/*****************************************************************************
+ * @TAG Accounting
+ */
+void ETX_Load_init(EtxLoad_t *pLoad, uint32_t freq, uint32_t now) {
+	memset(pLoad, 0, sizeof(EtxLoad_t));
+	pLoad->freq = freq;
+	pLoad->slotStart = now;
+}
+
+/*********************************************************************
+ * @fn      ETX_Load_idle
+ *
+ * @brief   Count an idle period, split over the slots it spans. A period
+ *          reported late, after ETX_Load_get completed its slot, only
+ *          counts from the start of the current slot.
+ *
+ * @param   pLoad - accounting
+ * @param   begin - start of the idle period
+ * @param   end - end of the idle period
+ *
+ * @return  none
+ */
+void ETX_Load_idle(EtxLoad_t *pLoad, uint32_t begin, uint32_t end) {
+	if ((int32_t) (begin - pLoad->slotStart) < 0)
+		begin = pLoad->slotStart;
+	ETX_Load_roll(pLoad, begin);
+
+	while ((int32_t) (end - pLoad->slotStart) >= (int32_t) pLoad->freq) {
+		uint32_t slotEnd = pLoad->slotStart + pLoad->freq;
+
+		pLoad->slots[pLoad->slot].idle += slotEnd - begin;
+		begin = slotEnd;
+		ETX_Load_next(pLoad);
+	}
+	if ((int32_t) (end - begin) > 0)
+		pLoad->slots[pLoad->slot].idle += end - begin;
+}
+
+/** standby goes to the current slot, its idle time is counted apart **/
+void ETX_Load_standby(EtxLoad_t *pLoad, uint32_t begin, uint32_t end) {
+	EtxLoadSlot_t *pSlot = &pLoad->slots[pLoad->slot];
+
+	if (pSlot->standbyCount < 0xFFFF)
+		pSlot->standbyCount++;
+	pSlot->standby += end - begin;
+}
+
+/** loads of the complete slots **/
+void ETX_Load_get(EtxLoad_t *pLoad, uint32_t now, EtxLoadStats_t *pStats) {
+	uint64_t idle = 0, standby = 0;
+	uint32_t standbyCount = 0;
+	uint8_t slot;
+	uint8_t i;
+
+	ETX_Load_roll(pLoad, now);
+	memset(pStats, 0, sizeof(EtxLoadStats_t));
+	pStats->peak = pLoad->peak;
+	if (pLoad->numSlots == 0)
+		return;
+
+	slot = pLoad->slot;
+	for (i = 0; i < pLoad->numSlots; i++) {
+		const EtxLoadSlot_t *pSlot;
+
+		slot = (slot + ETX_LOAD_SLOTS) % (ETX_LOAD_SLOTS + 1);
+		pSlot = &pLoad->slots[slot];
+		if (i == 0)
+			pStats->load1s = ETX_Load_permille(pLoad, pSlot->idle, 1);
+		idle += pSlot->idle;
+		standby += pSlot->standby;
+		standbyCount += pSlot->standbyCount;
+	}
+
+	pStats->load10s = ETX_Load_permille(pLoad, idle, pLoad->numSlots);
+	pStats->standbyCount = (standbyCount < 0xFFFF) ? standbyCount : 0xFFFF;
+	if (standbyCount != 0)
+		pStats->standbyAvg = (uint32_t) ((standby * 1000000)
+				/ ((uint64_t) pLoad->freq * standbyCount));
+}
+
+uint16_t ETX_Load_lastSecond(const EtxLoad_t *pLoad, uint16_t *pStandby) {
+	const EtxLoadSlot_t *pSlot = &pLoad->slots[(pLoad->slot + ETX_LOAD_SLOTS)
+			% (ETX_LOAD_SLOTS + 1)];
+
+	*pStandby = 0;
+	if (pLoad->numSlots == 0)
+		return 0;
+	*pStandby = ETX_LOAD_FULL - ETX_Load_permille(pLoad, pSlot->standby, 1);
+	return ETX_Load_permille(pLoad, pSlot->idle, 1);
+}
+
+void ETX_Load_resetPeak(EtxLoad_t *pLoad) {
+	pLoad->peak = 0;
+}
+
+/** complete the slots which ended by now **/
+static void ETX_Load_roll(EtxLoad_t *pLoad, uint32_t now) {
+	while ((int32_t) (now - pLoad->slotStart) >= (int32_t) pLoad->freq)
+		ETX_Load_next(pLoad);
+}
+
+/** complete the current slot, start the next one **/
+static void ETX_Load_next(EtxLoad_t *pLoad) {
+	uint16_t load = ETX_Load_permille(pLoad, pLoad->slots[pLoad->slot].idle,
+			1);
+
+	if (load > pLoad->peak)
+		pLoad->peak = load;
+	if (pLoad->numSlots < ETX_LOAD_SLOTS)
+		pLoad->numSlots++;
+
+	pLoad->slot = (pLoad->slot + 1) % (ETX_LOAD_SLOTS + 1);
+	memset(&pLoad->slots[pLoad->slot], 0, sizeof(EtxLoadSlot_t));
+	pLoad->slotStart += pLoad->freq;
+}
+
+static uint16_t ETX_Load_permille(const EtxLoad_t *pLoad, uint64_t idle,
+		uint8_t seconds) {
+	uint64_t wall = (uint64_t) pLoad->freq * seconds;
+
+	if (idle >= wall)
+		return 0;
+	return (uint16_t) (ETX_LOAD_FULL - (idle * ETX_LOAD_FULL) / wall);
+}
@@ -0,0 +1,117 @@
+/*****************************************************************************
+ *
+ * @filepath    /evrs_tx_cc2650etx_app/src/etx_load.h
+ *
+ * @project     evrs_tx_cc2650etx_app
+ *
+ * @brief       CPU load from the idle time over windows of 1 s and 10 s.
+ *              Plain C with no TI-RTOS dependency, so it also builds on a
+ *              host, see tools/etx_load
+ *
+ * @date        18 Oct. 2026
+ *
+ * @author      Ziyi@outlook.com.au
+ *
+ ****************************************************************************/
+
+#ifndef ETXLOAD_H
+#define ETXLOAD_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// 1 s slots in the long window
+#define ETX_LOAD_SLOTS				10
+
+// Loads are in permille
+#define ETX_LOAD_FULL				1000
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// Idle time of a second
+typedef struct EtxLoadSlot_t {
+	uint32_t idle;			// counts
+	uint32_t standby;		// counts in standby
+	uint16_t standbyCount;	// standby entries
+} EtxLoadSlot_t;
+
+// Accounting, times are counts of a free running 32 bit counter
+typedef struct EtxLoad_t {
+	uint32_t freq;			// counts per second, the length of a slot
+	uint32_t slotStart;		// start of the current slot
+	uint8_t slot;			// current slot, the others are complete
+	uint8_t numSlots;		// complete slots, up to ETX_LOAD_SLOTS
+	uint16_t peak;			// highest load of a complete slot
+	EtxLoadSlot_t slots[ETX_LOAD_SLOTS + 1];
+} EtxLoad_t;
+
+// Loads of the complete slots
+typedef struct EtxLoadStats_t {
+	uint16_t load1s;		// the last second
+	uint16_t load10s;		// the last ETX_LOAD_SLOTS seconds
+	uint16_t peak;			// highest load1s since the reset
+	uint16_t standbyCount;	// standby entries, last ETX_LOAD_SLOTS seconds
+	uint32_t standbyAvg;	// average time in standby, us
+} EtxLoadStats_t;
+
+/*********************************************************************
+ * FUNCTIONS
+ */
+
+/*
+ * Start the accounting at now.
+ */
+extern void ETX_Load_init(EtxLoad_t *pLoad, uint32_t freq, uint32_t now);
+
+/*
+ * Count the time from begin to end as idle, the time before begin since
+ * the last call as busy.
+ */
+extern void ETX_Load_idle(EtxLoad_t *pLoad, uint32_t begin, uint32_t end);
+
+/*
+ * Count a standby entry which lasted from begin to end, on top of the idle
+ * time it is part of.
+ */
+extern void ETX_Load_standby(EtxLoad_t *pLoad, uint32_t begin, uint32_t end);
+
+/*
+ * Complete the slots which ended by now and get the loads. The time since
+ * the last idle period counts as busy.
+ */
+extern void ETX_Load_get(EtxLoad_t *pLoad, uint32_t now,
+		EtxLoadStats_t *pStats);
+
+/*
+ * Load and standby time of the last complete slot, in permille, 0 for both
+ * until a slot is complete.
+ */
+extern uint16_t ETX_Load_lastSecond(const EtxLoad_t *pLoad,
+		uint16_t *pStandby);
+
+/*
+ * Clear the peak load.
+ */
+extern void ETX_Load_resetPeak(EtxLoad_t *pLoad);
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ETXLOAD_H */
@@ -0,0 +1,201 @@
+/*****************************************************************************
+ *
+ * @filepath    /evrs_tx_cc2650etx_app/src/etx_prof.c
+ *
+ * @project     evrs_tx_cc2650etx_app
+ *
+ * @brief       cycle counts of code sections. The counts are not locked,
+ *              sites are meant for the app task.
+ *
+ * @date        18 Oct. 2026
+ *
+ * @author      Ziyi@outlook.com.au
+ *
+ ****************************************************************************/
+
+#include "etx_prof.h"
+
+#ifdef ETX_PROF
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <string.h>
+
+#if defined(__TI_COMPILER_VERSION__) || defined(__arm__)
+#include <inc/hw_types.h>
+#include <inc/hw_memmap.h>
+#include <inc/hw_cpu_scs.h>
+#include <inc/hw_cpu_dwt.h>
+
+#include "etx_board_display.h"
+
+#define ETX_PROF_TARGET
+#else
+#include <stdio.h>
+#include <time.h>
+#endif
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct EtxProfSite_t {
+	const char *pName;
+	uint32_t count;
+	uint32_t min;
+	uint32_t max;
+	uint64_t sum;
+	uint16_t hist[ETX_PROF_BUCKETS];	// saturate at 0xFFFF
+} EtxProfSite_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+// Site n is sites[n - 1], 0 stands for not registered
+static EtxProfSite_t sites[ETX_PROF_SITES];
+static uint8_t numSites = 0;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static void ETX_Prof_print(const EtxProfSite_t *pSite);
+
+/*****************************************************************************
+ * @TAG Profiling
+ */
+/** start the cycle counter, it stops while the CPU sleeps **/
+void ETX_Prof_init(void) {
+#ifdef ETX_PROF_TARGET
+	HWREG(CPU_SCS_BASE + CPU_SCS_O_DEMCR) |= CPU_SCS_DEMCR_TRCENA;
+	HWREG(CPU_DWT_BASE + CPU_DWT_O_CYCCNT) = 0;
+	HWREG(CPU_DWT_BASE + CPU_DWT_O_CTRL) |= CPU_DWT_CTRL_CYCCNTENA;
+#endif
+	ETX_Prof_reset();
+}
+
+/** register a site, or find the one of the same name **/
+uint8_t ETX_Prof_site(const char *pName) {
+	uint8_t i;
+
+	for (i = 0; i < numSites; i++) {
+		if (strcmp(sites[i].pName, pName) == 0)
+			return i + 1;
+	}
+	if (numSites >= ETX_PROF_SITES)
+		return 0;
+
+	sites[numSites].pName = pName;
+	sites[numSites].min = UINT32_MAX;
+	return ++numSites;
+}
+
+uint32_t ETX_Prof_now(void) {
+#ifdef ETX_PROF_TARGET
+	return HWREG(CPU_DWT_BASE + CPU_DWT_O_CYCCNT);
+#else
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint32_t) ((uint64_t) now.tv_sec * 1000000000 + now.tv_nsec);
+#endif
+}
+
+/** count a pass of a site **/
+void ETX_Prof_count(uint8_t site, uint32_t cycles) {
+	EtxProfSite_t *pSite;
+	uint8_t bucket = 0;
+
+	if ((site == 0) || (site > numSites))
+		return;
+	pSite = &sites[site - 1];
+
+	pSite->count++;
+	pSite->sum += cycles;
+	if (cycles < pSite->min)
+		pSite->min = cycles;
+	if (cycles > pSite->max)
+		pSite->max = cycles;
+
+	cycles >>= ETX_PROF_SHIFT + 1;
+	while ((cycles != 0) && (bucket < ETX_PROF_BUCKETS - 1)) {
+		cycles >>= 1;
+		bucket++;
+	}
+	if (pSite->hist[bucket] < 0xFFFF)
+		pSite->hist[bucket]++;
+}
+
+/** list the sites of the most cycles in total **/
+void ETX_Prof_dump(void) {
+	uint8_t listed[ETX_PROF_SITES] = { 0 };
+	uint8_t n, i;
+
+#ifdef ETX_PROF_TARGET
+	uout2("prof %d sites, %s", numSites, ETX_PROF_UNIT);
+#else
+	printf("prof %d sites, %s\n", numSites, ETX_PROF_UNIT);
+#endif
+	for (n = 0; (n < ETX_PROF_TOP) && (n < numSites); n++) {
+		int8_t top = -1;
+
+		for (i = 0; i < numSites; i++) {
+			if (!listed[i] && ((top < 0) || (sites[i].sum > sites[top].sum)))
+				top = i;
+		}
+		if ((top < 0) || (sites[top].count == 0))
+			break;
+		listed[top] = 1;
+		ETX_Prof_print(&sites[top]);
+	}
+}
+
+void ETX_Prof_reset(void) {
+	uint8_t i;
+
+	for (i = 0; i < numSites; i++) {
+		const char *pName = sites[i].pName;
+
+		memset(&sites[i], 0, sizeof(EtxProfSite_t));
+		sites[i].pName = pName;
+		sites[i].min = UINT32_MAX;
+	}
+}
+
+/** a line of stats and a line of histogram **/
+static void ETX_Prof_print(const EtxProfSite_t *pSite) {
+	char hist[ETX_PROF_BUCKETS * 6 + 1];
+	uint32_t mean = (uint32_t) (pSite->sum / pSite->count);
+	uint8_t len = 0;
+	uint8_t i;
+
+	// bucket counts, decimal, without printf on the target
+	for (i = 0; i < ETX_PROF_BUCKETS; i++) {
+		char digits[5];
+		uint16_t count = pSite->hist[i];
+		uint8_t numDigits = 0;
+
+		do {
+			digits[numDigits++] = '0' + count % 10;
+			count /= 10;
+		} while (count != 0);
+		while (numDigits != 0)
+			hist[len++] = digits[--numDigits];
+		hist[len++] = ' ';
+	}
+	hist[len - 1] = '\0';
+
+#ifdef ETX_PROF_TARGET
+	uout5("P %s n %d min %d max %d mean %d", pSite->pName, pSite->count,
+			pSite->min, pSite->max, mean);
+	uout1("H %s", hist);
+#else
+	printf("P %s n %u min %u max %u mean %u\n", pSite->pName, pSite->count,
+			pSite->min, pSite->max, mean);
+	printf("H %s\n", hist);
+#endif
+}
+
+#endif // ETX_PROF
@@ -0,0 +1,113 @@
+/*****************************************************************************
+ *
+ * @filepath    /evrs_tx_cc2650etx_app/src/etx_prof.h
+ *
+ * @project     evrs_tx_cc2650etx_app
+ *
+ * @brief       cycle counts of code sections, built only with ETX_PROF
+ *              defined. The target counts CPU cycles with the DWT, a host
+ *              build counts ns of the monotonic clock.
+ *
+ *              uprofBegin("name");
+ *              ...
+ *              uprofEnd();
+ *
+ *              The pair opens and closes a block, so a return in between
+ *              skips the count. Sites of the same name share their count.
+ *
+ * @date        18 Oct. 2026
+ *
+ * @author      Ziyi@outlook.com.au
+ *
+ ****************************************************************************/
+
+#ifndef ETXPROF_H
+#define ETXPROF_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Number of sites, the ones after are not counted
+#ifndef ETX_PROF_SITES
+#define ETX_PROF_SITES				12
+#endif
+
+// Histogram bucket 0 counts less than 2^(ETX_PROF_SHIFT + 1) cycles, bucket
+// n counts [2^(n + ETX_PROF_SHIFT), 2^(n + 1 + ETX_PROF_SHIFT)), the last
+// one counts everything above
+#define ETX_PROF_BUCKETS			16
+#define ETX_PROF_SHIFT				6
+
+// Sites listed by the dump, most cycles in total first
+#define ETX_PROF_TOP				8
+
+#if defined(__TI_COMPILER_VERSION__) || defined(__arm__)
+#define ETX_PROF_UNIT				"cycles"
+#else
+#define ETX_PROF_UNIT				"ns"
+#endif
+
+/*********************************************************************
+ * FUNCTIONS
+ */
+
+#ifdef ETX_PROF
+
+void ETX_Prof_init(void);
+uint8_t ETX_Prof_site(const char *pName);
+uint32_t ETX_Prof_now(void);
+void ETX_Prof_count(uint8_t site, uint32_t cycles);
+void ETX_Prof_dump(void);
+void ETX_Prof_reset(void);
+
+#define uprofInit() \
+    ETX_Prof_init()
+
+// site 0 is not registered yet, registration happens on the first pass
+#define uprofBegin(name) \
+    { \
+        static uint8_t profSite = 0; \
+        uint32_t profStart; \
+        if (profSite == 0) \
+            profSite = ETX_Prof_site(name); \
+        profStart = ETX_Prof_now();
+
+#define uprofEnd() \
+        ETX_Prof_count(profSite, ETX_Prof_now() - profStart); \
+    }
+
+#define uprofDump() \
+    ETX_Prof_dump()
+
+#define uprofReset() \
+    ETX_Prof_reset()
+
+#else
+
+#define uprofInit()
+#define uprofBegin(name)	{
+#define uprofEnd()			}
+#define uprofDump()
+#define uprofReset()
+
+#endif // ETX_PROF
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ETXPROF_H */
@@ -0,0 +1,431 @@
+/*****************************************************************************
+ *
+ * @filepath    /evrs_tx_cc2650etx_app/src/etx_proto.c
+ *
+ * @project     evrs_tx_cc2650etx_app
+ *
+ * @brief       the over-the-air protocol of the ETX
+ *
+ * @date        18 Oct. 2026
+ *
+ * @author      Ziyi@outlook.com.au
+ *
+ ****************************************************************************/
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stddef.h>
+#include <string.h>
+
+#include "etx_proto.h"
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static void ETX_Proto_double(uint8_t *pBlock);
+static uint32_t ETX_Proto_voteHash(const uint8_t *pDevID, uint8_t seq);
+
+/*****************************************************************************
+ * @TAG Beacons
+ */
+/** FNV-1a hash step over a buffer **/
+uint32_t ETX_Proto_hash(uint32_t hash, const uint8_t *pBuf, uint8_t len) {
+	while (len--)
+		hash = (hash ^ *pBuf++) * 16777619u;
+	return hash;
+}
+
+/** find an AD structure of the given type and data length **/
+const uint8_t *ETX_Proto_findAD(const uint8_t *pData, uint8_t dataLen,
+		uint8_t adType, uint8_t len) {
+	uint8_t i = 0;
+
+	// walk the AD structures, [len][type][data...]
+	while ((i + 1 < dataLen) && (pData[i] != 0)) {
+		if ((pData[i + 1] == adType) && (pData[i] == len + 1)
+				&& (i + 1 + pData[i] <= dataLen))
+			return &pData[i + 2];
+		i += pData[i] + 1;
+	}
+
+	return NULL;
+}
+
+/*********************************************************************
+ * @fn      ETX_Proto_cmac
+ *
+ * @brief   AES-CMAC, RFC 4493. The subkey is derived for every message,
+ *          it is one more block for the cipher and no key material is
+ *          kept outside of it.
+ *
+ * @param   pKey - cipher with the key
+ * @param   pMsg - message
+ * @param   len - length of the message
+ * @param   pMac - ETX_PROTO_AES_LEN bytes of MAC
+ *
+ * @return  false if the cipher failed
+ */
+bool ETX_Proto_cmac(const EtxProtoKey_t *pKey, const uint8_t *pMsg,
+		uint8_t len, uint8_t *pMac) {
+	uint8_t subkey[ETX_PROTO_AES_LEN];
+	uint8_t x[ETX_PROTO_AES_LEN];
+	uint8_t i;
+
+	memset(subkey, 0, sizeof(subkey));
+	if (!pKey->pfnAes(pKey->pArg, subkey, subkey))
+		return false;
+	ETX_Proto_double(subkey); // K1
+
+	memset(x, 0, sizeof(x));
+	while (len > ETX_PROTO_AES_LEN) {
+		for (i = 0; i < ETX_PROTO_AES_LEN; i++)
+			x[i] ^= pMsg[i];
+		if (!pKey->pfnAes(pKey->pArg, x, x))
+			return false;
+		pMsg += ETX_PROTO_AES_LEN;
+		len -= ETX_PROTO_AES_LEN;
+	}
+
+	// a short last block is padded and takes K2
+	if (len < ETX_PROTO_AES_LEN) {
+		ETX_Proto_double(subkey);
+		x[len] ^= 0x80;
+	}
+	for (i = 0; i < len; i++)
+		x[i] ^= pMsg[i];
+	for (i = 0; i < ETX_PROTO_AES_LEN; i++)
+		x[i] ^= subkey[i];
+	return pKey->pfnAes(pKey->pArg, x, pMac);
+}
+
+/** truncated AES-CMAC of the fields before the tag and the counter **/
+bool ETX_Proto_tag(const uint8_t *pBeacon, uint8_t tagPos, uint32_t count,
+		const EtxProtoKey_t *pKey, uint8_t *pTag) {
+	uint8_t msg[ETX_PROTO_TAG_MSG_LEN];
+	uint8_t mac[ETX_PROTO_AES_LEN];
+
+	if (tagPos > sizeof(msg) - 4)
+		return false;
+	memcpy(msg, pBeacon, tagPos);
+	msg[tagPos] = (uint8_t) count;
+	msg[tagPos + 1] = (uint8_t) (count >> 8);
+	msg[tagPos + 2] = (uint8_t) (count >> 16);
+	msg[tagPos + 3] = (uint8_t) (count >> 24);
+	if (!ETX_Proto_cmac(pKey, msg, tagPos + 4, mac))
+		return false;
+	memcpy(pTag, mac, ETX_PROTO_TAG_LEN);
+	return true;
+}
+
+/** check the tag of a beacon, every byte is compared whatever the first **/
+bool ETX_Proto_checkTag(const uint8_t *pBeacon, uint8_t tagPos,
+		uint32_t count, const EtxProtoKey_t *pKey) {
+	uint8_t tag[ETX_PROTO_TAG_LEN];
+	uint8_t diff = 0;
+	uint8_t i;
+
+	if (!ETX_Proto_tag(pBeacon, tagPos, count, pKey, tag))
+		return false;
+	for (i = 0; i < ETX_PROTO_TAG_LEN; i++)
+		diff |= tag[i] ^ pBeacon[tagPos + i];
+	return diff == 0;
+}
+
+/*****************************************************************************
+ * @TAG Acks
+ */
+/*********************************************************************
+ * @fn      ETX_Proto_ackCheck
+ *
+ * @brief   Look a vote up in the Bloom filter of an ack beacon. It uses
+ *          double hashing, the odd step walks all the filter bits. A
+ *          filter with more than ETX_ACK_MAX_BITS set is turned down, a
+ *          saturated one, all bits set at worst, would ack every vote of
+ *          the partition. The tag is not checked here.
+ *
+ * @param   pAck - ack beacon payload
+ * @param   pDevID - devID of the vote
+ * @param   seq - sequence number of the vote
+ *
+ * @return  ETX_PROTO_ACK_*
+ */
+uint8_t ETX_Proto_ackCheck(const uint8_t *pAck, const uint8_t *pDevID,
+		uint8_t seq) {
+	const uint8_t *pFilter = &pAck[ETX_ACK_FILTER_POS];
+	uint32_t h1, h2;
+	uint8_t bits = 0;
+	uint8_t i;
+
+	if ((pAck[4] == 0) || (pAck[5] == 0) || (pAck[5] > ETX_ACK_MAX_HASHES))
+		return ETX_PROTO_ACK_OTHER;
+	if (ETX_Proto_partition(pDevID, pAck[4]) != pAck[3])
+		return ETX_PROTO_ACK_OTHER;
+
+	for (i = 0; i < ETX_ACK_FILTER_BITS / 8; i++) {
+		uint8_t b;
+
+		for (b = pFilter[i]; b != 0; b &= b - 1)
+			bits++;
+	}
+	if (bits > ETX_ACK_MAX_BITS)
+		return ETX_PROTO_ACK_OTHER;
+
+	h1 = ETX_Proto_voteHash(pDevID, seq);
+	h2 = ((h1 >> 16) | (h1 << 16)) | 1;
+	for (i = 0; i < pAck[5]; i++) {
+		uint8_t bit = (h1 + i * h2) % ETX_ACK_FILTER_BITS;
+		if (!(pFilter[bit >> 3] & (1 << (bit & 0x07))))
+			return ETX_PROTO_ACK_MISSED;
+	}
+
+	return ETX_PROTO_ACK_HIT;
+}
+
+/** set the filter bits of a vote, partition and hashes already set **/
+void ETX_Proto_ackAdd(uint8_t *pAck, const uint8_t *pDevID, uint8_t seq) {
+	uint8_t *pFilter = &pAck[ETX_ACK_FILTER_POS];
+	uint32_t h1, h2;
+	uint8_t i;
+
+	h1 = ETX_Proto_voteHash(pDevID, seq);
+	h2 = ((h1 >> 16) | (h1 << 16)) | 1;
+	for (i = 0; (i < pAck[5]) && (i < ETX_ACK_MAX_HASHES); i++) {
+		uint8_t bit = (h1 + i * h2) % ETX_ACK_FILTER_BITS;
+		pFilter[bit >> 3] |= 1 << (bit & 0x07);
+	}
+}
+
+uint8_t ETX_Proto_partition(const uint8_t *pDevID, uint8_t partitions) {
+	return ETX_Proto_hash(ETX_PROTO_HASH_INIT, pDevID, ETX_PROTO_DEVID_LEN)
+			% partitions;
+}
+
+/*****************************************************************************
+ * @TAG Votes
+ */
+/** slot picked by a hash of devID and frame, so collisions don't repeat **/
+uint16_t ETX_Proto_slot(const uint8_t *pDevID, uint8_t frame, uint16_t slots) {
+	uint8_t key[ETX_PROTO_DEVID_LEN + 1];
+
+	memcpy(key, pDevID, ETX_PROTO_DEVID_LEN);
+	key[ETX_PROTO_DEVID_LEN] = frame;
+	return ETX_Proto_hash(ETX_PROTO_HASH_INIT, key, sizeof(key)) % slots;
+}
+
+/** random, exponentially growing pause so retries spread out **/
+uint32_t ETX_Proto_backoff(uint8_t retries, uint32_t random) {
+	uint8_t exp = (retries < ETX_VOTE_BACKOFF_MAX_EXP) ?
+			retries : ETX_VOTE_BACKOFF_MAX_EXP;
+
+	return ETX_VOTE_BACKOFF + random % ((uint32_t) ETX_VOTE_BACKOFF << exp);
+}
+
+void ETX_Proto_putVote(uint8_t *pBuf, const uint8_t *pDevID,
+		uint8_t question, uint8_t seq, uint8_t answer, uint32_t time) {
+	memcpy(pBuf, pDevID, ETX_PROTO_DEVID_LEN);
+	pBuf[4] = question;
+	pBuf[5] = seq;
+	pBuf[6] = answer;
+	pBuf[7] = (uint8_t) time;
+	pBuf[8] = (uint8_t) (time >> 8);
+	pBuf[9] = (uint8_t) (time >> 16);
+	pBuf[10] = (uint8_t) (time >> 24);
+}
+
+/*****************************************************************************
+ * @TAG BS commands
+ */
+/*********************************************************************
+ * @fn      ETX_Proto_cmdProcess
+ *
+ * @brief   Execute the BS commands of one write. Every command is coded
+ *          as [opcode][len][value...], and answered by
+ *          [opcode | ETXCMD_RSP][len][status][data...]. Processing stops
+ *          at a malformed command, or before a command whose longest
+ *          response doesn't fit in the buffer left, so no command runs
+ *          without its response being sent.
+ *
+ * @param   pCmd - commands written by the base station
+ * @param   cmdLen - length of the commands
+ * @param   pRsp - buffer for the responses
+ * @param   rspSize - size of the response buffer
+ * @param   pfnExec - executes a single command
+ * @param   pArg - passed on to pfnExec
+ *
+ * @return  length of the responses
+ */
+/** longest response data of a command, unknown ones have none **/
+static uint8_t ETX_Proto_cmdDataLen(uint8_t opcode) {
+	switch (opcode) {
+		case ETXCMD_GET_BATTERY:
+			return ETXCMD_BATTERY_LEN;
+		case ETXCMD_GET_STATS:
+			return ETXCMD_STATS_LEN;
+		default:
+			return 0;
+	}
+}
+
+uint8_t ETX_Proto_cmdProcess(const uint8_t *pCmd, uint8_t cmdLen,
+		uint8_t *pRsp, uint8_t rspSize, EtxProtoCmdExec_t pfnExec, void *pArg) {
+	uint8_t data[ETXCMD_DATA_LEN];
+	uint8_t i = 0;
+	uint8_t rspLen = 0;
+
+	while (i < cmdLen) {
+		uint8_t opcode = pCmd[i++];
+		uint8_t len = (i < cmdLen) ? pCmd[i++] : 0; // a lone opcode has no value
+		uint8_t dataLen = 0;
+		uint8_t status;
+
+		if (rspLen + 3 + ETX_Proto_cmdDataLen(opcode) > rspSize)
+			break; // the rest waits for the BS to write it again
+
+		if (len > cmdLen - i) {
+			status = ETXCMD_ERR_LEN;
+			i = cmdLen; // the rest can't be trusted
+		} else {
+			status = pfnExec(pArg, opcode, &pCmd[i], len, data, &dataLen);
+			i += len;
+		}
+
+		if (dataLen > ETX_Proto_cmdDataLen(opcode)) {
+			status = ETXCMD_ERR_UNKNOWN; // answered more than it may
+			dataLen = 0;
+		}
+		pRsp[rspLen++] = opcode | ETXCMD_RSP;
+		pRsp[rspLen++] = 1 + dataLen;
+		pRsp[rspLen++] = status;
+		memcpy(&pRsp[rspLen], data, dataLen);
+		rspLen += dataLen;
+	}
+
+	return rspLen;
+}
+
+#if (256 % ETX_PROTO_BATCH_DEPTH) != 0
+#error "ETX_PROTO_BATCH_DEPTH has to divide 256"
+#endif
+
+/** the batch is copied in before the index moves, the app never sees half **/
+bool ETX_Proto_batchPut(EtxProtoBatches_t *pRing, uint16_t connHandle,
+		const uint8_t *pValue, uint8_t len) {
+	EtxProtoBatch_t *pBatch;
+
+	if ((len > ETX_PROTO_BATCH_LEN)
+			|| ((uint8_t) (pRing->in - pRing->out) >= ETX_PROTO_BATCH_DEPTH))
+		return false;
+
+	pBatch = &pRing->buf[pRing->in % ETX_PROTO_BATCH_DEPTH];
+	pBatch->connHandle = connHandle;
+	pBatch->len = len;
+	memcpy(pBatch->value, pValue, len);
+	pRing->in++;
+	return true;
+}
+
+/** the slot is only given back once the batch is copied out **/
+uint8_t ETX_Proto_batchGet(EtxProtoBatches_t *pRing, uint16_t *pConnHandle,
+		uint8_t *pValue) {
+	const EtxProtoBatch_t *pBatch;
+	uint8_t len;
+
+	if (pRing->out == pRing->in)
+		return 0;
+
+	pBatch = &pRing->buf[pRing->out % ETX_PROTO_BATCH_DEPTH];
+	*pConnHandle = pBatch->connHandle;
+	len = pBatch->len;
+	memcpy(pValue, pBatch->value, len);
+	pRing->out++;
+	return len;
+}
+
+/*****************************************************************************
+ * @TAG Time sync
+ */
+/*********************************************************************
+ * @fn      ETX_Proto_timeSync
+ *
+ * @brief   Set the BS time. The error of the time predicted since the
+ *          last sync gives the drift of our clock against the BS, half
+ *          of it is taken each time so a late beacon does little harm,
+ *          and less over syncs closer than ETX_TIME_DRIFT_SPAN.
+ *
+ * @param   pTime - time kept
+ * @param   bsTime - BS time now, in ms
+ * @param   tick - tick now
+ * @param   tickPeriod - tick period, in us
+ * @param   pError - error of the predicted time, in ms
+ *
+ * @return  ETX_PROTO_TIME_*
+ */
+uint8_t ETX_Proto_timeSync(EtxProtoTime_t *pTime, uint32_t bsTime,
+		uint32_t tick, uint32_t tickPeriod, int32_t *pError) {
+	uint8_t result = ETX_PROTO_TIME_FIRST;
+
+	*pError = 0;
+	if (pTime->isSynced) {
+		uint32_t elapsed = (uint32_t) (((uint64_t) (tick - pTime->syncTick)
+				* tickPeriod) / 1000);
+		int32_t error = (int32_t) (bsTime
+				- ETX_Proto_timeGet(pTime, tick, tickPeriod));
+
+		*pError = error;
+		if ((error > ETX_TIME_STEP) || (error < -ETX_TIME_STEP)) {
+			// not drift, the BS time has been set
+			result = ETX_PROTO_TIME_STEP;
+		} else if (elapsed < ETX_TIME_DRIFT_INTERVAL) {
+			// too close to the last sync to tell drift from latency
+			return ETX_PROTO_TIME_SKIP;
+		} else {
+			if (elapsed < ETX_TIME_DRIFT_SPAN)
+				elapsed = ETX_TIME_DRIFT_SPAN;
+			pTime->driftPpm += (int32_t) (((int64_t) error * 1000000)
+					/ elapsed) / 2;
+			if (pTime->driftPpm > ETX_TIME_DRIFT_MAX)
+				pTime->driftPpm = ETX_TIME_DRIFT_MAX;
+			else if (pTime->driftPpm < -ETX_TIME_DRIFT_MAX)
+				pTime->driftPpm = -ETX_TIME_DRIFT_MAX;
+			result = ETX_PROTO_TIME_DRIFT;
+		}
+	}
+
+	pTime->syncTick = tick;
+	pTime->syncTime = bsTime;
+	pTime->isSynced = true;
+	return result;
+}
+
+/** BS time at a tick **/
+uint32_t ETX_Proto_timeGet(const EtxProtoTime_t *pTime, uint32_t tick,
+		uint32_t tickPeriod) {
+	// a tick before the last sync gives a negative offset, in us so the
+	// drift of a few seconds is not lost to the ms
+	int64_t offset = (int64_t) (int32_t) (tick - pTime->syncTick)
+			* tickPeriod;
+
+	offset += (offset * pTime->driftPpm) / 1000000;
+	// the BS time of the sync was cut down to its ms, round to the nearest
+	offset = (offset >= 0) ? (offset + 500) / 1000 : -((500 - offset) / 1000);
+	return pTime->syncTime + (int32_t) offset;
+}
+
+/** hash of a vote, devID then seq **/
+static uint32_t ETX_Proto_voteHash(const uint8_t *pDevID, uint8_t seq) {
+	return ETX_Proto_hash(
+			ETX_Proto_hash(ETX_PROTO_HASH_INIT, pDevID, ETX_PROTO_DEVID_LEN),
+			&seq, 1);
+}
+
+/** double in GF(2^128), a CMAC subkey from the one before **/
+static void ETX_Proto_double(uint8_t *pBlock) {
+	uint8_t carry = pBlock[0] & 0x80;
+	uint8_t i;
+
+	for (i = 0; i < ETX_PROTO_AES_LEN - 1; i++)
+		pBlock[i] = (uint8_t) ((pBlock[i] << 1) | (pBlock[i + 1] >> 7));
+	pBlock[i] = (uint8_t) ((pBlock[i] << 1) ^ (carry ? 0x87 : 0x00));
+}
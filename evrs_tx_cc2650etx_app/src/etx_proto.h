@@ -0,0 +1,326 @@
+/*****************************************************************************
+ *
+ * @filepath    /evrs_tx_cc2650etx_app/src/etx_proto.h
+ *
+ * @project     evrs_tx_cc2650etx_app
+ *
+ * @brief       the over-the-air protocol of the ETX, beacons, acks, slots,
+ *              back-off and time sync. Plain C with no TI-RTOS or BLE stack
+ *              dependency, so it also builds on a host, see tools/etx_sim
+ *
+ * @date        18 Oct. 2026
+ *
+ * @author      Ziyi@outlook.com.au
+ *
+ ****************************************************************************/
+
+#ifndef ETXPROTO_H
+#define ETXPROTO_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define ETX_ADTYPE_DEST				0xAF
+#define ETX_ADTYPE_DEVID			0xAE
+#define ETX_ADTYPE_BEACON			0xAD
+#define ETX_ADTYPE_VOTE				0xAC
+#define ETX_ADTYPE_ACK				0xAB
+
+#define ETX_PROTO_DEVID_LEN			4
+
+// BS beacon: [bsID][session lo][session hi][question][flags][min answer]
+// [max answer][frame][slots lo][slots hi][slot length, ms][BS time, ms,
+// 4 bytes][counter, 4 bytes][tag, 4 bytes], the tag is checked by
+// ETX_Beacon_verify(). The counter goes up by one with every beacon the
+// BS sends and never goes back for a key, a beacon whose counter didn't
+// go up is a replay. The BS sends its beacons from the address it
+// connects with, a beacon that passes is where the ETX learns it
+#define ETX_BEACON_LEN				23
+#define ETX_BEACON_COUNT_POS		15
+#define ETX_BEACON_TAG_POS			19
+#define ETX_BEACON_FLAG_OPEN		0x01
+#define ETX_BEACON_FLAG_SLOTTED		0x02	// votes go out in the TDMA slots
+
+// BS ack beacon: [bsID][session lo][session hi][partition][partitions]
+// [hashes][filter, 16 bytes][counter lo][counter hi][tag, 4 bytes]. The
+// filter is a Bloom filter of the votes (devID, seq) collected from the
+// devices in the partition, a device belongs to partition
+// hash(devID) % partitions. The counter is the one of the beacons, it
+// only carries its low bytes to fit, and the tag is made the same way.
+// It goes out non-connectable without the flags AD, 30 bytes
+#define ETX_ACK_LEN					28
+#define ETX_ACK_FILTER_POS			6
+#define ETX_ACK_FILTER_BITS			128
+#define ETX_ACK_COUNT_POS			22
+#define ETX_ACK_TAG_POS				24
+#define ETX_ACK_MAX_HASHES			8
+
+// A filter with more bits set is no ack, it would take most votes not in
+// it. At the best number of hashes a filter is half set, the BS splits
+// its partitions further before it fills up more
+#define ETX_ACK_MAX_BITS			(ETX_ACK_FILTER_BITS / 2)
+
+// Vote in the advertising data: [devID, 4 bytes][question][seq][answer]
+// [time, ms, 4 bytes]
+#define ETX_PROTO_VOTE_LEN			11
+
+// Result of looking a vote up in an ack beacon
+#define ETX_PROTO_ACK_OTHER			0	// bad beacon or another partition
+#define ETX_PROTO_ACK_MISSED		1	// our partition, vote not in it
+#define ETX_PROTO_ACK_HIT			2	// vote collected
+
+// Advertising pauses for a random time of up to ETX_VOTE_BACKOFF << n ms
+// after the n-th ack beacon missing our vote
+#ifndef ETX_VOTE_BACKOFF
+#define ETX_VOTE_BACKOFF			100
+#endif
+#define ETX_VOTE_BACKOFF_MAX_EXP	6
+
+// Clock drift is only estimated over sync intervals longer than this (ms),
+// and is limited to ETX_TIME_DRIFT_MAX ppm. A shorter interval weighs in
+// as if it were ETX_TIME_DRIFT_SPAN long, the latency of beacons a few
+// seconds apart is no drift
+#define ETX_TIME_DRIFT_INTERVAL		10000
+#define ETX_TIME_DRIFT_SPAN			60000
+#define ETX_TIME_DRIFT_MAX			500
+
+// A sync this far (ms) off the predicted time sets the time instead
+#define ETX_TIME_STEP				1000
+
+// Result of a time sync
+#define ETX_PROTO_TIME_FIRST		0	// first sync, time set
+#define ETX_PROTO_TIME_STEP			1	// too far off, time set
+#define ETX_PROTO_TIME_DRIFT		2	// drift updated, time set
+#define ETX_PROTO_TIME_SKIP			3	// too close to the last sync
+
+// BS Command format
+// A write to ETXPROFILE_CMD carries one or more commands, each one is
+// coded as [opcode][len][value...]. A single opcode byte is accepted as a
+// command without value. After the write, the characteristic holds one
+// response per command coded as [opcode | ETXCMD_RSP][len][status][data...]
+// A write without response to ETXPROFILE_BATCH carries [seq][commands...]
+// and is answered by one notification of [seq][responses...]
+#define ETXCMD_OPEN_QUESTION		0x01	// [question no.]
+#define ETXCMD_CLOSE_QUESTION		0x02	// -
+#define ETXCMD_LOCK_INPUT			0x03	// [1 to lock, 0 to unlock]
+#define ETXCMD_SET_LED				0x04	// [led][state][period lo][period hi]
+#define ETXCMD_GET_BATTERY			0x05	// - , rsp: [mV lo][mV hi]
+#define ETXCMD_GET_STATS			0x06	// - , rsp: [seq][wasted][held][sent][dropped][scan fails]
+#define ETXCMD_RESET_INIT			0x07	// -
+#define ETXCMD_SET_ADV_PARAM		0x08	// [interval lo][interval hi] (625us)
+#define ETXCMD_SET_CONN_PARAM		0x09	// [min][max][latency][timeout], uint16 each
+#define ETXCMD_SET_SCAN_PARAM		0x0A	// [period][duration], uint16 ms each
+#define ETXCMD_SET_TIME				0x0B	// [BS time, ms, 4 bytes]
+#define ETXCMD_START_QUIZ			0x0C	// [questions][min answer][max answer]
+#define ETXCMD_END_QUIZ				0x0D	// - , after the sheet is read
+#define ETXCMD_SET_KEY				0x0E	// [beacon key, 16 bytes], once
+#define ETXCMD_BIND					0x0F	// [bsID][session lo][session hi][counter, 4 bytes][tag, 4 bytes]
+
+#define ETXCMD_RSP					0x80
+
+// BS Command status
+#define ETXCMD_SUCCESS				0x00
+#define ETXCMD_ERR_UNKNOWN			0x01	// unknown opcode
+#define ETXCMD_ERR_LEN				0x02	// wrong value length
+#define ETXCMD_ERR_VALUE			0x03	// value out of range
+#define ETXCMD_ERR_STATE			0x04	// not allowed in current state
+
+// BS command batches wait in a ring between the stack, which puts them
+// in as they are written, and the app, which takes them out. Each side
+// only moves its own index, the depth has to divide 256 so they wrap
+// together
+#define ETX_PROTO_BATCH_LEN			20	// [seq][commands...]
+#define ETX_PROTO_BATCH_DEPTH		4
+
+// Longest response data of a BS command, it has to fit in ETXPROFILE_CMD_LEN
+// with its header
+#define ETXCMD_DATA_LEN				17
+
+// Response data of the commands that have any, room for it is kept before
+// the command runs
+#define ETXCMD_BATTERY_LEN			2
+#define ETXCMD_STATS_LEN			11
+
+// ETXCMD_BIND is the first contact of the BS picked. It carries the
+// fields of a beacon which tie it to the BS, counted and tagged the same
+// way, so a BS of another room can't claim it. The link it comes over is
+// the address of the BS from then on
+#define ETXCMD_BIND_LEN				11
+#define ETXCMD_BIND_COUNT_POS		3
+#define ETXCMD_BIND_TAG_POS			7
+
+// FNV-1a offset basis
+#define ETX_PROTO_HASH_INIT			2166136261u
+
+// Beacon tags are the first ETX_PROTO_TAG_LEN bytes of the AES-CMAC (RFC
+// 4493) of the fields before the tag followed by the 32 bit counter,
+// with the key provisioned for the installation
+#define ETX_PROTO_KEY_LEN			16
+#define ETX_PROTO_AES_LEN			16
+#define ETX_PROTO_TAG_LEN			4
+#define ETX_PROTO_TAG_MSG_LEN		32	// longest fields and counter
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// Encrypts one ETX_PROTO_AES_LEN block with AES-128, pIn and pOut may be
+// the same, returns false if the cipher failed
+typedef bool (*EtxProtoAes_t)(void *pArg, const uint8_t *pIn, uint8_t *pOut);
+
+// Beacon key, the cipher holds it, the AES engine on the ETX
+typedef struct EtxProtoKey_t {
+	EtxProtoAes_t pfnAes;
+	void *pArg;				// passed on to pfnAes
+} EtxProtoKey_t;
+
+// BS time kept against a local tick counter
+typedef struct EtxProtoTime_t {
+	bool isSynced;
+	uint32_t syncTick;		// tick of the last sync
+	uint32_t syncTime;		// BS time of the last sync, ms
+	int32_t driftPpm;		// how much faster the BS clock runs
+} EtxProtoTime_t;
+
+// BS command batch waiting for the app
+typedef struct EtxProtoBatch_t {
+	uint16_t connHandle;
+	uint8_t len;
+	uint8_t value[ETX_PROTO_BATCH_LEN];
+} EtxProtoBatch_t;
+
+typedef struct EtxProtoBatches_t {
+	EtxProtoBatch_t buf[ETX_PROTO_BATCH_DEPTH];
+	volatile uint8_t in;	// moved by the stack only
+	volatile uint8_t out;	// moved by the app only
+} EtxProtoBatches_t;
+
+// Executes one BS command, returns ETXCMD_SUCCESS or an ETXCMD_ERR_ code,
+// the response data goes to pData, up to the ETXCMD_..._LEN of the opcode
+typedef uint8_t (*EtxProtoCmdExec_t)(void *pArg, uint8_t opcode,
+		const uint8_t *pVal, uint8_t len, uint8_t *pData, uint8_t *pDataLen);
+
+/*********************************************************************
+ * FUNCTIONS
+ */
+
+/*
+ * FNV-1a hash step over a buffer, start from ETX_PROTO_HASH_INIT.
+ */
+extern uint32_t ETX_Proto_hash(uint32_t hash, const uint8_t *pBuf,
+		uint8_t len);
+
+/*
+ * Find the data of an AD structure of the given type and data length.
+ */
+extern const uint8_t *ETX_Proto_findAD(const uint8_t *pData, uint8_t dataLen,
+		uint8_t adType, uint8_t len);
+
+/*
+ * AES-CMAC of a message, the ETX_PROTO_AES_LEN byte MAC goes to pMac.
+ * Returns false if the cipher failed.
+ */
+extern bool ETX_Proto_cmac(const EtxProtoKey_t *pKey, const uint8_t *pMsg,
+		uint8_t len, uint8_t *pMac);
+
+/*
+ * Tag of a beacon over the tagPos bytes before the tag and the counter,
+ * it goes to pTag. Returns false if the cipher failed.
+ */
+extern bool ETX_Proto_tag(const uint8_t *pBeacon, uint8_t tagPos,
+		uint32_t count, const EtxProtoKey_t *pKey, uint8_t *pTag);
+
+/*
+ * Check the tag of a beacon.
+ */
+extern bool ETX_Proto_checkTag(const uint8_t *pBeacon, uint8_t tagPos,
+		uint32_t count, const EtxProtoKey_t *pKey);
+
+/*
+ * Look a vote up in an ack beacon, return ETX_PROTO_ACK_*.
+ */
+extern uint8_t ETX_Proto_ackCheck(const uint8_t *pAck, const uint8_t *pDevID,
+		uint8_t seq);
+
+/*
+ * Add a vote to the filter of an ack beacon, the BS side of
+ * ETX_Proto_ackCheck.
+ */
+extern void ETX_Proto_ackAdd(uint8_t *pAck, const uint8_t *pDevID,
+		uint8_t seq);
+
+/*
+ * Ack partition of a device.
+ */
+extern uint8_t ETX_Proto_partition(const uint8_t *pDevID, uint8_t partitions);
+
+/*
+ * TDMA slot of a device in a frame.
+ */
+extern uint16_t ETX_Proto_slot(const uint8_t *pDevID, uint8_t frame,
+		uint16_t slots);
+
+/*
+ * Advertising pause after an ack beacon missed the vote, in ms, from a
+ * random number.
+ */
+extern uint32_t ETX_Proto_backoff(uint8_t retries, uint32_t random);
+
+/*
+ * Write a vote as it goes in the advertising data.
+ */
+extern void ETX_Proto_putVote(uint8_t *pBuf, const uint8_t *pDevID,
+		uint8_t question, uint8_t seq, uint8_t answer, uint32_t time);
+
+/*
+ * Execute the BS commands of one write, return the length of the responses.
+ */
+extern uint8_t ETX_Proto_cmdProcess(const uint8_t *pCmd, uint8_t cmdLen,
+		uint8_t *pRsp, uint8_t rspSize, EtxProtoCmdExec_t pfnExec, void *pArg);
+
+/*
+ * Put a batch in the ring, false if it is full or the batch too long.
+ */
+extern bool ETX_Proto_batchPut(EtxProtoBatches_t *pRing, uint16_t connHandle,
+		const uint8_t *pValue, uint8_t len);
+
+/*
+ * Take the oldest batch out of the ring, return its length, 0 if the ring
+ * is empty. pValue holds ETX_PROTO_BATCH_LEN bytes.
+ */
+extern uint8_t ETX_Proto_batchGet(EtxProtoBatches_t *pRing,
+		uint16_t *pConnHandle, uint8_t *pValue);
+
+/*
+ * Sync to the BS time, return ETX_PROTO_TIME_*. The time error against
+ * the prediction goes to pError. tickPeriod is in us.
+ */
+extern uint8_t ETX_Proto_timeSync(EtxProtoTime_t *pTime, uint32_t bsTime,
+		uint32_t tick, uint32_t tickPeriod, int32_t *pError);
+
+/*
+ * BS time at a tick, time since tick 0 if never synced.
+ */
+extern uint32_t ETX_Proto_timeGet(const EtxProtoTime_t *pTime, uint32_t tick,
+		uint32_t tickPeriod);
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ETXPROTO_H */
@@ -0,0 +1,120 @@
+/*****************************************************************************
+ *
+ * @filepath    /evrs_tx_cc2650etx_app/src/etx_quiz.c
+ *
+ * @project     evrs_tx_cc2650etx_app
+ *
+ * @brief       answer sheet of a quiz
+ *
+ * @date        18 Oct. 2026
+ *
+ * @author      Ziyi@outlook.com.au
+ *
+ ****************************************************************************/
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <string.h>
+
+#include "etx_quiz.h"
+
+/*****************************************************************************
+ * @TAG Quiz
+ */
+/** settings of a quiz, answers from 1 up to maxAnswer **/
+bool ETX_Quiz_isValid(uint8_t numQuestions, uint8_t answerMin,
+		uint8_t answerMax, uint8_t maxAnswer) {
+	return (numQuestions != 0) && (numQuestions <= ETX_QUIZ_MAX_QUESTIONS)
+			&& (answerMin != 0) && (answerMin <= answerMax)
+			&& (answerMax <= maxAnswer);
+}
+
+void ETX_Quiz_start(EtxQuiz_t *pQuiz, uint16_t token, uint8_t numQuestions,
+		uint8_t answerMin, uint8_t answerMax) {
+	memset(pQuiz, 0, sizeof(EtxQuiz_t));
+	pQuiz->token = token;
+	pQuiz->numQuestions = numQuestions;
+	pQuiz->answerMin = answerMin;
+	pQuiz->answerMax = answerMax;
+}
+
+void ETX_Quiz_end(EtxQuiz_t *pQuiz) {
+	memset(pQuiz, 0, sizeof(EtxQuiz_t));
+}
+
+bool ETX_Quiz_check(const EtxQuiz_t *pQuiz, uint8_t maxAnswer) {
+	uint8_t i;
+
+	if (!ETX_Quiz_isValid(pQuiz->numQuestions, pQuiz->answerMin,
+			pQuiz->answerMax, maxAnswer)
+			|| (pQuiz->current >= pQuiz->numQuestions)
+			|| (pQuiz->flags & ~ETX_QUIZ_FLAG_SUBMITTED))
+		return false;
+
+	// the answers past the last question stay 0
+	for (i = 0; i < ETX_QUIZ_MAX_QUESTIONS; i++) {
+		uint8_t answer = pQuiz->answers[i];
+
+		if (answer == 0)
+			continue;
+		if ((i >= pQuiz->numQuestions) || (answer < pQuiz->answerMin)
+				|| (answer > pQuiz->answerMax))
+			return false;
+	}
+	return true;
+}
+
+bool ETX_Quiz_answer(EtxQuiz_t *pQuiz, uint8_t answer) {
+	if ((pQuiz->numQuestions == 0) || (pQuiz->flags & ETX_QUIZ_FLAG_SUBMITTED)
+			|| (answer < pQuiz->answerMin) || (answer > pQuiz->answerMax))
+		return false;
+
+	pQuiz->answers[pQuiz->current] = answer;
+	return true;
+}
+
+uint8_t ETX_Quiz_next(EtxQuiz_t *pQuiz) {
+	if (pQuiz->numQuestions != 0)
+		pQuiz->current = (pQuiz->current + 1) % pQuiz->numQuestions;
+	return pQuiz->current;
+}
+
+uint8_t ETX_Quiz_answered(const EtxQuiz_t *pQuiz) {
+	uint8_t i, count = 0;
+
+	for (i = 0; i < pQuiz->numQuestions; i++) {
+		if (pQuiz->answers[i] != 0)
+			count++;
+	}
+	return count;
+}
+
+bool ETX_Quiz_isDone(const EtxQuiz_t *pQuiz) {
+	return (pQuiz->numQuestions != 0)
+			&& (pQuiz->current == pQuiz->numQuestions - 1)
+			&& (ETX_Quiz_answered(pQuiz) == pQuiz->numQuestions);
+}
+
+/*********************************************************************
+ * @fn      ETX_Quiz_sheet
+ *
+ * @brief   Write the sheet as it is uploaded to the BS. Only the answers
+ *          of the questions of the quiz are written, so the BS reads the
+ *          whole sheet in as few long read requests as it can.
+ *
+ * @param   pQuiz - quiz
+ * @param   pBuf - buffer of ETX_QUIZ_SHEET_LEN bytes
+ *
+ * @return  length of the sheet
+ */
+uint8_t ETX_Quiz_sheet(const EtxQuiz_t *pQuiz, uint8_t *pBuf) {
+	pBuf[0] = (uint8_t) pQuiz->token;
+	pBuf[1] = (uint8_t) (pQuiz->token >> 8);
+	pBuf[2] = pQuiz->numQuestions;
+	pBuf[3] = ETX_Quiz_answered(pQuiz);
+	pBuf[4] = pQuiz->flags;
+	memcpy(&pBuf[ETX_QUIZ_SHEET_HDR_LEN], pQuiz->answers, pQuiz->numQuestions);
+
+	return ETX_QUIZ_SHEET_HDR_LEN + pQuiz->numQuestions;
+}
@@ -0,0 +1,125 @@
+/*****************************************************************************
+ *
+ * @filepath    /evrs_tx_cc2650etx_app/src/etx_quiz.h
+ *
+ * @project     evrs_tx_cc2650etx_app
+ *
+ * @brief       answer sheet of a quiz, the answers of all its questions are
+ *              kept on the device and uploaded in one go. Plain C with no
+ *              TI-RTOS or BLE stack dependency, so it also builds on a host,
+ *              see tools/etx_bs
+ *
+ * @date        18 Oct. 2026
+ *
+ * @author      Ziyi@outlook.com.au
+ *
+ ****************************************************************************/
+
+#ifndef ETXQUIZ_H
+#define ETXQUIZ_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#ifndef ETX_QUIZ_MAX_QUESTIONS
+#define ETX_QUIZ_MAX_QUESTIONS		32
+#endif
+
+// Sheet as uploaded: [session lo][session hi][questions][answered][flags]
+// [answers, one per question, 0 if not answered]
+#define ETX_QUIZ_SHEET_HDR_LEN		5
+#define ETX_QUIZ_SHEET_LEN			(ETX_QUIZ_SHEET_HDR_LEN \
+									+ ETX_QUIZ_MAX_QUESTIONS)
+
+#define ETX_QUIZ_FLAG_SUBMITTED		0x01	// the student is done
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// Quiz in progress, numQuestions is 0 if there is none. Kept in NV behind
+// the record header of evrs_tx_main.c
+typedef struct EtxQuiz_t {
+	uint16_t token;			// session token of the BS which started it
+	uint8_t numQuestions;
+	uint8_t current;		// question on the keys, from 0
+	uint8_t answerMin;
+	uint8_t answerMax;
+	uint8_t flags;			// ETX_QUIZ_FLAG_
+	uint8_t answers[ETX_QUIZ_MAX_QUESTIONS];
+} EtxQuiz_t;
+
+/*********************************************************************
+ * FUNCTIONS
+ */
+
+/*
+ * Check the settings of a quiz the BS asks for.
+ */
+extern bool ETX_Quiz_isValid(uint8_t numQuestions, uint8_t answerMin,
+		uint8_t answerMax, uint8_t maxAnswer);
+
+/*
+ * Start a quiz with an empty sheet at its first question.
+ */
+extern void ETX_Quiz_start(EtxQuiz_t *pQuiz, uint16_t token,
+		uint8_t numQuestions, uint8_t answerMin, uint8_t answerMax);
+
+/*
+ * Drop the quiz and its sheet.
+ */
+extern void ETX_Quiz_end(EtxQuiz_t *pQuiz);
+
+/*
+ * Check a quiz restored from NV, the answers included.
+ */
+extern bool ETX_Quiz_check(const EtxQuiz_t *pQuiz, uint8_t maxAnswer);
+
+/*
+ * Set the answer of the current question, false if it is out of range or
+ * the sheet is submitted.
+ */
+extern bool ETX_Quiz_answer(EtxQuiz_t *pQuiz, uint8_t answer);
+
+/*
+ * Step to the next question, the first one after the last. Returns the
+ * new current question.
+ */
+extern uint8_t ETX_Quiz_next(EtxQuiz_t *pQuiz);
+
+/*
+ * Number of questions answered.
+ */
+extern uint8_t ETX_Quiz_answered(const EtxQuiz_t *pQuiz);
+
+/*
+ * All questions answered and the last one is on the keys, the next KEY_OK
+ * submits the sheet.
+ */
+extern bool ETX_Quiz_isDone(const EtxQuiz_t *pQuiz);
+
+/*
+ * Write the sheet as uploaded, returns its length.
+ */
+extern uint8_t ETX_Quiz_sheet(const EtxQuiz_t *pQuiz, uint8_t *pBuf);
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ETXQUIZ_H */
@@ -29,6 +29,10 @@
 #include "gattservapp.h"
 #include "devinfoservice.h"
 #include "etx_gatt_prof.h"
+#include "etx_proto.h"
+#include "etx_link.h"
+#include "etx_fsm.h"
+#include "etx_quiz.h"
 
 #include "peripheral.h"
 #include "gapbondmgr.h"
@@ -45,11 +49,17 @@
 #include "etx_board.h"
 #include <ti/drivers/Power.h>
 #include <ti/drivers/ADC.h>
+#include <ti/drivers/crypto/CryptoCC26XX.h>
+#include <driverlib/sys_ctrl.h>
 #include "etx_board_key.h"
 #include "etx_board_led.h"
 #include "etx_board_display.h"
+#include "etx_board_trace.h"
 
 #include "evrs_tx_main.h"
+#include "etx_diag.h"
+#include "etx_capture.h"
+#include "etx_prof.h"
 
 /*********************************************************************
  * CONSTANTS
@@ -91,15 +101,58 @@
 #define ETX_TASK_STACK_SIZE                   1024
 #endif
 
-#define ETX_ADTYPE_DEST				0xAF
-#define ETX_ADTYPE_DEVID			0xAE
+// Idle period before the device shuts itself down (in ms)
+#ifndef ETX_INACTIVITY_TIMEOUT
+#define ETX_INACTIVITY_TIMEOUT                300000
+#endif
+
+// A shutdown refused while a link or the radio is busy is tried again
+// after this time (in ms)
+#define ETX_SHUTDOWN_RETRY			1000
+
+// Vote in the advertising data, see etx_proto.h
+#define ETX_ADV_VOTE_POS			12
+
+// Stack and heap high-water marks are updated this often (ms)
+#ifndef ETX_MON_PERIOD
+#define ETX_MON_PERIOD				60000
+#endif
+
+// The app task kicks the watchdog each time it wakes. The watchdog halts in
+// standby, so an idle device needs no kicks. Without standby it counts
+// while the task waits, so a clock also kicks it this often (ms)
+#if !defined(POWER_SAVING) || defined(USE_FPGA)
+#define ETX_WDT_KICK_PERIOD			(Board_WATCHDOG_RELOAD / 4)
+#endif
+
+// Beacon scan in IDLE, a scan of ETX_SCAN_DURATION is started every
+// ETX_SCAN_PERIOD (both in ms), 0 period disables it
+#ifndef ETX_SCAN_PERIOD
+#define ETX_SCAN_PERIOD				2000
+#endif
+#ifndef ETX_SCAN_DURATION
+#define ETX_SCAN_DURATION			100
+#endif
+
+// Devices the GAP keeps a record of in a scan, the records come out of the
+// ICall heap for the scan window. Beacons are taken from the reports as
+// they come, so only a few BS are kept track of
+#define ETX_SCAN_MAX_RES			4
+
+// The duty cycle stops after this many scans in a row the stack refused,
+// it is restarted with the next state change or SET_SCAN_PARAM
+#define ETX_SCAN_MAX_FAILS			3
 
-// Application state
-typedef enum AppState_t {
-	APP_STATE_INIT,
-	APP_STATE_IDLE,
-	APP_STATE_ACTIVE
-} AppState_t;
+// Ticks of the pending vote along the pipeline, 0 if not reached yet
+typedef struct EtxVoteProbe_t {
+	uint32_t keyTick;		// key ISR
+	uint32_t okTick;		// KEY_OK handled
+	uint32_t advTick;		// advertising enabled
+	uint32_t connTick;		// BS connected
+} EtxVoteProbe_t;
+
+// Action of the app state machine, false keeps the state
+typedef bool (*EtxFsmAction_t)(uint8_t param);
 
 // Internal Events for RTOS application
 #define ETX_GAP_STATE_CHG_EVT  		0x0001
@@ -108,11 +161,69 @@ typedef enum AppState_t {
 #define ETX_CONN_EVT_END_EVT    	0x0008
 #define ETX_KEY_PRESS_EVT      		0x0010
 #define ETX_APP_STATE_CHG_EVT  		0x0020
-
-#define ETX_DEVID_LEN 			4
+#define ETX_INACTIVITY_EVT			0x0040
+#define ETX_ADV_FALLBACK_EVT		0x0080
+// hdr.event is 8 bits, the app messages below are plain IDs, they never
+// meet the stack event flags
+#define ETX_SCAN_EVT				0x0009
+#define ETX_VOTE_RETRY_EVT			0x000A
+#define ETX_SLOT_EVT				0x000B
+#define ETX_MON_EVT					0x000C
+#define ETX_WDT_EVT					0x000D
+
+// Advertising modes are in etx_link.h
+
+// GAP advertising run by the app next to a link, GAPRole only advertises
+// non-connectable while connected
+#define ETX_GAP_ADV_OFF			0
+#define ETX_GAP_ADV_ON			1
+#define ETX_GAP_ADV_ENDING		2	// waiting for GAP_END_DISCOVERABLE_DONE
+
+#define ETX_DEVID_LEN 			ETX_PROTO_DEVID_LEN
 #define ETX_DEVID_NV_ID			0x80
 #define ETX_DEVID_PREFIX		0x95
 
+#define ETX_SESSION_NV_ID		0x81
+// 0x82 holds the last crash record, see etx_diag.h
+#define ETX_SHEET_NV_ID			0x83
+// Beacon key of the installation, written once by ETXCMD_SET_KEY
+#define ETX_KEY_NV_ID			0x84
+
+// Quiz record in NV, its header is the one of the session record in
+// etx_link.h
+#define ETX_SHEET_NV_VER		0xE1
+
+// Number of blocked ATT responses held for retransmission per connection
+#ifndef ETX_MAX_PENDING_RSP
+#define ETX_MAX_PENDING_RSP		4
+#endif
+
+// Ranges accepted by the BS commands, see Core spec Vol 6, Part B, 4.4.2
+#define ETX_ADV_INT_MIN			0x0020	// units of 625us
+#define ETX_ADV_INT_MAX			0x4000
+#define ETX_CONN_INT_MIN		6		// units of 1.25ms
+#define ETX_CONN_INT_MAX		3200
+#define ETX_CONN_LATENCY_MAX	499
+#define ETX_CONN_TIMEOUT_MIN	10		// units of 10ms
+#define ETX_CONN_TIMEOUT_MAX	3200
+
+// Diagnostics pages are read through the profile
+#if ETX_DIAG_PAGE_LEN > ETXPROFILE_DIAG_LEN
+#error "ETXPROFILE_DIAG_LEN is too small for the diagnostics pages"
+#endif
+
+// The quiz answer sheet is read through the profile
+#if ETX_QUIZ_SHEET_LEN > ETXPROFILE_SHEET_LEN
+#error "ETXPROFILE_SHEET_LEN is too small for the answer sheet"
+#endif
+
+// Number of base stations which can be connected at the same time
+#ifdef MAX_NUM_BLE_CONNS
+#define ETX_MAX_CONNS			MAX_NUM_BLE_CONNS
+#else
+#define ETX_MAX_CONNS			1
+#endif
+
 /*********************************************************************
  * TYPEDEFS
  */
@@ -120,8 +231,54 @@ typedef enum AppState_t {
 // App event passed from profiles.
 typedef struct SbpEvt_t {
 	appEvtHdr_t hdr;  // event header.
+	uint16_t connHandle; // connection the event came from, if any
 } SbpEvt_t;
 
+// ATT response held for retransmission
+typedef struct EtxAttRsp_t {
+	gattMsgEvent_t *pMsg;	// blocked response message
+	uint32_t holdTick;		// clock tick when the response was blocked
+} EtxAttRsp_t;
+
+// FIFO of blocked ATT responses of a connection
+typedef struct EtxAttRspQueue_t {
+	EtxAttRsp_t slot[ETX_MAX_PENDING_RSP];
+	uint8_t head;
+	uint8_t count;
+} EtxAttRspQueue_t;
+
+// ATT response retransmission counters
+typedef struct EtxAttRspStats_t {
+	uint16_t held;			// responses blocked and queued
+	uint16_t sent;			// queued responses sent out
+	uint16_t dropped;		// responses dropped (queue full or link lost)
+	uint32_t retries;		// retransmission attempts
+	uint32_t latencyMax;	// worst blocked to sent time, in clock ticks
+	uint32_t latencySum;	// sum of blocked to sent time, in clock ticks
+} EtxAttRspStats_t;
+
+// Per connection context of a base station link
+typedef struct EtxConn_t {
+	uint16_t connHandle;	// INVALID_CONNHANDLE if the slot is free
+	uint8_t peerAddrType;
+	uint8_t peerAddr[B_ADDR_LEN];
+	uint16_t mtu;			// negotiated ATT MTU
+	uint16_t connInterval;	// units of 1.25ms
+	uint16_t connLatency;
+	uint16_t connTimeout;	// units of 10ms
+	bool isVoteAcked;		// the vote has been collected over this link
+	uint16_t batchCount;	// BS command batches executed
+	uint8_t batchSeq;		// next expected BS command batch seq
+	EtxAttRspQueue_t attRsp;
+} EtxConn_t;
+
+// Quiz record kept in NV
+typedef struct EtxSheetRec_t {
+	uint8_t version;		// ETX_SHEET_NV_VER
+	uint8_t len;			// sizeof(EtxSheetRec_t)
+	EtxQuiz_t quiz;
+} EtxSheetRec_t;
+
 /*********************************************************************
  * GLOBAL VARIABLES
  */
@@ -139,6 +296,29 @@ static ICall_Semaphore sem;
 // Clock instances for internal periodic events.
 //static Clock_Struct periodicClock;
 
+// Clock instance for inactivity shutdown
+static Clock_Struct inactivityClock;
+
+// Clock instance for advertising mode fallback
+static Clock_Struct advFallbackClock;
+
+// Clock instance for the beacon scan duty cycle
+static Clock_Struct scanClock;
+
+// Clock instance for the vote retry back-off
+static Clock_Struct voteRetryClock;
+
+// Clock instance for the start and end of the TDMA slot
+static Clock_Struct slotClock;
+
+// Clock instance for the stack and heap monitor
+static Clock_Struct monClock;
+
+#ifdef ETX_WDT_KICK_PERIOD
+// Clock instance for the watchdog kicks
+static Clock_Struct wdtClock;
+#endif
+
 // Queue object used for app messages
 static Queue_Struct appMsg;
 static Queue_Handle appMsgQueue;
@@ -147,6 +327,9 @@ static Queue_Handle appMsgQueue;
 Task_Struct sbpTask;
 Char sbpTaskStack[ETX_TASK_STACK_SIZE];
 
+// GAPRole task, in peripheral.c
+extern Task_Struct gapRoleTask;
+
 // App state and parameters
 static AppState_t appState = APP_STATE_INIT;
 
@@ -167,7 +350,12 @@ static uint8_t advertData[] = {
 		LO_UINT16(ETXPROFILE_SERV_UUID), HI_UINT16(ETXPROFILE_SERV_UUID),
 
 		0x02,
-		ETX_ADTYPE_DEST, 0x00
+		ETX_ADTYPE_DEST, 0x00,
+
+		// pending vote, filled in ETX_Vote_updateAdvert()
+		0x0C,
+		ETX_ADTYPE_VOTE, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00
 };
 
 // GAP - SCAN RSP data (max size = 31 bytes)
@@ -192,9 +380,11 @@ static uint8_t scanRspData[15] = {
 // GAP GATT Attributes
 static const uint8_t attDeviceName[GAP_DEVICE_NAME_LEN] = "EVRS Transmitter";
 
+// Connected base stations
+static EtxConn_t connList[ETX_MAX_CONNS];
+
 // Globals used for ATT Response retransmission
-static gattMsgEvent_t *pAttRsp = NULL;
-static uint8_t rspTxRetry = 0;
+static EtxAttRspStats_t attRspStats = { 0 };
 
 // battery level flag
 static bool isBatLow = false;
@@ -205,6 +395,87 @@ static uint8_t destBSID = 0x00;
 // User Data Buffer
 static uint8_t userData = 0x00;
 
+// Question announced by the base station, votes are only taken while open
+static uint8_t questionNum = 0;
+static bool isQuestionOpen = true;
+
+// Keys locked by the base station
+static bool isInputLocked = false;
+
+// Answers accepted for the current question
+static uint8_t answerMin = 1;
+static uint8_t answerMax = KEY_OK - 1;
+
+// Beacon scan duty cycle, in ms
+static uint16_t scanPeriod = ETX_SCAN_PERIOD;
+static uint16_t scanDuration = ETX_SCAN_DURATION;
+
+// Sequence number of the last collected vote
+static uint8_t voteSeq = 0;
+
+// Ack beacons which missed the pending vote
+static uint8_t voteRetries = 0;
+
+// BS time, ms. The TI-RTOS Clock runs off the RTC, so it keeps counting
+// in standby, and is corrected by the drift measured between syncs
+static EtxProtoTime_t bsTime = { 0 };
+
+// Time KEY_OK was pressed for the pending vote
+static uint32_t voteTime = 0;
+
+// Latency probes
+static EtxVoteProbe_t voteProbe = { 0 };
+static uint32_t keyDebounceTick = 0;
+
+// Slotted submission announced by the BS beacon
+static bool isSlotted = false;
+static bool isInSlot = false;
+static uint8_t slotLen = 0;		// in ms
+
+// Session token given by the base station, 0 if none
+static uint16_t sessionToken = 0;
+
+// Counter of the last beacon taken, see ETX_Link_beacon
+static uint32_t beaconCount = 0;
+
+// Beacon key of the installation, beacons are ignored until it is set.
+// The AES engine is shared with the stack, the key goes in its key store
+// for every tag checked. Words, the key store takes aligned keys
+static uint32_t beaconKey[ETX_PROTO_KEY_LEN / 4];
+static bool isBeaconKeySet = false;
+static CryptoCC26XX_Handle cryptoHandle = NULL;
+
+// session restored from NV after waking up from shutdown
+static bool isSessionResumed = false;
+
+// Quiz in progress, the sheet is stored in NV when the student moves on
+// from an answer and before shutdown
+static EtxQuiz_t quiz = { 0 };
+static bool isSheetDirty = false;
+
+// Quiz asked for by ETXCMD_START_QUIZ, [questions][min answer][max answer]
+static uint8_t quizReq[3] = { 0 };
+
+// Address of the base station which collected the last vote
+static bool isBSAddrKnown = false;
+static uint8_t bsAddrType = 0;
+static uint8_t bsAddr[B_ADDR_LEN] = { 0 };
+
+// Current advertising mode
+static uint8_t advMode = ETX_ADV_OFF;
+
+// Connectable advertising next to a link, and the mode to start once the
+// GAP has ended the previous one
+static uint8_t gapAdvState = ETX_GAP_ADV_OFF;
+static uint8_t advPending = ETX_ADV_OFF;
+
+// Links which were released without collecting the pending vote
+static uint16_t connWasted = 0;
+
+// Beacon scans the stack refused, in all and in a row
+static uint16_t scanFailed = 0;
+static uint8_t scanFailRun = 0;
+
 // device ID params about Flash
 static uint8_t devID[ETX_DEVID_LEN] = { 0 };
 
@@ -217,33 +488,111 @@ static void ETX_taskFxn(UArg a0, UArg a1);
 
 /** Internal message gen and routing **/
 static void ETX_enqueueMsg(uint8_t event, uint8_t state);
+static void ETX_enqueueConnMsg(uint8_t event, uint8_t state,
+		uint16_t connHandle);
 static uint8_t ETX_processStackMsg(ICall_Hdr *pMsg);
 static void ETX_processAppMsg(SbpEvt_t *pMsg);
 
-static void ETX_sendAttRsp(void);
-static void ETX_freeAttRsp(uint8_t status);
+static bool ETX_holdAttRsp(EtxConn_t *pConn, gattMsgEvent_t *pMsg);
+static void ETX_sendAttRsp(EtxConn_t *pConn);
+static void ETX_freeAttRsp(EtxConn_t *pConn, uint8_t status);
+static void ETX_flushAttRsp(EtxConn_t *pConn, uint8_t status);
+
+/** Connection contexts **/
+static EtxConn_t *ETX_Conn_Find(uint16_t connHandle);
+static EtxConn_t *ETX_Conn_Add(uint16_t connHandle);
+static void ETX_Conn_Prune(void);
+
+static bool ETX_shutdown(void);
+static void ETX_advertise(uint8_t mode);
+static void ETX_whitelistUpdate(void);
+static void ETX_BS_learn(uint8_t addrType, const uint8_t *pAddr);
 
 
 /** Callbacks **/
 static void ETX_CB_GAPRoleStateChange(gaprole_States_t newState);
-static void ETX_CB_charValueChange(uint8_t paramID);
-static void ETX_CB_charValueEnquire(uint8_t paramID);
+static void ETX_CB_charValueChange(uint16_t connHandle, uint8_t paramID);
+static void ETX_CB_charValueEnquire(uint16_t connHandle, uint8_t paramID);
 static void ETX_CB_keyPress(uint8_t keys);
 static void ETX_CBm_appStateChange(AppState_t newState);
+static void ETX_CB_inactivityTimeout(UArg arg);
+static void ETX_CB_advFallbackTimeout(UArg arg);
+static void ETX_CB_scanTimeout(UArg arg);
+static void ETX_CB_voteRetryTimeout(UArg arg);
+static void ETX_CB_slotTimeout(UArg arg);
+static void ETX_CB_monTimeout(UArg arg);
+#ifdef ETX_WDT_KICK_PERIOD
+static void ETX_CB_wdtTimeout(UArg arg);
+#endif
 
 /** Event process service **/
 static uint8_t ETX_EVT_GATTMsgReceived(gattMsgEvent_t *pMsg);
 static void ETX_EVT_GAPRoleStateChange(gaprole_States_t newState);
-static void ETX_EVT_charValueChange(uint8_t paramID);
-static void ETX_EVT_charValueEnquire(uint8_t paramID);
+static void ETX_EVT_charValueChange(uint16_t connHandle, uint8_t paramID);
+static void ETX_EVT_charValueEnquire(uint16_t connHandle, uint8_t paramID);
 static void ETX_EVT_keyPress(uint8_t shift, uint8_t keys);
 static void ETX_EVT_appStateChange(AppState_t newState);
+static void ETX_EVT_GAPMsgReceived(gapEventHdr_t *pMsg);
+
+// App state machine
+static bool ETX_Fsm_dispatch(uint8_t event, uint8_t param);
+static bool ETX_Fsm_guard(uint8_t guard, uint8_t param);
+static bool ETX_Fsm_setBS(uint8_t param);
+static bool ETX_Fsm_join(uint8_t param);
+static bool ETX_Fsm_locked(uint8_t param);
+static bool ETX_Fsm_answer(uint8_t param);
+static bool ETX_Fsm_vote(uint8_t param);
+static bool ETX_Fsm_collected(uint8_t param);
+static bool ETX_Fsm_quizStart(uint8_t param);
+static bool ETX_Fsm_quizAnswer(uint8_t param);
+static bool ETX_Fsm_quizNext(uint8_t param);
+static bool ETX_Fsm_quizSubmit(uint8_t param);
+static bool ETX_Fsm_quizEnd(uint8_t param);
+
+// BS command interpreter
+static uint8_t ETX_CMD_process(EtxConn_t *pConn, const uint8_t *pCmd,
+		uint8_t cmdLen, uint8_t *pRsp, uint8_t rspSize);
+static uint8_t ETX_CMD_run(void *pArg, uint8_t opcode, const uint8_t *pVal,
+		uint8_t len, uint8_t *pData, uint8_t *pDataLen);
+static uint8_t ETX_CMD_exec(EtxConn_t *pConn, uint8_t opcode,
+		const uint8_t *pVal, uint8_t len, uint8_t *pData, uint8_t *pDataLen);
+static void ETX_CMD_batch(uint16_t connHandle, uint8_t *pBatch, uint8_t len);
+static void ETX_Question_set(uint8_t num, bool isOpen);
+
+// Beacon listener
+static void ETX_Scan_start(void);
+static void ETX_Scan_stop(void);
+static bool ETX_Crypto_aes(void *pArg, const uint8_t *pIn, uint8_t *pOut);
+static bool ETX_Beacon_verify(const uint8_t *pBeacon, uint8_t countPos,
+		uint8_t tagPos);
+static void ETX_Beacon_process(uint8_t addrType, const uint8_t *pAddr,
+		const uint8_t *pData, uint8_t dataLen);
+static void ETX_Ack_process(const uint8_t *pData, uint8_t dataLen);
+
+// Votes
+static void ETX_Vote_updateAdvert(void);
+static void ETX_Vote_collected(void);
+static void ETX_Slot_schedule(uint8_t frame, uint16_t slots, uint8_t len);
+static void ETX_Slot_stop(void);
+
+// Time sync
+static void ETX_Time_sync(uint32_t time);
+static uint32_t ETX_Time_get(uint32_t tick);
 
 /** Device ID **/
 static void ETX_DevId_Find(uint8_t* nvBuf);
 static void ETX_DevId_Refresh(uint8_t IdPrefix, uint8_t* nvBuf);
 static void ETX_DevID_updateScanRsp();
 
+/** Session retention **/
+static bool ETX_Session_Load(void);
+static void ETX_Session_Store(void);
+static bool ETX_Sheet_Load(void);
+static void ETX_Sheet_Store(void);
+static void ETX_Sheet_publish(void);
+static void ETX_Key_Load(void);
+static bool ETX_Key_Store(const uint8_t *pKey);
+
 /** Battery Level **/
 static uint32_t ETX_ADC_valueGet(uint8_t BOARD_ADC);
 
@@ -325,11 +674,48 @@ static void ETX_init(void) {
 	// Create an RTOS queue for message from profile to be sent to app.
 	appMsgQueue = Util_constructQueue(&appMsg);
 
+	// No base station connected yet
+	{
+		uint8_t i;
+		for (i = 0; i < ETX_MAX_CONNS; i++)
+			connList[i].connHandle = INVALID_CONNHANDLE;
+	}
+
 	Board_initKeys(ETX_CB_keyPress);
 	Board_initLEDs();
 	Board_Display_Init();
 	ADC_init();
 
+	// save what the last crash left behind, before anything else can fail
+	ETX_Diag_recover();
+	uprofInit();
+
+	// the task loop kicks it, so the kicks stop if the loop does
+	ETX_Diag_watchdogOpen();
+	ETX_Diag_loadOpen();
+#ifdef ETX_WDT_KICK_PERIOD
+	Util_constructClock(&wdtClock, ETX_CB_wdtTimeout,
+			ETX_WDT_KICK_PERIOD, ETX_WDT_KICK_PERIOD, true, 0);
+#endif
+
+	Util_constructClock(&inactivityClock, ETX_CB_inactivityTimeout,
+			ETX_INACTIVITY_TIMEOUT, 0, false, 0);
+	Util_constructClock(&advFallbackClock, ETX_CB_advFallbackTimeout,
+			ETX_DIRECT_ADV_TIMEOUT, 0, false, 0);
+	Util_constructClock(&scanClock, ETX_CB_scanTimeout,
+			ETX_SCAN_PERIOD, ETX_SCAN_PERIOD, false, 0);
+	Util_constructClock(&voteRetryClock, ETX_CB_voteRetryTimeout,
+			ETX_VOTE_BACKOFF, 0, false, 0);
+	Util_constructClock(&slotClock, ETX_CB_slotTimeout, 1, 0, false, 0);
+	Util_constructClock(&monClock, ETX_CB_monTimeout,
+			ETX_MON_PERIOD, ETX_MON_PERIOD, true, 0);
+
+	// paint the stacks before they see much use
+	ETX_Diag_addStack(Task_handle(&sbpTask));
+	ETX_Diag_addStack(Task_handle(&gapRoleTask));
+	utraceTask(Task_handle(&sbpTask));
+	utraceTask(Task_handle(&gapRoleTask));
+
 	Board_ledON(BOARD_RLED);
 	Board_ledON(BOARD_BLED);
 
@@ -355,6 +741,27 @@ static void ETX_init(void) {
 		ETX_DevID_updateScanRsp();
 	}
 
+	// Beacon key, the AES engine checks the beacon tags
+	{
+		CryptoCC26XX_Params cryptoParams;
+
+		ETX_Key_Load();
+		CryptoCC26XX_init();
+		CryptoCC26XX_Params_init(&cryptoParams);
+		cryptoHandle = CryptoCC26XX_open(Board_CRYPTO, false, &cryptoParams);
+		if (cryptoHandle == NULL)
+			uout0("AES engine not available, beacons are ignored");
+	}
+
+	// Resume the session after waking up from shutdown, the advertising
+	// data is populated here so the device can go straight to IDLE
+	if (SysCtrlResetSourceGet() == RSTSRC_WAKEUP_FROM_SHUTDOWN) {
+		isSessionResumed = ETX_Session_Load();
+		advertData[9] = destBSID;
+		if (isSessionResumed)
+			ETX_Sheet_Load();
+	}
+
 	// Setup the GAP
 	GAP_SetParamValue(TGAP_CONN_PAUSE_PERIPHERAL, CONN_PAUSE_PERIPHERAL);
 
@@ -373,6 +780,7 @@ static void ETX_init(void) {
 		uint16_t desiredMaxInterval = DEFAULT_DESIRED_MAX_CONN_INTERVAL;
 		uint16_t desiredSlaveLatency = DEFAULT_DESIRED_SLAVE_LATENCY;
 		uint16_t desiredConnTimeout = DEFAULT_DESIRED_CONN_TIMEOUT;
+		uint8_t maxScanRes = ETX_SCAN_MAX_RES;
 
 		// Set the GAP Role Parameters
 		GAPRole_SetParameter(GAPROLE_ADVERT_ENABLED, sizeof(uint8_t),
@@ -395,6 +803,9 @@ static void ETX_init(void) {
 				&desiredSlaveLatency);
 		GAPRole_SetParameter(GAPROLE_TIMEOUT_MULTIPLIER, sizeof(uint16_t),
 				&desiredConnTimeout);
+		// observer role of PLUS_OBSERVER, for the beacon scan
+		GAPRole_SetParameter(GAPROLE_MAX_SCAN_RES, sizeof(uint8_t),
+				&maxScanRes);
 	}
 
 	// Set the GAP Characteristics
@@ -499,6 +910,9 @@ static void ETX_taskFxn(UArg a0, UArg a1) {
 			ICall_ServiceEnum src;
 			ICall_HciExtEvt *pMsg = NULL;
 
+			utrace(BOARD_TRACE_WAKE, 0);
+			ETX_Diag_kick();
+
 			if (ICall_fetchServiceMsg(&src, &dest,
 					(void **) &pMsg) == ICALL_ERRNO_SUCCESS) {
 				uint8 safeToDealloc = TRUE;
@@ -508,14 +922,28 @@ static void ETX_taskFxn(UArg a0, UArg a1) {
 
 					// Check for BLE stack events first
 					if (pEvt->signature == 0xffff) {
+						ETX_Diag_loopBegin(ETX_DIAG_MSG_STACK_EVT,
+								(uint8_t) pEvt->event_flag);
+						utrace(BOARD_TRACE_STACK_EVT, pEvt->event_flag);
+						ucaptureEvt(pEvt->event_flag);
 						if (pEvt->event_flag & ETX_CONN_EVT_END_EVT) {
-							// Try to retransmit pending ATT Response (if any)
-							ETX_sendAttRsp();
+							// Try to retransmit pending ATT Responses (if any)
+							uint8_t i;
+							for (i = 0; i < ETX_MAX_CONNS; i++)
+								ETX_sendAttRsp(&connList[i]);
 						}
 					} else {
 						// Process inter-task message
+						ETX_Diag_loopBegin(ETX_DIAG_MSG_STACK,
+								((ICall_Hdr*) pMsg)->event);
+						ucaptureMsg(pMsg);
+						uprofBegin("stackMsg");
 						safeToDealloc = ETX_processStackMsg((ICall_Hdr*) pMsg);
+						uprofEnd();
 					}
+					ETX_Diag_loopEnd();
+					utrace(BOARD_TRACE_END, 0);
+					ucaptureEnd();
 				}
 
 				if (pMsg && safeToDealloc) {
@@ -528,7 +956,13 @@ static void ETX_taskFxn(UArg a0, UArg a1) {
 				SbpEvt_t *pMsg = (SbpEvt_t *) Util_dequeueMsg(appMsgQueue);
 				if (pMsg) {
 					// Process message.
+					ETX_Diag_loopBegin(ETX_DIAG_MSG_APP, pMsg->hdr.event);
+					ucaptureApp(pMsg->hdr.event, pMsg->hdr.state,
+							pMsg->connHandle);
 					ETX_processAppMsg(pMsg);
+					ETX_Diag_loopEnd();
+					utrace(BOARD_TRACE_END, 0);
+					ucaptureEnd();
 
 					// Free the space from the message.
 					ICall_free(pMsg);
@@ -545,12 +979,19 @@ static void ETX_taskFxn(UArg a0, UArg a1) {
  */
 /** Creates a message and puts the message in RTOS queue **/
 static void ETX_enqueueMsg(uint8_t event, uint8_t state) {
+	ETX_enqueueConnMsg(event, state, INVALID_CONNHANDLE);
+}
+
+/** Creates a message of a connection and puts it in RTOS queue **/
+static void ETX_enqueueConnMsg(uint8_t event, uint8_t state,
+		uint16_t connHandle) {
 	SbpEvt_t *pMsg;
 
 	// Create dynamic pointer to message.
 	if ((pMsg = ICall_malloc(sizeof(SbpEvt_t)))) {
 		pMsg->hdr.event = event;
 		pMsg->hdr.state = state;
+		pMsg->connHandle = connHandle;
 
 		// Enqueue the message.
 		Util_enqueueMsg(appMsgQueue, sem, (uint8*) pMsg);
@@ -559,25 +1000,109 @@ static void ETX_enqueueMsg(uint8_t event, uint8_t state) {
 
 /** Process an incoming callback from a profile **/
 static void ETX_processAppMsg(SbpEvt_t *pMsg) {
+	utrace(BOARD_TRACE_APP_MSG, (pMsg->hdr.state << 8) | pMsg->hdr.event);
+	ETX_Diag_event(pMsg->hdr.event, pMsg->hdr.state);
 	switch (pMsg->hdr.event) {
 		case ETX_GAP_STATE_CHG_EVT:
 			ETX_EVT_GAPRoleStateChange((gaprole_States_t) pMsg->hdr.state);
 		break;
 
 		case ETX_APP_STATE_CHG_EVT:
+			uprofBegin("appStateChange");
 			ETX_EVT_appStateChange((AppState_t) pMsg->hdr.state);
+			uprofEnd();
 		break;
 
 		case ETX_CHAR_CHANGE_EVT:
-			ETX_EVT_charValueChange(pMsg->hdr.state);
+			ETX_EVT_charValueChange(pMsg->connHandle, pMsg->hdr.state);
 		break;
 
 		case ETX_CHAR_ENQUIRE_EVT:
-			ETX_EVT_charValueEnquire(pMsg->hdr.state);
+			ETX_EVT_charValueEnquire(pMsg->connHandle, pMsg->hdr.state);
 		break;
 
 		case ETX_KEY_PRESS_EVT:
+			uprofBegin("keyPress");
 			ETX_EVT_keyPress(0, pMsg->hdr.state);
+			uprofEnd();
+		break;
+
+		case ETX_INACTIVITY_EVT:
+			uout0("inactivity timeout");
+			ETX_Fsm_dispatch(ETX_FSM_EVT_TIMEOUT, 0);
+		break;
+
+		case ETX_SCAN_EVT:
+			if (appState != APP_STATE_INIT) {
+				gapDevDiscReq_t discReq;
+				bStatus_t status;
+
+				// the results are reported to this task, not to GAPRole
+				discReq.taskID = ICall_getLocalMsgEntityId(
+						ICALL_SERVICE_CLASS_BLE_MSG, selfEntity);
+				discReq.mode = DEVDISC_MODE_ALL;
+				discReq.activeScan = FALSE;
+				discReq.whiteList = FALSE;
+				GAP_SetParamValue(TGAP_GEN_DISC_SCAN, scanDuration);
+				status = GAP_DeviceDiscoveryRequest(&discReq);
+				if (status == SUCCESS) {
+					scanFailRun = 0;
+					utrace(BOARD_TRACE_SCAN, scanDuration);
+					break;
+				}
+				// counted in GET_STATS, and not retried for ever
+				scanFailed++;
+				uout1("Beacon scan not started: 0x%02x", status);
+				if (++scanFailRun >= ETX_SCAN_MAX_FAILS) {
+					Util_stopClock(&scanClock);
+					uout1("Beacon scan stopped after %d failures", scanFailRun);
+				}
+			}
+		break;
+
+		case ETX_MON_EVT:
+			ETX_Diag_monitor();
+		break;
+
+		case ETX_WDT_EVT:
+			// the wake has kicked the watchdog
+		break;
+
+		case ETX_VOTE_RETRY_EVT:
+			if ((appState == APP_STATE_ACTIVE) && !isSlotted)
+				ETX_advertise(ETX_ADV_ON);
+		break;
+
+		case ETX_SLOT_EVT:
+			if ((appState != APP_STATE_ACTIVE) || !isSlotted)
+				break;
+			if (!isInSlot) {
+				// directed advertising would overrun the slot
+				isInSlot = true;
+				ETX_advertise(isBSAddrKnown ? ETX_ADV_WHITELIST : ETX_ADV_OPEN);
+				Util_restartClock(&slotClock, slotLen);
+			} else {
+				// a link set up in the slot is left to finish
+				isInSlot = false;
+				ETX_advertise(ETX_ADV_OFF);
+			}
+		break;
+
+		case ETX_ADV_FALLBACK_EVT:
+			// the last base station did not show up, widen the advertising
+			if (((appState == APP_STATE_ACTIVE)
+					|| (appState == APP_STATE_SUBMIT))
+					&& (linkDB_NumActive() == 0)
+					&& (advMode != ETX_ADV_OFF)) {
+				uint32_t timeout;
+				uint8_t mode = ETX_Link_advFallback(advMode, &timeout);
+
+				if (mode != ETX_ADV_OFF) {
+					uout1("Adv mode %d timeout, fall back", advMode);
+					ETX_advertise(mode);
+				}
+			}
+		break;
 
 		default:
 			// Do nothing.
@@ -589,12 +1114,19 @@ static void ETX_processAppMsg(SbpEvt_t *pMsg) {
 static uint8_t ETX_processStackMsg(ICall_Hdr *pMsg) {
 	uint8_t safeToDealloc = TRUE;
 
+	utrace(BOARD_TRACE_STACK_MSG, pMsg->event);
+
 	switch (pMsg->event) {
 		case GATT_MSG_EVENT:
 			// Process GATT message
 			safeToDealloc = ETX_EVT_GATTMsgReceived((gattMsgEvent_t *) pMsg);
 		break;
 
+		case GAP_MSG_EVENT:
+			// Process GAP message, only the beacon scan reports here
+			ETX_EVT_GAPMsgReceived((gapEventHdr_t *) pMsg);
+		break;
+
 		case HCI_GAP_EVENT_EVENT:
 			// Process HCI message
 			if (pMsg->status == HCI_BLE_HARDWARE_ERROR_EVENT_CODE)
@@ -609,69 +1141,383 @@ static uint8_t ETX_processStackMsg(ICall_Hdr *pMsg) {
 	return (safeToDealloc);
 }
 
+/*********************************************************************
+ * @fn      ETX_holdAttRsp
+ *
+ * @brief   Queue a blocked ATT response for retransmission on the next
+ *          connection events.
+ *
+ * @param   pConn - connection the response belongs to
+ * @param   pMsg - GATT message holding the blocked response
+ *
+ * @return  TRUE if the message is held, FALSE if the queue is full
+ */
+static bool ETX_holdAttRsp(EtxConn_t *pConn, gattMsgEvent_t *pMsg) {
+	EtxAttRspQueue_t *pQueue = &pConn->attRsp;
+	EtxAttRsp_t *pSlot;
+
+	if (pQueue->count >= ETX_MAX_PENDING_RSP) {
+		attRspStats.dropped++;
+		return (FALSE);
+	}
+
+	// Retransmit on the end of each connection event while responses are
+	// pending, this is a no-op when the notice is already enabled
+	if (HCI_EXT_ConnEventNoticeCmd(pMsg->connHandle, selfEntity,
+			ETX_CONN_EVT_END_EVT) != SUCCESS) {
+		attRspStats.dropped++;
+		return (FALSE);
+	}
+
+	pSlot = &pQueue->slot[(pQueue->head + pQueue->count)
+			% ETX_MAX_PENDING_RSP];
+	pSlot->pMsg = pMsg;
+	pSlot->holdTick = Clock_getTicks();
+	pQueue->count++;
+	attRspStats.held++;
+
+	return (TRUE);
+}
+
 /*********************************************************************
  * @fn      ETX_sendAttRsp
  *
- * @brief   Send a pending ATT response message.
+ * @brief   Send the pending ATT responses in FIFO order, stop at the
+ *          first one which is still blocked.
  *
- * @param   none
+ * @param   pConn - connection to serve
  *
  * @return  none
  */
-static void ETX_sendAttRsp(void) {
-	// See if there's a pending ATT Response to be transmitted
-	if (pAttRsp != NULL) {
+static void ETX_sendAttRsp(EtxConn_t *pConn) {
+	while (pConn->attRsp.count > 0) {
+		gattMsgEvent_t *pMsg = pConn->attRsp.slot[pConn->attRsp.head].pMsg;
 		uint8_t status;
 
-		// Increment retransmission count
-		rspTxRetry++;
+		attRspStats.retries++;
 
 		// Try to retransmit ATT response till either we're successful or
 		// the ATT Client times out (after 30s) and drops the connection.
-		status = GATT_SendRsp(pAttRsp->connHandle, pAttRsp->method,
-				&(pAttRsp->msg));
-		if ((status != blePending) && (status != MSG_BUFFER_NOT_AVAIL)) {
-			// Disable connection event end notice
-			HCI_EXT_ConnEventNoticeCmd(pAttRsp->connHandle, selfEntity, 0);
-
-			// We're done with the response message
-			ETX_freeAttRsp(status);
-		} else {
-			// Continue retrying
-			uout1("Rsp send retry: %d", rspTxRetry);
+		status = GATT_SendRsp(pMsg->connHandle, pMsg->method, &(pMsg->msg));
+		if ((status == blePending) || (status == MSG_BUFFER_NOT_AVAIL)) {
+			// Continue retrying on the next connection event
+			return;
 		}
+
+		// We're done with this response message
+		ETX_freeAttRsp(pConn, status);
 	}
 }
 
 /*********************************************************************
  * @fn      ETX_freeAttRsp
  *
- * @brief   Free ATT response message.
+ * @brief   Free the ATT response message at the head of the queue.
  *
+ * @param   pConn - connection the response belongs to
  * @param   status - response transmit status
  *
  * @return  none
  */
-static void ETX_freeAttRsp(uint8_t status) {
+static void ETX_freeAttRsp(EtxConn_t *pConn, uint8_t status) {
+	EtxAttRspQueue_t *pQueue = &pConn->attRsp;
+	EtxAttRsp_t *pSlot;
+
 	// See if there's a pending ATT response message
-	if (pAttRsp != NULL) {
-		// See if the response was sent out successfully
-		if (status == SUCCESS) {
-			uout1("Rsp sent retry: %d", rspTxRetry);
-		} else {
-			// Free response payload
-			GATT_bm_free(&pAttRsp->msg, pAttRsp->method);
-
-			uout1("Rsp retry failed: %d", rspTxRetry);
+	if (pQueue->count == 0)
+		return;
+
+	pSlot = &pQueue->slot[pQueue->head];
+
+	// See if the response was sent out successfully
+	if (status == SUCCESS) {
+		uint32_t latency = Clock_getTicks() - pSlot->holdTick;
+
+		attRspStats.sent++;
+		attRspStats.latencySum += latency;
+		if (latency > attRspStats.latencyMax)
+			attRspStats.latencyMax = latency;
+	} else {
+		// Free response payload
+		GATT_bm_free(&pSlot->pMsg->msg, pSlot->pMsg->method);
+
+		attRspStats.dropped++;
+	}
+
+	// Disable connection event end notice once nothing is pending
+	if (pQueue->count == 1)
+		HCI_EXT_ConnEventNoticeCmd(pSlot->pMsg->connHandle, selfEntity, 0);
+
+	// Free response message
+	ICall_freeMsg(pSlot->pMsg);
+
+	pSlot->pMsg = NULL;
+	pQueue->head = (pQueue->head + 1) % ETX_MAX_PENDING_RSP;
+	pQueue->count--;
+}
+
+/*********************************************************************
+ * @fn      ETX_flushAttRsp
+ *
+ * @brief   Free all pending ATT response messages.
+ *
+ * @param   pConn - connection to flush
+ * @param   status - reason the responses are dropped
+ *
+ * @return  none
+ */
+static void ETX_flushAttRsp(EtxConn_t *pConn, uint8_t status) {
+	while (pConn->attRsp.count > 0)
+		ETX_freeAttRsp(pConn, status);
+}
+
+
+/*********************************************************************
+ * @TAG Connection contexts
+ */
+/** find the context of a connection, NULL if unknown **/
+static EtxConn_t *ETX_Conn_Find(uint16_t connHandle) {
+	uint8_t i;
+
+	if (connHandle == INVALID_CONNHANDLE)
+		return NULL;
+
+	for (i = 0; i < ETX_MAX_CONNS; i++)
+		if (connList[i].connHandle == connHandle)
+			return &connList[i];
+
+	return NULL;
+}
+
+/** take a free context for a new connection, NULL if none left **/
+static EtxConn_t *ETX_Conn_Add(uint16_t connHandle) {
+	EtxConn_t *pConn = ETX_Conn_Find(connHandle);
+	uint8_t i;
+
+	if (pConn != NULL)
+		return pConn;
+
+	for (i = 0; i < ETX_MAX_CONNS; i++) {
+		if (connList[i].connHandle == INVALID_CONNHANDLE) {
+			pConn = &connList[i];
+			memset(pConn, 0, sizeof(EtxConn_t));
+			pConn->connHandle = connHandle;
+			pConn->mtu = ATT_MTU_SIZE;
+			return pConn;
 		}
+	}
 
-		// Free response message
-		ICall_freeMsg(pAttRsp);
+	return NULL;
+}
 
-		// Reset our globals
-		pAttRsp = NULL;
-		rspTxRetry = 0;
+/** release the contexts of the links which are gone **/
+static void ETX_Conn_Prune(void) {
+	uint8_t i;
+
+	for (i = 0; i < ETX_MAX_CONNS; i++) {
+		EtxConn_t *pConn = &connList[i];
+		if ((pConn->connHandle != INVALID_CONNHANDLE)
+				&& !linkDB_Up(pConn->connHandle)) {
+			ETX_flushAttRsp(pConn, bleNotConnected);
+			if ((appState == APP_STATE_ACTIVE) && !pConn->isVoteAcked)
+				connWasted++;
+			uout1("Link released: 0x%04x", pConn->connHandle);
+			utrace(BOARD_TRACE_CONN, (pConn->connHandle & 0x0F) << 12);
+			pConn->connHandle = INVALID_CONNHANDLE;
+		}
+	}
+}
+
+
+/*********************************************************************
+ * @fn      ETX_shutdown
+ *
+ * @brief   Put the device into shutdown. Any key wakes it up again. The
+ *          links are terminated first, the shutdown waits for them to be
+ *          gone. Power_shutdown returns if a constraint holds it off, the
+ *          RF driver sets one while the radio is busy.
+ *
+ * @param   none
+ *
+ * @return  false if the device is still up, try again later
+ */
+static bool ETX_shutdown(void) {
+	bool isLinkUp = false;
+	int_fast16_t status;
+	uint8_t i;
+
+	// the session is kept in NV, only stop advertising here
+	ETX_advertise(ETX_ADV_OFF);
+	ETX_Scan_stop();
+	Util_stopClock(&inactivityClock);
+	Board_ledOFF(BOARD_RLED);
+	Board_ledOFF(BOARD_BLED);
+
+	for (i = 0; i < ETX_MAX_CONNS; i++) {
+		if ((connList[i].connHandle != INVALID_CONNHANDLE)
+				&& linkDB_Up(connList[i].connHandle)) {
+			GAP_TerminateLinkReq(ICall_getLocalMsgEntityId(
+					ICALL_SERVICE_CLASS_BLE_MSG, selfEntity),
+					connList[i].connHandle, HCI_DISCONNECT_REMOTE_USER_TERM);
+			isLinkUp = true;
+		}
+	}
+	if (isLinkUp) {
+		uout0("Shutdown waits for the links");
+		return false;
 	}
+
+	uout0("device is shutting down");
+	status = Power_shutdown(NULL, 0);
+	// only back here if it was refused
+	uout1("Shutdown refused: %d", status);
+	return false;
+}
+
+
+/*********************************************************************
+ * @fn      ETX_advertise
+ *
+ * @brief   Enable or disable advertising. When the base station which
+ *          collected the last vote is known, high duty cycle directed
+ *          advertising towards it is used first so it can reconnect
+ *          within a few ms. Then undirected advertising only accepts
+ *          its connection so stray base stations in the neighbouring
+ *          rooms can't tie up the radio, before anyone may connect.
+ *          While a link is up GAPRole would only advertise
+ *          non-connectable, so the app asks the GAP itself then.
+ *
+ * @param   mode - one of the ETX_ADV_ modes
+ *
+ * @return  none
+ */
+static void ETX_advertise(uint8_t mode) {
+	uint8_t adEnable = FALSE;
+	uint8_t advType = GAP_ADTYPE_ADV_IND;
+	uint8_t filterPolicy = GAP_FILTER_POLICY_ALL;
+	uint32_t fallback;
+
+	// advertising has to be off while its type is changed
+	Util_stopClock(&advFallbackClock);
+	GAPRole_SetParameter(GAPROLE_ADVERT_ENABLED, sizeof(uint8_t), &adEnable);
+	if ((gapAdvState == ETX_GAP_ADV_ON) && (GAP_EndDiscoverable(
+			ICall_getLocalMsgEntityId(ICALL_SERVICE_CLASS_BLE_MSG, selfEntity))
+			== SUCCESS))
+		gapAdvState = ETX_GAP_ADV_ENDING;
+	else if (gapAdvState == ETX_GAP_ADV_ON)
+		gapAdvState = ETX_GAP_ADV_OFF;
+
+	// started again by GAP_END_DISCOVERABLE_DONE_EVENT
+	advPending = ETX_ADV_OFF;
+	if (gapAdvState == ETX_GAP_ADV_ENDING) {
+		advPending = mode;
+		return;
+	}
+
+	mode = ETX_Link_advMode(mode, isBSAddrKnown, linkDB_NumActive());
+	advMode = mode;
+	if (ETX_Link_advFallback(mode, &fallback) != ETX_ADV_OFF)
+		Util_restartClock(&advFallbackClock, fallback);
+
+	switch (mode) {
+		case ETX_ADV_DIRECTED:
+			advType = GAP_ADTYPE_ADV_HDC_DIRECT_IND;
+			GAPRole_SetParameter(GAPROLE_ADV_DIRECT_TYPE, sizeof(uint8_t),
+					&bsAddrType);
+			GAPRole_SetParameter(GAPROLE_ADV_DIRECT_ADDR, B_ADDR_LEN, bsAddr);
+		break;
+
+		case ETX_ADV_WHITELIST:
+			filterPolicy = GAP_FILTER_POLICY_WHITE_CON;
+		break;
+
+		case ETX_ADV_OPEN:
+		break;
+
+		default:
+			return;
+	}
+
+	if (linkDB_NumActive() != 0) {
+		// the advertising data and interval are the ones GAPRole set
+		gapAdvertisingParams_t params;
+		bStatus_t rtn;
+
+		params.eventType = advType;
+		params.initiatorAddrType = ADDRTYPE_PUBLIC;
+		memset(params.initiatorAddr, 0, B_ADDR_LEN);
+		params.channelMap = GAP_ADVCHAN_ALL;
+		params.filterPolicy = filterPolicy;
+		rtn = GAP_MakeDiscoverable(ICall_getLocalMsgEntityId(
+				ICALL_SERVICE_CLASS_BLE_MSG, selfEntity), &params);
+		if (rtn != SUCCESS) {
+			uout1("Connectable advertising not started: 0x%02x", rtn);
+			advMode = ETX_ADV_OFF;
+			return;
+		}
+		gapAdvState = ETX_GAP_ADV_ON;
+	} else {
+		GAPRole_SetParameter(GAPROLE_ADV_EVENT_TYPE, sizeof(uint8_t),
+				&advType);
+		GAPRole_SetParameter(GAPROLE_ADV_FILTER_POLICY, sizeof(uint8_t),
+				&filterPolicy);
+
+		adEnable = TRUE;
+		GAPRole_SetParameter(GAPROLE_ADVERT_ENABLED, sizeof(uint8_t),
+				&adEnable);
+	}
+	utrace(BOARD_TRACE_ADV, (mode == ETX_ADV_DIRECTED) ? 0x8000
+			: GAP_GetParamValue(TGAP_GEN_DISC_ADV_INT_MIN));
+
+	if ((appState == APP_STATE_ACTIVE) && (voteProbe.okTick != 0)
+			&& (voteProbe.advTick == 0)) {
+		voteProbe.advTick = Clock_getTicks();
+		ETX_Diag_latency(ETX_DIAG_LAT_ADVERTISE, voteProbe.okTick,
+				voteProbe.advTick);
+	}
+}
+
+/*********************************************************************
+ * @fn      ETX_whitelistUpdate
+ *
+ * @brief   Load the address of the last base station into the
+ *          controller white list.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void ETX_whitelistUpdate(void) {
+	HCI_LE_ClearWhiteListCmd();
+	if (isBSAddrKnown)
+		HCI_LE_AddWhiteListCmd(bsAddrType, bsAddr);
+}
+
+/*********************************************************************
+ * @fn      ETX_BS_learn
+ *
+ * @brief   Take the address of the BS picked, from a beacon of it or its
+ *          ETXCMD_BIND, both checked against destBSID and the beacon key.
+ *          Directed and white list advertising go to it from then on. A
+ *          central which merely read a vote is no proof, a BS of the room
+ *          next door may do that.
+ *
+ * @param   addrType - address type of the BS
+ * @param   pAddr - address of the BS
+ *
+ * @return  none
+ */
+static void ETX_BS_learn(uint8_t addrType, const uint8_t *pAddr) {
+	if (isBSAddrKnown && (bsAddrType == addrType)
+			&& (memcmp(bsAddr, pAddr, B_ADDR_LEN) == 0))
+		return;
+
+	isBSAddrKnown = true;
+	bsAddrType = addrType;
+	memcpy(bsAddr, pAddr, B_ADDR_LEN);
+	ETX_whitelistUpdate();
+	ETX_Session_Store();
+	uout1("BS %d address learnt", destBSID);
 }
 
 
@@ -685,17 +1531,18 @@ static void ETX_CB_GAPRoleStateChange(gaprole_States_t newState) {
 }
 
 /** callback for char changed **/
-static void ETX_CB_charValueChange(uint8_t paramID) {
-	ETX_enqueueMsg(ETX_CHAR_CHANGE_EVT, paramID);
+static void ETX_CB_charValueChange(uint16_t connHandle, uint8_t paramID) {
+	ETX_enqueueConnMsg(ETX_CHAR_CHANGE_EVT, paramID, connHandle);
 }
 
 /** callback for char enquired **/
-static void ETX_CB_charValueEnquire(uint8_t paramID) {
-	ETX_enqueueMsg(ETX_CHAR_ENQUIRE_EVT, paramID);
+static void ETX_CB_charValueEnquire(uint16_t connHandle, uint8_t paramID) {
+	ETX_enqueueConnMsg(ETX_CHAR_ENQUIRE_EVT, paramID, connHandle);
 }
 
 /** callback for key pressed **/
 static void ETX_CB_keyPress(uint8_t keys) {
+	keyDebounceTick = Clock_getTicks();
 	ETX_enqueueMsg(ETX_KEY_PRESS_EVT, keys);
 }
 
@@ -703,6 +1550,38 @@ static void ETX_CBm_appStateChange(AppState_t newState) {
 	ETX_enqueueMsg(ETX_APP_STATE_CHG_EVT, newState);
 }
 
+/** callback for inactivity clock expired **/
+static void ETX_CB_inactivityTimeout(UArg arg) {
+	ETX_enqueueMsg(ETX_INACTIVITY_EVT, 0);
+}
+
+/** callback for advertising mode clock expired **/
+static void ETX_CB_advFallbackTimeout(UArg arg) {
+	ETX_enqueueMsg(ETX_ADV_FALLBACK_EVT, 0);
+}
+
+static void ETX_CB_scanTimeout(UArg arg) {
+	ETX_enqueueMsg(ETX_SCAN_EVT, 0);
+}
+
+static void ETX_CB_voteRetryTimeout(UArg arg) {
+	ETX_enqueueMsg(ETX_VOTE_RETRY_EVT, 0);
+}
+
+static void ETX_CB_slotTimeout(UArg arg) {
+	ETX_enqueueMsg(ETX_SLOT_EVT, 0);
+}
+
+static void ETX_CB_monTimeout(UArg arg) {
+	ETX_enqueueMsg(ETX_MON_EVT, 0);
+}
+
+#ifdef ETX_WDT_KICK_PERIOD
+static void ETX_CB_wdtTimeout(UArg arg) {
+	ETX_enqueueMsg(ETX_WDT_EVT, 0);
+}
+#endif
+
 /*********************************************************************
  * @TAG Event process functions
  */
@@ -712,15 +1591,9 @@ static uint8_t ETX_EVT_GATTMsgReceived(gattMsgEvent_t *pMsg) {
 	// See if GATT server was unable to transmit an ATT response
 	if (pMsg->hdr.status == blePending) {
 		// No HCI buffer was available. Let's try to retransmit the response
-		// on the next connection event.
-		if (HCI_EXT_ConnEventNoticeCmd(pMsg->connHandle, selfEntity,
-				ETX_CONN_EVT_END_EVT) == SUCCESS) {
-			// First free any pending response
-			ETX_freeAttRsp(FAILURE);
-
-			// Hold on to the response message for retransmission
-			pAttRsp = pMsg;
-
+		// on the next connection event, behind the ones already pending.
+		EtxConn_t *pConn = ETX_Conn_Find(pMsg->connHandle);
+		if ((pConn != NULL) && ETX_holdAttRsp(pConn, pMsg)) {
 			// Don't free the response message yet
 			return (FALSE);
 		}
@@ -733,7 +1606,10 @@ static uint8_t ETX_EVT_GATTMsgReceived(gattMsgEvent_t *pMsg) {
 		uout1("FC Violated: %d", pMsg->msg.flowCtrlEvt.opcode);
 	} else if (pMsg->method == ATT_MTU_UPDATED_EVENT) {
 		// MTU size updated
-		uout1("MTU Size: $d", pMsg->msg.mtuEvt.MTU);
+		EtxConn_t *pConn = ETX_Conn_Find(pMsg->connHandle);
+		if (pConn != NULL)
+			pConn->mtu = pMsg->msg.mtuEvt.MTU;
+		uout1("MTU Size: %d", pMsg->msg.mtuEvt.MTU);
 	}
 
 	// Free message payload. Needed only for ATT Protocol messages
@@ -743,8 +1619,56 @@ static uint8_t ETX_EVT_GATTMsgReceived(gattMsgEvent_t *pMsg) {
 	return (TRUE);
 }
 
+/** Process GAP messages of the beacon scan **/
+static void ETX_EVT_GAPMsgReceived(gapEventHdr_t *pMsg) {
+	switch (pMsg->opcode) {
+		case GAP_DEVICE_INFO_EVENT: {
+			gapDeviceInfoEvent_t *pInfo = (gapDeviceInfoEvent_t *) pMsg;
+
+			// beacons are broadcast, connectable adverts are other devices
+			if (pInfo->eventType == GAP_ADRPT_ADV_NONCONN_IND) {
+				ETX_Beacon_process(pInfo->addrType, pInfo->addr,
+						pInfo->pEvtData, pInfo->dataLen);
+				ETX_Ack_process(pInfo->pEvtData, pInfo->dataLen);
+			}
+		}
+		break;
+
+		case GAP_DEVICE_DISCOVERY_EVENT:
+			// scan window is over, the clock starts the next one
+		break;
+
+		// connectable advertising next to a link, see ETX_advertise
+		case GAP_MAKE_DISCOVERABLE_DONE_EVENT:
+			if (pMsg->hdr.status == SUCCESS) {
+				uout1("Connectable advertising next to %d links",
+						linkDB_NumActive());
+			} else {
+				gapAdvState = ETX_GAP_ADV_OFF;
+				uout1("Connectable advertising failed: 0x%02x",
+						pMsg->hdr.status);
+			}
+		break;
+
+		case GAP_END_DISCOVERABLE_DONE_EVENT:
+			if (gapAdvState == ETX_GAP_ADV_ENDING) {
+				uint8_t mode = advPending;
+
+				gapAdvState = ETX_GAP_ADV_OFF;
+				advPending = ETX_ADV_OFF;
+				if (mode != ETX_ADV_OFF)
+					ETX_advertise(mode);
+			}
+		break;
+
+		default:
+		break;
+	}
+}
+
 /** GAP Role state changed **/
 static void ETX_EVT_GAPRoleStateChange(gaprole_States_t newState) {
+	ETX_Diag_setGapState(newState);
 
 	switch (newState) {
 		case GAPROLE_STARTED: {
@@ -759,7 +1683,19 @@ static void ETX_EVT_GAPRoleStateChange(gaprole_States_t newState) {
 			DevInfo_SetParameter(DEVINFO_SYSTEM_ID, DEVINFO_SYSTEM_ID_LEN,
 					systemId);
 
-			ETX_CBm_appStateChange(APP_STATE_INIT);
+			ETX_Fsm_dispatch(ETX_FSM_EVT_START, 0);
+
+			// replay the key which woke the device, it is queued after the
+			// state change so it's handled by the state machine as usual.
+			// In a resumed session KEY_OK submits the answer picked before
+			// the shutdown, in INIT a number key picks the BS
+			{
+				uint8_t wakeKey = Board_getWakeKey();
+				if ((wakeKey != 0) && (wakeKey != KEY_PWR)) {
+					uout1("woken up by key: S%d", wakeKey);
+					ETX_CB_keyPress(wakeKey);
+				}
+			}
 
 			uout0("GAP Role Initialized");
 
@@ -772,27 +1708,62 @@ static void ETX_EVT_GAPRoleStateChange(gaprole_States_t newState) {
 		break;
 
 		case GAPROLE_CONNECTED: {
-			linkDBInfo_t linkInfo;
+			uint16_t connHandle = INVALID_CONNHANDLE;
 			uint8_t numActive = 0;
+			EtxConn_t *pConn;
 
 			//Util_startClock(&periodicClock);
+			Util_restartClock(&inactivityClock, ETX_INACTIVITY_TIMEOUT);
+
+			if ((appState == APP_STATE_ACTIVE) && (voteProbe.advTick != 0)
+					&& (voteProbe.connTick == 0)) {
+				voteProbe.connTick = Clock_getTicks();
+				ETX_Diag_latency(ETX_DIAG_LAT_CONNECT, voteProbe.advTick,
+						voteProbe.connTick);
+			}
 
+			ETX_Conn_Prune();
 			numActive = linkDB_NumActive();
 
-			// Use numActive to determine the connection handle of the last
-			// connection
-			if (linkDB_GetInfo(numActive - 1, &linkInfo) == SUCCESS) {
-				uout1("Num Conns: %d", (uint16_t )numActive);
-				uout0(Util_convertBdAddr2Str(linkInfo.addr));
+			// GAPRole reports the parameters of the latest connection
+			GAPRole_GetParameter(GAPROLE_CONNHANDLE, &connHandle);
+			pConn = ETX_Conn_Add(connHandle);
+			if (pConn != NULL) {
+				linkDBInfo_t linkInfo;
+
+				if (linkDB_GetInfo(connHandle, &linkInfo) == SUCCESS)
+					pConn->peerAddrType = linkInfo.addrType;
+				GAPRole_GetParameter(GAPROLE_CONN_BD_ADDR, pConn->peerAddr);
+				GAPRole_GetParameter(GAPROLE_CONN_INTERVAL,
+						&pConn->connInterval);
+				GAPRole_GetParameter(GAPROLE_CONN_LATENCY, &pConn->connLatency);
+				GAPRole_GetParameter(GAPROLE_CONN_TIMEOUT, &pConn->connTimeout);
+				utrace(BOARD_TRACE_CONN, ((connHandle & 0x0F) << 12)
+						| (pConn->connInterval & 0x0FFF));
+
+				uout2("Connected: 0x%04x, Num Conns: %d", connHandle,
+						(uint16_t )numActive);
+				uout0(Util_convertBdAddr2Str(pConn->peerAddr));
+				// the controller filters by the BS address, tell a leak
+				if (!ETX_Link_isAccepted(advMode, isBSAddrKnown ? bsAddrType
+						: ETX_LINK_ADDR_UNKNOWN, bsAddr, pConn->peerAddrType,
+						pConn->peerAddr))
+					uout1("Link 0x%04x passed the advertising filter",
+							connHandle);
 			} else {
-				uint8_t peerAddress[B_ADDR_LEN];
-
-				GAPRole_GetParameter(GAPROLE_CONN_BD_ADDR, peerAddress);
-
-				uout0("Connected");
-				uout0(Util_convertBdAddr2Str(peerAddress));
+				uout1("No context left for link 0x%04x", connHandle);
 			}
 
+			// Keep advertising while a vote or sheet is pending so a second
+			// base station can connect, whichever reads it first wins. The
+			// link ended any advertising of the GAP
+			Util_stopClock(&advFallbackClock);
+			gapAdvState = ETX_GAP_ADV_OFF;
+			advPending = ETX_ADV_OFF;
+			if ((((appState == APP_STATE_ACTIVE) && !isSlotted)
+					|| (appState == APP_STATE_SUBMIT))
+					&& (numActive < ETX_MAX_CONNS))
+				ETX_advertise(ETX_ADV_OPEN);
 		}
 		break;
 
@@ -801,14 +1772,22 @@ static void ETX_EVT_GAPRoleStateChange(gaprole_States_t newState) {
 		break;
 
 		case GAPROLE_WAITING:
-			ETX_freeAttRsp(bleNotConnected);
-
-			uout0("Disconnected");
+			ETX_Conn_Prune();
+			uout4("Rsp held: %d sent: %d dropped: %d retries: %d",
+					attRspStats.held, attRspStats.sent, attRspStats.dropped,
+					attRspStats.retries);
+			if (attRspStats.sent != 0)
+				uout2("Rsp latency max: %dus mean: %dus",
+						attRspStats.latencyMax * Clock_tickPeriod,
+						(attRspStats.latencySum / attRspStats.sent)
+								* Clock_tickPeriod);
+
+			uout1("Disconnected, wasted links: %d", connWasted);
 			// Board_ledOFF(BOARD_BLED);
 		break;
 
 		case GAPROLE_WAITING_AFTER_TIMEOUT:
-			ETX_freeAttRsp(bleNotConnected);
+			ETX_Conn_Prune();
 			uout0("Timed Out");
 		break;
 
@@ -824,13 +1803,29 @@ static void ETX_EVT_GAPRoleStateChange(gaprole_States_t newState) {
 }
 
 /** data has been changed **/
-static void ETX_EVT_charValueChange(uint8_t paramID) {
+static void ETX_EVT_charValueChange(uint16_t connHandle, uint8_t paramID) {
 	uint8_t newValue;
 
 	switch (paramID) {
-		case ETXPROFILE_CMD:
-			ETXProfile_GetParameter(ETXPROFILE_CMD, &newValue);
-			uout1("BS Command: 0x%02x", (uint8_t )newValue);
+		case ETXPROFILE_CMD: {
+			uint8_t cmd[ETXPROFILE_CMD_LEN];
+			uint8_t rsp[ETXPROFILE_CMD_LEN];
+			uint8_t cmdLen = ETXProfile_GetParameterLen(ETXPROFILE_CMD);
+			uint8_t rspLen;
+
+			ETXProfile_GetParameter(ETXPROFILE_CMD, cmd);
+			uout2("BS Command: 0x%02x, len %d", cmd[0], cmdLen);
+
+			// the write was answered before the commands ran, the responses
+			// go out as a notification and replace the commands until the
+			// BS reads them
+			rspLen = ETX_CMD_process(ETX_Conn_Find(connHandle), cmd, cmdLen,
+					rsp, sizeof(rsp));
+			if (rspLen != 0) {
+				ETXProfile_SetParameter(ETXPROFILE_CMD, rspLen, rsp);
+				ETXProfile_NotifyCmd(connHandle, rspLen, rsp);
+			}
+		}
 		break;
 
 		case ETXPROFILE_DATA:
@@ -838,6 +1833,38 @@ static void ETX_EVT_charValueChange(uint8_t paramID) {
 			uout1("User Data: 0x%02x", (uint8_t )newValue);
 		break;
 
+		case ETXPROFILE_DIAG: {
+			uint8_t page[ETXPROFILE_DIAG_LEN];
+			uint8_t len;
+
+			ETXProfile_GetParameter(ETXPROFILE_DIAG, page);
+			if (page[0] == ETX_DIAG_PAGE_DUMP) {
+				ETX_Diag_dump();
+				utraceDump();
+				ucaptureDump();
+				uprofDump();
+			} else if (page[0] == ETX_DIAG_PAGE_RESET) {
+				ETX_Diag_reset();
+			} else {
+				len = ETX_Diag_getPage(page[0], page);
+				if (len != 0)
+					ETXProfile_SetParameter(ETXPROFILE_DIAG, len, page);
+			}
+		}
+		break;
+
+		case ETXPROFILE_BATCH: {
+			// several batches may have arrived in one connection event,
+			// take all of them, later messages find the buffer empty
+			uint8_t batch[ETXPROFILE_BATCH_LEN];
+			uint16_t batchConn;
+			uint8_t len;
+
+			while ((len = ETXProfile_GetBatch(&batchConn, batch)) != 0)
+				ETX_CMD_batch(batchConn, batch, len);
+		}
+		break;
+
 		default:
 			// should not reach here!
 		break;
@@ -845,14 +1872,15 @@ static void ETX_EVT_charValueChange(uint8_t paramID) {
 }
 
 /** Data has been enquired **/
-static void ETX_EVT_charValueEnquire(uint8_t paramID) {
+static void ETX_EVT_charValueEnquire(uint16_t connHandle, uint8_t paramID) {
 
 	uint8_t newValue;
+	EtxConn_t *pConn = ETX_Conn_Find(connHandle);
 	switch (paramID) {
 
 		case ETXPROFILE_CMD:
-			ETXProfile_GetParameter(ETXPROFILE_CMD, &newValue);
-			uout1("BS Command Submitted: 0x%02x", (uint8_t )newValue);
+			uout1("BS Command Submitted, len %d",
+					ETXProfile_GetParameterLen(ETXPROFILE_CMD));
 
 			newValue = 0;
 			ETXProfile_SetParameter(ETXPROFILE_CMD, sizeof(newValue),
@@ -862,13 +1890,20 @@ static void ETX_EVT_charValueEnquire(uint8_t paramID) {
 		case ETXPROFILE_DATA:
 			ETXProfile_GetParameter(ETXPROFILE_DATA, &newValue);
 			uout1("User Data Submitted: 0x%02x", (uint8_t )newValue);
+			if (voteProbe.connTick != 0)
+				ETX_Diag_latency(ETX_DIAG_LAT_COLLECT, voteProbe.connTick,
+						Clock_getTicks());
+			// any BS may collect the vote, but only the one picked is
+			// learnt, see ETX_BS_learn
+			if (pConn != NULL) {
+				pConn->isVoteAcked = TRUE;
+				if (isBSAddrKnown && !ETX_Link_isAccepted(ETX_ADV_WHITELIST,
+						bsAddrType, bsAddr, pConn->peerAddrType,
+						pConn->peerAddr))
+					uout1("Vote read by a stray BS, link 0x%04x", connHandle);
+			}
 
-			userData = 0;
-			ETXProfile_SetParameter(ETXPROFILE_DATA, sizeof(newValue),
-					&userData);
-
-			ETX_CBm_appStateChange(APP_STATE_IDLE);
-
+			ETX_Fsm_dispatch(ETX_FSM_EVT_COLLECTED, 0);
 		break;
 
 		default:
@@ -883,70 +1918,58 @@ static void ETX_EVT_keyPress(uint8_t shift, uint8_t keys) {
 	// ok and lower number will have higher priority
 
 	uout1("key pressed: S%d", keys);
-	Board_ledHIGH(BOARD_RLED);
-	switch (appState) {
-		case APP_STATE_INIT:
-			if (keys < KEY_OK) { // number key pressed
-				destBSID = keys;
-				advertData[9] = destBSID;
-				uout1("destiny BS set to: %d", destBSID);
-			}
-
-			if ((keys == KEY_OK) && (destBSID != 0)) {
-				bStatus_t rtn;
-				rtn = GAPRole_SetParameter(GAPROLE_ADVERT_DATA,
-						sizeof(advertData), advertData);
-				if (rtn == SUCCESS)
-						ETX_CBm_appStateChange(APP_STATE_IDLE);
-			}
-
-		break;
-
-		case APP_STATE_IDLE:
-			if (keys < KEY_OK) { // number key pressed
-				userData = keys;
-				uout1("response set to: %d", userData);
-			}
-			if ((keys == KEY_OK) && (userData != 0)) {
-				bStatus_t rtn;
-				rtn = ETXProfile_SetParameter(ETXPROFILE_DATA, sizeof(userData), &userData);
-				if (rtn == SUCCESS)
-						ETX_CBm_appStateChange(APP_STATE_ACTIVE);
-			}
-		break;
-		case APP_STATE_ACTIVE:
-		break;
-		default:
-		break;
-
+	// a key replayed after wake up never went through the ISR
+	if (Board_getKeyTick() != 0) {
+		ETX_Diag_latency(ETX_DIAG_LAT_DEBOUNCE, Board_getKeyTick(),
+				keyDebounceTick);
+		ETX_Diag_latency(ETX_DIAG_LAT_DISPATCH, keyDebounceTick,
+				Clock_getTicks());
 	}
+	// a key doesn't hold off the retry of a refused shutdown
+	if (appState != APP_STATE_SLEEP)
+		Util_restartClock(&inactivityClock, ETX_INACTIVITY_TIMEOUT);
+	Board_ledHIGH(BOARD_RLED);
+	if (keys < KEY_OK)
+		ETX_Fsm_dispatch(ETX_FSM_EVT_NUM, keys);
+	else if (keys == KEY_OK)
+		ETX_Fsm_dispatch(ETX_FSM_EVT_OK, keys);
+	else if (keys == KEY_PWR)
+		ETX_Fsm_dispatch(ETX_FSM_EVT_PWR, keys);
 	Board_ledLOW(BOARD_RLED);
-
-	if (keys == KEY_PWR) {
-		ETX_EVT_appStateChange(APP_STATE_INIT);
-		Board_ledOFF(BOARD_RLED);
-		Board_ledOFF(BOARD_BLED);
-		uout0("device is shutting down");
-		Power_shutdown(NULL,0);
-	}
 }
 
 /** process app state change event **/
 static void ETX_EVT_appStateChange(AppState_t newState) {
 	appState = newState;
+	ETX_Diag_setAppState(newState);
 	uout1("into new state: 0x%02x", newState);
+	Util_restartClock(&inactivityClock, ETX_INACTIVITY_TIMEOUT);
 	switch (newState) {
 		case APP_STATE_INIT:
-			destBSID = 0x00;
+			// leaving a session, drop the retained record as well
+			if (destBSID != 0x00) {
+				destBSID = 0x00;
+				voteSeq = 0;
+				sessionToken = 0;
+				isBSAddrKnown = false;
+				ETX_Session_Store();
+			}
+			if (quiz.numQuestions != 0) {
+				ETX_Quiz_end(&quiz);
+				ETX_Sheet_Store();
+			}
+			ETX_Sheet_publish();
 			advertData[9] = destBSID;
 			userData = 0x00;
 			ETXProfile_SetParameter(ETXPROFILE_DATA, sizeof(userData), &userData);
+			answerMin = 1;
+			answerMax = KEY_OK - 1;
 
-			{
-				uint8_t adEnable = FALSE;
-				GAPRole_SetParameter(GAPROLE_ADVERT_ENABLED, sizeof(uint8_t),
-						&adEnable);
-			}
+			ETX_advertise(ETX_ADV_OFF);
+			ETX_Scan_stop();
+			Util_stopClock(&voteRetryClock);
+			ETX_Slot_stop();
+			isSlotted = false;
 
 			if (isBatLow) // battery level is low?
 				Board_ledFlash(BOARD_RLED, 500);
@@ -956,22 +1979,56 @@ static void ETX_EVT_appStateChange(AppState_t newState) {
 		break;
 
 		case APP_STATE_IDLE:
-			{
-				uint8_t adEnable = FALSE;
-				GAPRole_SetParameter(GAPROLE_ADVERT_ENABLED, sizeof(uint8_t),
-						&adEnable);
-			}
+			ETX_advertise(ETX_ADV_OFF);
+			Util_stopClock(&voteRetryClock);
+			ETX_Slot_stop();
+			ETX_Scan_start();
 
-			Board_ledLowFlash(BOARD_BLED, 1000);
+			if (isQuestionOpen)
+				Board_ledLowFlash(BOARD_BLED, 1000);
+			else
+				Board_ledOFF(BOARD_BLED);
 
 		break;
 
 		case APP_STATE_ACTIVE:
-			{
-				uint8_t adEnable = TRUE;
-				GAPRole_SetParameter(GAPROLE_ADVERT_ENABLED, sizeof(uint8_t),
-						&adEnable);
-			}
+			// the vote goes out in the advertising data as well, the
+			// ack beacons are scanned for while advertising
+			voteRetries = 0;
+			ETX_Vote_updateAdvert();
+			ETX_Scan_start();
+			// in slotted mode the next beacon tells when to advertise
+			if (!isSlotted)
+				ETX_advertise(ETX_ADV_ON);
+			Board_ledFlash(BOARD_BLED, 100);
+		break;
+
+		case APP_STATE_SLEEP:
+			if (isSheetDirty)
+				ETX_Sheet_Store();
+			// keep the picked answer, a KEY_OK waking the device submits it
+			if (destBSID != 0x00)
+				ETX_Session_Store();
+			// the retry comes as a timeout, it enters SLEEP again
+			if (!ETX_shutdown())
+				Util_restartClock(&inactivityClock, ETX_SHUTDOWN_RETRY);
+		break;
+
+		case APP_STATE_QUIZ:
+			// no beacons or votes until the sheet is submitted
+			ETX_advertise(ETX_ADV_OFF);
+			ETX_Scan_stop();
+			Util_stopClock(&voteRetryClock);
+			ETX_Slot_stop();
+			uout2("quiz question %d of %d", quiz.current + 1,
+					quiz.numQuestions);
+			Board_ledLowFlash(BOARD_BLED, 500);
+		break;
+
+		case APP_STATE_SUBMIT:
+			// any BS may collect the sheet, the one of the session first
+			ETX_Scan_stop();
+			ETX_advertise(ETX_ADV_ON);
 			Board_ledFlash(BOARD_BLED, 100);
 		break;
 
@@ -980,6 +2037,743 @@ static void ETX_EVT_appStateChange(AppState_t newState) {
 	}
 }
 
+/*****************************************************************************
+ * @TAG App state machine
+ */
+// Indexed by ETX_FSM_A_, see the transition table in etx_fsm.c
+static const EtxFsmAction_t fsmActions[ETX_FSM_ACTIONS] = {
+	[ETX_FSM_A_NONE] = NULL,
+	[ETX_FSM_A_SET_BS] = ETX_Fsm_setBS,
+	[ETX_FSM_A_JOIN] = ETX_Fsm_join,
+	[ETX_FSM_A_LOCKED] = ETX_Fsm_locked,
+	[ETX_FSM_A_ANSWER] = ETX_Fsm_answer,
+	[ETX_FSM_A_VOTE] = ETX_Fsm_vote,
+	[ETX_FSM_A_COLLECTED] = ETX_Fsm_collected,
+	[ETX_FSM_A_QUIZ_START] = ETX_Fsm_quizStart,
+	[ETX_FSM_A_QUIZ_ANSWER] = ETX_Fsm_quizAnswer,
+	[ETX_FSM_A_QUIZ_NEXT] = ETX_Fsm_quizNext,
+	[ETX_FSM_A_QUIZ_SUBMIT] = ETX_Fsm_quizSubmit,
+	[ETX_FSM_A_QUIZ_END] = ETX_Fsm_quizEnd,
+};
+
+/*********************************************************************
+ * @fn      ETX_Fsm_dispatch
+ *
+ * @brief   Run an event through the transition table. The action of the
+ *          row taken runs right away, the new state is entered through
+ *          the message queue so an action's own messages go first.
+ *
+ * @param   event - ETX_FSM_EVT_
+ * @param   param - key of a key event, 0 otherwise
+ *
+ * @return  false if the event is ignored or its action failed
+ */
+static bool ETX_Fsm_dispatch(uint8_t event, uint8_t param) {
+	const EtxFsmRow_t *pRow = ETX_Fsm_find(appState, event, param,
+			ETX_Fsm_guard);
+
+	if (pRow == NULL)
+		return false;
+	if ((pRow->action != ETX_FSM_A_NONE) && !fsmActions[pRow->action](param))
+		return false;
+	if (pRow->next != ETX_FSM_STAY)
+		ETX_CBm_appStateChange((AppState_t) pRow->next);
+	return true;
+}
+
+static bool ETX_Fsm_guard(uint8_t guard, uint8_t param) {
+	switch (guard) {
+		case ETX_FSM_G_RESUMED:
+			return isSessionResumed;
+		case ETX_FSM_G_BS_SET:
+			return (destBSID != 0);
+		case ETX_FSM_G_LOCKED:
+			return isInputLocked || !isQuestionOpen;
+		case ETX_FSM_G_ANSWER:
+			return (param >= answerMin) && (param <= answerMax);
+		case ETX_FSM_G_ANSWERED:
+			return (userData != 0);
+		case ETX_FSM_G_IN_QUIZ:
+			return isSessionResumed && (quiz.numQuestions != 0);
+		case ETX_FSM_G_SUBMITTED:
+			return isSessionResumed && (quiz.numQuestions != 0)
+					&& (quiz.flags & ETX_QUIZ_FLAG_SUBMITTED);
+		case ETX_FSM_G_INPUT_LOCKED:
+			return isInputLocked;
+		case ETX_FSM_G_QUIZ_ANSWER:
+			return (param >= quiz.answerMin) && (param <= quiz.answerMax);
+		case ETX_FSM_G_QUIZ_DONE:
+			return ETX_Quiz_isDone(&quiz);
+		default:
+			return false;
+	}
+}
+
+/** number key in INIT, pick the destination BS **/
+static bool ETX_Fsm_setBS(uint8_t param) {
+	destBSID = param;
+	advertData[9] = destBSID;
+	uout1("destiny BS set to: %d", destBSID);
+	return true;
+}
+
+/** KEY_OK in INIT, advertise to the BS and keep the session **/
+static bool ETX_Fsm_join(uint8_t param) {
+	bStatus_t rtn;
+
+	uprofBegin("advertData");
+	rtn = GAPRole_SetParameter(GAPROLE_ADVERT_DATA, sizeof(advertData),
+			advertData);
+	uprofEnd();
+	if (rtn != SUCCESS)
+		return false;
+	ETX_Session_Store();
+	return true;
+}
+
+static bool ETX_Fsm_locked(uint8_t param) {
+	uout0("input locked");
+	return true;
+}
+
+static bool ETX_Fsm_answer(uint8_t param) {
+	userData = param;
+	uout1("response set to: %d", userData);
+	return true;
+}
+
+/** KEY_OK in IDLE, stamp the answer and publish it **/
+static bool ETX_Fsm_vote(uint8_t param) {
+	uint8_t stamp[ETXPROFILE_STAMP_LEN];
+	uint32_t keyTick = Board_getKeyTick();
+
+	// stamp the press itself, not the end of the debounce. A key replayed
+	// after wake up never went through the ISR, it is stamped now, its
+	// total latency starts here and leaves the boot out
+	if (keyTick == 0)
+		keyTick = Clock_getTicks();
+	voteTime = ETX_Time_get(keyTick);
+	memset(&voteProbe, 0, sizeof(voteProbe));
+	voteProbe.keyTick = keyTick;
+	voteProbe.okTick = Clock_getTicks();
+	stamp[0] = voteSeq;
+	stamp[1] = BREAK_UINT32(voteTime, 0);
+	stamp[2] = BREAK_UINT32(voteTime, 1);
+	stamp[3] = BREAK_UINT32(voteTime, 2);
+	stamp[4] = BREAK_UINT32(voteTime, 3);
+	stamp[5] = bsTime.isSynced ? ETXPROFILE_STAMP_SYNCED : 0;
+	ETXProfile_SetParameter(ETXPROFILE_STAMP, sizeof(stamp), stamp);
+
+	return (ETXProfile_SetParameter(ETXPROFILE_DATA, sizeof(userData),
+			&userData) == SUCCESS);
+}
+
+static bool ETX_Fsm_collected(uint8_t param) {
+	ETX_Vote_collected();
+	return true;
+}
+
+/** BS started a quiz, as asked in quizReq **/
+static bool ETX_Fsm_quizStart(uint8_t param) {
+	ETX_Quiz_start(&quiz, sessionToken, quizReq[0], quizReq[1], quizReq[2]);
+	ETX_Sheet_publish();
+	ETX_Sheet_Store();
+	uout2("quiz started: %d questions, answers up to %d", quiz.numQuestions,
+			quiz.answerMax);
+	return true;
+}
+
+/** number key in QUIZ, the sheet is stored when the student moves on **/
+static bool ETX_Fsm_quizAnswer(uint8_t param) {
+	if (!ETX_Quiz_answer(&quiz, param))
+		return false;
+	isSheetDirty = true;
+	ETX_Sheet_publish();
+	uout2("question %d answered: %d", quiz.current + 1, param);
+	return true;
+}
+
+static bool ETX_Fsm_quizNext(uint8_t param) {
+	ETX_Quiz_next(&quiz);
+	if (isSheetDirty)
+		ETX_Sheet_Store();
+	uout2("quiz question %d of %d", quiz.current + 1, quiz.numQuestions);
+	return true;
+}
+
+/** KEY_OK on the last question of a complete sheet **/
+static bool ETX_Fsm_quizSubmit(uint8_t param) {
+	quiz.flags |= ETX_QUIZ_FLAG_SUBMITTED;
+	ETX_Sheet_publish();
+	ETX_Sheet_Store();
+	uout1("quiz sheet submitted: %d answers", quiz.numQuestions);
+	return true;
+}
+
+/** the BS has the sheet or called the quiz off **/
+static bool ETX_Fsm_quizEnd(uint8_t param) {
+	ETX_Quiz_end(&quiz);
+	ETX_Sheet_publish();
+	ETX_Sheet_Store();
+	uout0("quiz ended");
+	return true;
+}
+
+/*****************************************************************************
+ * @TAG BS command interpreter
+ */
+/** execute the BS commands of one write over a link, see
+ * ETX_Proto_cmdProcess **/
+static uint8_t ETX_CMD_process(EtxConn_t *pConn, const uint8_t *pCmd,
+		uint8_t cmdLen, uint8_t *pRsp, uint8_t rspSize) {
+	return ETX_Proto_cmdProcess(pCmd, cmdLen, pRsp, rspSize, ETX_CMD_run,
+			pConn);
+}
+
+/** execute and log a single BS command, pArg is the link **/
+static uint8_t ETX_CMD_run(void *pArg, uint8_t opcode, const uint8_t *pVal,
+		uint8_t len, uint8_t *pData, uint8_t *pDataLen) {
+	uint8_t status = ETX_CMD_exec((EtxConn_t *) pArg, opcode, pVal, len, pData,
+			pDataLen);
+
+	uout2("BS Command 0x%02x: status %d", opcode, status);
+	return status;
+}
+
+/*********************************************************************
+ * @fn      ETX_CMD_exec
+ *
+ * @brief   Execute a single BS command.
+ *
+ * @param   pConn - link the command came over, NULL if it is gone
+ * @param   opcode - one of the ETXCMD_ opcodes
+ * @param   pVal - value of the command
+ * @param   len - length of the value
+ * @param   pData - buffer for the response data
+ * @param   pDataLen - set to the length of the response data
+ *
+ * @return  ETXCMD_SUCCESS or one of the ETXCMD_ERR_ codes
+ */
+static uint8_t ETX_CMD_exec(EtxConn_t *pConn, uint8_t opcode,
+		const uint8_t *pVal, uint8_t len, uint8_t *pData, uint8_t *pDataLen) {
+	*pDataLen = 0;
+
+	switch (opcode) {
+		case ETXCMD_OPEN_QUESTION:
+			if (len != 1)
+				return ETXCMD_ERR_LEN;
+			if (appState == APP_STATE_INIT)
+				return ETXCMD_ERR_STATE;
+			ETX_Question_set(pVal[0], true);
+		break;
+
+		case ETXCMD_CLOSE_QUESTION:
+			if (len != 0)
+				return ETXCMD_ERR_LEN;
+			ETX_Question_set(questionNum, false);
+		break;
+
+		case ETXCMD_LOCK_INPUT:
+			if (len != 1)
+				return ETXCMD_ERR_LEN;
+			isInputLocked = (pVal[0] != 0);
+		break;
+
+		case ETXCMD_SET_LED: {
+			uint16_t period = 0;
+
+			if ((len != 2) && (len != 4))
+				return ETXCMD_ERR_LEN;
+			if ((pVal[0] > BOARD_BLED) || (pVal[1] > BOARD_LED_STATE_LOWFLASH))
+				return ETXCMD_ERR_VALUE;
+			if (len == 4)
+				period = BUILD_UINT16(pVal[2], pVal[3]);
+			if ((pVal[1] >= BOARD_LED_STATE_FLASH) && (period == 0))
+				return ETXCMD_ERR_VALUE;
+			Board_ledControl((BoardLedID_t) pVal[0], (BoardLedState_t) pVal[1],
+					period);
+		}
+		break;
+
+		case ETXCMD_GET_BATTERY: {
+			uint16_t batLevel;
+
+			if (len != 0)
+				return ETXCMD_ERR_LEN;
+			batLevel = ETX_ADC_valueGet(Board_ADCIN) / 1000;
+			isBatLow = (batLevel < 2500) ? 1 : 0;
+			pData[0] = LO_UINT16(batLevel);
+			pData[1] = HI_UINT16(batLevel);
+			*pDataLen = ETXCMD_BATTERY_LEN;
+		}
+		break;
+
+		case ETXCMD_GET_STATS:
+			// [voteSeq][wasted links][rsp held][rsp sent][rsp dropped]
+			// [beacon scans failed]
+			if (len != 0)
+				return ETXCMD_ERR_LEN;
+			pData[0] = voteSeq;
+			pData[1] = LO_UINT16(connWasted);
+			pData[2] = HI_UINT16(connWasted);
+			pData[3] = LO_UINT16(attRspStats.held);
+			pData[4] = HI_UINT16(attRspStats.held);
+			pData[5] = LO_UINT16(attRspStats.sent);
+			pData[6] = HI_UINT16(attRspStats.sent);
+			pData[7] = LO_UINT16(attRspStats.dropped);
+			pData[8] = HI_UINT16(attRspStats.dropped);
+			pData[9] = LO_UINT16(scanFailed);
+			pData[10] = HI_UINT16(scanFailed);
+			*pDataLen = ETXCMD_STATS_LEN;
+		break;
+
+		case ETXCMD_RESET_INIT:
+			if (len != 0)
+				return ETXCMD_ERR_LEN;
+			// queued, so the response is in place before the state changes
+			ETX_Fsm_dispatch(ETX_FSM_EVT_RESET, 0);
+		break;
+
+		case ETXCMD_SET_ADV_PARAM: {
+			uint16_t advInt;
+
+			if (len != 2)
+				return ETXCMD_ERR_LEN;
+			advInt = BUILD_UINT16(pVal[0], pVal[1]);
+			if ((advInt < ETX_ADV_INT_MIN) || (advInt > ETX_ADV_INT_MAX))
+				return ETXCMD_ERR_VALUE;
+			// takes effect the next time advertising is enabled
+			GAP_SetParamValue(TGAP_LIM_DISC_ADV_INT_MIN, advInt);
+			GAP_SetParamValue(TGAP_LIM_DISC_ADV_INT_MAX, advInt);
+			GAP_SetParamValue(TGAP_GEN_DISC_ADV_INT_MIN, advInt);
+			GAP_SetParamValue(TGAP_GEN_DISC_ADV_INT_MAX, advInt);
+		}
+		break;
+
+		case ETXCMD_SET_CONN_PARAM: {
+			uint16_t minInterval, maxInterval, slaveLatency, connTimeout;
+
+			if (len != 8)
+				return ETXCMD_ERR_LEN;
+			minInterval = BUILD_UINT16(pVal[0], pVal[1]);
+			maxInterval = BUILD_UINT16(pVal[2], pVal[3]);
+			slaveLatency = BUILD_UINT16(pVal[4], pVal[5]);
+			connTimeout = BUILD_UINT16(pVal[6], pVal[7]);
+			if ((minInterval < ETX_CONN_INT_MIN)
+					|| (maxInterval > ETX_CONN_INT_MAX)
+					|| (minInterval > maxInterval)
+					|| (slaveLatency > ETX_CONN_LATENCY_MAX)
+					|| (connTimeout < ETX_CONN_TIMEOUT_MIN)
+					|| (connTimeout > ETX_CONN_TIMEOUT_MAX))
+				return ETXCMD_ERR_VALUE;
+			// supervision timeout has to cover two effective intervals
+			if ((uint32_t) connTimeout * 4
+					<= (uint32_t) (1 + slaveLatency) * maxInterval)
+				return ETXCMD_ERR_VALUE;
+
+			GAPRole_SetParameter(GAPROLE_MIN_CONN_INTERVAL, sizeof(uint16_t),
+					&minInterval);
+			GAPRole_SetParameter(GAPROLE_MAX_CONN_INTERVAL, sizeof(uint16_t),
+					&maxInterval);
+			GAPRole_SetParameter(GAPROLE_SLAVE_LATENCY, sizeof(uint16_t),
+					&slaveLatency);
+			GAPRole_SetParameter(GAPROLE_TIMEOUT_MULTIPLIER, sizeof(uint16_t),
+					&connTimeout);
+			if (GAPRole_SendUpdateParam(minInterval, maxInterval, slaveLatency,
+					connTimeout, GAPROLE_NO_ACTION) != SUCCESS)
+				return ETXCMD_ERR_STATE;
+		}
+		break;
+
+		case ETXCMD_SET_SCAN_PARAM: {
+			uint16_t period, duration;
+
+			if (len != 4)
+				return ETXCMD_ERR_LEN;
+			period = BUILD_UINT16(pVal[0], pVal[1]);
+			duration = BUILD_UINT16(pVal[2], pVal[3]);
+			if ((period != 0) && ((duration == 0) || (duration >= period)))
+				return ETXCMD_ERR_VALUE;
+			scanPeriod = period;
+			scanDuration = duration;
+			if (appState == APP_STATE_IDLE)
+				ETX_Scan_start();
+		}
+		break;
+
+		case ETXCMD_SET_TIME:
+			if (len != 4)
+				return ETXCMD_ERR_LEN;
+			ETX_Time_sync(BUILD_UINT32(pVal[0], pVal[1], pVal[2], pVal[3]));
+		break;
+
+		case ETXCMD_START_QUIZ:
+			if (len != 3)
+				return ETXCMD_ERR_LEN;
+			if (!ETX_Quiz_isValid(pVal[0], pVal[1], pVal[2], KEY_OK - 1))
+				return ETXCMD_ERR_VALUE;
+			memcpy(quizReq, pVal, sizeof(quizReq));
+			if (!ETX_Fsm_dispatch(ETX_FSM_EVT_QUIZ, pVal[0]))
+				return ETXCMD_ERR_STATE;
+		break;
+
+		case ETXCMD_END_QUIZ:
+			if (len != 0)
+				return ETXCMD_ERR_LEN;
+			if (!ETX_Fsm_dispatch(ETX_FSM_EVT_QUIZ_END, 0))
+				return ETXCMD_ERR_STATE;
+		break;
+
+		case ETXCMD_SET_KEY:
+			// provisioned once, a BS can't take over the beacons later
+			if (len != ETX_PROTO_KEY_LEN)
+				return ETXCMD_ERR_LEN;
+			if (isBeaconKeySet || !ETX_Key_Store(pVal))
+				return ETXCMD_ERR_STATE;
+		break;
+
+		case ETXCMD_BIND:
+			// only the BS picked can tag it, the link is its address
+			if (len != ETXCMD_BIND_LEN)
+				return ETXCMD_ERR_LEN;
+			if (pConn == NULL)
+				return ETXCMD_ERR_STATE;
+			if (!ETX_Beacon_verify(pVal, ETXCMD_BIND_COUNT_POS,
+					ETXCMD_BIND_TAG_POS))
+				return ETXCMD_ERR_VALUE;
+			ETX_BS_learn(pConn->peerAddrType, pConn->peerAddr);
+		break;
+
+		default:
+			return ETXCMD_ERR_UNKNOWN;
+	}
+
+	return ETXCMD_SUCCESS;
+}
+
+/** open or close a question, from a BS command or beacon **/
+static void ETX_Question_set(uint8_t num, bool isOpen) {
+	// a new question takes a new answer
+	if ((num != questionNum) && (appState == APP_STATE_IDLE))
+		userData = 0x00;
+	questionNum = num;
+	isQuestionOpen = isOpen;
+	utrace(BOARD_TRACE_QUESTION, (num << 8) | isOpen);
+
+	if (appState == APP_STATE_IDLE) {
+		if (isQuestionOpen)
+			Board_ledLowFlash(BOARD_BLED, 1000);
+		else
+			Board_ledOFF(BOARD_BLED);
+	}
+	uout2("question %d %s", questionNum, isOpen ? "opened" : "closed");
+}
+
+/*********************************************************************
+ * @fn      ETX_CMD_batch
+ *
+ * @brief   Execute a BS command batch written without response, and
+ *          notify its result as [seq][responses...] in one go.
+ *
+ * @param   connHandle - connection the batch was written on
+ * @param   pBatch - [seq][commands...]
+ * @param   len - length of the batch
+ *
+ * @return  none
+ */
+static void ETX_CMD_batch(uint16_t connHandle, uint8_t *pBatch, uint8_t len) {
+	uint8_t rsp[ETXPROFILE_BATCH_LEN];
+	uint8_t rspSize = sizeof(rsp);
+	uint8_t rspLen;
+	EtxConn_t *pConn = ETX_Conn_Find(connHandle);
+
+	if (pConn == NULL)
+		return;
+
+	// the BS sees lost batches by their missing notification
+	if ((pConn->batchCount != 0) && (pBatch[0] != pConn->batchSeq))
+		uout2("BS Batch seq %d, expected %d", pBatch[0], pConn->batchSeq);
+	pConn->batchSeq = pBatch[0] + 1;
+	pConn->batchCount++;
+
+	// the notification has to fit in the MTU of this link
+	if (pConn->mtu - 3 < rspSize)
+		rspSize = pConn->mtu - 3;
+
+	rsp[0] = pBatch[0];
+	rspLen = 1 + ETX_CMD_process(pConn, &pBatch[1], len - 1, &rsp[1],
+			rspSize - 1);
+	if (ETXProfile_NotifyBatch(connHandle, rspLen, rsp) != SUCCESS)
+		uout1("BS Batch %d not notified", pBatch[0]);
+}
+
+/*****************************************************************************
+ * @TAG Beacon listener
+ */
+/** (re)start the beacon scan duty cycle **/
+static void ETX_Scan_start(void) {
+	ETX_Scan_stop();
+	scanFailRun = 0;
+	if (scanPeriod == 0)
+		return;
+	Clock_setPeriod(Clock_handle(&scanClock),
+			((uint32_t) scanPeriod * 1000) / Clock_tickPeriod);
+	Util_restartClock(&scanClock, scanPeriod);
+}
+
+/** stop the beacon scan **/
+static void ETX_Scan_stop(void) {
+	Util_stopClock(&scanClock);
+	GAP_DeviceDiscoveryCancel(
+			ICall_getLocalMsgEntityId(ICALL_SERVICE_CLASS_BLE_MSG, selfEntity));
+}
+
+/** one AES-128 block on the AES engine, pArg is the key store index **/
+static bool ETX_Crypto_aes(void *pArg, const uint8_t *pIn, uint8_t *pOut) {
+	CryptoCC26XX_AESECB_Transaction trans;
+	uint32_t block[ETX_PROTO_AES_LEN / 4];	// the engine takes words
+
+	memcpy(block, pIn, sizeof(block));
+	CryptoCC26XX_Transac_init((CryptoCC26XX_Transaction *) &trans,
+			CRYPTOCC26XX_OP_AES_ECB_ENCRYPT);
+	trans.keyIndex = *(int *) pArg;
+	trans.msgIn = block;
+	trans.msgOut = block;
+	if (CryptoCC26XX_transact(cryptoHandle,
+			(CryptoCC26XX_Transaction *) &trans) != CRYPTOCC26XX_STATUS_SUCCESS)
+		return false;
+	memcpy(pOut, block, sizeof(block));
+	return true;
+}
+
+/*********************************************************************
+ * @fn      ETX_Beacon_verify
+ *
+ * @brief   Check a beacon comes from our base station and session, see
+ *          ETX_Link_beacon. The first beacon of our base station hands
+ *          out the session, it is kept with the session record. The key
+ *          is in the key store of the AES engine only while the tag is
+ *          checked.
+ *
+ * @param   pBeacon - beacon payload, [bsID][session lo][session hi]...
+ * @param   countPos - position of the counter, tagPos if there is none
+ * @param   tagPos - position of the tag in the payload
+ *
+ * @return  true if the beacon is for us
+ */
+static bool ETX_Beacon_verify(const uint8_t *pBeacon, uint8_t countPos,
+		uint8_t tagPos) {
+	EtxProtoKey_t key;
+	int keyIndex;
+	uint8_t result;
+
+	if (!isBeaconKeySet || (cryptoHandle == NULL) || (pBeacon == NULL)
+			|| (pBeacon[0] != destBSID))
+		return false;
+	keyIndex = CryptoCC26XX_allocateKey(cryptoHandle, CRYPTOCC26XX_KEY_ANY,
+			beaconKey);
+	if (keyIndex == CRYPTOCC26XX_STATUS_ERROR) {
+		uout0("Beacon key not loaded");
+		return false;
+	}
+	key.pfnAes = ETX_Crypto_aes;
+	key.pArg = &keyIndex;
+	result = ETX_Link_beacon(pBeacon, countPos, tagPos, &key, destBSID,
+			&sessionToken, &beaconCount);
+	CryptoCC26XX_releaseKey(cryptoHandle, &keyIndex);
+
+	switch (result) {
+		case ETX_LINK_BEACON_OK:
+			return true;
+
+		case ETX_LINK_BEACON_JOINED:
+			ETX_Session_Store();
+			return true;
+
+		case ETX_LINK_BEACON_BAD_TAG:
+			uout0("Beacon tag mismatch");
+			return false;
+
+		case ETX_LINK_BEACON_REPLAYED:
+			uout1("Beacon replayed, count %d", beaconCount);
+			return false;
+
+		default:
+			return false;
+	}
+}
+
+/** take the question state and the BS address from a BS beacon **/
+static void ETX_Beacon_process(uint8_t addrType, const uint8_t *pAddr,
+		const uint8_t *pData, uint8_t dataLen) {
+	const uint8_t *pBeacon = ETX_Proto_findAD(pData, dataLen,
+			ETX_ADTYPE_BEACON, ETX_BEACON_LEN);
+
+	if (!ETX_Beacon_verify(pBeacon, ETX_BEACON_COUNT_POS, ETX_BEACON_TAG_POS))
+		return;
+	ETX_BS_learn(addrType, pAddr);
+
+	if ((pBeacon[5] != 0) && (pBeacon[5] <= pBeacon[6])
+			&& (pBeacon[6] < KEY_OK)) {
+		answerMin = pBeacon[5];
+		answerMax = pBeacon[6];
+	}
+
+	// beacons repeat, only act on a change
+	if ((pBeacon[3] != questionNum)
+			|| ((pBeacon[4] & ETX_BEACON_FLAG_OPEN) != 0) != isQuestionOpen)
+		ETX_Question_set(pBeacon[3],
+				(pBeacon[4] & ETX_BEACON_FLAG_OPEN) != 0);
+
+	ETX_Time_sync(BUILD_UINT32(pBeacon[11], pBeacon[12], pBeacon[13],
+			pBeacon[14]));
+
+	// every beacon starts a frame of slots
+	{
+		uint16_t slots = BUILD_UINT16(pBeacon[8], pBeacon[9]);
+		bool wasSlotted = isSlotted;
+
+		isSlotted = (pBeacon[4] & ETX_BEACON_FLAG_SLOTTED) && (slots != 0)
+				&& (pBeacon[10] != 0);
+		if (appState != APP_STATE_ACTIVE)
+			return;
+		if (isSlotted) {
+			ETX_Slot_schedule(pBeacon[7], slots, pBeacon[10]);
+		} else if (wasSlotted) {
+			ETX_Slot_stop();
+			ETX_advertise(ETX_ADV_ON);
+		}
+	}
+}
+
+/*********************************************************************
+ * @fn      ETX_Ack_process
+ *
+ * @brief   Look our pending vote up in the BS ack beacon. The ack beacon
+ *          takes the tag and counter checks of a beacon, a forged or
+ *          replayed one would drop the vote. The vote is collected if all
+ *          its bits are set in the Bloom filter of our partition, and the
+ *          filter isn't saturated. Otherwise the advertising pauses for a
+ *          random, exponentially growing time so the retries of the
+ *          devices which missed spread out.
+ *
+ * @param   pData - advertising data
+ * @param   dataLen - length of the advertising data
+ *
+ * @return  none
+ */
+static void ETX_Ack_process(const uint8_t *pData, uint8_t dataLen) {
+	const uint8_t *pAck;
+	uint8_t result;
+
+	if (appState != APP_STATE_ACTIVE)
+		return;
+
+	pAck = ETX_Proto_findAD(pData, dataLen, ETX_ADTYPE_ACK, ETX_ACK_LEN);
+	if (!ETX_Beacon_verify(pAck, ETX_ACK_COUNT_POS, ETX_ACK_TAG_POS))
+		return;
+
+	result = ETX_Proto_ackCheck(pAck, devID, voteSeq);
+	if (result == ETX_PROTO_ACK_HIT) {
+		uout1("Vote %d acked by beacon", voteSeq);
+		ETX_Fsm_dispatch(ETX_FSM_EVT_COLLECTED, 0);
+	} else if ((result == ETX_PROTO_ACK_MISSED) && !isSlotted
+			&& !Util_isActive(&voteRetryClock)) {
+		// in slotted mode the retry is the slot of the next frame
+		uint32_t delay = ETX_Proto_backoff(voteRetries, Util_GetTRNG());
+
+		voteRetries++;
+		uout2("Vote missed, retry %d in %dms", voteRetries, delay);
+		ETX_advertise(ETX_ADV_OFF);
+		Util_restartClock(&voteRetryClock, delay);
+	}
+}
+
+/*****************************************************************************
+ * @TAG Votes
+ */
+/** put the pending vote in the advertising data **/
+static void ETX_Vote_updateAdvert(void) {
+	ETX_Proto_putVote(&advertData[ETX_ADV_VOTE_POS], devID, questionNum,
+			voteSeq, userData, voteTime);
+	uprofBegin("advertData");
+	GAPRole_SetParameter(GAPROLE_ADVERT_DATA, sizeof(advertData), advertData);
+	uprofEnd();
+	utrace(BOARD_TRACE_VOTE, (questionNum << 8) | voteSeq);
+}
+
+/*********************************************************************
+ * @fn      ETX_Slot_schedule
+ *
+ * @brief   Sync to the frame started by a BS beacon. The slot of the
+ *          device is picked by a hash of its devID and the frame number,
+ *          so devices which collide in one frame are apart in the next.
+ *          Advertising is off outside of the slot.
+ *
+ * @param   frame - frame number of the beacon
+ * @param   slots - number of slots in the frame
+ * @param   len - length of a slot, in ms
+ *
+ * @return  none
+ */
+static void ETX_Slot_schedule(uint8_t frame, uint16_t slots, uint8_t len) {
+	uint16_t slot = ETX_Proto_slot(devID, frame, slots);
+
+	ETX_Slot_stop();
+	Util_stopClock(&voteRetryClock);
+	ETX_advertise(ETX_ADV_OFF);
+	slotLen = len;
+	// the frame starts when the beacon is heard, a zero timeout never fires
+	Util_restartClock(&slotClock, 1 + (uint32_t) slot * len);
+}
+
+/** leave the current slot **/
+static void ETX_Slot_stop(void) {
+	Util_stopClock(&slotClock);
+	isInSlot = false;
+}
+
+/** the pending vote reached the base station, by GATT or ack beacon **/
+static void ETX_Vote_collected(void) {
+	if (voteProbe.keyTick != 0)
+		ETX_Diag_latency(ETX_DIAG_LAT_TOTAL, voteProbe.keyTick,
+				Clock_getTicks());
+	memset(&voteProbe, 0, sizeof(voteProbe));
+
+	userData = 0;
+	ETXProfile_SetParameter(ETXPROFILE_DATA, sizeof(userData), &userData);
+
+	voteSeq++;
+	ETX_Session_Store();
+}
+
+/*****************************************************************************
+ * @TAG Time sync
+ */
+/** set the BS time, in ms, the drift is measured between syncs **/
+static void ETX_Time_sync(uint32_t time) {
+	int32_t error;
+
+	switch (ETX_Proto_timeSync(&bsTime, time, Clock_getTicks(),
+			Clock_tickPeriod, &error)) {
+		case ETX_PROTO_TIME_STEP:
+			uout1("Time stepped by %dms", error);
+		break;
+
+		case ETX_PROTO_TIME_DRIFT:
+			uout2("Time error %dms, drift %dppm", error, bsTime.driftPpm);
+		break;
+
+		default:
+		break;
+	}
+}
+
+/** BS time at a Clock tick, time since boot if never synced **/
+static uint32_t ETX_Time_get(uint32_t tick) {
+	return ETX_Proto_timeGet(&bsTime, tick, Clock_tickPeriod);
+}
+
 /*****************************************************************************
  * @TAG Device ID Functions
  */
@@ -1019,6 +2813,110 @@ static void ETX_DevID_updateScanRsp() {
 	scanRspData[14] = devID[3];
 }
 
+/*****************************************************************************
+ * @TAG Session retention
+ */
+/** restore the session from NV, return true if a valid one is found **/
+static bool ETX_Session_Load(void) {
+	EtxSession_t rec;
+	uint8_t rtn = osal_snv_read(ETX_SESSION_NV_ID, sizeof(rec), (uint8 *) &rec);
+	if (rtn != SUCCESS)
+		return false;
+	if (!ETX_Link_sessionCheck(&rec, KEY_OK - 1)) {
+		uout0("Session record dropped");
+		return false;
+	}
+
+	destBSID = rec.destBSID;
+	voteSeq = rec.voteSeq;
+	sessionToken = rec.token;
+	beaconCount = rec.beaconCount;
+	isBSAddrKnown = (rec.bsAddrType != ETX_LINK_ADDR_UNKNOWN);
+	bsAddrType = rec.bsAddrType;
+	memcpy(bsAddr, rec.bsAddr, B_ADDR_LEN);
+	questionNum = rec.question;
+	userData = rec.answer;
+	ETX_whitelistUpdate();
+	uout3("Session resumed: BS %d, seq %d, answer %d", destBSID, voteSeq,
+			userData);
+	return true;
+}
+
+/** save the current session into NV **/
+static void ETX_Session_Store(void) {
+	EtxSession_t rec;
+	ETX_Link_sessionInit(&rec);
+	rec.destBSID = destBSID;
+	rec.voteSeq = voteSeq;
+	rec.token = sessionToken;
+	rec.bsAddrType = isBSAddrKnown ? bsAddrType : ETX_LINK_ADDR_UNKNOWN;
+	memcpy(rec.bsAddr, bsAddr, B_ADDR_LEN);
+	rec.question = questionNum;
+	rec.answer = userData;
+	rec.beaconCount = beaconCount;
+	if (osal_snv_write(ETX_SESSION_NV_ID, sizeof(rec), (uint8 *) &rec)
+			!= SUCCESS)
+		uout0("Session store failed");
+}
+
+/** restore the quiz of the resumed session from NV **/
+static bool ETX_Sheet_Load(void) {
+	EtxSheetRec_t rec;
+	uint8_t rtn = osal_snv_read(ETX_SHEET_NV_ID, sizeof(rec), (uint8 *) &rec);
+	if ((rtn != SUCCESS) || (rec.version != ETX_SHEET_NV_VER)
+			|| (rec.len != sizeof(rec)) || (rec.quiz.numQuestions == 0)
+			|| (rec.quiz.token != sessionToken)
+			|| !ETX_Quiz_check(&rec.quiz, KEY_OK - 1))
+		return false;
+
+	quiz = rec.quiz;
+	ETX_Sheet_publish();
+	uout2("Quiz resumed: %d of %d answered", ETX_Quiz_answered(&quiz),
+			quiz.numQuestions);
+	return true;
+}
+
+/** save the quiz into NV, an ended one as well so it's not resumed **/
+static void ETX_Sheet_Store(void) {
+	EtxSheetRec_t rec;
+
+	isSheetDirty = false;
+	rec.version = ETX_SHEET_NV_VER;
+	rec.len = sizeof(rec);
+	rec.quiz = quiz;
+	if (osal_snv_write(ETX_SHEET_NV_ID, sizeof(rec), (uint8 *) &rec)
+			!= SUCCESS)
+		uout0("Sheet store failed");
+}
+
+/** put the sheet in the profile for the BS to read **/
+static void ETX_Sheet_publish(void) {
+	uint8_t sheet[ETX_QUIZ_SHEET_LEN];
+
+	ETXProfile_SetParameter(ETXPROFILE_SHEET, ETX_Quiz_sheet(&quiz, sheet),
+			sheet);
+}
+
+/** restore the beacon key of the installation from NV **/
+static void ETX_Key_Load(void) {
+	isBeaconKeySet = (osal_snv_read(ETX_KEY_NV_ID, ETX_PROTO_KEY_LEN,
+			(uint8 *) beaconKey) == SUCCESS);
+	if (!isBeaconKeySet)
+		uout0("No beacon key, beacons are ignored");
+}
+
+/** provision the beacon key, it is read back before it is taken **/
+static bool ETX_Key_Store(const uint8_t *pKey) {
+	if ((osal_snv_write(ETX_KEY_NV_ID, ETX_PROTO_KEY_LEN, (uint8 *) pKey)
+			!= SUCCESS)
+			|| (osal_snv_read(ETX_KEY_NV_ID, ETX_PROTO_KEY_LEN,
+					(uint8 *) beaconKey) != SUCCESS))
+		return false;
+	isBeaconKeySet = true;
+	uout0("Beacon key provisioned");
+	return true;
+}
+
 /******************************************************************************
  * ADC Control
  */
@@ -1037,6 +2935,7 @@ static uint32_t ETX_ADC_valueGet(uint8_t BOARD_ADC) {
 		return 0;
 	}
 	res = ADC_convert(adc, &adcValue);
+	utrace(BOARD_TRACE_ADC, BOARD_ADC);
 	if (res == ADC_STATUS_SUCCESS) {
 		ADC_close(adc);
 		uint32_t rtn = ADC_convertRawToMicroVolts(adc, adcValue);
@@ -0,0 +1,363 @@
+/*****************************************************************************
+ *
+ * @filepath    /tools/etx_ack/etx_ack.c
+ *
+ * @project     evrs tools
+ *
+ * @brief       measures the false positive rate of the ack beacon filter.
+ *              It runs the firmware's ETX_Proto_partition, ETX_Proto_ackAdd
+ *              and ETX_Proto_ackCheck over a population of devIDs, each
+ *              round every device has a new vote and some of them are
+ *              collected into the ack beacon of their partition.
+ *
+ *              A false positive is a vote not collected which the ETX finds
+ *              in the filter, it stops advertising it and the vote is lost
+ *              until the BS reads it over a link. A stale one is the next
+ *              vote of a device found by the filter of its collected vote.
+ *              A filter with more than ETX_ACK_MAX_BITS set is full, the
+ *              ETX takes it for no ack, the share of full beacons is the
+ *              cost of too few partitions.
+ *
+ *              Errors, exit with 1:
+ *              - a partition out of range
+ *              - a collected vote missed (false negative)
+ *              - a vote taken by the beacon of another partition
+ *              - a filter with no or too many hashes, or full, taken for
+ *                an ack
+ *              - a measured rate well above the Bloom filter estimate
+ *                (1 - (1 - 1/m)^(k n))^k of the beacons sent
+ *
+ * build        cc -O2 -std=gnu99 -I../../evrs_tx_cc2650etx_app/src
+ *                  -o etx_ack etx_ack.c ../../evrs_tx_cc2650etx_app/src/etx_proto.c
+ *                  -lm
+ *
+ * usage        ./etx_ack                     300 devices, 1 to 8 hashes
+ *              ./etx_ack -n 1000 -p 50 -k 4  one setting
+ *              ./etx_ack -s -c 90            sequential devIDs, 90% collected
+ *
+ * @date        18 Oct. 2026
+ *
+ * @author      Ziyi@outlook.com.au
+ *
+ ****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "etx_proto.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Measured rates may be this much above the estimate before it is an error,
+// relative and absolute for the rounding of small counts. The estimate is
+// for independent hashes, the double hashing of a 128 bit filter only
+// draws on 14 bits of the vote hash and runs up to 3 times above it with
+// many hashes, a broken hash is far worse
+#define ACK_FP_MARGIN		3.0
+#define ACK_FP_SLACK		0.002
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct AckCfg_t {
+	int devices;
+	int partitions;		// 0 for one per 16 devices, as etx_sim
+	int hashes;			// 0 for all of them
+	int collected;		// percent of the votes in a beacon
+	int rounds;
+	bool isSequential;	// devIDs in a row, as flashed in production
+} AckCfg_t;
+
+typedef struct AckDev_t {
+	uint8_t devID[ETX_PROTO_DEVID_LEN];
+	uint8_t partition;
+	uint8_t seq;
+	bool isCollected;
+} AckDev_t;
+
+typedef struct AckResult_t {
+	uint64_t checked;
+	uint64_t falsePos;
+	uint64_t staleChecked;
+	uint64_t stale;
+	double estimate;	// sum over the checks
+	uint64_t votes;		// votes in the beacons
+	uint64_t beacons;
+	uint64_t full;		// beacons whose filter is too full to ack
+} AckResult_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static uint32_t rng = 1;
+static int errors = 0;
+
+/*****************************************************************************
+ * @TAG Population
+ */
+static uint32_t Ack_random(void) {
+	rng = rng * 1103515245 + 12345;
+	return rng >> 16;
+}
+
+static AckDev_t *Ack_population(const AckCfg_t *pCfg, int *pPartLen) {
+	AckDev_t *pDev = calloc(pCfg->devices, sizeof(AckDev_t));
+	uint32_t base = (Ack_random() << 16) | Ack_random();
+	int i;
+
+	for (i = 0; i < pCfg->devices; i++) {
+		uint32_t id = pCfg->isSequential ? base + i :
+				(Ack_random() << 16) | Ack_random();
+
+		pDev[i].devID[0] = (uint8_t) id;
+		pDev[i].devID[1] = (uint8_t) (id >> 8);
+		pDev[i].devID[2] = (uint8_t) (id >> 16);
+		pDev[i].devID[3] = (uint8_t) (id >> 24);
+		pDev[i].partition = ETX_Proto_partition(pDev[i].devID,
+				(uint8_t) pCfg->partitions);
+		if (pDev[i].partition >= pCfg->partitions) {
+			printf("device %d: partition %d of %d\n", i, pDev[i].partition,
+					pCfg->partitions);
+			errors++;
+			pDev[i].partition = 0;
+		}
+		pDev[i].seq = (uint8_t) Ack_random();
+		pPartLen[pDev[i].partition]++;
+	}
+	return pDev;
+}
+
+/*****************************************************************************
+ * @TAG Filter
+ */
+/** bits set in the filter of an ack beacon **/
+static int Ack_bits(const uint8_t *pAck) {
+	int bits = 0;
+	int i;
+
+	for (i = 0; i < ETX_ACK_FILTER_BITS; i++)
+		bits += (pAck[ETX_ACK_FILTER_POS + i / 8] >> (i % 8)) & 1;
+	return bits;
+}
+
+/** one round, a beacon per partition **/
+static void Ack_round(const AckCfg_t *pCfg, AckDev_t *pDev, int hashes,
+		AckResult_t *pRes) {
+	uint8_t ack[ETX_ACK_LEN];
+	int part, i;
+
+	for (i = 0; i < pCfg->devices; i++) {
+		pDev[i].seq++;
+		pDev[i].isCollected = (int) (Ack_random() % 100) < pCfg->collected;
+	}
+
+	for (part = 0; part < pCfg->partitions; part++) {
+		uint32_t votes = 0;
+		double estimate;
+		bool isFull;
+
+		memset(ack, 0, sizeof(ack));
+		ack[3] = (uint8_t) part;
+		ack[4] = (uint8_t) pCfg->partitions;
+		ack[5] = (uint8_t) hashes;
+		for (i = 0; i < pCfg->devices; i++) {
+			if ((pDev[i].partition == part) && pDev[i].isCollected) {
+				ETX_Proto_ackAdd(ack, pDev[i].devID, pDev[i].seq);
+				votes++;
+			}
+		}
+		estimate = pow(1.0 - pow(1.0 - 1.0 / ETX_ACK_FILTER_BITS,
+				(double) hashes * votes), hashes);
+		pRes->votes += votes;
+		pRes->beacons++;
+		isFull = Ack_bits(ack) > ETX_ACK_MAX_BITS;
+		if (isFull)
+			pRes->full++;
+
+		for (i = 0; i < pCfg->devices; i++) {
+			uint8_t result = ETX_Proto_ackCheck(ack, pDev[i].devID,
+					pDev[i].seq);
+
+			if (isFull) {
+				if (result != ETX_PROTO_ACK_OTHER) {
+					printf("device %d: full filter of %d bits taken\n", i,
+							Ack_bits(ack));
+					errors++;
+				}
+			} else if (pDev[i].partition != part) {
+				if (result != ETX_PROTO_ACK_OTHER) {
+					printf("device %d of partition %d taken by %d\n", i,
+							pDev[i].partition, part);
+					errors++;
+				}
+			} else if (pDev[i].isCollected) {
+				if (result != ETX_PROTO_ACK_HIT) {
+					printf("device %d: collected vote %d missed\n", i,
+							pDev[i].seq);
+					errors++;
+				}
+				// its next vote against this filter
+				pRes->staleChecked++;
+				if (ETX_Proto_ackCheck(ack, pDev[i].devID,
+						(uint8_t) (pDev[i].seq + 1)) == ETX_PROTO_ACK_HIT)
+					pRes->stale++;
+			} else {
+				pRes->checked++;
+				pRes->estimate += estimate;
+				if (result == ETX_PROTO_ACK_HIT)
+					pRes->falsePos++;
+			}
+		}
+	}
+}
+
+/** a filter without or with too many hashes, or full, is no ack **/
+static void Ack_checkHeader(const AckDev_t *pDev) {
+	uint8_t ack[ETX_ACK_LEN];
+	int i;
+
+	// one bit over the limit, the vote's own bits among them, one partition
+	memset(ack, 0, sizeof(ack));
+	ack[4] = 1;
+	ack[5] = ETX_ACK_MAX_HASHES;
+	ETX_Proto_ackAdd(ack, pDev->devID, pDev->seq);
+	for (i = 0; Ack_bits(ack) <= ETX_ACK_MAX_BITS; i++)
+		ack[ETX_ACK_FILTER_POS + (i % 128) / 8] |= 1 << (i % 8);
+	if (ETX_Proto_ackCheck(ack, pDev->devID, pDev->seq)
+			!= ETX_PROTO_ACK_OTHER) {
+		printf("full filter taken\n");
+		errors++;
+	}
+	ack[ETX_ACK_FILTER_POS + ((i - 1) % 128) / 8] &= ~(1 << ((i - 1) % 8));
+	if ((Ack_bits(ack) == ETX_ACK_MAX_BITS) && (ETX_Proto_ackCheck(ack,
+			pDev->devID, pDev->seq) != ETX_PROTO_ACK_HIT)) {
+		printf("filter of %d bits missed\n", ETX_ACK_MAX_BITS);
+		errors++;
+	}
+
+	memset(ack, 0xFF, sizeof(ack));
+	ack[3] = pDev->partition;
+	ack[4] = (uint8_t) (pDev->partition + 1);
+	ack[5] = 0;
+	if (ETX_Proto_ackCheck(ack, pDev->devID, pDev->seq)
+			!= ETX_PROTO_ACK_OTHER) {
+		printf("filter without hashes taken\n");
+		errors++;
+	}
+	ack[5] = ETX_ACK_MAX_HASHES + 1;
+	if (ETX_Proto_ackCheck(ack, pDev->devID, pDev->seq)
+			!= ETX_PROTO_ACK_OTHER) {
+		printf("filter of %d hashes taken\n", ETX_ACK_MAX_HASHES + 1);
+		errors++;
+	}
+	ack[4] = 0;
+	ack[5] = 1;
+	if (ETX_Proto_ackCheck(ack, pDev->devID, pDev->seq)
+			!= ETX_PROTO_ACK_OTHER) {
+		printf("filter of no partitions taken\n");
+		errors++;
+	}
+}
+
+/*****************************************************************************
+ * @TAG Main
+ */
+static void Ack_usage(const AckCfg_t *pCfg) {
+	printf("usage: etx_ack [options]\n"
+			"  -n n      devices (%d)\n"
+			"  -p n      partitions, 0 for one per 16 devices (%d)\n"
+			"  -k n      filter hashes, 0 for 1 to %d (%d)\n"
+			"  -c pct    votes collected in a beacon (%d)\n"
+			"  -r n      rounds (%d)\n"
+			"  -s        sequential devIDs instead of random ones\n"
+			"  -S seed   random seed\n", pCfg->devices, pCfg->partitions,
+			ETX_ACK_MAX_HASHES, pCfg->hashes, pCfg->collected, pCfg->rounds);
+}
+
+int main(int argc, char **argv) {
+	AckCfg_t cfg = { .devices = 300, .partitions = 0, .hashes = 0,
+			.collected = 50, .rounds = 200, .isSequential = false };
+	AckDev_t *pDev;
+	int *pPartLen;
+	int minLen, maxLen;
+	int opt, k, i;
+
+	while ((opt = getopt(argc, argv, "n:p:k:c:r:sS:h")) != -1) {
+		switch (opt) {
+			case 'n': cfg.devices = atoi(optarg); break;
+			case 'p': cfg.partitions = atoi(optarg); break;
+			case 'k': cfg.hashes = atoi(optarg); break;
+			case 'c': cfg.collected = atoi(optarg); break;
+			case 'r': cfg.rounds = atoi(optarg); break;
+			case 's': cfg.isSequential = true; break;
+			case 'S': rng = (uint32_t) strtoul(optarg, NULL, 0); break;
+			default:
+				Ack_usage(&cfg);
+				return (opt == 'h') ? 0 : 1;
+		}
+	}
+	if (cfg.partitions == 0)
+		cfg.partitions = (cfg.devices + 15) / 16;
+	if ((cfg.devices < 1) || (cfg.partitions < 1) || (cfg.partitions > 255)
+			|| (cfg.hashes < 0) || (cfg.hashes > ETX_ACK_MAX_HASHES)
+			|| (cfg.collected < 0) || (cfg.collected > 100)
+			|| (cfg.rounds < 1)) {
+		Ack_usage(&cfg);
+		return 1;
+	}
+
+	pPartLen = calloc(cfg.partitions, sizeof(int));
+	pDev = Ack_population(&cfg, pPartLen);
+	minLen = maxLen = pPartLen[0];
+	for (i = 1; i < cfg.partitions; i++) {
+		if (pPartLen[i] < minLen)
+			minLen = pPartLen[i];
+		if (pPartLen[i] > maxLen)
+			maxLen = pPartLen[i];
+	}
+	Ack_checkHeader(&pDev[0]);
+
+	printf("# %d %s devIDs, %d partitions of %d to %d (mean %.1f), "
+			"%d%% collected, %d rounds, filter %d bits\n", cfg.devices,
+			cfg.isSequential ? "sequential" : "random", cfg.partitions, minLen,
+			maxLen, (double) cfg.devices / cfg.partitions, cfg.collected,
+			cfg.rounds, ETX_ACK_FILTER_BITS);
+	printf("# %-6s %8s %10s %12s %12s %12s %8s\n", "hashes", "votes",
+			"checked", "false pos", "estimate", "stale", "full");
+	for (k = cfg.hashes ? cfg.hashes : 1;
+			k <= (cfg.hashes ? cfg.hashes : ETX_ACK_MAX_HASHES); k++) {
+		AckResult_t res = { 0 };
+		double rate, estimate;
+		int r;
+
+		for (r = 0; r < cfg.rounds; r++)
+			Ack_round(&cfg, pDev, k, &res);
+		rate = res.checked ? (double) res.falsePos / res.checked : 0;
+		estimate = res.checked ? res.estimate / res.checked : 0;
+		printf("  %-6d %8.1f %10llu %12.5f %12.5f %12.5f %7.1f%%\n", k,
+				(double) res.votes / res.beacons,
+				(unsigned long long) res.checked, rate, estimate,
+				res.staleChecked ?
+						(double) res.stale / res.staleChecked : 0,
+				100.0 * res.full / res.beacons);
+		if (rate > estimate * ACK_FP_MARGIN + ACK_FP_SLACK) {
+			printf("hashes %d: false positive rate %.5f, estimate %.5f\n", k,
+					rate, estimate);
+			errors++;
+		}
+	}
+
+	printf("%d errors\n", errors);
+	free(pDev);
+	free(pPartLen);
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,1432 @@
+/*****************************************************************************
+ *
+ * @filepath    /tools/etx_bs/etx_bs.c
+ *
+ * @project     evrs tools
+ *
+ * @brief       base station stand-in for throughput tests of the ETX
+ *              profile. It scripts BS sessions against host ETX instances
+ *              and measures the transactions per second and the latency of
+ *              every operation.
+ *
+ *              Transport: HCI ACL data packets (H4 type 0x02, connection
+ *              handle, L2CAP header, ATT channel 0x0004) over a stream
+ *              socket, one socket per link. With -i, both ends hold every
+ *              packet back to the next connection event.
+ *
+ *              ETX instance: the attributes of ETXProfileAttrTbl from
+ *              ETX_HDL_SERVICE, with the BS commands framed by the
+ *              firmware's ETX_Proto_cmdProcess. The write response goes
+ *              before the responses of the commands are notified on CMD, as
+ *              the device runs them after the stack answered. Batches go
+ *              through the firmware's batch ring, a batch it can't take is
+ *              lost. A question opened gets a vote at once. Reading the User
+ *              Data collects it, as on the device. A quiz started gets a
+ *              whole sheet of answers at once, submitted, kept by the
+ *              firmware's etx_quiz.c. The GAP, GATT and discovery procedures
+ *              are not served, the BS knows the handles.
+ *
+ *              With -t, the batch ring is checked for overflow, wrap and
+ *              batches arriving while it is full, the batch interpreter
+ *              against known responses, and the same commands are timed
+ *              written to CMD and as a batch.
+ *
+ *              Script, one operation per line, # for comments:
+ *                mtu <n>         exchange MTU
+ *                open <q>        open question q
+ *                close           close the question
+ *                time            set the BS time
+ *                vote            read the vote stamp and the User Data
+ *                stats           get the stats
+ *                cmd <hex>       raw BS commands, written and notified
+ *                batch <hex>     raw BS commands, as a batch and notified
+ *                log <page>      select a diagnostics page and long read it
+ *                quiz <n>        start a quiz of n questions
+ *                sheet           long read the answer sheet, end the quiz
+ *
+ * build        cc -O2 -std=gnu99 -pthread -I../../evrs_tx_cc2650etx_app/src
+ *                  -o etx_bs etx_bs.c ../../evrs_tx_cc2650etx_app/src/etx_proto.c
+ *                  ../../evrs_tx_cc2650etx_app/src/etx_quiz.c
+ *
+ * usage        ./etx_bs -n 8 -r 1000                  in-process instances
+ *              ./etx_bs -L 5500 &                     instances on TCP 5500
+ *              ./etx_bs -c 127.0.0.1:5500 -n 8 -f session.txt
+ *              ./etx_bs -n 8 -r 100 -f quiz.txt       a quiz per student
+ *              ./etx_bs -t -n 4 -r 50 -i 7500         checks, CMD vs batch
+ *              ./etx_bs -h for all the settings
+ *
+ * @date        18 Oct. 2026
+ *
+ * @author      Ziyi@outlook.com.au
+ *
+ ****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "etx_proto.h"
+#include "etx_quiz.h"
+
+// etx_gatt_prof.h comes with the BLE stack types
+typedef uint8_t uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef uint8_t bStatus_t;
+#include "etx_gatt_prof.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define BS_MAX_OPS				64
+#define BS_MAX_LINE				128
+#define BS_MAX_PDU				251
+#define BS_DEFAULT_MTU			23
+
+// Handles of the ETX service, in the order of ETXProfileAttrTbl
+#define ETX_HDL_SERVICE			0x0020
+#define ETX_HDL_CMD				(ETX_HDL_SERVICE + 2)
+#define ETX_HDL_CMD_CCC			(ETX_HDL_SERVICE + 3)
+#define ETX_HDL_DATA			(ETX_HDL_SERVICE + 6)
+#define ETX_HDL_BATCH			(ETX_HDL_SERVICE + 9)
+#define ETX_HDL_BATCH_CCC		(ETX_HDL_SERVICE + 10)
+#define ETX_HDL_STAMP			(ETX_HDL_SERVICE + 13)
+#define ETX_HDL_DIAG			(ETX_HDL_SERVICE + 16)
+#define ETX_HDL_SHEET			(ETX_HDL_SERVICE + 19)
+
+// ATT opcodes
+#define ATT_ERROR_RSP			0x01
+#define ATT_MTU_REQ				0x02
+#define ATT_MTU_RSP				0x03
+#define ATT_READ_REQ			0x0A
+#define ATT_READ_RSP			0x0B
+#define ATT_READ_BLOB_REQ		0x0C
+#define ATT_READ_BLOB_RSP		0x0D
+#define ATT_WRITE_REQ			0x12
+#define ATT_WRITE_RSP			0x13
+#define ATT_NOTIFY				0x1B
+#define ATT_WRITE_CMD			0x52
+
+// ATT errors
+#define ATT_ERR_HANDLE			0x01
+#define ATT_ERR_READ			0x02
+#define ATT_ERR_WRITE			0x03
+#define ATT_ERR_REQ				0x06
+#define ATT_ERR_OFFSET			0x07
+#define ATT_ERR_LEN				0x0D
+
+#define HCI_ACL_PKT				0x02
+#define L2CAP_CID_ATT			0x0004
+
+// Operations of the script
+enum {
+	OP_MTU,
+	OP_OPEN,
+	OP_CLOSE,
+	OP_TIME,
+	OP_VOTE,
+	OP_STATS,
+	OP_CMD,
+	OP_BATCH,
+	OP_LOG,
+	OP_QUIZ,
+	OP_SHEET,
+	OP_NUM
+};
+
+static const char *const opNames[OP_NUM] = {
+	"mtu", "open", "close", "time", "vote", "stats", "cmd", "batch", "log",
+	"quiz", "sheet"
+};
+
+static const char defaultScript[] =
+	"mtu 65\n"
+	"time\n"
+	"open 1\n"
+	"vote\n"
+	"stats\n"
+	"batch 0500 0600\n"
+	"close\n"
+	"log ff\n";
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct BsOp_t {
+	uint8_t op;
+	uint8_t len;
+	uint8_t val[ETXPROFILE_CMD_LEN];
+} BsOp_t;
+
+typedef struct BsCfg_t {
+	BsOp_t ops[BS_MAX_OPS];
+	int numOps;
+	int links;
+	int runs;
+	int connInterval;			// us, 0 to deliver at once
+	const char *pConnect;		// host:port, NULL for in-process instances
+	int listenPort;
+} BsCfg_t;
+
+// One end of a link
+typedef struct BsLink_t {
+	int fd;
+	uint16_t connHandle;
+	const BsCfg_t *pCfg;
+} BsLink_t;
+
+// Latencies of an operation, us
+typedef struct BsStat_t {
+	double *pLat;
+	size_t len;
+	size_t size;
+	uint32_t errors;
+} BsStat_t;
+
+typedef struct BsRun_t {
+	BsLink_t link;
+	BsStat_t stats[OP_NUM];
+	uint64_t transactions;
+	bool isFailed;
+} BsRun_t;
+
+// Host ETX instance
+typedef struct EtxHost_t {
+	BsLink_t link;
+	uint16_t mtu;
+	uint8_t cmd[ETXPROFILE_CMD_LEN];
+	uint8_t cmdLen;
+	uint8_t data;
+	uint8_t stamp[ETXPROFILE_STAMP_LEN];
+	uint8_t diag[ETXPROFILE_DIAG_LEN];
+	uint8_t diagLen;
+	bool isNotifyOn;
+	bool isCmdNotifyOn;
+	bool isVotePending;
+	bool isInputLocked;
+	uint8_t questionNum;
+	bool isQuestionOpen;
+	uint8_t voteSeq;
+	uint16_t collected;
+	EtxQuiz_t quiz;
+	uint8_t sheet[ETX_QUIZ_SHEET_LEN];
+	uint8_t sheetLen;
+	EtxProtoBatches_t batches;
+	EtxProtoTime_t bsTime;
+	uint32_t rng;
+} EtxHost_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static struct timespec epoch;
+
+/*****************************************************************************
+ * @TAG Transport
+ */
+static uint64_t Bs_nowUs(void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) (now.tv_sec - epoch.tv_sec) * 1000000
+			+ (now.tv_nsec - epoch.tv_nsec) / 1000;
+}
+
+/** hold a packet back to the next connection event **/
+static void Bs_connEvent(const BsLink_t *pLink) {
+	uint64_t now, next;
+	struct timespec wait;
+
+	if (pLink->pCfg->connInterval <= 0)
+		return;
+	now = Bs_nowUs();
+	next = (now / pLink->pCfg->connInterval + 1) * pLink->pCfg->connInterval;
+	wait.tv_sec = (next - now) / 1000000;
+	wait.tv_nsec = ((next - now) % 1000000) * 1000;
+	nanosleep(&wait, NULL);
+}
+
+static bool Bs_readAll(int fd, uint8_t *pBuf, size_t len) {
+	while (len > 0) {
+		ssize_t n = read(fd, pBuf, len);
+		if (n <= 0) {
+			if ((n < 0) && (errno == EINTR))
+				continue;
+			return false;
+		}
+		pBuf += n;
+		len -= n;
+	}
+	return true;
+}
+
+/** send an ATT PDU as one HCI ACL data packet **/
+static bool Bs_send(const BsLink_t *pLink, const uint8_t *pPdu, uint16_t len) {
+	uint8_t pkt[9 + BS_MAX_PDU];
+	uint16_t aclLen = len + 4;
+
+	if (len > BS_MAX_PDU)
+		return false;
+	pkt[0] = HCI_ACL_PKT;
+	pkt[1] = (uint8_t) pLink->connHandle;
+	pkt[2] = ((pLink->connHandle >> 8) & 0x0F) | 0x20; // first, flushable
+	pkt[3] = (uint8_t) aclLen;
+	pkt[4] = (uint8_t) (aclLen >> 8);
+	pkt[5] = (uint8_t) len;
+	pkt[6] = (uint8_t) (len >> 8);
+	pkt[7] = (uint8_t) L2CAP_CID_ATT;
+	pkt[8] = (uint8_t) (L2CAP_CID_ATT >> 8);
+	memcpy(&pkt[9], pPdu, len);
+
+	Bs_connEvent(pLink);
+	return write(pLink->fd, pkt, 9 + len) == 9 + len;
+}
+
+/** receive an ATT PDU, returns its length or -1 when the link is gone **/
+static int Bs_recv(const BsLink_t *pLink, uint8_t *pPdu) {
+	uint8_t hdr[9];
+	uint16_t aclLen, len;
+
+	for (;;) {
+		if (!Bs_readAll(pLink->fd, hdr, sizeof(hdr)) || (hdr[0] != HCI_ACL_PKT))
+			return -1;
+		aclLen = hdr[3] | (hdr[4] << 8);
+		len = hdr[5] | (hdr[6] << 8);
+		if ((aclLen != len + 4) || (len > BS_MAX_PDU)
+				|| !Bs_readAll(pLink->fd, pPdu, len))
+			return -1;
+		// other channels are dropped, as by the stack
+		if ((hdr[7] | (hdr[8] << 8)) == L2CAP_CID_ATT)
+			return len;
+	}
+}
+
+/*****************************************************************************
+ * @TAG Host ETX instance
+ */
+/** single BS command, a stand-in for ETX_CMD_exec **/
+static uint8_t Host_cmdExec(void *pArg, uint8_t opcode, const uint8_t *pVal,
+		uint8_t len, uint8_t *pData, uint8_t *pDataLen) {
+	EtxHost_t *pHost = pArg;
+	int32_t error;
+
+	*pDataLen = 0;
+	switch (opcode) {
+		case ETXCMD_OPEN_QUESTION:
+			if (len != 1)
+				return ETXCMD_ERR_LEN;
+			pHost->questionNum = pVal[0];
+			pHost->isQuestionOpen = true;
+			// the student answers at once
+			if (!pHost->isInputLocked) {
+				uint32_t time;
+
+				pHost->rng = pHost->rng * 1103515245 + 12345;
+				pHost->data = 1 + (pHost->rng >> 16) % 5;
+				pHost->voteSeq++;
+				pHost->isVotePending = true;
+				time = ETX_Proto_timeGet(&pHost->bsTime, (uint32_t) Bs_nowUs(), 1);
+				pHost->stamp[0] = pHost->voteSeq;
+				pHost->stamp[1] = (uint8_t) time;
+				pHost->stamp[2] = (uint8_t) (time >> 8);
+				pHost->stamp[3] = (uint8_t) (time >> 16);
+				pHost->stamp[4] = (uint8_t) (time >> 24);
+				pHost->stamp[5] = pHost->bsTime.isSynced ?
+						ETXPROFILE_STAMP_SYNCED : 0;
+			}
+		break;
+
+		case ETXCMD_CLOSE_QUESTION:
+			if (len != 0)
+				return ETXCMD_ERR_LEN;
+			pHost->isQuestionOpen = false;
+		break;
+
+		case ETXCMD_LOCK_INPUT:
+			if (len != 1)
+				return ETXCMD_ERR_LEN;
+			pHost->isInputLocked = (pVal[0] != 0);
+		break;
+
+		case ETXCMD_SET_LED:
+			if ((len != 2) && (len != 4))
+				return ETXCMD_ERR_LEN;
+		break;
+
+		case ETXCMD_GET_BATTERY:
+			if (len != 0)
+				return ETXCMD_ERR_LEN;
+			pData[0] = (uint8_t) 3000;
+			pData[1] = 3000 >> 8;
+			*pDataLen = ETXCMD_BATTERY_LEN;
+		break;
+
+		case ETXCMD_GET_STATS:
+			if (len != 0)
+				return ETXCMD_ERR_LEN;
+			memset(pData, 0, ETXCMD_STATS_LEN);
+			pData[0] = pHost->voteSeq;
+			pData[5] = (uint8_t) pHost->collected;
+			pData[6] = (uint8_t) (pHost->collected >> 8);
+			*pDataLen = ETXCMD_STATS_LEN;
+		break;
+
+		case ETXCMD_RESET_INIT:
+			if (len != 0)
+				return ETXCMD_ERR_LEN;
+			pHost->isVotePending = false;
+			pHost->isQuestionOpen = false;
+		break;
+
+		case ETXCMD_SET_ADV_PARAM:
+			if (len != 2)
+				return ETXCMD_ERR_LEN;
+		break;
+
+		case ETXCMD_SET_CONN_PARAM:
+			if (len != 8)
+				return ETXCMD_ERR_LEN;
+		break;
+
+		case ETXCMD_SET_SCAN_PARAM: {
+			uint16_t period = pVal[0] | (pVal[1] << 8);
+			uint16_t duration = pVal[2] | (pVal[3] << 8);
+
+			if (len != 4)
+				return ETXCMD_ERR_LEN;
+			if ((period != 0) && ((duration == 0) || (duration >= period)))
+				return ETXCMD_ERR_VALUE;
+		}
+		break;
+
+		case ETXCMD_SET_TIME:
+			if (len != 4)
+				return ETXCMD_ERR_LEN;
+			// microsecond ticks
+			ETX_Proto_timeSync(&pHost->bsTime, pVal[0] | (pVal[1] << 8)
+					| (pVal[2] << 16) | ((uint32_t) pVal[3] << 24),
+					(uint32_t) Bs_nowUs(), 1, &error);
+		break;
+
+		case ETXCMD_START_QUIZ: {
+			uint8_t i;
+
+			if (len != 3)
+				return ETXCMD_ERR_LEN;
+			if (!ETX_Quiz_isValid(pVal[0], pVal[1], pVal[2], 9))
+				return ETXCMD_ERR_VALUE;
+			if (pHost->quiz.numQuestions != 0)
+				return ETXCMD_ERR_STATE;
+			// the student works through the sheet at once
+			ETX_Quiz_start(&pHost->quiz, 0, pVal[0], pVal[1], pVal[2]);
+			for (i = 0; i < pVal[0]; i++) {
+				pHost->rng = pHost->rng * 1103515245 + 12345;
+				ETX_Quiz_answer(&pHost->quiz,
+						pVal[1] + (pHost->rng >> 16) % (pVal[2] - pVal[1] + 1));
+				ETX_Quiz_next(&pHost->quiz);
+			}
+			pHost->quiz.flags |= ETX_QUIZ_FLAG_SUBMITTED;
+			pHost->sheetLen = ETX_Quiz_sheet(&pHost->quiz, pHost->sheet);
+		}
+		break;
+
+		case ETXCMD_END_QUIZ:
+			if (len != 0)
+				return ETXCMD_ERR_LEN;
+			if (pHost->quiz.numQuestions == 0)
+				return ETXCMD_ERR_STATE;
+			ETX_Quiz_end(&pHost->quiz);
+			pHost->sheetLen = ETX_Quiz_sheet(&pHost->quiz, pHost->sheet);
+		break;
+
+		default:
+			return ETXCMD_ERR_UNKNOWN;
+	}
+
+	return ETXCMD_SUCCESS;
+}
+
+/** value of a readable attribute, NULL if it can't be read **/
+static const uint8_t *Host_value(EtxHost_t *pHost, uint16_t handle,
+		uint16_t *pLen) {
+	switch (handle) {
+		case ETX_HDL_CMD:
+			*pLen = pHost->cmdLen;
+			return pHost->cmd;
+
+		case ETX_HDL_DATA:
+			*pLen = 1;
+			return &pHost->data;
+
+		case ETX_HDL_STAMP:
+			*pLen = ETXPROFILE_STAMP_LEN;
+			return pHost->stamp;
+
+		case ETX_HDL_DIAG:
+			*pLen = pHost->diagLen;
+			return pHost->diag;
+
+		case ETX_HDL_SHEET:
+			*pLen = pHost->sheetLen;
+			return pHost->sheet;
+
+		default:
+			return NULL;
+	}
+}
+
+/** a read has been served, as ETX_EVT_charValueEnquire **/
+static void Host_enquired(EtxHost_t *pHost, uint16_t handle) {
+	if (handle == ETX_HDL_CMD) {
+		pHost->cmd[0] = 0;
+		pHost->cmdLen = 1;
+	} else if ((handle == ETX_HDL_DATA) && pHost->isVotePending) {
+		pHost->isVotePending = false;
+		pHost->collected++;
+	}
+}
+
+/** fill a diagnostics page with a recognisable pattern **/
+static void Host_diag(EtxHost_t *pHost, uint8_t page) {
+	uint8_t i;
+
+	pHost->diag[0] = page;
+	for (i = 1; i < ETXPROFILE_DIAG_LEN; i++)
+		pHost->diag[i] = page ^ i;
+	pHost->diagLen = ETXPROFILE_DIAG_LEN;
+}
+
+static bool Host_error(EtxHost_t *pHost, uint8_t req, uint16_t handle,
+		uint8_t error) {
+	uint8_t rsp[5] = { ATT_ERROR_RSP, req, (uint8_t) handle,
+			(uint8_t) (handle >> 8), error };
+
+	return Bs_send(&pHost->link, rsp, sizeof(rsp));
+}
+
+/** serve one ATT PDU **/
+static bool Host_att(EtxHost_t *pHost, const uint8_t *pPdu, int len) {
+	uint8_t rsp[BS_MAX_PDU];
+	uint16_t handle = (len >= 3) ? (pPdu[1] | (pPdu[2] << 8)) : 0;
+	const uint8_t *pVal;
+	uint16_t valLen;
+	uint16_t offset = 0;
+
+	switch (pPdu[0]) {
+		case ATT_MTU_REQ: {
+			uint16_t mtu = (len >= 3) ? handle : BS_DEFAULT_MTU;
+
+			pHost->mtu = (mtu < BS_DEFAULT_MTU) ? BS_DEFAULT_MTU :
+					(mtu > BS_MAX_PDU) ? BS_MAX_PDU : mtu;
+			rsp[0] = ATT_MTU_RSP;
+			rsp[1] = (uint8_t) BS_MAX_PDU;
+			rsp[2] = 0;
+			return Bs_send(&pHost->link, rsp, 3);
+		}
+
+		case ATT_READ_BLOB_REQ:
+			if (len != 5)
+				return Host_error(pHost, pPdu[0], handle, ATT_ERR_LEN);
+			offset = pPdu[3] | (pPdu[4] << 8);
+			// fall through
+		case ATT_READ_REQ:
+			if (len < 3)
+				return Host_error(pHost, pPdu[0], handle, ATT_ERR_LEN);
+			pVal = Host_value(pHost, handle, &valLen);
+			if (pVal == NULL)
+				return Host_error(pHost, pPdu[0], handle, (handle
+						== ETX_HDL_BATCH) ? ATT_ERR_READ : ATT_ERR_HANDLE);
+			if (offset > valLen)
+				return Host_error(pHost, pPdu[0], handle, ATT_ERR_OFFSET);
+			valLen -= offset;
+			if (valLen > pHost->mtu - 1)
+				valLen = pHost->mtu - 1;
+			rsp[0] = pPdu[0] + 1;
+			memcpy(&rsp[1], &pVal[offset], valLen);
+			if (offset == 0)
+				Host_enquired(pHost, handle);
+			return Bs_send(&pHost->link, rsp, 1 + valLen);
+
+		case ATT_WRITE_REQ:
+			if (len < 3)
+				return Host_error(pHost, pPdu[0], handle, ATT_ERR_LEN);
+			switch (handle) {
+				case ETX_HDL_CMD:
+					if (len - 3 > ETXPROFILE_CMD_LEN)
+						return Host_error(pHost, pPdu[0], handle, ATT_ERR_LEN);
+					pHost->cmdLen = ETX_Proto_cmdProcess(&pPdu[3], len - 3,
+							pHost->cmd, sizeof(pHost->cmd), Host_cmdExec, pHost);
+				break;
+
+				case ETX_HDL_DIAG:
+					if (len != 4)
+						return Host_error(pHost, pPdu[0], handle, ATT_ERR_LEN);
+					Host_diag(pHost, pPdu[3]);
+				break;
+
+				case ETX_HDL_CMD_CCC:
+					if (len != 5)
+						return Host_error(pHost, pPdu[0], handle, ATT_ERR_LEN);
+					pHost->isCmdNotifyOn = (pPdu[3] & 0x01) != 0;
+				break;
+
+				case ETX_HDL_BATCH_CCC:
+					if (len != 5)
+						return Host_error(pHost, pPdu[0], handle, ATT_ERR_LEN);
+					pHost->isNotifyOn = (pPdu[3] & 0x01) != 0;
+				break;
+
+				default:
+					return Host_error(pHost, pPdu[0], handle, ATT_ERR_WRITE);
+			}
+			rsp[0] = ATT_WRITE_RSP;
+			if (!Bs_send(&pHost->link, rsp, 1))
+				return false;
+			// the commands have run, their responses stand on CMD until read
+			if ((handle != ETX_HDL_CMD) || !pHost->isCmdNotifyOn)
+				return true;
+			valLen = (pHost->cmdLen > pHost->mtu - 3) ? pHost->mtu - 3 :
+					pHost->cmdLen;
+			rsp[0] = ATT_NOTIFY;
+			rsp[1] = (uint8_t) ETX_HDL_CMD;
+			rsp[2] = (uint8_t) (ETX_HDL_CMD >> 8);
+			memcpy(&rsp[3], pHost->cmd, valLen);
+			return Bs_send(&pHost->link, rsp, 3 + valLen);
+
+		case ATT_WRITE_CMD: {
+			uint8_t batch[ETXPROFILE_BATCH_LEN];
+			uint16_t batchConn;
+			uint8_t rspSize = ETXPROFILE_BATCH_LEN;
+
+			// no response of any kind, a batch the ring can't take is lost
+			if ((handle != ETX_HDL_BATCH) || (len < 5)
+					|| !ETX_Proto_batchPut(&pHost->batches,
+							pHost->link.connHandle, &pPdu[3], len - 3))
+				return true;
+			if (pHost->mtu - 3 < rspSize)
+				rspSize = pHost->mtu - 3;
+			// the app side, as in ETX_CMD_batch
+			while ((len = ETX_Proto_batchGet(&pHost->batches, &batchConn,
+					batch)) != 0) {
+				rsp[0] = ATT_NOTIFY;
+				rsp[1] = (uint8_t) ETX_HDL_BATCH;
+				rsp[2] = (uint8_t) (ETX_HDL_BATCH >> 8);
+				rsp[3] = batch[0];
+				valLen = 1 + ETX_Proto_cmdProcess(&batch[1], len - 1, &rsp[4],
+						rspSize - 1, Host_cmdExec, pHost);
+				if (pHost->isNotifyOn && !Bs_send(&pHost->link, rsp, 3 + valLen))
+					return false;
+			}
+			return true;
+		}
+
+		default:
+			// commands are never answered
+			if (pPdu[0] & 0x40)
+				return true;
+			return Host_error(pHost, pPdu[0], 0, ATT_ERR_REQ);
+	}
+}
+
+static void *Host_serve(void *arg) {
+	EtxHost_t *pHost = arg;
+	uint8_t pdu[BS_MAX_PDU];
+	int len;
+
+	pHost->mtu = BS_DEFAULT_MTU;
+	pHost->cmdLen = 1;
+	pHost->rng = pHost->link.connHandle;
+	pHost->sheetLen = ETX_Quiz_sheet(&pHost->quiz, pHost->sheet);
+	Host_diag(pHost, 0);
+	while ((len = Bs_recv(&pHost->link, pdu)) > 0) {
+		if (!Host_att(pHost, pdu, len))
+			break;
+	}
+
+	close(pHost->link.fd);
+	free(pHost);
+	return NULL;
+}
+
+/*****************************************************************************
+ * @TAG Base station
+ */
+/** one ATT request and its response, errors come back as -1 **/
+static int Bs_request(BsRun_t *pRun, const uint8_t *pReq, uint16_t reqLen,
+		uint8_t *pRsp) {
+	int len;
+
+	if (!Bs_send(&pRun->link, pReq, reqLen))
+		return -2;
+	do {
+		len = Bs_recv(&pRun->link, pRsp);
+		if (len < 0)
+			return -2;
+	} while (pRsp[0] == ATT_NOTIFY);
+	pRun->transactions++;
+
+	if ((pRsp[0] == ATT_ERROR_RSP) || (pRsp[0] != pReq[0] + 1))
+		return -1;
+	return len;
+}
+
+static int Bs_read(BsRun_t *pRun, uint16_t handle, uint8_t *pRsp) {
+	uint8_t req[3] = { ATT_READ_REQ, (uint8_t) handle, (uint8_t) (handle >> 8) };
+
+	return Bs_request(pRun, req, sizeof(req), pRsp);
+}
+
+static int Bs_write(BsRun_t *pRun, uint16_t handle, const uint8_t *pVal,
+		uint8_t len) {
+	uint8_t req[3 + BS_MAX_PDU];
+	uint8_t rsp[BS_MAX_PDU];
+
+	req[0] = ATT_WRITE_REQ;
+	req[1] = (uint8_t) handle;
+	req[2] = (uint8_t) (handle >> 8);
+	memcpy(&req[3], pVal, len);
+	return Bs_request(pRun, req, 3 + len, rsp);
+}
+
+/** read a long value, the BS doesn't know its length up front **/
+static int Bs_readLong(BsRun_t *pRun, uint16_t handle, uint8_t *pBuf,
+		uint16_t size) {
+	uint8_t req[5] = { ATT_READ_BLOB_REQ, (uint8_t) handle,
+			(uint8_t) (handle >> 8), 0, 0 };
+	uint8_t pdu[BS_MAX_PDU];
+	uint16_t offset;
+	int len, mtu;
+
+	len = Bs_read(pRun, handle, pdu);
+	if (len < 1)
+		return len;
+	// a full response means there is more
+	mtu = len;
+	offset = 0;
+	for (;;) {
+		if (offset + len - 1 > size)
+			return -1;
+		memcpy(&pBuf[offset], &pdu[1], len - 1);
+		offset += len - 1;
+		if (len != mtu)
+			return offset;
+		req[3] = (uint8_t) offset;
+		req[4] = (uint8_t) (offset >> 8);
+		len = Bs_request(pRun, req, sizeof(req), pdu);
+		if (len < 0)
+			return len;
+	}
+}
+
+/** write BS commands and check every status in the notified responses **/
+static int Bs_cmd(BsRun_t *pRun, const uint8_t *pCmd, uint8_t len) {
+	uint8_t rsp[BS_MAX_PDU];
+	int rspLen, i;
+
+	if (Bs_write(pRun, ETX_HDL_CMD, pCmd, len) < 0)
+		return -1;
+	// the write response comes before the commands ran, a read right away
+	// could still see them
+	do {
+		rspLen = Bs_recv(&pRun->link, rsp);
+		if (rspLen < 0)
+			return -2;
+	} while ((rsp[0] != ATT_NOTIFY) || (rspLen < 3)
+			|| ((rsp[1] | (rsp[2] << 8)) != ETX_HDL_CMD));
+	if (rspLen < 6)
+		return -1;
+	for (i = 3; i + 2 < rspLen; i += 2 + rsp[i + 1]) {
+		if (!(rsp[i] & ETXCMD_RSP) || (rsp[i + 2] != ETXCMD_SUCCESS))
+			return -1;
+	}
+	return 0;
+}
+
+/** run one operation of the script, 0 if it went well **/
+static int Bs_op(BsRun_t *pRun, const BsOp_t *pOp, uint8_t batchSeq) {
+	uint8_t pdu[BS_MAX_PDU];
+	uint8_t cmd[ETXPROFILE_CMD_LEN + 1];
+	int len;
+
+	switch (pOp->op) {
+		case OP_MTU:
+			cmd[0] = ATT_MTU_REQ;
+			cmd[1] = pOp->val[0];
+			cmd[2] = pOp->val[1];
+			return (Bs_request(pRun, cmd, 3, pdu) == 3) ? 0 : -1;
+
+		case OP_OPEN:
+			cmd[0] = ETXCMD_OPEN_QUESTION;
+			cmd[1] = 1;
+			cmd[2] = pOp->val[0];
+			return Bs_cmd(pRun, cmd, 3);
+
+		case OP_CLOSE:
+			cmd[0] = ETXCMD_CLOSE_QUESTION;
+			cmd[1] = 0;
+			return Bs_cmd(pRun, cmd, 2);
+
+		case OP_TIME: {
+			uint32_t now = (uint32_t) (Bs_nowUs() / 1000);
+
+			cmd[0] = ETXCMD_SET_TIME;
+			cmd[1] = 4;
+			cmd[2] = (uint8_t) now;
+			cmd[3] = (uint8_t) (now >> 8);
+			cmd[4] = (uint8_t) (now >> 16);
+			cmd[5] = (uint8_t) (now >> 24);
+			return Bs_cmd(pRun, cmd, 6);
+		}
+
+		case OP_VOTE:
+			// the stamp goes first, reading the User Data collects the vote
+			if (Bs_read(pRun, ETX_HDL_STAMP, pdu) != 1 + ETXPROFILE_STAMP_LEN)
+				return -1;
+			len = Bs_read(pRun, ETX_HDL_DATA, pdu);
+			return ((len == 2) && (pdu[1] != 0)) ? 0 : -1;
+
+		case OP_STATS:
+			cmd[0] = ETXCMD_GET_STATS;
+			cmd[1] = 0;
+			return Bs_cmd(pRun, cmd, 2);
+
+		case OP_CMD:
+			return Bs_cmd(pRun, pOp->val, pOp->len);
+
+		case OP_BATCH:
+			pdu[0] = ATT_WRITE_CMD;
+			pdu[1] = (uint8_t) ETX_HDL_BATCH;
+			pdu[2] = (uint8_t) (ETX_HDL_BATCH >> 8);
+			pdu[3] = batchSeq;
+			memcpy(&pdu[4], pOp->val, pOp->len);
+			if (!Bs_send(&pRun->link, pdu, 4 + pOp->len))
+				return -2;
+			len = Bs_recv(&pRun->link, pdu);
+			if (len < 0)
+				return -2;
+			pRun->transactions++;
+			return ((pdu[0] == ATT_NOTIFY) && (len >= 4) && (pdu[3] == batchSeq)) ?
+					0 : -1;
+
+		case OP_LOG:
+			if (Bs_write(pRun, ETX_HDL_DIAG, pOp->val, 1) < 0)
+				return -1;
+			len = Bs_readLong(pRun, ETX_HDL_DIAG, pdu, sizeof(pdu));
+			if (len < 0)
+				return len;
+			return ((len == ETXPROFILE_DIAG_LEN) && (pdu[0] == pOp->val[0])) ?
+					0 : -1;
+
+		case OP_QUIZ:
+			cmd[0] = ETXCMD_START_QUIZ;
+			cmd[1] = 3;
+			cmd[2] = pOp->val[0];
+			cmd[3] = 1;
+			cmd[4] = 5;
+			return Bs_cmd(pRun, cmd, 5);
+
+		case OP_SHEET:
+			// the whole sheet in one go, then the quiz is done with
+			len = Bs_readLong(pRun, ETX_HDL_SHEET, pdu, sizeof(pdu));
+			if (len < 0)
+				return len;
+			if ((len < ETX_QUIZ_SHEET_HDR_LEN) || (pdu[2] == 0)
+					|| (len != ETX_QUIZ_SHEET_HDR_LEN + pdu[2])
+					|| (pdu[3] != pdu[2])
+					|| !(pdu[4] & ETX_QUIZ_FLAG_SUBMITTED))
+				return -1;
+			cmd[0] = ETXCMD_END_QUIZ;
+			cmd[1] = 0;
+			return Bs_cmd(pRun, cmd, 2);
+	}
+
+	return -1;
+}
+
+static void Bs_stat(BsStat_t *pStat, double lat) {
+	if (pStat->len == pStat->size) {
+		pStat->size = pStat->size ? pStat->size * 2 : 256;
+		pStat->pLat = realloc(pStat->pLat, pStat->size * sizeof(double));
+	}
+	pStat->pLat[pStat->len++] = lat;
+}
+
+static void *Bs_session(void *arg) {
+	BsRun_t *pRun = arg;
+	const BsCfg_t *pCfg = pRun->link.pCfg;
+	uint8_t ccc[2] = { 0x01, 0x00 };
+	uint8_t batchSeq = 0;
+	int r, i;
+
+	// commands and batches are answered by notification
+	if ((Bs_write(pRun, ETX_HDL_CMD_CCC, ccc, sizeof(ccc)) < 0)
+			|| (Bs_write(pRun, ETX_HDL_BATCH_CCC, ccc, sizeof(ccc)) < 0)) {
+		pRun->isFailed = true;
+		return NULL;
+	}
+
+	for (r = 0; r < pCfg->runs; r++) {
+		for (i = 0; i < pCfg->numOps; i++) {
+			const BsOp_t *pOp = &pCfg->ops[i];
+			uint64_t start = Bs_nowUs();
+			int status = Bs_op(pRun, pOp, batchSeq);
+
+			if (pOp->op == OP_BATCH)
+				batchSeq++;
+			if (status == -2) {
+				fprintf(stderr, "link 0x%04x lost\n", pRun->link.connHandle);
+				pRun->isFailed = true;
+				return NULL;
+			}
+			Bs_stat(&pRun->stats[pOp->op], (double) (Bs_nowUs() - start));
+			if (status != 0)
+				pRun->stats[pOp->op].errors++;
+		}
+	}
+	return NULL;
+}
+
+/*****************************************************************************
+ * @TAG Main
+ */
+static int Bs_hex(const char *pStr, uint8_t *pBuf, int size) {
+	int len = 0;
+	unsigned int byte;
+
+	while (*pStr) {
+		if ((*pStr == ' ') || (*pStr == '\t')) {
+			pStr++;
+			continue;
+		}
+		if ((len >= size) || (sscanf(pStr, "%2x", &byte) != 1))
+			return -1;
+		pBuf[len++] = (uint8_t) byte;
+		pStr += ((pStr[1] != '\0') && (pStr[1] != ' ')) ? 2 : 1;
+	}
+	return len;
+}
+
+/** parse a script, one operation per line **/
+static bool Bs_script(BsCfg_t *pCfg, const char *pText) {
+	char line[BS_MAX_LINE];
+	int lineNum = 0;
+
+	while (*pText) {
+		const char *pEnd = strchr(pText, '\n');
+		size_t len = pEnd ? (size_t) (pEnd - pText) : strlen(pText);
+		char *pArg;
+		BsOp_t *pOp;
+		int op, val;
+
+		lineNum++;
+		if (len >= sizeof(line))
+			len = sizeof(line) - 1;
+		memcpy(line, pText, len);
+		line[len] = '\0';
+		pText += pEnd ? (size_t) (pEnd - pText) + 1 : strlen(pText);
+
+		if ((pArg = strchr(line, '#')) != NULL)
+			*pArg = '\0';
+		pArg = strtok(line, " \t\r");
+		if (pArg == NULL)
+			continue;
+		for (op = 0; op < OP_NUM; op++) {
+			if (strcmp(pArg, opNames[op]) == 0)
+				break;
+		}
+		if ((op == OP_NUM) || (pCfg->numOps >= BS_MAX_OPS)) {
+			fprintf(stderr, "line %d: unknown operation %s\n", lineNum, pArg);
+			return false;
+		}
+
+		pOp = &pCfg->ops[pCfg->numOps++];
+		memset(pOp, 0, sizeof(BsOp_t));
+		pOp->op = op;
+		pArg = strtok(NULL, "\r");
+		switch (op) {
+			case OP_MTU:
+			case OP_OPEN:
+			case OP_QUIZ:
+				if ((pArg == NULL) || ((val = atoi(pArg)) <= 0)
+						|| ((op == OP_MTU) && (val > BS_MAX_PDU))
+						|| ((op == OP_OPEN) && (val > 0xFF))
+						|| ((op == OP_QUIZ) && (val > ETX_QUIZ_MAX_QUESTIONS))) {
+					fprintf(stderr, "line %d: bad value\n", lineNum);
+					return false;
+				}
+				pOp->val[0] = (uint8_t) val;
+				pOp->val[1] = (uint8_t) (val >> 8);
+			break;
+
+			case OP_CMD:
+			case OP_BATCH:
+			case OP_LOG:
+				val = pArg ? Bs_hex(pArg, pOp->val, (op == OP_BATCH) ?
+						ETXPROFILE_BATCH_LEN - 1 : (op == OP_LOG) ?
+						1 : ETXPROFILE_CMD_LEN) : -1;
+				if (val <= 0) {
+					fprintf(stderr, "line %d: bad hex value\n", lineNum);
+					return false;
+				}
+				pOp->len = (uint8_t) val;
+			break;
+
+			default:
+			break;
+		}
+	}
+	return pCfg->numOps > 0;
+}
+
+static int Bs_connect(const char *pAddr) {
+	char host[BS_MAX_LINE];
+	char *pPort;
+	struct addrinfo hints = { 0 }, *pInfo;
+	int fd, one = 1;
+
+	strncpy(host, pAddr, sizeof(host) - 1);
+	host[sizeof(host) - 1] = '\0';
+	pPort = strrchr(host, ':');
+	if (pPort == NULL)
+		return -1;
+	*pPort++ = '\0';
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(host, pPort, &hints, &pInfo) != 0)
+		return -1;
+	fd = socket(pInfo->ai_family, SOCK_STREAM, 0);
+	if ((fd >= 0) && (connect(fd, pInfo->ai_addr, pInfo->ai_addrlen) != 0)) {
+		close(fd);
+		fd = -1;
+	}
+	freeaddrinfo(pInfo);
+	if (fd >= 0)
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	return fd;
+}
+
+/** serve ETX instances on a TCP port, one per connection **/
+static int Bs_listen(const BsCfg_t *pCfg) {
+	struct sockaddr_in addr = { 0 };
+	uint16_t connHandle = 0;
+	int fd, one = 1;
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(pCfg->listenPort);
+	if ((bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0)
+			|| (listen(fd, 64) != 0)) {
+		perror("listen");
+		return 1;
+	}
+	printf("ETX instances on port %d\n", pCfg->listenPort);
+
+	for (;;) {
+		EtxHost_t *pHost;
+		pthread_t thread;
+		int link = accept(fd, NULL, NULL);
+
+		if (link < 0)
+			continue;
+		setsockopt(link, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		pHost = calloc(1, sizeof(EtxHost_t));
+		pHost->link.fd = link;
+		pHost->link.connHandle = connHandle++ & 0x0FFF;
+		pHost->link.pCfg = pCfg;
+		pthread_create(&thread, NULL, Host_serve, pHost);
+		pthread_detach(thread);
+	}
+}
+
+static int Bs_cmpDouble(const void *a, const void *b) {
+	double x = *(const double *) a, y = *(const double *) b;
+	return (x > y) - (x < y);
+}
+
+/** run the sessions of every link, returns the time it took, 0 on failure **/
+static uint64_t Bs_run(const BsCfg_t *pCfg, BsStat_t *pTotal,
+		uint64_t *pTransactions) {
+	BsRun_t *pRuns;
+	pthread_t *pThreads;
+	uint64_t start, elapsed;
+	int i, op;
+
+	// one link per BS session, each to its own ETX instance
+	pRuns = calloc(pCfg->links, sizeof(BsRun_t));
+	pThreads = calloc(pCfg->links, sizeof(pthread_t));
+	for (i = 0; i < pCfg->links; i++) {
+		BsRun_t *pRun = &pRuns[i];
+
+		pRun->link.connHandle = (uint16_t) i;
+		pRun->link.pCfg = pCfg;
+		if (pCfg->pConnect != NULL) {
+			pRun->link.fd = Bs_connect(pCfg->pConnect);
+			if (pRun->link.fd < 0) {
+				fprintf(stderr, "can't connect to %s\n", pCfg->pConnect);
+				return 0;
+			}
+		} else {
+			EtxHost_t *pHost = calloc(1, sizeof(EtxHost_t));
+			pthread_t thread;
+			int fds[2];
+
+			if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+				perror("socketpair");
+				return 0;
+			}
+			pRun->link.fd = fds[0];
+			pHost->link = pRun->link;
+			pHost->link.fd = fds[1];
+			pthread_create(&thread, NULL, Host_serve, pHost);
+			pthread_detach(thread);
+		}
+	}
+
+	start = Bs_nowUs();
+	for (i = 0; i < pCfg->links; i++)
+		pthread_create(&pThreads[i], NULL, Bs_session, &pRuns[i]);
+	for (i = 0; i < pCfg->links; i++)
+		pthread_join(pThreads[i], NULL);
+	elapsed = Bs_nowUs() - start;
+
+	// merge the links
+	*pTransactions = 0;
+	for (i = 0; i < pCfg->links; i++) {
+		*pTransactions += pRuns[i].transactions;
+		if (pRuns[i].isFailed)
+			fprintf(stderr, "link %d failed\n", i);
+		for (op = 0; op < OP_NUM; op++) {
+			BsStat_t *pStat = &pRuns[i].stats[op];
+			size_t j;
+
+			for (j = 0; j < pStat->len; j++)
+				Bs_stat(&pTotal[op], pStat->pLat[j]);
+			pTotal[op].errors += pStat->errors;
+			free(pStat->pLat);
+		}
+		close(pRuns[i].link.fd);
+	}
+
+	free(pThreads);
+	free(pRuns);
+	return elapsed ? elapsed : 1;
+}
+
+/*****************************************************************************
+ * @TAG Checks
+ */
+/** fill a batch with a pattern of its number **/
+static uint8_t Bs_batchFill(uint8_t *pBatch, uint32_t num) {
+	uint8_t len = 2 + num % (ETXPROFILE_BATCH_LEN - 1);
+	uint8_t i;
+
+	for (i = 0; i < len; i++)
+		pBatch[i] = (uint8_t) (num + i);
+	return len;
+}
+
+/** the ring between the stack and the app, as etx_gatt_prof.c holds it **/
+static int Bs_checkRing(void) {
+	static EtxProtoBatches_t ring;
+	uint8_t batch[ETXPROFILE_BATCH_LEN], out[ETXPROFILE_BATCH_LEN];
+	uint32_t putNum = 0, getNum = 0, rng = 1;
+	uint16_t connHandle;
+	int errors = 0;
+	int i;
+	uint8_t len;
+
+	if (ETX_Proto_batchGet(&ring, &connHandle, out) != 0) {
+		printf("ring: empty ring gave a batch\n");
+		errors++;
+	}
+	if (ETX_Proto_batchPut(&ring, 0, batch, ETXPROFILE_BATCH_LEN + 1)) {
+		printf("ring: took a batch too long\n");
+		errors++;
+	}
+
+	// overflow, the batch after the depth is refused and never shows up
+	for (i = 0; i <= ETXPROFILE_BATCH_DEPTH; i++) {
+		len = Bs_batchFill(batch, putNum);
+		if (ETX_Proto_batchPut(&ring, (uint16_t) putNum, batch, len))
+			putNum++;
+		else if (i != ETXPROFILE_BATCH_DEPTH) {
+			printf("ring: batch %d of %d refused\n", i + 1,
+					ETXPROFILE_BATCH_DEPTH);
+			errors++;
+		}
+	}
+	if (putNum != ETXPROFILE_BATCH_DEPTH) {
+		printf("ring: %u batches taken, depth %d\n", putNum,
+				ETXPROFILE_BATCH_DEPTH);
+		errors++;
+	}
+
+	// a batch arriving while the ring is full, then once the app took one
+	len = Bs_batchFill(batch, putNum);
+	if (ETX_Proto_batchPut(&ring, (uint16_t) putNum, batch, len)) {
+		printf("ring: full ring took a batch\n");
+		errors++;
+	}
+
+	// wrap, the indexes go round 256 many times at every fill level
+	for (i = 0; i < 100000; i++) {
+		rng = rng * 1103515245 + 12345;
+		if ((rng >> 16) & 1) {
+			len = Bs_batchFill(batch, putNum);
+			if (ETX_Proto_batchPut(&ring, (uint16_t) putNum, batch, len)) {
+				if (putNum - getNum >= ETXPROFILE_BATCH_DEPTH) {
+					printf("ring: batch %u taken with %u waiting\n", putNum,
+							putNum - getNum);
+					errors++;
+				}
+				putNum++;
+			} else if (putNum - getNum < ETXPROFILE_BATCH_DEPTH) {
+				printf("ring: batch %u refused with %u waiting\n", putNum,
+						putNum - getNum);
+				errors++;
+			}
+		} else {
+			uint8_t want = Bs_batchFill(batch, getNum);
+
+			len = ETX_Proto_batchGet(&ring, &connHandle, out);
+			if (len == 0) {
+				if (getNum != putNum) {
+					printf("ring: empty with %u waiting\n", putNum - getNum);
+					errors++;
+				}
+				continue;
+			}
+			if ((getNum == putNum) || (len != want)
+					|| (connHandle != (uint16_t) getNum)
+					|| (memcmp(out, batch, len) != 0)) {
+				printf("ring: batch %u out of order or corrupted\n", getNum);
+				errors++;
+			}
+			getNum++;
+		}
+		if (errors > 10)
+			break;
+	}
+	printf("ring: depth %d, %u batches through, %d errors\n",
+			ETXPROFILE_BATCH_DEPTH, getNum, errors);
+	return errors;
+}
+
+/** the batch interpreter, as ETX_CMD_batch runs it **/
+static int Bs_checkBatch(void) {
+	static const struct {
+		const char *pName;
+		const char *pCmd;
+		uint8_t rspSize;
+		const char *pRsp;
+		bool isQuestionOpen;	// after the commands
+	} cases[] = {
+		{ "two commands", "0600 0500", 19,
+				"860c000000000000000000000000 8503 00b80b", false },
+		{ "response full", "0600 0600", 19, "860c000000000000000000000000",
+				false },
+		{ "lone opcode", "02", 19, "820100", false },
+		{ "truncated", "0105 03 0500", 19, "810102", false },
+		{ "unknown opcode", "7f00 0301 01", 19, "ff0101 830100", false },
+		{ "bad value", "0a04 0a00 0a00", 19, "8a0103", false },
+		{ "mtu 65", "0600 0600 0500", 61,
+				"860c000000000000000000000000 860c000000000000000000000000 8503 00b80b",
+				false },
+		// a command whose response doesn't fit is not run
+		{ "overflow, not run", "0600 0101 01", 16,
+				"860c000000000000000000000000", false },
+		{ "overflow, run", "0600 0101 01", 17,
+				"860c000000000000000000000000 810100", true },
+		{ "overflow, data", "0500 0600", 18, "8503 00b80b", false },
+	};
+	int errors = 0;
+	size_t i;
+
+	for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		EtxHost_t host = { 0 };
+		uint8_t cmd[BS_MAX_PDU], rsp[BS_MAX_PDU], want[BS_MAX_PDU];
+		int cmdLen = Bs_hex(cases[i].pCmd, cmd, sizeof(cmd));
+		int wantLen = Bs_hex(cases[i].pRsp, want, sizeof(want));
+		uint8_t rspLen;
+
+		rspLen = ETX_Proto_cmdProcess(cmd, (uint8_t) cmdLen, rsp,
+				cases[i].rspSize, Host_cmdExec, &host);
+		if ((rspLen != wantLen) || (memcmp(rsp, want, rspLen) != 0)
+				|| (host.isQuestionOpen != cases[i].isQuestionOpen)) {
+			int j;
+
+			printf("batch: %s: question %s,", cases[i].pName,
+					host.isQuestionOpen ? "open" : "closed");
+			for (j = 0; j < rspLen; j++)
+				printf(" %02x", rsp[j]);
+			printf("\n");
+			errors++;
+		}
+	}
+	printf("batch: %zu cases, %d errors\n", sizeof(cases) / sizeof(cases[0]),
+			errors);
+	return errors;
+}
+
+/** the same commands written to CMD and as a batch, commands per second **/
+static int Bs_checkThroughput(const BsCfg_t *pCfg) {
+	static const char *const scripts[] = {
+		"mtu 65\ncmd 0500 0200 030100\n",
+		"mtu 65\nbatch 0500 0200 030100\n",
+	};
+	int errors = 0;
+	int i;
+
+	printf("# %d links x %d runs, conn interval %d us, 3 commands per op\n",
+			pCfg->links, pCfg->runs, pCfg->connInterval);
+	printf("# %-6s %12s %10s %10s\n", "op", "commands/s", "mean us", "p99 us");
+	for (i = 0; i < 2; i++) {
+		static BsCfg_t cfg;
+		BsStat_t total[OP_NUM] = { { 0 } };
+		BsStat_t *pStat;
+		uint64_t transactions, elapsed;
+		double sum = 0;
+		size_t j;
+
+		cfg = *pCfg;
+		cfg.numOps = 0;
+		if (!Bs_script(&cfg, scripts[i]))
+			return 1;
+		elapsed = Bs_run(&cfg, total, &transactions);
+		pStat = &total[cfg.ops[1].op];
+		if ((elapsed == 0) || (pStat->len == 0) || (pStat->errors != 0)
+				|| (total[OP_MTU].errors != 0)) {
+			printf("%s: failed\n", opNames[cfg.ops[1].op]);
+			errors++;
+		} else {
+			qsort(pStat->pLat, pStat->len, sizeof(double), Bs_cmpDouble);
+			for (j = 0; j < pStat->len; j++)
+				sum += pStat->pLat[j];
+			// the MTU exchange is not part of the throughput
+			printf("  %-6s %12.0f %10.1f %10.1f\n", opNames[cfg.ops[1].op],
+					3 * pStat->len * 1e6 / sum * pCfg->links,
+					sum / pStat->len,
+					pStat->pLat[(size_t) (0.99 * (pStat->len - 1))]);
+		}
+		free(total[OP_MTU].pLat);
+		free(pStat->pLat);
+	}
+	return errors;
+}
+
+static void Bs_usage(void) {
+	printf("usage: etx_bs [options]\n"
+			"  -n links  links run at the same time (1)\n"
+			"  -r runs   times each link runs the script (100)\n"
+			"  -f file   script, the built-in one otherwise\n"
+			"  -i us     connection interval to emulate, 0 for none (0)\n"
+			"  -c h:p    run against ETX instances on TCP, in-process otherwise\n"
+			"  -L port   serve ETX instances on TCP instead\n"
+			"  -t        check the batch ring and interpreter, then compare\n"
+			"            the throughput of CMD and batches\n"
+			"\nbuilt-in script:\n%s", defaultScript);
+}
+
+int main(int argc, char **argv) {
+	static BsCfg_t cfg = { .links = 1, .runs = 100 };
+	const char *pScript = defaultScript;
+	char *pFile = NULL;
+	BsStat_t total[OP_NUM] = { { 0 } };
+	uint64_t transactions;
+	uint64_t elapsed;
+	bool isCheck = false;
+	int opt, op;
+
+	clock_gettime(CLOCK_MONOTONIC, &epoch);
+	while ((opt = getopt(argc, argv, "n:r:f:i:c:L:th")) != -1) {
+		switch (opt) {
+			case 'n': cfg.links = atoi(optarg); break;
+			case 'r': cfg.runs = atoi(optarg); break;
+			case 'f': pFile = optarg; break;
+			case 'i': cfg.connInterval = atoi(optarg); break;
+			case 'c': cfg.pConnect = optarg; break;
+			case 'L': cfg.listenPort = atoi(optarg); break;
+			case 't': isCheck = true; break;
+			default:
+				Bs_usage();
+				return (opt == 'h') ? 0 : 1;
+		}
+	}
+	if ((cfg.links < 1) || (cfg.runs < 1) || (cfg.connInterval < 0)) {
+		Bs_usage();
+		return 1;
+	}
+	if (cfg.listenPort > 0)
+		return Bs_listen(&cfg);
+	if (isCheck) {
+		int errors = Bs_checkRing() + Bs_checkBatch()
+				+ Bs_checkThroughput(&cfg);
+
+		printf("%d errors\n", errors);
+		return errors ? 1 : 0;
+	}
+
+	if (pFile != NULL) {
+		FILE *pIn = fopen(pFile, "r");
+		long size;
+
+		if (pIn == NULL) {
+			perror(pFile);
+			return 1;
+		}
+		fseek(pIn, 0, SEEK_END);
+		size = ftell(pIn);
+		rewind(pIn);
+		pScript = pFile = calloc(1, size + 1);
+		if (fread(pFile, 1, size, pIn) != (size_t) size) {
+			perror(pFile);
+			return 1;
+		}
+		fclose(pIn);
+	}
+	if (!Bs_script(&cfg, pScript))
+		return 1;
+
+	elapsed = Bs_run(&cfg, total, &transactions);
+	if (elapsed == 0)
+		return 1;
+
+	printf("# %d links x %d runs, conn interval %d us, %.3f s\n", cfg.links,
+			cfg.runs, cfg.connInterval, elapsed / 1e6);
+	printf("# %llu ATT transactions, %.0f per s\n",
+			(unsigned long long) transactions, transactions * 1e6 / elapsed);
+	printf("# %-6s %9s %7s %10s %10s %10s %10s\n", "op", "count", "errors",
+			"mean us", "p50 us", "p99 us", "max us");
+	for (op = 0; op < OP_NUM; op++) {
+		BsStat_t *pStat = &total[op];
+		double sum = 0;
+		size_t j;
+
+		if (pStat->len == 0)
+			continue;
+		qsort(pStat->pLat, pStat->len, sizeof(double), Bs_cmpDouble);
+		for (j = 0; j < pStat->len; j++)
+			sum += pStat->pLat[j];
+		printf("  %-6s %9zu %7u %10.1f %10.1f %10.1f %10.1f\n", opNames[op],
+				pStat->len, pStat->errors, sum / pStat->len,
+				pStat->pLat[pStat->len / 2],
+				pStat->pLat[(size_t) (0.99 * (pStat->len - 1))],
+				pStat->pLat[pStat->len - 1]);
+		free(pStat->pLat);
+	}
+	return 0;
+}
@@ -0,0 +1,982 @@
+/*****************************************************************************
+ *
+ * @filepath    /tools/etx_diag/etx_diag.c
+ *
+ * @project     evrs tools
+ *
+ * @brief       decodes the diagnostics of the ETX, see etx_diag.h, renders
+ *              the vote latency histograms as percentiles per stage and
+ *              the crash record as a post-mortem.
+ *
+ *              Input, one per line, # for comments:
+ *                a page as long read from the diagnostics characteristic,
+ *                in hex, bytes may be split by spaces, - or :
+ *                  00 00 0a 00 00 00 03 00 ...
+ *                the UART dump taken after writing the dump page (0xFF)
+ *                  Latency histograms, tick 10us
+ *                  lat 5, 2^14 ticks: 12
+ *                the crash record as kept in NV, ETX_DIAG_CRASH_NV_ID, or
+ *                in the no-init RAM of crashRec, read with a debugger
+ *                  58 52 43 45 03 03 00 01 ...
+ *
+ *              Pages of the same stage are added up, so the pages of many
+ *              devices give the latency of the class. A percentile falls in
+ *              a bucket of [2^n, 2^(n+1)) ticks, it is put in the bucket
+ *              linearly, the last bucket has no top and only shows its
+ *              floor as > n ms.
+ *
+ *              A crash record is checked against its FNV-1a check, the crash
+ *              page carries it since the record is dropped from NV without
+ *              the magic. Its source, cause, fault status, states and the
+ *              latest app events are printed, pc and lr are symbolized with
+ *              addr2line against the ELF of the firmware given with -e, and
+ *              so is the file of a TI-RTOS error read from the ELF.
+ *
+ *              Errors, exit with 1:
+ *              - a line which is no page and no dump line
+ *              - a latency page of the wrong length or stage
+ *              - pages of a stage with different tick periods
+ *              - a crash record of the wrong length or magic, or whose check
+ *                doesn't match, it is printed all the same
+ *              - with -t, the self checks of the percentiles failed
+ *
+ * build        cc -O2 -std=gnu99 -o etx_diag etx_diag.c
+ *
+ * usage        ./etx_diag pages.txt
+ *              ./etx_diag -e evrs_tx_cc2650etx_app.out crash.txt
+ *              ./etx_diag -t               self checks
+ *
+ * @date        18 Oct. 2026
+ *
+ * @author      Ziyi@outlook.com.au
+ *
+ ****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define DIAG_MAX_LINE			512
+#define DIAG_MAX_PAGE			128
+
+// keep in step with etx_diag.h
+#define DIAG_LAT_STAGES			6
+#define DIAG_LAT_BUCKETS		20
+#define DIAG_PAGE_LAT			0x00
+#define DIAG_LAT_LEN			(4 + 2 * DIAG_LAT_BUCKETS)
+
+// keep in step with etx_diag.h and etx_diag.c
+#define DIAG_PAGE_CRASH			0x20
+#define DIAG_CRASH_MAGIC		0x45435258
+#define DIAG_CRASH_EVENTS		5
+#define DIAG_CRASH_LEN			52	// after the page id
+#define DIAG_CRASH_REC_LEN		56	// in NV, the magic to the check
+#define DIAG_CRASH_ASSERT		0x01
+#define DIAG_CRASH_ERROR		0x02
+#define DIAG_CRASH_FAULT		0x03
+#define DIAG_CRASH_WATCHDOG		0x04
+
+// keep in step with evrs_tx_main.c
+#define DIAG_GAP_STATE_CHG_EVT	0x01
+#define DIAG_APP_STATE_CHG_EVT	0x20
+
+// Bits of CFSR and HFSR, fault addresses are valid with MMARVALID and
+// BFARVALID
+#define DIAG_MMARVALID			(1u << 7)
+#define DIAG_BFARVALID			(1u << 15)
+
+#define DIAG_ADDR2LINE			"arm-none-eabi-addr2line"
+
+// Percentiles rendered
+#define DIAG_PERCENTILES		4
+
+static const char *stageNames[DIAG_LAT_STAGES] = {
+	"debounce", "dispatch", "advertise", "connect", "collect", "total"
+};
+
+static const double percentiles[DIAG_PERCENTILES] = { 0.5, 0.9, 0.95, 0.99 };
+
+static const char *sourceNames[] = {
+	"none", "BLE stack assert", "TI-RTOS error", "CPU fault", "watchdog"
+};
+
+static const char *excNames[16] = {
+	NULL, "reset", "NMI", "HardFault", "MemManage", "BusFault", "UsageFault",
+	NULL, NULL, NULL, NULL, "SVCall", "DebugMon", NULL, "PendSV", "SysTick"
+};
+
+// AppState_t of etx_fsm.h, gaprole_States_t of peripheral.h of the SDK
+static const char *appStateNames[] = {
+	"init", "idle", "active", "sleep", "quiz", "submit"
+};
+
+static const char *gapStateNames[] = {
+	"init", "started", "advertising", "advertising nonconn", "waiting",
+	"waiting after timeout", "connected", "connected advertising", "error"
+};
+
+// ETX_DIAG_MSG_* of etx_diag.h
+static const char *classNames[] = {
+	"none", "stack event", "stack message", "app message"
+};
+
+static const struct {
+	uint8_t event;
+	const char *pName;
+} appNames[] = {
+	{ 0x01, "gap state" }, { 0x02, "char change" }, { 0x04, "char enquire" },
+	{ 0x08, "conn event end" }, { 0x10, "key press" }, { 0x20, "app state" },
+	{ 0x40, "inactivity" }, { 0x80, "adv fallback" }, { 0x09, "scan" },
+	{ 0x0A, "vote retry" }, { 0x0B, "slot" }, { 0x0C, "monitor" },
+	{ 0x0D, "watchdog" }
+};
+
+// Status bits of a fault
+typedef struct DiagBit_t {
+	uint32_t bit;
+	const char *pName;
+} DiagBit_t;
+
+static const DiagBit_t cfsrBits[] = {
+	{ 1u << 0, "IACCVIOL" }, { 1u << 1, "DACCVIOL" }, { 1u << 3, "MUNSTKERR" },
+	{ 1u << 4, "MSTKERR" }, { 1u << 7, "MMARVALID" }, { 1u << 8, "IBUSERR" },
+	{ 1u << 9, "PRECISERR" }, { 1u << 10, "IMPRECISERR" },
+	{ 1u << 11, "UNSTKERR" }, { 1u << 12, "STKERR" }, { 1u << 15, "BFARVALID" },
+	{ 1u << 16, "UNDEFINSTR" }, { 1u << 17, "INVSTATE" }, { 1u << 18, "INVPC" },
+	{ 1u << 19, "NOCP" }, { 1u << 24, "UNALIGNED" }, { 1u << 25, "DIVBYZERO" }
+}, hfsrBits[] = {
+	{ 1u << 1, "VECTTBL" }, { 1u << 30, "FORCED" }, { 1u << 31, "DEBUGEVT" }
+};
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct DiagLat_t {
+	uint64_t buckets[DIAG_LAT_BUCKETS];
+	uint32_t tickPeriod;	// us, 0 until a page is read
+	uint32_t pages;
+	bool isSaturated;		// a bucket of a page was at 0xFFFF
+} DiagLat_t;
+
+// Crash record, EtxDiagCrash_t of etx_diag.c
+typedef struct DiagCrash_t {
+	uint32_t magic;
+	uint8_t source;
+	uint8_t cause;
+	uint8_t subcause;
+	uint8_t count;
+	uint8_t appState;
+	uint8_t gapState;
+	uint8_t events[2 * DIAG_CRASH_EVENTS];	// event, state, oldest first
+	uint32_t pc;
+	uint32_t lr;
+	uint32_t cfsr;
+	uint32_t hfsr;
+	uint32_t mmfar;
+	uint32_t bfar;
+	uint32_t ticks;
+	uint32_t task;
+	uint32_t check;
+} DiagCrash_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static DiagLat_t lat[DIAG_LAT_STAGES];
+
+static const char *pElf = NULL;
+static const char *pAddr2line = DIAG_ADDR2LINE;
+static uint32_t crashTick = 10;		// Clock_tickPeriod, us
+
+static uint32_t rng = 1;
+static int errors = 0;
+
+/*****************************************************************************
+ * @TAG Latency
+ */
+/** bucket of a latency, keep in step with ETX_Diag_latency **/
+static uint8_t Diag_bucket(uint32_t ticks) {
+	uint8_t bucket = 0;
+
+	while ((ticks >>= 1) && (bucket < DIAG_LAT_BUCKETS - 1))
+		bucket++;
+	return bucket;
+}
+
+/** lowest latency of a bucket, ticks **/
+static double Diag_floor(uint8_t bucket) {
+	return bucket ? (double) (1UL << bucket) : 0.0;
+}
+
+/*********************************************************************
+ * @fn      Diag_percentile
+ *
+ * @brief   Latency below which a share of the votes is, in ticks. It is
+ *          put in its bucket linearly with the rank of the vote in the
+ *          bucket.
+ *
+ * @param   pLat - histogram
+ * @param   p - share, 0 to 1
+ * @param   pBucket - bucket of the percentile
+ *
+ * @return  ticks, -1 if the histogram is empty
+ */
+static double Diag_percentile(const DiagLat_t *pLat, double p,
+		uint8_t *pBucket) {
+	uint64_t total = 0, below = 0;
+	double rank;
+	uint8_t i;
+
+	for (i = 0; i < DIAG_LAT_BUCKETS; i++)
+		total += pLat->buckets[i];
+	if (total == 0)
+		return -1.0;
+
+	rank = p * total;
+	for (i = 0; i < DIAG_LAT_BUCKETS - 1; i++) {
+		if (below + pLat->buckets[i] >= rank)
+			break;
+		below += pLat->buckets[i];
+	}
+	*pBucket = i;
+	if (i == DIAG_LAT_BUCKETS - 1)
+		return Diag_floor(i);
+	return Diag_floor(i) + (Diag_floor(i + 1) - Diag_floor(i))
+			* (rank - below) / pLat->buckets[i];
+}
+
+/** add a latency page to its stage, return what is wrong with it **/
+static const char *Diag_latPage(const uint8_t *pPage, int len) {
+	DiagLat_t *pLat;
+	uint32_t tickPeriod;
+	uint8_t i;
+
+	if (len != DIAG_LAT_LEN)
+		return "wrong length";
+	if (pPage[1] != pPage[0] - DIAG_PAGE_LAT)
+		return "wrong stage";
+	pLat = &lat[pPage[1]];
+	tickPeriod = pPage[2] | (pPage[3] << 8);
+	if (tickPeriod == 0)
+		return "no tick period";
+	if (pLat->tickPeriod && (pLat->tickPeriod != tickPeriod))
+		return "another tick period";
+	pLat->tickPeriod = tickPeriod;
+	pLat->pages++;
+	for (i = 0; i < DIAG_LAT_BUCKETS; i++) {
+		uint16_t count = pPage[4 + 2 * i] | (pPage[5 + 2 * i] << 8);
+
+		pLat->buckets[i] += count;
+		if (count == 0xFFFF)
+			pLat->isSaturated = true;
+	}
+	return NULL;
+}
+
+/** a percentile in ms, the last bucket has no top **/
+static void Diag_printMs(const DiagLat_t *pLat, double p) {
+	uint8_t bucket;
+	double ticks = Diag_percentile(pLat, p, &bucket);
+
+	if (ticks < 0)
+		printf(" %9s", "-");
+	else if (bucket == DIAG_LAT_BUCKETS - 1)
+		printf("  >%7.0f", ticks * pLat->tickPeriod / 1000);
+	else
+		printf(" %9.2f", ticks * pLat->tickPeriod / 1000);
+}
+
+static void Diag_printLat(void) {
+	uint8_t stage, i;
+
+	for (stage = 0; stage < DIAG_LAT_STAGES; stage++) {
+		if (lat[stage].pages != 0)
+			break;
+	}
+	if (stage == DIAG_LAT_STAGES)
+		return;
+
+	printf("# %-10s %5s %8s", "stage", "pages", "votes");
+	for (i = 0; i < DIAG_PERCENTILES; i++) {
+		char name[16];
+
+		snprintf(name, sizeof(name), "p%g", percentiles[i] * 100);
+		printf(" %6s ms", name);
+	}
+	printf(" %6s ms\n", "max");
+
+	for (stage = 0; stage < DIAG_LAT_STAGES; stage++) {
+		const DiagLat_t *pLat = &lat[stage];
+		uint64_t total = 0;
+
+		for (i = 0; i < DIAG_LAT_BUCKETS; i++)
+			total += pLat->buckets[i];
+		if (pLat->pages == 0)
+			continue;
+
+		printf("  %-10s %5u %8llu", stageNames[stage], pLat->pages,
+				(unsigned long long) total);
+		for (i = 0; i < DIAG_PERCENTILES; i++)
+			Diag_printMs(pLat, percentiles[i]);
+		Diag_printMs(pLat, 1.0);
+		printf("%s\n", pLat->isSaturated ? "  saturated, reset the pages" : "");
+	}
+}
+
+/*****************************************************************************
+ * @TAG Crash record
+ */
+static uint32_t Diag_getWord(const uint8_t *pBuf) {
+	return pBuf[0] | ((uint32_t) pBuf[1] << 8) | ((uint32_t) pBuf[2] << 16)
+			| ((uint32_t) pBuf[3] << 24);
+}
+
+static void Diag_putWord(uint8_t *pBuf, uint32_t word) {
+	pBuf[0] = (uint8_t) word;
+	pBuf[1] = (uint8_t) (word >> 8);
+	pBuf[2] = (uint8_t) (word >> 16);
+	pBuf[3] = (uint8_t) (word >> 24);
+}
+
+/** FNV-1a, as ETX_Diag_check **/
+static uint32_t Diag_fnv(const uint8_t *pBuf, int len) {
+	uint32_t hash = 2166136261u;
+	int i;
+
+	for (i = 0; i < len; i++) {
+		hash ^= pBuf[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/** the record as the CC2650 lays it out in RAM and NV, little endian **/
+static void Diag_crashBytes(const DiagCrash_t *pRec, uint8_t *pBuf) {
+	const uint32_t words[8] = { pRec->pc, pRec->lr, pRec->cfsr, pRec->hfsr,
+			pRec->mmfar, pRec->bfar, pRec->ticks, pRec->task };
+	int i;
+
+	Diag_putWord(&pBuf[0], pRec->magic);
+	pBuf[4] = pRec->source;
+	pBuf[5] = pRec->cause;
+	pBuf[6] = pRec->subcause;
+	pBuf[7] = pRec->count;
+	pBuf[8] = pRec->appState;
+	pBuf[9] = pRec->gapState;
+	memcpy(&pBuf[10], pRec->events, sizeof(pRec->events));
+	for (i = 0; i < 8; i++)
+		Diag_putWord(&pBuf[20 + 4 * i], words[i]);
+	Diag_putWord(&pBuf[52], pRec->check);
+}
+
+static uint32_t Diag_crashCheck(const DiagCrash_t *pRec) {
+	uint8_t buf[DIAG_CRASH_REC_LEN];
+
+	Diag_crashBytes(pRec, buf);
+	return Diag_fnv(buf, DIAG_CRASH_REC_LEN - 4);
+}
+
+/*********************************************************************
+ * @fn      Diag_crash
+ *
+ * @brief   Read a crash record, the crash page or the record of NV. The
+ *          page is the record after its magic, which only a valid record
+ *          has.
+ *
+ * @param   pBuf - page or record
+ * @param   len - of pBuf
+ * @param   pRec - record read
+ *
+ * @return  what is wrong with it, NULL if it is a record or "none" if no
+ *          crash was recorded
+ */
+static const char *Diag_crash(const uint8_t *pBuf, int len,
+		DiagCrash_t *pRec) {
+	const uint8_t *p;
+	int i;
+
+	memset(pRec, 0, sizeof(DiagCrash_t));
+	if ((len == 1) && (pBuf[0] == DIAG_PAGE_CRASH))
+		return "none";
+	if ((len == 1 + DIAG_CRASH_LEN) && (pBuf[0] == DIAG_PAGE_CRASH)) {
+		pRec->magic = DIAG_CRASH_MAGIC;
+		p = &pBuf[1];
+	} else if (len == DIAG_CRASH_REC_LEN) {
+		pRec->magic = Diag_getWord(pBuf);
+		if (pRec->magic != DIAG_CRASH_MAGIC)
+			return "wrong magic";
+		p = &pBuf[4];
+	} else {
+		return "wrong length";
+	}
+
+	pRec->source = p[0];
+	pRec->cause = p[1];
+	pRec->subcause = p[2];
+	pRec->count = p[3];
+	pRec->appState = p[4];
+	pRec->gapState = p[5];
+	memcpy(pRec->events, &p[6], sizeof(pRec->events));
+	p += 6 + sizeof(pRec->events);
+	for (i = 0; i < 9; i++) {
+		uint32_t word = Diag_getWord(&p[4 * i]);
+
+		switch (i) {
+			case 0: pRec->pc = word; break;
+			case 1: pRec->lr = word; break;
+			case 2: pRec->cfsr = word; break;
+			case 3: pRec->hfsr = word; break;
+			case 4: pRec->mmfar = word; break;
+			case 5: pRec->bfar = word; break;
+			case 6: pRec->ticks = word; break;
+			case 7: pRec->task = word; break;
+			default: pRec->check = word; break;
+		}
+	}
+	return NULL;
+}
+
+/** print a function and line of the firmware at an address **/
+static void Diag_symbol(uint32_t addr) {
+	char cmd[512], fn[256], loc[256];
+	FILE *pPipe;
+
+	// nothing to look up, or an EXC_RETURN
+	if ((pElf == NULL) || (addr == 0) || (addr >= 0xF0000000))
+		return;
+	snprintf(cmd, sizeof(cmd), "%s -f -C -e '%s' 0x%08x", pAddr2line, pElf,
+			addr & ~1u);
+	if ((pPipe = popen(cmd, "r")) == NULL)
+		return;
+	if ((fgets(fn, sizeof(fn), pPipe) != NULL)
+			&& (fgets(loc, sizeof(loc), pPipe) != NULL)) {
+		fn[strcspn(fn, "\r\n")] = '\0';
+		loc[strcspn(loc, "\r\n")] = '\0';
+		printf("  %s at %s", fn, loc);
+	}
+	pclose(pPipe);
+}
+
+/** read a string of the firmware from the ELF, through its segments **/
+static bool Diag_elfString(uint32_t addr, char *pStr, int size) {
+	uint8_t hdr[52];
+	uint32_t phoff;
+	uint16_t phentsize, phnum, i;
+	bool isFound = false;
+	FILE *pFile;
+
+	if ((pElf == NULL) || ((pFile = fopen(pElf, "rb")) == NULL))
+		return false;
+	// 32 bit, little endian
+	if ((fread(hdr, 1, sizeof(hdr), pFile) != sizeof(hdr))
+			|| (memcmp(hdr, "\177ELF", 4) != 0) || (hdr[4] != 1)
+			|| (hdr[5] != 1)) {
+		fclose(pFile);
+		return false;
+	}
+	phoff = Diag_getWord(&hdr[28]);
+	phentsize = hdr[42] | (hdr[43] << 8);
+	phnum = hdr[44] | (hdr[45] << 8);
+
+	for (i = 0; (i < phnum) && !isFound; i++) {
+		uint8_t ph[32];
+		uint32_t vaddr;
+
+		if ((fseek(pFile, phoff + (long) i * phentsize, SEEK_SET) != 0)
+				|| (fread(ph, 1, sizeof(ph), pFile) != sizeof(ph)))
+			break;
+		vaddr = Diag_getWord(&ph[8]);
+		// a loaded segment holding the address
+		if ((Diag_getWord(&ph[0]) == 1) && (addr >= vaddr)
+				&& (addr - vaddr < Diag_getWord(&ph[16]))
+				&& (fseek(pFile, Diag_getWord(&ph[4]) + (addr - vaddr),
+						SEEK_SET) == 0)) {
+			int c, len = 0;
+
+			while ((len < size - 1) && ((c = fgetc(pFile)) != EOF) && c)
+				pStr[len++] = (char) c;
+			pStr[len] = '\0';
+			isFound = true;
+		}
+	}
+	fclose(pFile);
+	return isFound;
+}
+
+static const char *Diag_name(const char **pNames, int count, uint8_t i) {
+	return ((i < count) && pNames[i]) ? pNames[i] : "?";
+}
+
+static void Diag_printBits(uint32_t word, const DiagBit_t *pBits, int count) {
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (word & pBits[i].bit)
+			printf(" %s", pBits[i].pName);
+	}
+}
+
+/** the post-mortem of a record **/
+static void Diag_printCrash(const DiagCrash_t *pRec) {
+	uint32_t check = Diag_crashCheck(pRec);
+	int i;
+
+	printf("crash %d: %s", pRec->count,
+			Diag_name(sourceNames, 5, pRec->source));
+	switch (pRec->source) {
+		case DIAG_CRASH_ASSERT:
+			printf(", cause 0x%02x, subcause 0x%02x, see hal_assert.h\n",
+					pRec->cause, pRec->subcause);
+		break;
+
+		case DIAG_CRASH_ERROR: {
+			char file[128];
+
+			if (Diag_elfString(pRec->pc, file, sizeof(file)))
+				printf(" at %s:%u\n", file, pRec->lr);
+			else
+				printf(" at file 0x%08x, line %u\n", pRec->pc, pRec->lr);
+		}
+		break;
+
+		case DIAG_CRASH_FAULT:
+			if (pRec->cause >= 16)
+				printf(", IRQ %d\n", pRec->cause - 16);
+			else
+				printf(", %s\n", Diag_name(excNames, 16, pRec->cause));
+		break;
+
+		case DIAG_CRASH_WATCHDOG:
+			printf(", stuck in %s 0x%02x for %u ticks\n",
+					Diag_name(classNames, 4, pRec->cause), pRec->subcause,
+					pRec->pc);
+		break;
+
+		default:
+			printf(" %d\n", pRec->source);
+		break;
+	}
+
+	printf("  uptime %.2f s, task 0x%08x, app %s, gap %s\n",
+			(double) pRec->ticks * crashTick / 1e6, pRec->task,
+			Diag_name(appStateNames, 6, pRec->appState),
+			Diag_name(gapStateNames, 9, pRec->gapState));
+	if ((pRec->source == DIAG_CRASH_FAULT) ||
+			(pRec->source == DIAG_CRASH_ASSERT)) {
+		printf("  pc    0x%08x", pRec->pc);
+		Diag_symbol(pRec->pc);
+		printf("\n  lr    0x%08x", pRec->lr);
+		Diag_symbol(pRec->lr);
+		printf("\n");
+	}
+	printf("  CFSR  0x%08x", pRec->cfsr);
+	Diag_printBits(pRec->cfsr, cfsrBits, sizeof(cfsrBits) / sizeof(cfsrBits[0]));
+	printf("\n  HFSR  0x%08x", pRec->hfsr);
+	Diag_printBits(pRec->hfsr, hfsrBits, sizeof(hfsrBits) / sizeof(hfsrBits[0]));
+	printf("\n");
+	if (pRec->cfsr & DIAG_MMARVALID)
+		printf("  MMFAR 0x%08x\n", pRec->mmfar);
+	if (pRec->cfsr & DIAG_BFARVALID)
+		printf("  BFAR  0x%08x\n", pRec->bfar);
+
+	printf("  events, oldest first:\n");
+	for (i = 0; i < DIAG_CRASH_EVENTS; i++) {
+		uint8_t event = pRec->events[2 * i];
+		uint8_t state = pRec->events[2 * i + 1];
+		const char *pName = "?";
+		size_t n;
+
+		// slots not used since the boot
+		if (event == 0)
+			continue;
+		for (n = 0; n < sizeof(appNames) / sizeof(appNames[0]); n++) {
+			if (appNames[n].event == event)
+				pName = appNames[n].pName;
+		}
+		if (event == DIAG_GAP_STATE_CHG_EVT)
+			printf("    %-14s %s\n", pName, Diag_name(gapStateNames, 9, state));
+		else if (event == DIAG_APP_STATE_CHG_EVT)
+			printf("    %-14s %s\n", pName, Diag_name(appStateNames, 6, state));
+		else
+			printf("    %-14s 0x%02x, state 0x%02x\n", pName, event, state);
+	}
+
+	if (check != pRec->check) {
+		printf("  check 0x%08x, record 0x%08x, the record is corrupted\n",
+				check, pRec->check);
+		errors++;
+	}
+}
+
+/*****************************************************************************
+ * @TAG Input
+ */
+/** a page in hex, bytes may be split by spaces, - or : **/
+static int Diag_hex(const char *pStr, uint8_t *pBuf, int size) {
+	int len = 0;
+	unsigned int byte;
+
+	while (*pStr) {
+		if ((*pStr == ' ') || (*pStr == '\t') || (*pStr == '-')
+				|| (*pStr == ':') || (*pStr == '\r') || (*pStr == '\n')) {
+			pStr++;
+			continue;
+		}
+		if ((pStr[0] == '0') && ((pStr[1] == 'x') || (pStr[1] == 'X'))) {
+			pStr += 2;
+			continue;
+		}
+		if ((len >= size) || (sscanf(pStr, "%2x", &byte) != 1))
+			return -1;
+		pBuf[len++] = (uint8_t) byte;
+		pStr += (pStr[1] && (pStr[1] != ' ')) ? 2 : 1;
+	}
+	return len;
+}
+
+/** a line of the UART dump, as ETX_Diag_dump prints it **/
+static bool Diag_dumpLine(const char *pLine, uint32_t *pTickPeriod) {
+	const char *p;
+	unsigned int stage, bucket, count, tick;
+
+	if ((p = strstr(pLine, "Latency histograms, tick ")) != NULL
+			&& (sscanf(p, "Latency histograms, tick %uus", &tick) == 1)) {
+		*pTickPeriod = tick;
+		return true;
+	}
+	if (((p = strstr(pLine, "lat ")) == NULL)
+			|| (sscanf(p, "lat %u, 2^%u ticks: %u", &stage, &bucket,
+					&count) != 3))
+		return false;
+	if ((stage >= DIAG_LAT_STAGES) || (bucket >= DIAG_LAT_BUCKETS)
+			|| (*pTickPeriod == 0))
+		return false;
+
+	if (lat[stage].pages == 0)
+		lat[stage].pages = 1;
+	lat[stage].tickPeriod = *pTickPeriod;
+	lat[stage].buckets[bucket] += count;
+	if (count == 0xFFFF)
+		lat[stage].isSaturated = true;
+	return true;
+}
+
+/** the rest of the UART dump, told by ETX_Diag_dump and ETX_Diag_recover **/
+static bool Diag_isDump(const char *pLine) {
+	static const char *pDumps[] = {
+		"stack ", "heap:", "last crash:", "loop:", "load:", "crash ",
+		"reset source:"
+	};
+	size_t i;
+
+	for (i = 0; i < sizeof(pDumps) / sizeof(pDumps[0]); i++) {
+		if (strstr(pLine, pDumps[i]) != NULL)
+			return true;
+	}
+	return false;
+}
+
+static void Diag_load(FILE *pIn) {
+	char line[DIAG_MAX_LINE];
+	uint8_t page[DIAG_MAX_PAGE];
+	uint32_t tickPeriod = 0;
+	int lineNum = 0;
+
+	while (fgets(line, sizeof(line), pIn) != NULL) {
+		char *pHash = strchr(line, '#');
+		int len;
+
+		lineNum++;
+		if (pHash != NULL)
+			*pHash = '\0';
+		if (strspn(line, " \t\r\n") == strlen(line))
+			continue;
+		if (Diag_dumpLine(line, &tickPeriod))
+			continue;
+
+		len = Diag_hex(line, page, sizeof(page));
+		if (len < 1) {
+			if (!Diag_isDump(line)) {
+				printf("line %d: not a page\n", lineNum);
+				errors++;
+			}
+		} else if ((page[0] == DIAG_PAGE_CRASH)
+				|| (len == DIAG_CRASH_REC_LEN)) {
+			DiagCrash_t rec;
+			const char *pWrong = Diag_crash(page, len, &rec);
+
+			if (pWrong == NULL) {
+				Diag_printCrash(&rec);
+			} else if (strcmp(pWrong, "none") == 0) {
+				printf("no crash recorded\n");
+			} else {
+				printf("line %d: crash record, %s\n", lineNum, pWrong);
+				errors++;
+			}
+		} else if (page[0] < DIAG_PAGE_LAT + DIAG_LAT_STAGES) {
+			const char *pWrong = Diag_latPage(page, len);
+
+			if (pWrong != NULL) {
+				printf("line %d: latency page 0x%02x, %s\n", lineNum, page[0],
+						pWrong);
+				errors++;
+			}
+		}
+	}
+}
+
+/*****************************************************************************
+ * @TAG Checks
+ */
+static uint32_t Diag_random(void) {
+	rng = rng * 1103515245 + 12345;
+	return rng >> 16;
+}
+
+static int Diag_cmp(const void *a, const void *b) {
+	uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+	return (x > y) - (x < y);
+}
+
+/*********************************************************************
+ * @fn      Diag_check
+ *
+ * @brief   Bucket known latencies as the firmware does, send them through
+ *          a page and check every percentile falls in the bucket of the
+ *          exact one, and the page checks themselves.
+ *
+ * @param   none
+ *
+ * @return  none, errors are counted
+ */
+static void Diag_check(void) {
+	static uint32_t samples[20000];
+	uint16_t hist[DIAG_LAT_BUCKETS] = { 0 };
+	uint8_t page[DIAG_LAT_LEN];
+	int n = sizeof(samples) / sizeof(samples[0]);
+	int i, k;
+
+	// a spread from a few ticks to a few seconds, as the connect stage
+	for (i = 0; i < n; i++) {
+		uint8_t shift = (uint8_t) (Diag_random() % 19);
+
+		samples[i] = (1u << shift) + Diag_random() % (1u << shift);
+		hist[Diag_bucket(samples[i])]++;
+	}
+	qsort(samples, n, sizeof(samples[0]), Diag_cmp);
+
+	memset(lat, 0, sizeof(lat));
+	page[0] = DIAG_PAGE_LAT + 3;
+	page[1] = 3;
+	page[2] = 10;
+	page[3] = 0;
+	for (i = 0; i < DIAG_LAT_BUCKETS; i++) {
+		page[4 + 2 * i] = (uint8_t) hist[i];
+		page[5 + 2 * i] = (uint8_t) (hist[i] >> 8);
+	}
+	if (Diag_latPage(page, sizeof(page)) != NULL) {
+		printf("check: page not taken\n");
+		errors++;
+	}
+
+	for (k = 1; k < 100; k++) {
+		uint32_t exact = samples[(n * k + 99) / 100 - 1];
+		uint8_t bucket;
+		double ticks = Diag_percentile(&lat[3], k / 100.0, &bucket);
+
+		if ((bucket != Diag_bucket(exact)) || (ticks < Diag_floor(bucket))
+				|| ((bucket < DIAG_LAT_BUCKETS - 1)
+						&& (ticks > Diag_floor(bucket + 1)))) {
+			printf("check: p%d %.1f ticks in bucket %d, exact %u in %d\n", k,
+					ticks, bucket, exact, Diag_bucket(exact));
+			errors++;
+		}
+	}
+
+	// the same stage again adds up, another tick period doesn't
+	if ((Diag_latPage(page, sizeof(page)) != NULL) || (lat[3].pages != 2)
+			|| (lat[3].buckets[Diag_bucket(samples[0])]
+					!= 2u * hist[Diag_bucket(samples[0])])) {
+		printf("check: pages of a stage not added up\n");
+		errors++;
+	}
+	page[2] = 20;
+	if (Diag_latPage(page, sizeof(page)) == NULL) {
+		printf("check: page of another tick period taken\n");
+		errors++;
+	}
+	page[2] = 10;
+	page[1] = 2;
+	if (Diag_latPage(page, sizeof(page)) == NULL) {
+		printf("check: page of another stage taken\n");
+		errors++;
+	}
+	page[1] = 3;
+	if (Diag_latPage(page, sizeof(page) - 2) == NULL) {
+		printf("check: short page taken\n");
+		errors++;
+	}
+
+	// an empty histogram has no percentiles, the top bucket no top
+	{
+		DiagLat_t empty;
+		uint8_t bucket;
+
+		memset(&empty, 0, sizeof(empty));
+		if (Diag_percentile(&empty, 0.5, &bucket) >= 0) {
+			printf("check: empty histogram has a percentile\n");
+			errors++;
+		}
+		empty.buckets[DIAG_LAT_BUCKETS - 1] = 1;
+		if ((Diag_percentile(&empty, 0.5, &bucket)
+				!= Diag_floor(DIAG_LAT_BUCKETS - 1))
+				|| (bucket != DIAG_LAT_BUCKETS - 1)) {
+			printf("check: top bucket not at its floor\n");
+			errors++;
+		}
+	}
+
+	if (Diag_bucket(0) != 0 || Diag_bucket(1) != 0 || Diag_bucket(2) != 1
+			|| Diag_bucket(0xFFFFFFFF) != DIAG_LAT_BUCKETS - 1) {
+		printf("check: buckets differ from ETX_Diag_latency\n");
+		errors++;
+	}
+	memset(lat, 0, sizeof(lat));
+}
+
+/*********************************************************************
+ * @fn      Diag_checkCrash
+ *
+ * @brief   Lay out a record as the firmware does, in NV and as the crash
+ *          page, and check both read back the same and a corrupted or
+ *          foreign one is told.
+ *
+ * @param   none
+ *
+ * @return  none, errors are counted
+ */
+static void Diag_checkCrash(void) {
+	DiagCrash_t rec, read;
+	uint8_t raw[DIAG_CRASH_REC_LEN];
+	uint8_t page[1 + DIAG_CRASH_LEN];
+	int i;
+
+	// FNV-1a of "a"
+	if (Diag_fnv((const uint8_t *) "a", 1) != 0xE40C292C) {
+		printf("check: FNV-1a of \"a\" is 0x%08x\n",
+				Diag_fnv((const uint8_t *) "a", 1));
+		errors++;
+	}
+
+	memset(&rec, 0, sizeof(rec));
+	rec.magic = DIAG_CRASH_MAGIC;
+	rec.source = DIAG_CRASH_FAULT;
+	rec.cause = 3;
+	rec.count = 2;
+	rec.appState = 2;
+	rec.gapState = 6;
+	for (i = 0; i < 2 * DIAG_CRASH_EVENTS; i++)
+		rec.events[i] = (uint8_t) (0x10 + i);
+	rec.pc = 0x0001A2B4;
+	rec.lr = 0x0001A001;
+	rec.cfsr = DIAG_BFARVALID | (1u << 9);
+	rec.hfsr = 1u << 30;
+	rec.bfar = 0x40001000;
+	rec.ticks = 123456;
+	rec.task = 0x20001234;
+	rec.check = Diag_crashCheck(&rec);
+
+	// the record of NV, then the page as ETX_Diag_getPage fills it
+	Diag_crashBytes(&rec, raw);
+	page[0] = DIAG_PAGE_CRASH;
+	memcpy(&page[1], &raw[4], DIAG_CRASH_LEN);
+
+	if ((Diag_crash(raw, sizeof(raw), &read) != NULL)
+			|| (memcmp(&read, &rec, sizeof(rec)) != 0)
+			|| (Diag_crashCheck(&read) != read.check)) {
+		printf("check: record of NV not read back\n");
+		errors++;
+	}
+	if ((Diag_crash(page, sizeof(page), &read) != NULL)
+			|| (memcmp(&read, &rec, sizeof(rec)) != 0)
+			|| (Diag_crashCheck(&read) != read.check)) {
+		printf("check: crash page not read back\n");
+		errors++;
+	}
+
+	// any byte flipped is told by the check
+	for (i = 1; i < 1 + DIAG_CRASH_LEN - 4; i++) {
+		page[i] ^= 0x01;
+		if ((Diag_crash(page, sizeof(page), &read) != NULL)
+				|| (Diag_crashCheck(&read) == read.check)) {
+			printf("check: byte %d of the page flipped not told\n", i);
+			errors++;
+		}
+		page[i] ^= 0x01;
+	}
+
+	raw[0] ^= 0x01;
+	if (Diag_crash(raw, sizeof(raw), &read) == NULL) {
+		printf("check: record of another magic taken\n");
+		errors++;
+	}
+	if ((Diag_crash(page, 1, &read) == NULL)
+			|| (Diag_crash(page, sizeof(page) - 4, &read) == NULL)) {
+		printf("check: empty or short crash page taken\n");
+		errors++;
+	}
+}
+
+/*****************************************************************************
+ * @TAG Main
+ */
+int main(int argc, char **argv) {
+	FILE *pIn;
+	bool isCheck = false;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "e:a:p:th")) != -1) {
+		switch (opt) {
+			case 'e': pElf = optarg; break;
+			case 'a': pAddr2line = optarg; break;
+			case 'p': crashTick = (uint32_t) atoi(optarg); break;
+			case 't': isCheck = true; break;
+			default:
+				printf("usage: etx_diag [options] [pages.txt]\n"
+						"  -e elf    firmware to symbolize a crash against\n"
+						"  -a tool   addr2line (%s)\n"
+						"  -p us     tick period of the crash uptime (%u)\n"
+						"  -t        self checks\n", DIAG_ADDR2LINE, crashTick);
+				return (opt == 'h') ? 0 : 1;
+		}
+	}
+
+	if (isCheck) {
+		Diag_check();
+		Diag_checkCrash();
+		printf("%d errors\n", errors);
+		return errors ? 1 : 0;
+	}
+
+	pIn = (optind < argc) ? fopen(argv[optind], "r") : stdin;
+	if (pIn == NULL) {
+		perror(argv[optind]);
+		return 1;
+	}
+	Diag_load(pIn);
+	if (pIn != stdin)
+		fclose(pIn);
+
+	Diag_printLat();
+	printf("%d errors\n", errors);
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,597 @@
+/*****************************************************************************
+ *
+ * @filepath    /tools/etx_energy/etx_energy.c
+ *
+ * @project     evrs tools
+ *
+ * @brief       estimates the battery drain of an ETX from its event trace
+ *              with a CC2650 current model, so firmware settings can be
+ *              compared before a current probe is set up.
+ *
+ *              The trace is the UART output of a firmware built with
+ *              ETX_TRACE, taken after writing the dump page (0xFF) to the
+ *              diagnostics characteristic, several dumps in a row make one
+ *              timeline:
+ *
+ *                trace 3 records, tick 10us
+ *                T 0001a2b4 03 30 00a0
+ *                ...
+ *                trace end
+ *
+ *              The records tell when advertising, links, scans and LEDs go
+ *              on and off and their intervals, the ADC samples, the votes
+ *              and questions, and every second the CPU load and standby
+ *              residency. The radio events in between are counted from the
+ *              intervals and charged with the model, the CPU with the load
+ *              records, or with the handled messages if there are none.
+ *              The model is the default below with any key=value of -m or
+ *              of a -M file on top, currents in uA, times in us.
+ *
+ *              The trace ring holds BOARD_TRACE_DEPTH records, build with a
+ *              deeper ring or dump often enough so it doesn't wrap, a gap
+ *              in the timeline is charged as if nothing changed.
+ *
+ * build        cc -O2 -std=gnu99 -o etx_energy etx_energy.c
+ *
+ * usage        ./etx_energy [-m key=value] [-M model.txt] [-x dBm]
+ *                  [-S session, min] [-b battery, mAh] [-l] [dump.txt...]
+ *
+ * @date        18 Oct. 2026
+ *
+ * @author      Ziyi@outlook.com.au
+ *
+ ****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define EN_MAX_LINE				256
+#define EN_MAX_LINKS			16
+
+// keep in step with drv/etx_board_trace.h
+#define EN_TRACE_STACK_EVT		0x02
+#define EN_TRACE_STACK_MSG		0x03
+#define EN_TRACE_APP_MSG		0x04
+#define EN_TRACE_END			0x05
+#define EN_TRACE_LED			0x20
+#define EN_TRACE_LED_FLASH		0x21
+#define EN_TRACE_ADV			0x30
+#define EN_TRACE_CONN			0x31
+#define EN_TRACE_SCAN			0x32
+#define EN_TRACE_ADC			0x33
+#define EN_TRACE_LOAD			0x34
+#define EN_TRACE_VOTE			0x40
+#define EN_TRACE_QUESTION		0x41
+#define EN_TRACE_THREADS		8
+
+// keep in step with src/evrs_tx_main.c and drv/etx_board_led.h
+#define EN_GAP_STATE_CHG_EVT	0x01
+#define EN_LEDS					2
+#define EN_LED_STATE_ON			1
+#define EN_LED_STATE_HIGH		3
+
+// GAPRole states which advertise
+#define EN_GAP_ADVERTISING		2
+#define EN_GAP_ADVERTISING_NC	3
+#define EN_GAP_CONNECTED_ADV	7
+
+// Subsystems of the breakdown
+#define EN_SUB_STANDBY			0
+#define EN_SUB_IDLE				1
+#define EN_SUB_CPU				2
+#define EN_SUB_ADV				3
+#define EN_SUB_CONN				4
+#define EN_SUB_SCAN				5
+#define EN_SUB_LED				6
+#define EN_SUB_ADC				7
+#define EN_SUBS					8
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// Current model, uA and us
+typedef struct EnModel_t {
+	double standbyUa;		// standby, RTC and RAM retention
+	double idleUa;			// awake, CPU waiting for an interrupt
+	double cpuUa;			// CPU running, 48 MHz
+	double rxUa;			// radio receiving
+	double txUa;			// radio transmitting, from -x unless set
+	double radioPreUs;		// radio event wake up and set up, at preUa
+	double radioPreUa;
+	double advBytes;		// advertising data
+	double advRxUs;			// listening for requests after an ADV_IND
+	double advDelayUs;		// mean random delay added to the interval
+	double connTxUs;		// empty packet
+	double connRxUs;		// listening, window widening included
+	double ledUa[EN_LEDS];	// red, blue
+	double adcUs;			// ADC open, sample and close, at adcUa
+	double adcUa;
+} EnModel_t;
+
+// State of the device along the trace
+typedef struct EnState_t {
+	int gapState;			// -1 until the first state change
+	bool isAdvEnabled;		// advertising enabled by the app
+	uint16_t advInterval;	// 625us, bit 15 for high duty directed
+	uint16_t connInterval[EN_MAX_LINKS];	// 1.25ms, 0 for no link
+	uint8_t ledLevel[EN_LEDS];
+	uint64_t scanEnd;		// us
+	uint64_t msgBegin[EN_TRACE_THREADS];	// us, 0 for no message
+	int lastVote;
+	int lastQuestion;
+} EnState_t;
+
+// What the trace adds up to, charges in uA * us
+typedef struct EnTotals_t {
+	double charge[EN_SUBS];
+	double radioUs;			// radio events, not idle
+	double busyUs;			// handled messages
+	double advEvents;
+	double connEvents;
+	uint32_t scans;
+	uint32_t adcSamples;
+	uint32_t votes;
+	uint32_t questions;
+	uint32_t loadSeconds;	// with a load record
+	double loadSum;			// %
+	double standbySum;		// %
+	uint64_t firstUs;
+	uint64_t lastUs;
+	uint32_t records;
+} EnTotals_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+// Clock tick of the dump being read
+static unsigned tickUs = 10;
+
+static const char *const subNames[EN_SUBS] = {
+	"standby", "idle", "cpu", "advertising", "connections", "scans", "leds",
+	"adc"
+};
+
+// CC2650 data sheet currents at 3 V
+static EnModel_t model = {
+	.standbyUa = 1, .idleUa = 550, .cpuUa = 2900, .rxUa = 5900, .txUa = 0,
+	.radioPreUs = 1000, .radioPreUa = 3000, .advBytes = 31, .advRxUs = 200,
+	.advDelayUs = 5000, .connTxUs = 80, .connRxUs = 200,
+	.ledUa = { 2000, 2000 }, .adcUs = 500, .adcUa = 1500
+};
+
+static const struct {
+	const char *pKey;
+	double *pValue;
+} modelKeys[] = {
+	{ "standby_ua", &model.standbyUa }, { "idle_ua", &model.idleUa },
+	{ "cpu_ua", &model.cpuUa }, { "rx_ua", &model.rxUa },
+	{ "tx_ua", &model.txUa }, { "radio_pre_us", &model.radioPreUs },
+	{ "radio_pre_ua", &model.radioPreUa }, { "adv_bytes", &model.advBytes },
+	{ "adv_rx_us", &model.advRxUs }, { "adv_delay_us", &model.advDelayUs },
+	{ "conn_tx_us", &model.connTxUs }, { "conn_rx_us", &model.connRxUs },
+	{ "led_r_ua", &model.ledUa[0] }, { "led_b_ua", &model.ledUa[1] },
+	{ "adc_us", &model.adcUs }, { "adc_ua", &model.adcUa }
+};
+
+// TX current of the data sheet by output power
+static const struct {
+	int dBm;
+	double ua;
+} txTable[] = {
+	{ 0, 6100 }, { 5, 9100 }
+};
+
+/*****************************************************************************
+ * @TAG Model
+ */
+static bool En_setModel(const char *pArg) {
+	char key[32];
+	double value;
+	size_t i;
+
+	if (sscanf(pArg, " %31[a-z_0-9] = %lf", key, &value) != 2)
+		return false;
+	for (i = 0; i < sizeof(modelKeys) / sizeof(modelKeys[0]); i++) {
+		if (strcmp(key, modelKeys[i].pKey) == 0) {
+			*modelKeys[i].pValue = value;
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool En_loadModel(const char *pPath) {
+	char line[EN_MAX_LINE];
+	FILE *pIn = fopen(pPath, "r");
+	bool isOk = true;
+
+	if (pIn == NULL) {
+		perror(pPath);
+		return false;
+	}
+	while (fgets(line, sizeof(line), pIn) != NULL) {
+		char *p = line + strspn(line, " \t");
+
+		if ((*p == '#') || (*p == '\n') || (*p == '\0'))
+			continue;
+		if (!En_setModel(p)) {
+			fprintf(stderr, "%s: bad line %s", pPath, line);
+			isOk = false;
+		}
+	}
+	fclose(pIn);
+	return isOk;
+}
+
+/** charge of a radio event, the packets of its channels with their set up **/
+static double En_radioEvent(double txUs, double rxUs, double *pRadioUs) {
+	*pRadioUs += model.radioPreUs + txUs + rxUs;
+	return model.radioPreUs * model.radioPreUa + txUs * model.txUa
+			+ rxUs * model.rxUa;
+}
+
+/*****************************************************************************
+ * @TAG Timeline
+ */
+/*********************************************************************
+ * @fn      En_advance
+ *
+ * @brief   Charge the time from the last record to now with the state
+ *          the device was in.
+ *
+ * @param   pState - state since the last record
+ * @param   pTotals - totals
+ * @param   now - time of the record, us
+ *
+ * @return  none
+ */
+static void En_advance(const EnState_t *pState, EnTotals_t *pTotals,
+		uint64_t now) {
+	double span = (double) (now - pTotals->lastUs);
+	bool isAdvertising;
+	int i;
+
+	if (pTotals->records == 0)
+		return;
+
+	isAdvertising = (pState->gapState < 0) ? pState->isAdvEnabled
+			: ((pState->gapState == EN_GAP_ADVERTISING)
+					|| (pState->gapState == EN_GAP_ADVERTISING_NC)
+					|| (pState->gapState == EN_GAP_CONNECTED_ADV));
+	if (isAdvertising && (pState->advInterval != 0)) {
+		bool isDirected = (pState->advInterval & 0x8000) != 0;
+		// 3 channels, an ADV_IND with the address and data, a
+		// high duty cycle ADV_DIRECT_IND every 3.75 ms without listening
+		double interval = isDirected ? 3750
+				: (pState->advInterval & 0x7FFF) * 625.0 + model.advDelayUs;
+		double txUs = 3 * 8 * (isDirected ? 22 : 16 + model.advBytes);
+		double rxUs = isDirected ? 0 : 3 * model.advRxUs;
+		double events = span / interval;
+		double radioUs = 0;
+
+		pTotals->advEvents += events;
+		pTotals->charge[EN_SUB_ADV] += events
+				* En_radioEvent(txUs, rxUs, &radioUs);
+		pTotals->radioUs += events * radioUs;
+	}
+
+	for (i = 0; i < EN_MAX_LINKS; i++) {
+		if (pState->connInterval[i] != 0) {
+			double events = span / (pState->connInterval[i] * 1250.0);
+			double radioUs = 0;
+
+			pTotals->connEvents += events;
+			pTotals->charge[EN_SUB_CONN] += events
+					* En_radioEvent(model.connTxUs, model.connRxUs, &radioUs);
+			pTotals->radioUs += events * radioUs;
+		}
+	}
+
+	if (pState->scanEnd > pTotals->lastUs) {
+		double scanUs = (double) (((pState->scanEnd < now) ? pState->scanEnd
+				: now) - pTotals->lastUs);
+
+		pTotals->charge[EN_SUB_SCAN] += scanUs * model.rxUa;
+		pTotals->radioUs += scanUs;
+	}
+
+	for (i = 0; i < EN_LEDS; i++) {
+		if (pState->ledLevel[i])
+			pTotals->charge[EN_SUB_LED] += span * model.ledUa[i];
+	}
+}
+
+/*********************************************************************
+ * @fn      En_record
+ *
+ * @brief   Apply a trace record, after charging the time up to it.
+ *
+ * @param   pState - state of the device
+ * @param   pTotals - totals
+ * @param   now - time of the record, us
+ * @param   thread - thread of the record
+ * @param   id - trace ID
+ * @param   arg - argument
+ *
+ * @return  none
+ */
+static void En_record(EnState_t *pState, EnTotals_t *pTotals, uint64_t now,
+		uint8_t thread, uint8_t id, uint16_t arg) {
+	En_advance(pState, pTotals, now);
+	if (pTotals->records++ == 0)
+		pTotals->firstUs = now;
+	pTotals->lastUs = now;
+
+	switch (id) {
+		case EN_TRACE_STACK_EVT:
+		case EN_TRACE_STACK_MSG:
+		case EN_TRACE_APP_MSG:
+			if (thread < EN_TRACE_THREADS)
+				pState->msgBegin[thread] = now;
+			if ((id == EN_TRACE_APP_MSG)
+					&& ((arg & 0xFF) == EN_GAP_STATE_CHG_EVT))
+				pState->gapState = arg >> 8;
+		break;
+
+		case EN_TRACE_END:
+			if ((thread < EN_TRACE_THREADS)
+					&& (pState->msgBegin[thread] != 0)) {
+				pTotals->busyUs += (double) (now - pState->msgBegin[thread]);
+				pState->msgBegin[thread] = 0;
+			}
+		break;
+
+		case EN_TRACE_LED:
+			if ((arg & 0xFF) < EN_LEDS)
+				pState->ledLevel[arg & 0xFF] = ((arg >> 8) == EN_LED_STATE_ON)
+						|| ((arg >> 8) == EN_LED_STATE_HIGH);
+		break;
+
+		case EN_TRACE_LED_FLASH:
+			if (arg < EN_LEDS)
+				pState->ledLevel[arg] = !pState->ledLevel[arg];
+		break;
+
+		case EN_TRACE_ADV:
+			pState->isAdvEnabled = true;
+			pState->advInterval = arg;
+		break;
+
+		case EN_TRACE_CONN:
+			pState->connInterval[arg >> 12] = arg & 0x0FFF;
+		break;
+
+		case EN_TRACE_SCAN:
+			pTotals->scans++;
+			pState->scanEnd = now + (uint64_t) arg * 1000;
+			pTotals->charge[EN_SUB_SCAN] += En_radioEvent(0, 0,
+					&pTotals->radioUs);
+		break;
+
+		case EN_TRACE_ADC:
+			pTotals->adcSamples++;
+			pTotals->charge[EN_SUB_ADC] += model.adcUs * model.adcUa;
+		break;
+
+		case EN_TRACE_LOAD:
+			pTotals->loadSeconds++;
+			pTotals->loadSum += arg >> 8;
+			pTotals->standbySum += arg & 0xFF;
+		break;
+
+		case EN_TRACE_VOTE:
+			if (arg != pState->lastVote)
+				pTotals->votes++;
+			pState->lastVote = arg;
+		break;
+
+		case EN_TRACE_QUESTION:
+			if ((arg & 0x01) && ((arg >> 8) != pState->lastQuestion)) {
+				pTotals->questions++;
+				pState->lastQuestion = arg >> 8;
+			}
+		break;
+
+		default:
+		break;
+	}
+}
+
+/** read the dumps, records outside of them are ignored **/
+static void En_read(FILE *pIn, EnState_t *pState, EnTotals_t *pTotals,
+		uint32_t *pLastTick, uint64_t *pWraps) {
+	char line[EN_MAX_LINE];
+	bool isInDump = false;
+
+	while (fgets(line, sizeof(line), pIn) != NULL) {
+		const char *p = line + strspn(line, " \t");
+		unsigned count, tick, thread, id, arg;
+
+		if (sscanf(p, "trace %u records, tick %uus", &count, &tickUs) == 2) {
+			isInDump = true;
+			continue;
+		}
+		if (strncmp(p, "trace end", 9) == 0) {
+			isInDump = false;
+			continue;
+		}
+		if (!isInDump || (sscanf(p, "T %8x %2x %2x %4x", &tick, &thread, &id,
+				&arg) != 4))
+			continue;
+
+		// Clock ticks are 32 bits, keep the timeline going across a wrap
+		if ((pTotals->records != 0) && (tick < *pLastTick))
+			(*pWraps)++;
+		*pLastTick = tick;
+		En_record(pState, pTotals, ((*pWraps << 32) + tick) * tickUs,
+				(uint8_t) thread, (uint8_t) id, (uint16_t) arg);
+	}
+}
+
+/*****************************************************************************
+ * @TAG Report
+ */
+/** charge the CPU and the sleep over the whole span **/
+static void En_chargeCpu(EnTotals_t *pTotals) {
+	double span = (double) (pTotals->lastUs - pTotals->firstUs);
+	double cpuUs, standbyUs, idleUs;
+
+	if (pTotals->loadSeconds != 0) {
+		cpuUs = span * pTotals->loadSum / pTotals->loadSeconds / 100;
+		standbyUs = span * pTotals->standbySum / pTotals->loadSeconds / 100;
+		idleUs = span - cpuUs - standbyUs - pTotals->radioUs;
+	} else {
+		// without load records, in standby whenever no message is handled
+		cpuUs = pTotals->busyUs;
+		idleUs = 0;
+		standbyUs = span - cpuUs - pTotals->radioUs;
+	}
+	if (idleUs < 0)
+		idleUs = 0;
+	if (standbyUs < 0)
+		standbyUs = 0;
+
+	pTotals->charge[EN_SUB_CPU] = cpuUs * model.cpuUa;
+	pTotals->charge[EN_SUB_STANDBY] = standbyUs * model.standbyUa;
+	pTotals->charge[EN_SUB_IDLE] = idleUs * model.idleUa;
+}
+
+static void En_report(const EnTotals_t *pTotals, double sessionMin,
+		double batteryMah) {
+	double span = (double) (pTotals->lastUs - pTotals->firstUs);
+	double total = 0, mah, avgUa;
+	int i;
+
+	for (i = 0; i < EN_SUBS; i++)
+		total += pTotals->charge[i];
+	mah = total / 3.6e12;	// uA * us to mAh
+	avgUa = total / span;
+
+	printf("trace %u records, %.1f s, %u votes, %u questions, "
+			"%u s with load records\n", pTotals->records, span / 1e6,
+			pTotals->votes, pTotals->questions, pTotals->loadSeconds);
+	printf("%.0f advertising events, %.0f connection events, %u scans, "
+			"%u ADC samples\n\n", pTotals->advEvents, pTotals->connEvents,
+			pTotals->scans, pTotals->adcSamples);
+
+	printf("%-12s %12s %10s %7s\n", "subsystem", "uAh", "avg uA", "share");
+	for (i = 0; i < EN_SUBS; i++)
+		printf("%-12s %12.3f %10.2f %6.1f%%\n", subNames[i],
+				pTotals->charge[i] / 3.6e9, pTotals->charge[i] / span,
+				(total > 0) ? 100 * pTotals->charge[i] / total : 0);
+	printf("%-12s %12.3f %10.2f\n\n", "total", total / 3.6e9, avgUa);
+
+	printf("mAh per hour     %.4f\n", avgUa / 1000);
+	if (pTotals->votes != 0)
+		printf("mAh per vote     %.6f\n", mah / pTotals->votes);
+	if (pTotals->questions != 0)
+		printf("mAh per question %.6f\n", mah / pTotals->questions);
+	printf("mAh per session  %.4f (%.0f min)\n",
+			avgUa / 1000 * sessionMin / 60, sessionMin);
+	printf("battery life     %.0f h (%.0f mAh)\n", batteryMah / avgUa * 1000,
+			batteryMah);
+}
+
+/*****************************************************************************
+ * @TAG Main
+ */
+static void En_usage(void) {
+	size_t i;
+
+	printf("usage: etx_energy [-m key=value] [-M model file] [-x TX dBm]"
+			" [-S session, min] [-b battery, mAh] [-l] [dump.txt...]\n"
+			"  -l  list the model\n");
+	printf("model keys:");
+	for (i = 0; i < sizeof(modelKeys) / sizeof(modelKeys[0]); i++)
+		printf(" %s", modelKeys[i].pKey);
+	printf("\n");
+}
+
+int main(int argc, char **argv) {
+	EnState_t state;
+	EnTotals_t totals;
+	double sessionMin = 45, batteryMah = 220;
+	bool isListed = false;
+	int txDbm = 0;
+	uint32_t lastTick = 0;
+	uint64_t wraps = 0;
+	size_t i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "m:M:x:S:b:lh")) != -1) {
+		switch (opt) {
+			case 'm':
+				if (!En_setModel(optarg)) {
+					fprintf(stderr, "bad model value %s\n", optarg);
+					return 1;
+				}
+			break;
+			case 'M':
+				if (!En_loadModel(optarg))
+					return 1;
+			break;
+			case 'x': txDbm = atoi(optarg); break;
+			case 'S': sessionMin = atof(optarg); break;
+			case 'b': batteryMah = atof(optarg); break;
+			case 'l': isListed = true; break;
+			default:
+				En_usage();
+				return (opt == 'h') ? 0 : 1;
+		}
+	}
+
+	if (model.txUa == 0) {
+		for (i = 0; i < sizeof(txTable) / sizeof(txTable[0]); i++) {
+			if (txTable[i].dBm == txDbm)
+				model.txUa = txTable[i].ua;
+		}
+		if (model.txUa == 0) {
+			fprintf(stderr, "no TX current for %d dBm, set tx_ua\n", txDbm);
+			return 1;
+		}
+	}
+	if (isListed) {
+		for (i = 0; i < sizeof(modelKeys) / sizeof(modelKeys[0]); i++)
+			printf("%s=%g\n", modelKeys[i].pKey, *modelKeys[i].pValue);
+		printf("\n");
+	}
+
+	memset(&state, 0, sizeof(state));
+	memset(&totals, 0, sizeof(totals));
+	state.gapState = -1;
+	state.lastVote = -1;
+	state.lastQuestion = -1;
+
+	if (optind == argc) {
+		En_read(stdin, &state, &totals, &lastTick, &wraps);
+	} else {
+		for (; optind < argc; optind++) {
+			FILE *pIn = fopen(argv[optind], "r");
+
+			if (pIn == NULL) {
+				perror(argv[optind]);
+				return 1;
+			}
+			En_read(pIn, &state, &totals, &lastTick, &wraps);
+			fclose(pIn);
+		}
+	}
+	if ((totals.records < 2) || (totals.lastUs == totals.firstUs)) {
+		fprintf(stderr, "no trace records\n");
+		return 1;
+	}
+
+	En_chargeCpu(&totals);
+	En_report(&totals, sessionMin, batteryMah);
+	return 0;
+}
@@ -0,0 +1,318 @@
+/*****************************************************************************
+ *
+ * @filepath    /tools/etx_fsm/etx_fsm.c
+ *
+ * @project     evrs tools
+ *
+ * @brief       checks the app state machine table of etx_fsm.c on a host.
+ *
+ *              Errors, exit with 1:
+ *              - a guard, action or next state out of range
+ *              - a row after an unguarded one in the same cell, never taken
+ *              - a state not reachable from INIT, any guard may pass
+ *              - a state without an unguarded TIMEOUT and PWR row into
+ *                SLEEP, the device would never shut down, or never try
+ *                again a shutdown refused in SLEEP
+ *              - a row out of SLEEP other than RESET into INIT
+ *
+ *              Then prints the shortest path from INIT to every state, in
+ *              events and in queue hops, each state change is one message
+ *              through the app task queue on top of the event itself.
+ *              With -d the table is printed as a Graphviz graph instead.
+ *
+ * build        cc -O2 -std=gnu99 -I../../evrs_tx_cc2650etx_app/src
+ *                  -o etx_fsm etx_fsm.c ../../evrs_tx_cc2650etx_app/src/etx_fsm.c
+ *
+ * usage        ./etx_fsm -v
+ *              ./etx_fsm -d | dot -Tsvg -o etx_fsm.svg
+ *
+ * @date        18 Oct. 2026
+ *
+ * @author      Ziyi@outlook.com.au
+ *
+ ****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "etx_fsm.h"
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static const char *stateNames[APP_STATES] = {
+	"INIT", "IDLE", "ACTIVE", "SLEEP", "QUIZ", "SUBMIT"
+};
+
+static const char *eventNames[ETX_FSM_EVTS] = {
+	"START", "NUM", "OK", "PWR", "TIMEOUT", "RESET", "COLLECTED", "QUIZ",
+	"QUIZ_END"
+};
+
+static const char *guardNames[ETX_FSM_GUARDS] = {
+	"", "RESUMED", "BS_SET", "LOCKED", "ANSWER", "ANSWERED", "IN_QUIZ",
+	"SUBMITTED", "INPUT_LOCKED", "QUIZ_ANSWER", "QUIZ_DONE"
+};
+
+static const char *actionNames[ETX_FSM_ACTIONS] = {
+	"", "SET_BS", "JOIN", "LOCKED", "ANSWER", "VOTE", "COLLECTED",
+	"QUIZ_START", "QUIZ_ANSWER", "QUIZ_NEXT", "QUIZ_SUBMIT", "QUIZ_END"
+};
+
+static int errors = 0;
+
+/*****************************************************************************
+ * @TAG Checks
+ */
+static void Fsm_error(uint8_t state, uint8_t event, const char *pMsg) {
+	printf("error: %s x %s: %s\n",
+			(state < APP_STATES) ? stateNames[state] : "?",
+			(event < ETX_FSM_EVTS) ? eventNames[event] : "-", pMsg);
+	errors++;
+}
+
+/** ranges and dead rows **/
+static void Fsm_checkRows(void) {
+	uint8_t state, event, i;
+
+	for (state = 0; state < APP_STATES; state++) {
+		for (event = 0; event < ETX_FSM_EVTS; event++) {
+			const EtxFsmCell_t *pCell = &ETX_Fsm_table[state][event];
+			bool isCovered = false;
+
+			if (pCell->numRows > ETX_FSM_CELL_ROWS) {
+				Fsm_error(state, event, "too many rows");
+				continue;
+			}
+			if ((state == APP_STATE_SLEEP) && (pCell->numRows != 0)) {
+				uint8_t next = (event == ETX_FSM_EVT_RESET) ?
+						APP_STATE_INIT : APP_STATE_SLEEP;
+
+				for (i = 0; i < pCell->numRows; i++) {
+					if ((i < ETX_FSM_CELL_ROWS)
+							&& (pCell->rows[i].next != next))
+						Fsm_error(state, event, "row out of SLEEP");
+				}
+			}
+
+			for (i = 0; i < pCell->numRows; i++) {
+				const EtxFsmRow_t *pRow = &pCell->rows[i];
+
+				if (pRow->guard >= ETX_FSM_GUARDS)
+					Fsm_error(state, event, "bad guard");
+				if (pRow->action >= ETX_FSM_ACTIONS)
+					Fsm_error(state, event, "bad action");
+				if ((pRow->next >= APP_STATES) && (pRow->next != ETX_FSM_STAY))
+					Fsm_error(state, event, "bad next state");
+				if (isCovered)
+					Fsm_error(state, event, "row never taken");
+				if (pRow->guard == ETX_FSM_G_NONE)
+					isCovered = true;
+			}
+		}
+	}
+}
+
+/** an unguarded row of the event into SLEEP **/
+static bool Fsm_sleeps(uint8_t state, uint8_t event) {
+	const EtxFsmCell_t *pCell = &ETX_Fsm_table[state][event];
+	uint8_t i;
+
+	for (i = 0; (i < pCell->numRows) && (i < ETX_FSM_CELL_ROWS); i++) {
+		if (pCell->rows[i].guard == ETX_FSM_G_NONE)
+			return (pCell->rows[i].next == APP_STATE_SLEEP);
+	}
+	return false;
+}
+
+static void Fsm_checkSleep(void) {
+	uint8_t state;
+
+	for (state = 0; state < APP_STATES; state++) {
+		if (!Fsm_sleeps(state, ETX_FSM_EVT_TIMEOUT))
+			Fsm_error(state, ETX_FSM_EVT_TIMEOUT, "no shutdown");
+		if (!Fsm_sleeps(state, ETX_FSM_EVT_PWR))
+			Fsm_error(state, ETX_FSM_EVT_PWR, "no shutdown");
+	}
+}
+
+/*****************************************************************************
+ * @TAG Paths
+ */
+typedef struct FsmPath_t {
+	bool isReached;
+	int hops;				// state changes
+	uint8_t from;			// previous state
+	const EtxFsmRow_t *pRow;	// row taken from the previous state
+	uint8_t event;
+} FsmPath_t;
+
+/*********************************************************************
+ * @fn      Fsm_paths
+ *
+ * @brief   Shortest paths from INIT, breadth first, any guard may pass.
+ *          Rows which keep the state are not steps of a path.
+ *
+ * @param   paths - per state
+ *
+ * @return  none
+ */
+static void Fsm_paths(FsmPath_t paths[APP_STATES]) {
+	uint8_t queue[APP_STATES];
+	int head = 0, tail = 0;
+
+	memset(paths, 0, sizeof(FsmPath_t) * APP_STATES);
+	paths[APP_STATE_INIT].isReached = true;
+	queue[tail++] = APP_STATE_INIT;
+
+	while (head < tail) {
+		uint8_t state = queue[head++];
+		uint8_t event, i;
+
+		for (event = 0; event < ETX_FSM_EVTS; event++) {
+			const EtxFsmCell_t *pCell = &ETX_Fsm_table[state][event];
+
+			for (i = 0; (i < pCell->numRows) && (i < ETX_FSM_CELL_ROWS); i++) {
+				const EtxFsmRow_t *pRow = &pCell->rows[i];
+
+				if ((pRow->next >= APP_STATES) || paths[pRow->next].isReached)
+					continue;
+				paths[pRow->next].isReached = true;
+				paths[pRow->next].hops = paths[state].hops + 1;
+				paths[pRow->next].from = state;
+				paths[pRow->next].pRow = pRow;
+				paths[pRow->next].event = event;
+				queue[tail++] = pRow->next;
+			}
+		}
+	}
+}
+
+static void Fsm_printStep(const FsmPath_t paths[APP_STATES], uint8_t state) {
+	const FsmPath_t *pPath = &paths[state];
+
+	if (state == APP_STATE_INIT)
+		return;
+	Fsm_printStep(paths, pPath->from);
+	printf(" %s", eventNames[pPath->event]);
+	if ((pPath->pRow->guard != ETX_FSM_G_NONE)
+			&& (pPath->pRow->guard < ETX_FSM_GUARDS))
+		printf("[%s]", guardNames[pPath->pRow->guard]);
+	printf(" -> %s", stateNames[state]);
+}
+
+static void Fsm_printPaths(const FsmPath_t paths[APP_STATES]) {
+	uint8_t state;
+
+	printf("state     events  msgs  path\n");
+	for (state = 0; state < APP_STATES; state++) {
+		if (!paths[state].isReached) {
+			Fsm_error(state, 0xFF, "not reachable from INIT");
+			continue;
+		}
+		// every step is the event plus the queued state change
+		printf("%-9s %6d %5d  INIT", stateNames[state], paths[state].hops,
+				2 * paths[state].hops);
+		Fsm_printStep(paths, state);
+		printf("\n");
+	}
+}
+
+/*****************************************************************************
+ * @TAG Output
+ */
+static void Fsm_printTable(void) {
+	uint8_t state, event, i;
+
+	printf("state     event      guard        action      next\n");
+	for (state = 0; state < APP_STATES; state++) {
+		for (event = 0; event < ETX_FSM_EVTS; event++) {
+			const EtxFsmCell_t *pCell = &ETX_Fsm_table[state][event];
+
+			for (i = 0; (i < pCell->numRows) && (i < ETX_FSM_CELL_ROWS); i++) {
+				const EtxFsmRow_t *pRow = &pCell->rows[i];
+
+				printf("%-9s %-10s %-12s %-11s %s\n", stateNames[state],
+						eventNames[event],
+						(pRow->guard < ETX_FSM_GUARDS) ?
+								guardNames[pRow->guard] : "?",
+						(pRow->action < ETX_FSM_ACTIONS) ?
+								actionNames[pRow->action] : "?",
+						(pRow->next == ETX_FSM_STAY) ? "-" :
+						(pRow->next < APP_STATES) ?
+								stateNames[pRow->next] : "?");
+			}
+		}
+	}
+	printf("\n");
+}
+
+static void Fsm_printDot(void) {
+	uint8_t state, event, i;
+
+	printf("digraph etx_fsm {\n");
+	printf("\trankdir=LR;\n");
+	printf("\tnode [shape=box];\n");
+	for (state = 0; state < APP_STATES; state++) {
+		for (event = 0; event < ETX_FSM_EVTS; event++) {
+			const EtxFsmCell_t *pCell = &ETX_Fsm_table[state][event];
+
+			for (i = 0; (i < pCell->numRows) && (i < ETX_FSM_CELL_ROWS); i++) {
+				const EtxFsmRow_t *pRow = &pCell->rows[i];
+				uint8_t next = (pRow->next == ETX_FSM_STAY) ? state : pRow->next;
+
+				if ((next >= APP_STATES) || (pRow->guard >= ETX_FSM_GUARDS)
+						|| (pRow->action >= ETX_FSM_ACTIONS))
+					continue;
+				printf("\t%s -> %s [label=\"%s%s%s%s%s%s\"%s];\n",
+						stateNames[state], stateNames[next], eventNames[event],
+						(pRow->guard != ETX_FSM_G_NONE) ? " [" : "",
+						guardNames[pRow->guard],
+						(pRow->guard != ETX_FSM_G_NONE) ? "]" : "",
+						(pRow->action != ETX_FSM_A_NONE) ? " /" : "",
+						(pRow->action != ETX_FSM_A_NONE) ?
+								actionNames[pRow->action] : "",
+						(pRow->next == ETX_FSM_STAY) ? ", style=dashed" : "");
+			}
+		}
+	}
+	printf("}\n");
+}
+
+/*****************************************************************************
+ * @TAG Main
+ */
+int main(int argc, char **argv) {
+	FsmPath_t paths[APP_STATES];
+	bool isDot = false, isVerbose = false;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "dvh")) != -1) {
+		switch (opt) {
+			case 'd': isDot = true; break;
+			case 'v': isVerbose = true; break;
+			default:
+				printf("usage: etx_fsm [-d graphviz] [-v table]\n");
+				return (opt == 'h') ? 0 : 1;
+		}
+	}
+
+	if (isDot) {
+		Fsm_printDot();
+		return 0;
+	}
+
+	if (isVerbose)
+		Fsm_printTable();
+	Fsm_checkRows();
+	Fsm_checkSleep();
+	Fsm_paths(paths);
+	Fsm_printPaths(paths);
+	printf("%d errors\n", errors);
+
+	return (errors == 0) ? 0 : 1;
+}
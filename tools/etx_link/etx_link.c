@@ -0,0 +1,566 @@
+/*****************************************************************************
+ *
+ * @filepath    /tools/etx_link/etx_link.c
+ *
+ * @project     evrs tools
+ *
+ * @brief       checks the link rules of etx_link.c on a host.
+ *
+ *              Errors, exit with 1:
+ *              - a mode picked for what is known of the BS other than the
+ *                expected one
+ *              - the fallback not going DIRECTED, WHITELIST then OPEN with
+ *                the timeouts of etx_link.h, or not starting at OPEN when
+ *                the BS address is unknown
+ *              - a session record which doesn't survive a store and a
+ *                restore, or a bad or old layout one which passes
+ *              - a central let in or kept out by its address other than
+ *                expected, while a vote is pending and after it is
+ *                collected, before and after the BS address is learnt
+ *              - an AES-CMAC other than the examples of RFC 4493
+ *              - a beacon of another BS ID, session, key or with a bad tag
+ *                taken for ours, one whose counter didn't go up taken, or
+ *                one of ours turned down
+ *              - an ack beacon replayed taken, or one of ours turned down,
+ *                its short counter across a wrap included
+ *              - an ETXCMD_BIND of another BS ID or replayed taken, or one
+ *                of ours turned down
+ *
+ *              With -v the fallback timelines, the centrals let in and the
+ *              beacons taken are printed.
+ *
+ * build        cc -O2 -std=gnu99 -I../../evrs_tx_cc2650etx_app/src
+ *                  -o etx_link etx_link.c ../../evrs_tx_cc2650etx_app/src/etx_link.c
+ *                  ../../evrs_tx_cc2650etx_app/src/etx_proto.c
+ *                  ../../evrs_tx_cc2650etx_app/src/etx_aes.c
+ *
+ * usage        ./etx_link -v
+ *
+ * @date        18 Oct. 2026
+ *
+ * @author      Ziyi@outlook.com.au
+ *
+ ****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "etx_aes.h"
+#include "etx_link.h"
+#include "etx_proto.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Highest BS ID and answer, KEY_OK - 1 on the ETX
+#define LINK_MAX_ID			9
+
+// BS of the room and the one next door
+#define LINK_BS				3
+#define LINK_BS_NEXT		4
+#define LINK_SESSION		0x1234
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static const char *modeNames[] = {
+	"OFF", "DIRECTED", "WHITELIST", "OPEN"
+};
+
+// Beacon keys of the installation and of the one next door, the first
+// is the key of the examples of RFC 4493
+static const uint8_t linkKey[ETX_PROTO_KEY_LEN] = {
+	0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+	0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+static const uint8_t linkKeyNext[ETX_PROTO_KEY_LEN] = {
+	0x45, 0x54, 0x58, 0x42
+};
+
+static EtxAes_t aes, aesNext;
+static const EtxProtoKey_t key = { ETX_Aes_encrypt, &aes };
+static const EtxProtoKey_t keyNext = { ETX_Aes_encrypt, &aesNext };
+
+static bool isVerbose = false;
+static int errors = 0;
+
+/*****************************************************************************
+ * @TAG Checks
+ */
+static const char *Link_modeName(uint8_t mode) {
+	if (mode == ETX_ADV_ON)
+		return "ON";
+	return (mode <= ETX_ADV_OPEN) ? modeNames[mode] : "?";
+}
+
+static void Link_expect(bool isOk, const char *pCase) {
+	if (!isOk) {
+		printf("error: %s\n", pCase);
+		errors++;
+	}
+}
+
+/** mode picked for what is known of the BS and the links up **/
+static void Link_checkMode(void) {
+	static const struct {
+		uint8_t mode;
+		bool isAddrKnown;
+		uint8_t numLinks;
+		uint8_t expected;
+	} cases[] = {
+		{ ETX_ADV_ON,        false, 0, ETX_ADV_OPEN },
+		{ ETX_ADV_ON,        true,  0, ETX_ADV_DIRECTED },
+		{ ETX_ADV_ON,        true,  1, ETX_ADV_WHITELIST },
+		{ ETX_ADV_DIRECTED,  false, 0, ETX_ADV_OPEN },
+		{ ETX_ADV_DIRECTED,  true,  1, ETX_ADV_WHITELIST },
+		{ ETX_ADV_WHITELIST, false, 0, ETX_ADV_OPEN },
+		{ ETX_ADV_WHITELIST, true,  0, ETX_ADV_WHITELIST },
+		{ ETX_ADV_WHITELIST, true,  1, ETX_ADV_WHITELIST },
+		{ ETX_ADV_OPEN,      true,  0, ETX_ADV_OPEN },
+		{ ETX_ADV_OPEN,      false, 1, ETX_ADV_OPEN },
+		{ ETX_ADV_OFF,       true,  0, ETX_ADV_OFF },
+		{ 0x10,              true,  0, ETX_ADV_OFF },
+	};
+	uint8_t i;
+
+	for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		uint8_t mode = ETX_Link_advMode(cases[i].mode, cases[i].isAddrKnown,
+				cases[i].numLinks);
+
+		if (mode != cases[i].expected) {
+			printf("error: %s, address %s, %d links: %s, expected %s\n",
+					Link_modeName(cases[i].mode),
+					cases[i].isAddrKnown ? "known" : "unknown",
+					cases[i].numLinks, Link_modeName(mode),
+					Link_modeName(cases[i].expected));
+			errors++;
+		}
+	}
+}
+
+/*********************************************************************
+ * @fn      Link_fallback
+ *
+ * @brief   Run the advertising of one vote from ETX_ADV_ON with no BS
+ *          connecting, as the fallback clock of evrs_tx_main.c does.
+ *
+ * @param   isAddrKnown - BS address known
+ * @param   pModes - modes run, ETX_ADV_OFF terminated
+ * @param   pStarts - ms each mode starts at
+ *
+ * @return  none
+ */
+static void Link_fallback(bool isAddrKnown, uint8_t *pModes,
+		uint32_t *pStarts) {
+	uint8_t mode = ETX_Link_advMode(ETX_ADV_ON, isAddrKnown, 0);
+	uint32_t now = 0;
+	uint8_t n = 0;
+
+	while ((mode != ETX_ADV_OFF) && (n < ETX_ADV_OPEN)) {
+		uint32_t timeout;
+		uint8_t next = ETX_Link_advFallback(mode, &timeout);
+
+		pModes[n] = mode;
+		pStarts[n++] = now;
+		if (isVerbose)
+			printf("  %6u ms %s\n", now, Link_modeName(mode));
+		if (next == ETX_ADV_OFF)
+			break;
+		now += timeout;
+		mode = ETX_Link_advMode(next, isAddrKnown, 0);
+	}
+	pModes[n] = ETX_ADV_OFF;
+}
+
+static void Link_checkFallback(void) {
+	uint8_t modes[ETX_ADV_OPEN + 1];
+	uint32_t starts[ETX_ADV_OPEN + 1];
+
+	if (isVerbose)
+		printf("fallback, BS address known\n");
+	Link_fallback(true, modes, starts);
+	Link_expect((modes[0] == ETX_ADV_DIRECTED) && (starts[0] == 0),
+			"known address doesn't start DIRECTED");
+	Link_expect((modes[1] == ETX_ADV_WHITELIST)
+			&& (starts[1] == ETX_DIRECT_ADV_TIMEOUT),
+			"DIRECTED doesn't fall back to WHITELIST in time");
+	Link_expect((modes[2] == ETX_ADV_OPEN) && (starts[2]
+			== ETX_DIRECT_ADV_TIMEOUT + ETX_WHITELIST_ADV_TIMEOUT),
+			"WHITELIST doesn't fall back to OPEN in time");
+	Link_expect(modes[3] == ETX_ADV_OFF, "OPEN falls back");
+
+	if (isVerbose)
+		printf("fallback, BS address unknown\n");
+	Link_fallback(false, modes, starts);
+	Link_expect((modes[0] == ETX_ADV_OPEN) && (modes[1] == ETX_ADV_OFF),
+			"unknown address doesn't go straight to OPEN");
+}
+
+/*****************************************************************************
+ * @TAG Session record
+ */
+static void Link_checkSession(void) {
+	static const uint8_t addr[ETX_LINK_ADDR_LEN] = {
+		0x11, 0x22, 0x33, 0x44, 0x55, 0x66
+	};
+	EtxSession_t rec, nv;
+	uint8_t old[12];
+
+	// store and restore
+	ETX_Link_sessionInit(&rec);
+	Link_expect(!ETX_Link_sessionCheck(&rec, LINK_MAX_ID),
+			"empty session passes");
+	rec.destBSID = 3;
+	rec.voteSeq = 17;
+	rec.token = 0xBEEF;
+	rec.bsAddrType = 0;
+	memcpy(rec.bsAddr, addr, sizeof(addr));
+	rec.question = 5;
+	rec.answer = 2;
+	memcpy(&nv, &rec, sizeof(nv));
+	Link_expect(ETX_Link_sessionCheck(&nv, LINK_MAX_ID)
+			&& (memcmp(&nv, &rec, sizeof(nv)) == 0),
+			"session not restored");
+	Link_expect(ETX_Link_advMode(ETX_ADV_ON,
+			nv.bsAddrType != ETX_LINK_ADDR_UNKNOWN, 0) == ETX_ADV_DIRECTED,
+			"restored session doesn't advertise DIRECTED");
+
+	// restored without the BS address, it is learnt again
+	nv.bsAddrType = ETX_LINK_ADDR_UNKNOWN;
+	Link_expect(ETX_Link_sessionCheck(&nv, LINK_MAX_ID)
+			&& (ETX_Link_advMode(ETX_ADV_ON,
+					nv.bsAddrType != ETX_LINK_ADDR_UNKNOWN, 0)
+					== ETX_ADV_OPEN),
+			"session without address doesn't advertise OPEN");
+
+	// bad values
+	memcpy(&nv, &rec, sizeof(nv));
+	nv.destBSID = 0;
+	Link_expect(!ETX_Link_sessionCheck(&nv, LINK_MAX_ID), "BS 0 passes");
+	nv.destBSID = LINK_MAX_ID + 1;
+	Link_expect(!ETX_Link_sessionCheck(&nv, LINK_MAX_ID), "BS 10 passes");
+	memcpy(&nv, &rec, sizeof(nv));
+	nv.answer = LINK_MAX_ID + 1;
+	Link_expect(!ETX_Link_sessionCheck(&nv, LINK_MAX_ID), "answer 10 passes");
+
+	// another layout
+	memcpy(&nv, &rec, sizeof(nv));
+	nv.version++;
+	Link_expect(!ETX_Link_sessionCheck(&nv, LINK_MAX_ID),
+			"next version passes");
+	memcpy(&nv, &rec, sizeof(nv));
+	nv.len--;
+	Link_expect(!ETX_Link_sessionCheck(&nv, LINK_MAX_ID),
+			"other length passes");
+
+	// the record before the header, [BS][seq][token][addr type][addr],
+	// read with the size of the current one, the rest is whatever follows
+	// in flash, for every BS ID
+	memset(old, 0xFF, sizeof(old));
+	old[1] = 17;
+	old[2] = 0xEF;
+	old[3] = 0xBE;
+	old[4] = 0;
+	memcpy(&old[5], addr, sizeof(addr));
+	for (old[0] = 1; old[0] <= LINK_MAX_ID; old[0]++) {
+		memset(&nv, 0xFF, sizeof(nv));
+		memcpy(&nv, old, sizeof(old) < sizeof(nv) ? sizeof(old) : sizeof(nv));
+		if (ETX_Link_sessionCheck(&nv, LINK_MAX_ID)) {
+			printf("error: old session of BS %d passes\n", old[0]);
+			errors++;
+		}
+	}
+}
+
+/*****************************************************************************
+ * @TAG Base station
+ */
+typedef struct LinkCentral_t {
+	const char *pName;
+	uint8_t addrType;
+	uint8_t addr[ETX_LINK_ADDR_LEN];
+} LinkCentral_t;
+
+static const LinkCentral_t centrals[] = {
+	{ "BS",           0, { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06 } },
+	{ "BS next door", 0, { 0x11, 0x12, 0x13, 0x14, 0x15, 0x16 } },
+	{ "BS random",    1, { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06 } },
+};
+
+/** who may connect in a mode, expected as a bit per central **/
+static void Link_accept(const char *pPhase, uint8_t mode, bool isAddrKnown,
+		uint8_t expected) {
+	uint8_t addrType = isAddrKnown ? centrals[0].addrType
+			: ETX_LINK_ADDR_UNKNOWN;
+	uint8_t i;
+
+	for (i = 0; i < sizeof(centrals) / sizeof(centrals[0]); i++) {
+		bool isAccepted = ETX_Link_isAccepted(mode, addrType, centrals[0].addr,
+				centrals[i].addrType, centrals[i].addr);
+
+		if (isVerbose)
+			printf("  %-24s %-9s %-12s %s\n", pPhase, Link_modeName(mode),
+					centrals[i].pName, isAccepted ? "accepted" : "rejected");
+		if (isAccepted != ((expected >> i) & 1)) {
+			printf("error: %s, %s: %s %s\n", pPhase, Link_modeName(mode),
+					centrals[i].pName, isAccepted ? "accepted" : "rejected");
+			errors++;
+		}
+	}
+}
+
+/*********************************************************************
+ * @fn      Link_checkAccept
+ *
+ * @brief   Two votes to the BS of the room with the BS next door in
+ *          range. The first one goes out before the BS address is known,
+ *          its collection teaches it, the second one runs through the
+ *          fallback. Advertising is off once a vote is collected.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void Link_checkAccept(void) {
+	uint8_t mode;
+
+	if (isVerbose)
+		printf("connections\n");
+
+	// the first vote, anyone may connect, the BS which reads it is learnt
+	mode = ETX_Link_advMode(ETX_ADV_ON, false, 0);
+	Link_accept("pending, address unknown", mode, false, 0x07);
+	Link_accept("collected", ETX_ADV_OFF, true, 0x00);
+
+	// the next vote, only the BS until the fallback opens up
+	mode = ETX_Link_advMode(ETX_ADV_ON, true, 0);
+	Link_accept("pending", mode, true, 0x01);
+	mode = ETX_Link_advMode(ETX_Link_advFallback(mode, &(uint32_t) { 0 }),
+			true, 0);
+	Link_accept("pending", mode, true, 0x01);
+	Link_accept("pending, link up", ETX_Link_advMode(ETX_ADV_ON, true, 1),
+			true, 0x01);
+	mode = ETX_Link_advMode(ETX_Link_advFallback(mode, &(uint32_t) { 0 }),
+			true, 0);
+	Link_accept("pending", mode, true, 0x07);
+	Link_accept("collected", ETX_ADV_OFF, true, 0x00);
+}
+
+/** AES-CMAC against the examples of RFC 4493, 0, 16 and 40 bytes **/
+static void Link_checkCmac(void) {
+	static const uint8_t msg[40] = {
+		0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+		0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+		0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c,
+		0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+		0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11
+	};
+	static const struct {
+		uint8_t len;
+		uint8_t mac[ETX_PROTO_AES_LEN];
+	} cases[] = {
+		{ 0, { 0xbb, 0x1d, 0x69, 0x29, 0xe9, 0x59, 0x37, 0x28,
+				0x7f, 0xa3, 0x7d, 0x12, 0x9b, 0x75, 0x67, 0x46 } },
+		{ 16, { 0x07, 0x0a, 0x16, 0xb4, 0x6b, 0x4d, 0x41, 0x44,
+				0xf7, 0x9b, 0xdd, 0x9d, 0xd0, 0x4a, 0x28, 0x7c } },
+		{ 40, { 0xdf, 0xa6, 0x67, 0x47, 0xde, 0x9a, 0xe6, 0x30,
+				0x30, 0xca, 0x32, 0x61, 0x14, 0x97, 0xc8, 0x27 } },
+	};
+	uint8_t i;
+
+	for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		uint8_t mac[ETX_PROTO_AES_LEN];
+
+		if (!ETX_Proto_cmac(&key, msg, cases[i].len, mac)
+				|| (memcmp(mac, cases[i].mac, sizeof(mac)) != 0)) {
+			printf("error: cmac of %d bytes\n", cases[i].len);
+			errors++;
+		}
+	}
+}
+
+/** beacon of a BS with its counter and tag **/
+static void Link_putBeacon(uint8_t *pBeacon, uint8_t bsID, uint16_t session,
+		uint32_t count, const EtxProtoKey_t *pKey) {
+	memset(pBeacon, 0, ETX_BEACON_LEN);
+	pBeacon[0] = bsID;
+	pBeacon[1] = (uint8_t) session;
+	pBeacon[2] = (uint8_t) (session >> 8);
+	pBeacon[ETX_BEACON_COUNT_POS] = (uint8_t) count;
+	pBeacon[ETX_BEACON_COUNT_POS + 1] = (uint8_t) (count >> 8);
+	pBeacon[ETX_BEACON_COUNT_POS + 2] = (uint8_t) (count >> 16);
+	pBeacon[ETX_BEACON_COUNT_POS + 3] = (uint8_t) (count >> 24);
+	(void) ETX_Proto_tag(pBeacon, ETX_BEACON_TAG_POS, count, pKey,
+			&pBeacon[ETX_BEACON_TAG_POS]);
+}
+
+/** ack beacon of a BS, the low bytes of the counter, tagged with all **/
+static void Link_putAck(uint8_t *pAck, uint8_t bsID, uint16_t session,
+		uint32_t count) {
+	memset(pAck, 0, ETX_ACK_LEN);
+	pAck[0] = bsID;
+	pAck[1] = (uint8_t) session;
+	pAck[2] = (uint8_t) (session >> 8);
+	pAck[ETX_ACK_COUNT_POS] = (uint8_t) count;
+	pAck[ETX_ACK_COUNT_POS + 1] = (uint8_t) (count >> 8);
+	(void) ETX_Proto_tag(pAck, ETX_ACK_TAG_POS, count, &key,
+			&pAck[ETX_ACK_TAG_POS]);
+}
+
+/** value of an ETXCMD_BIND, tagged like a beacon **/
+static void Link_putBind(uint8_t *pBind, uint8_t bsID, uint16_t session,
+		uint32_t count) {
+	pBind[0] = bsID;
+	pBind[1] = (uint8_t) session;
+	pBind[2] = (uint8_t) (session >> 8);
+	pBind[ETXCMD_BIND_COUNT_POS] = (uint8_t) count;
+	pBind[ETXCMD_BIND_COUNT_POS + 1] = (uint8_t) (count >> 8);
+	pBind[ETXCMD_BIND_COUNT_POS + 2] = (uint8_t) (count >> 16);
+	pBind[ETXCMD_BIND_COUNT_POS + 3] = (uint8_t) (count >> 24);
+	(void) ETX_Proto_tag(pBind, ETXCMD_BIND_TAG_POS, count, &key,
+			&pBind[ETXCMD_BIND_TAG_POS]);
+}
+
+/** anything checked by ETX_Link_beacon **/
+static void Link_tagged(const char *pCase, const uint8_t *pBeacon,
+		uint8_t countPos, uint8_t tagPos, uint16_t *pToken, uint32_t *pCount,
+		uint8_t expected) {
+	uint8_t result = ETX_Link_beacon(pBeacon, countPos, tagPos, &key, LINK_BS,
+			pToken, pCount);
+
+	if (isVerbose)
+		printf("  %-30s %d, session 0x%04x, count %u\n", pCase, result,
+				*pToken, *pCount);
+	if (result != expected) {
+		printf("error: beacon %s: %d, expected %d\n", pCase, result, expected);
+		errors++;
+	}
+}
+
+/** a beacon, or an ack beacon if isAck **/
+static void Link_beacon(const char *pCase, const uint8_t *pBeacon,
+		bool isAck, uint16_t *pToken, uint32_t *pCount, uint8_t expected) {
+	Link_tagged(pCase, pBeacon,
+			isAck ? ETX_ACK_COUNT_POS : ETX_BEACON_COUNT_POS,
+			isAck ? ETX_ACK_TAG_POS : ETX_BEACON_TAG_POS, pToken, pCount,
+			expected);
+}
+
+/** the vote state doesn't matter to the beacons, both run the same **/
+static void Link_checkBeacon(void) {
+	uint8_t ours[ETX_BEACON_LEN], next[ETX_BEACON_LEN];
+	uint8_t other[ETX_BEACON_LEN], bad[ETX_BEACON_LEN];
+	uint8_t later[ETX_BEACON_LEN], forged[ETX_BEACON_LEN];
+	uint8_t earlier[ETX_BEACON_LEN], otherKey[ETX_BEACON_LEN];
+	uint8_t ack[ETX_ACK_LEN];
+	uint8_t bind[ETXCMD_BIND_LEN];
+	uint16_t token = 0;
+	uint32_t count = 0;
+
+	if (isVerbose)
+		printf("beacons\n");
+	Link_putBeacon(ours, LINK_BS, LINK_SESSION, 100, &key);
+	Link_putBeacon(later, LINK_BS, LINK_SESSION, 101, &key);
+	Link_putBeacon(earlier, LINK_BS, LINK_SESSION, 50, &key);
+	Link_putBeacon(next, LINK_BS_NEXT, LINK_SESSION + 1, 200, &key);
+	Link_putBeacon(other, LINK_BS, LINK_SESSION + 2, 200, &key);
+	Link_putBeacon(otherKey, LINK_BS, LINK_SESSION, 200, &keyNext);
+	Link_putBeacon(bad, LINK_BS, LINK_SESSION, 103, &key);
+	bad[3] ^= 0x01;
+	// a replay with the counter moved on, the tag is the one of count 100
+	memcpy(forged, ours, sizeof(forged));
+	forged[ETX_BEACON_COUNT_POS] = 102;
+
+	// before the session is known, another BS doesn't hand it out
+	Link_beacon("next door, not joined", next, false, &token, &count,
+			ETX_LINK_BEACON_OTHER_BS);
+	Link_beacon("bad tag, not joined", bad, false, &token, &count,
+			ETX_LINK_BEACON_BAD_TAG);
+	Link_beacon("other key, not joined", otherKey, false, &token, &count,
+			ETX_LINK_BEACON_BAD_TAG);
+	Link_expect(token == 0, "session taken from a bad beacon");
+	Link_beacon("ours, joins", ours, false, &token, &count,
+			ETX_LINK_BEACON_JOINED);
+	Link_expect(token == LINK_SESSION, "session not taken");
+	Link_expect(count == 100, "counter not taken");
+
+	// vote pending, then collected
+	Link_beacon("ours, again", ours, false, &token, &count,
+			ETX_LINK_BEACON_REPLAYED);
+	Link_beacon("ours, later", later, false, &token, &count,
+			ETX_LINK_BEACON_OK);
+	Link_beacon("ours, earlier", earlier, false, &token, &count,
+			ETX_LINK_BEACON_REPLAYED);
+	Link_beacon("counter moved on", forged, false, &token, &count,
+			ETX_LINK_BEACON_BAD_TAG);
+	Link_beacon("next door", next, false, &token, &count,
+			ETX_LINK_BEACON_OTHER_BS);
+	Link_beacon("our ID, other session", other, false, &token, &count,
+			ETX_LINK_BEACON_OTHER_SESSION);
+	Link_beacon("our ID, other key", otherKey, false, &token, &count,
+			ETX_LINK_BEACON_BAD_TAG);
+	Link_beacon("bad tag", bad, false, &token, &count,
+			ETX_LINK_BEACON_BAD_TAG);
+	Link_beacon("none", NULL, false, &token, &count, ETX_LINK_BEACON_OTHER_BS);
+	Link_expect(token == LINK_SESSION, "session changed");
+	Link_expect(count == 101, "counter taken from a beacon turned down");
+
+	// ack beacons carry the low 16 bits of the same counter
+	Link_putAck(ack, LINK_BS, LINK_SESSION, 102);
+	Link_beacon("ack", ack, true, &token, &count, ETX_LINK_BEACON_OK);
+	Link_beacon("ack, again", ack, true, &token, &count,
+			ETX_LINK_BEACON_BAD_TAG);
+	Link_expect(count == 102, "counter not taken from an ack");
+	Link_putBeacon(later, LINK_BS, LINK_SESSION, 0x1fffe, &key);
+	Link_beacon("ours, before a wrap", later, false, &token, &count,
+			ETX_LINK_BEACON_OK);
+	Link_putAck(ack, LINK_BS, LINK_SESSION, 0x20001);
+	Link_beacon("ack, across the wrap", ack, true, &token, &count,
+			ETX_LINK_BEACON_OK);
+	Link_expect(count == 0x20001, "counter lost across a wrap");
+
+	// the first contact of a BS, its address is learnt from the link
+	Link_putBind(bind, LINK_BS_NEXT, LINK_SESSION, 0x20002);
+	Link_tagged("bind, next door", bind, ETXCMD_BIND_COUNT_POS,
+			ETXCMD_BIND_TAG_POS, &token, &count, ETX_LINK_BEACON_OTHER_BS);
+	Link_putBind(bind, LINK_BS, LINK_SESSION, 0x20002);
+	Link_tagged("bind", bind, ETXCMD_BIND_COUNT_POS, ETXCMD_BIND_TAG_POS,
+			&token, &count, ETX_LINK_BEACON_OK);
+	Link_tagged("bind, again", bind, ETXCMD_BIND_COUNT_POS,
+			ETXCMD_BIND_TAG_POS, &token, &count, ETX_LINK_BEACON_REPLAYED);
+	Link_expect(count == 0x20002, "counter not taken from a bind");
+}
+
+/*****************************************************************************
+ * @TAG Main
+ */
+int main(int argc, char **argv) {
+	int opt;
+
+	while ((opt = getopt(argc, argv, "vh")) != -1) {
+		switch (opt) {
+			case 'v': isVerbose = true; break;
+			default:
+				printf("usage: etx_link [-v timeline]\n");
+				return (opt == 'h') ? 0 : 1;
+		}
+	}
+
+	ETX_Aes_init(&aes, linkKey);
+	ETX_Aes_init(&aesNext, linkKeyNext);
+
+	Link_checkMode();
+	Link_checkFallback();
+	Link_checkSession();
+	Link_checkAccept();
+	Link_checkCmac();
+	Link_checkBeacon();
+	printf("%d errors\n", errors);
+
+	return (errors == 0) ? 0 : 1;
+}
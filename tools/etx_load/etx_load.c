@@ -0,0 +1,303 @@
+/*****************************************************************************
+ *
+ * @filepath    /tools/etx_load/etx_load.c
+ *
+ * @project     evrs tools
+ *
+ * @brief       checks the CPU load accounting of etx_load.c against a
+ *              synthetic load on a host.
+ *
+ *              A profile is a list of load%:seconds segments. Every period
+ *              of a segment is busy for its share of the period, with some
+ *              jitter, then idle for the rest, entering standby when the
+ *              idle time is long enough, the way the app task runs a
+ *              connection event. The idle and standby periods go to
+ *              etx_load.c in the order the idle task and the power manager
+ *              report them, and the loads are read once a second at the
+ *              start of a busy period, the way the diagnostics page is.
+ *
+ *              Every read is checked against the load of the timeline
+ *              itself, exact for the loads, within the slot boundaries for
+ *              the standby entries. The counter starts just before it wraps
+ *              around. Exits with 1 if a check fails.
+ *
+ * build        cc -O2 -std=gnu99 -I../../evrs_tx_cc2650etx_app/src
+ *                  -o etx_load etx_load.c ../../evrs_tx_cc2650etx_app/src/etx_load.c
+ *
+ * usage        ./etx_load -p 20:5,90:3,100:2,5:12 -P 10 -j 30 -v
+ *
+ * @date        18 Oct. 2026
+ *
+ * @author      Ziyi@outlook.com.au
+ *
+ ****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "etx_load.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define LD_MAX_SEGMENTS			32
+#define LD_MAX_SECONDS			3600
+
+// Standby, as the power policy does it (us)
+#define LD_STANDBY_MIN			1000	// shorter idle periods only WFI
+#define LD_STANDBY_ENTER		100		// policy entry to standby
+#define LD_STANDBY_EXIT			400		// standby to the end of the idle
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct LdSegment_t {
+	int load;				// %
+	int seconds;
+} LdSegment_t;
+
+typedef struct LdCfg_t {
+	uint32_t freq;			// counter, Hz
+	int period;				// ms
+	int jitter;				// % of the busy time
+	unsigned seed;
+	bool isVerbose;
+	LdSegment_t segments[LD_MAX_SEGMENTS];
+	int numSegments;
+} LdCfg_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+// The timeline, per second since the start
+static uint64_t busySec[LD_MAX_SECONDS];
+static uint32_t standbyCountSec[LD_MAX_SECONDS];
+static uint64_t standbySec[LD_MAX_SECONDS];
+
+static int failures = 0;
+
+/*****************************************************************************
+ * @TAG Timeline
+ */
+/** count busy time from an absolute time on, split over the seconds **/
+static void Ld_busy(const LdCfg_t *pCfg, uint64_t from, uint64_t len) {
+	while (len != 0) {
+		uint64_t sec = from / pCfg->freq;
+		uint64_t left = (sec + 1) * pCfg->freq - from;
+		uint64_t part = (len < left) ? len : left;
+
+		if (sec < LD_MAX_SECONDS)
+			busySec[sec] += part;
+		from += part;
+		len -= part;
+	}
+}
+
+static uint16_t Ld_permille(const LdCfg_t *pCfg, uint64_t busy, int seconds) {
+	uint64_t wall = (uint64_t) pCfg->freq * seconds;
+
+	return (uint16_t) (ETX_LOAD_FULL - ((wall - busy) * ETX_LOAD_FULL) / wall);
+}
+
+/*********************************************************************
+ * @fn      Ld_check
+ *
+ * @brief   Check a read after the given number of complete seconds.
+ *
+ * @param   pCfg - configuration
+ * @param   pStats - loads read
+ * @param   seconds - complete seconds
+ * @param   peak - highest expected load of a second so far
+ *
+ * @return  none
+ */
+static void Ld_check(const LdCfg_t *pCfg, const EtxLoadStats_t *pStats,
+		int seconds, uint16_t peak) {
+	int from = (seconds > ETX_LOAD_SLOTS) ? seconds - ETX_LOAD_SLOTS : 0;
+	uint64_t busy = 0, standby = 0;
+	uint32_t standbyCount = 0;
+	uint16_t load1s, load10s;
+	uint32_t standbyAvg = 0;
+	bool isOk;
+	int s;
+
+	for (s = from; s < seconds; s++) {
+		busy += busySec[s];
+		standby += standbySec[s];
+		standbyCount += standbyCountSec[s];
+	}
+	load1s = Ld_permille(pCfg, busySec[seconds - 1], 1);
+	load10s = Ld_permille(pCfg, busy, seconds - from);
+	if (standbyCount != 0)
+		standbyAvg = (uint32_t) ((standby * 1000000)
+				/ ((uint64_t) pCfg->freq * standbyCount));
+
+	// a standby which ends in the next second is counted in the one
+	// before, at each end of the window
+	isOk = (pStats->load1s == load1s) && (pStats->load10s == load10s)
+			&& (pStats->peak == peak)
+			&& (abs((int) pStats->standbyCount - (int) standbyCount) <= 2)
+			&& ((standbyCount == 0)
+					|| (abs((int) pStats->standbyAvg - (int) standbyAvg)
+							<= (int) standbyAvg / 20));
+	if (!isOk)
+		failures++;
+
+	if (pCfg->isVerbose || !isOk)
+		printf("%5d %6d %6d %7d %7d %6d %6d %8u %8u %8u %8u %s\n", seconds,
+				pStats->load1s, load1s, pStats->load10s, load10s,
+				pStats->peak, peak, pStats->standbyCount, standbyCount,
+				pStats->standbyAvg, standbyAvg, isOk ? "" : "FAIL");
+}
+
+/*********************************************************************
+ * @fn      Ld_run
+ *
+ * @brief   Run the profile through the accounting, checking every read.
+ *
+ * @param   pCfg - configuration
+ *
+ * @return  seconds checked
+ */
+static int Ld_run(const LdCfg_t *pCfg) {
+	EtxLoad_t load;
+	EtxLoadStats_t stats;
+	uint32_t start = 0xFFFFFFFF - 3 * pCfg->freq / 2;	// wraps in 1.5 s
+	uint64_t period = (uint64_t) pCfg->freq * pCfg->period / 1000;
+	uint64_t standbyMin = (uint64_t) pCfg->freq * LD_STANDBY_MIN / 1000000;
+	uint64_t enter = (uint64_t) pCfg->freq * LD_STANDBY_ENTER / 1000000;
+	uint64_t exitLen = (uint64_t) pCfg->freq * LD_STANDBY_EXIT / 1000000;
+	uint64_t now = 0;		// since the start
+	uint16_t peak = 0;
+	int checked = 0;
+	int lastRead = 0;
+	int seg;
+
+	ETX_Load_init(&load, pCfg->freq, start);
+	srand(pCfg->seed);
+
+	for (seg = 0; seg < pCfg->numSegments; seg++) {
+		uint64_t segEnd = now + (uint64_t) pCfg->freq
+				* pCfg->segments[seg].seconds;
+
+		while (now < segEnd) {
+			uint64_t len = (segEnd - now < period) ? segEnd - now : period;
+			int64_t busyLen = (int64_t) (len * pCfg->segments[seg].load / 100);
+			int seconds = (int) (now / pCfg->freq);
+
+			// the diagnostics page is read once a second, by a busy task
+			if (seconds > lastRead) {
+				int s;
+
+				for (s = lastRead; s < seconds; s++) {
+					uint16_t secLoad = Ld_permille(pCfg, busySec[s], 1);
+
+					if (secLoad > peak)
+						peak = secLoad;
+				}
+				ETX_Load_get(&load, start + (uint32_t) now, &stats);
+				Ld_check(pCfg, &stats, seconds, peak);
+				checked++;
+				lastRead = seconds;
+			}
+
+			if (pCfg->jitter != 0)
+				busyLen += busyLen * pCfg->jitter
+						* ((rand() % 2001) - 1000) / 100000;
+			if (busyLen < 0)
+				busyLen = 0;
+			if (busyLen > (int64_t) len)
+				busyLen = len;
+			Ld_busy(pCfg, now, busyLen);
+
+			if (len - busyLen != 0) {
+				uint64_t idleBegin = now + busyLen;
+				uint64_t idleEnd = now + len;
+
+				if (len - busyLen > standbyMin) {
+					uint64_t sbBegin = idleBegin + enter;
+					uint64_t sbEnd = idleEnd - exitLen;
+					uint64_t sec = sbEnd / pCfg->freq;
+
+					ETX_Load_standby(&load, start + (uint32_t) sbBegin,
+							start + (uint32_t) sbEnd);
+					if (sec < LD_MAX_SECONDS) {
+						standbyCountSec[sec]++;
+						standbySec[sec] += sbEnd - sbBegin;
+					}
+				}
+				ETX_Load_idle(&load, start + (uint32_t) idleBegin,
+						start + (uint32_t) idleEnd);
+			}
+			now += len;
+		}
+	}
+
+	return checked;
+}
+
+/*****************************************************************************
+ * @TAG Main
+ */
+static bool Ld_parseProfile(LdCfg_t *pCfg, char *pArg) {
+	char *pTok;
+	int total = 0;
+
+	pCfg->numSegments = 0;
+	for (pTok = strtok(pArg, ","); pTok != NULL; pTok = strtok(NULL, ",")) {
+		LdSegment_t *pSeg = &pCfg->segments[pCfg->numSegments];
+
+		if ((pCfg->numSegments >= LD_MAX_SEGMENTS)
+				|| (sscanf(pTok, "%d:%d", &pSeg->load, &pSeg->seconds) != 2)
+				|| (pSeg->load < 0) || (pSeg->load > 100)
+				|| (pSeg->seconds < 1))
+			return false;
+		total += pSeg->seconds;
+		pCfg->numSegments++;
+	}
+	return (pCfg->numSegments != 0) && (total < LD_MAX_SECONDS);
+}
+
+int main(int argc, char **argv) {
+	char defProfile[] = "20:5,90:3,100:2,5:12,60:15";
+	LdCfg_t cfg = { 65536, 10, 30, 1, false, { { 0 } }, 0 };
+	int opt, checked;
+
+	Ld_parseProfile(&cfg, defProfile);
+	while ((opt = getopt(argc, argv, "p:P:j:f:s:vh")) != -1) {
+		switch (opt) {
+			case 'p':
+				if (!Ld_parseProfile(&cfg, optarg)) {
+					fprintf(stderr, "bad profile %s\n", optarg);
+					return 1;
+				}
+			break;
+			case 'P': cfg.period = atoi(optarg); break;
+			case 'j': cfg.jitter = atoi(optarg); break;
+			case 'f': cfg.freq = strtoul(optarg, NULL, 0); break;
+			case 's': cfg.seed = strtoul(optarg, NULL, 0); break;
+			case 'v': cfg.isVerbose = true; break;
+			default:
+				printf("usage: etx_load [-p load%%:seconds,...] [-P period, ms]"
+						" [-j busy jitter, %%] [-f counter Hz] [-s seed] [-v]\n");
+				return (opt == 'h') ? 0 : 1;
+		}
+	}
+	if ((cfg.period < 1) || (cfg.freq < 1000) || (cfg.freq > 0x7FFFFFFF / 2)
+			|| (cfg.jitter < 0) || (cfg.jitter > 100))
+		return 1;
+
+	printf("    t load1s    exp load10s     exp   peak    exp  standby"
+			"      exp  avg, us      exp\n");
+	checked = Ld_run(&cfg);
+	printf("%d reads, %d failed\n", checked, failures);
+
+	return (failures == 0) ? 0 : 1;
+}
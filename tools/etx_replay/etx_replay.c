@@ -0,0 +1,479 @@
+/*****************************************************************************
+ *
+ * @filepath    /tools/etx_replay/etx_replay.c
+ *
+ * @project     evrs tools
+ *
+ * @brief       replays a message capture of the ETX app task on a host and
+ *              reports the time of every handler, on the target as
+ *              captured and on the host as replayed.
+ *
+ *              The capture is the UART output of a firmware built with
+ *              ETX_CAPTURE, taken after writing the dump page (0xFF) to the
+ *              diagnostics characteristic:
+ *
+ *                capture 3 records, 0 dropped, freq 65536
+ *                C 0001a2b4 00000003 02d000 0d0300...
+ *                ...
+ *                capture end
+ *
+ *              The records are fed in order, as often as asked, to the host
+ *              build of what their handlers do with etx_proto.c: the beacon
+ *              and ack reports of the scan, time sync, the vote lookup and
+ *              the app state they depend on. Messages without protocol work
+ *              on the host only show their target time. The host state
+ *              starts over on every pass, so every pass is the same.
+ *
+ *              The beacon tags are checked with the key of the
+ *              installation given with -k, 32 hex digits, as the device
+ *              checks them. Without it the beacons are ignored, as on a
+ *              device with no key provisioned.
+ *
+ * build        cc -O2 -std=gnu99 -I../../evrs_tx_cc2650etx_app/src
+ *                  -o etx_replay etx_replay.c ../../evrs_tx_cc2650etx_app/src/etx_proto.c
+ *                  ../../evrs_tx_cc2650etx_app/src/etx_link.c
+ *                  ../../evrs_tx_cc2650etx_app/src/etx_aes.c
+ *
+ * usage        ./etx_replay [-r passes] [-k key] [-b bsID] [-d devID] dump.txt
+ *
+ * @date        18 Oct. 2026
+ *
+ * @author      Ziyi@outlook.com.au
+ *
+ ****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "etx_aes.h"
+#include "etx_link.h"
+#include "etx_proto.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define RP_MAX_LINE				256
+#define RP_MAX_SUMMARY			64
+#define RP_MAX_HANDLERS			64
+
+// keep in step with etx_diag.h
+#define RP_CLASS_STACK_EVT		0x01
+#define RP_CLASS_STACK			0x02
+#define RP_CLASS_APP			0x03
+
+// BLE stack, bcomdef.h, gap.h and att.h of the SDK
+#define RP_HCI_GAP_EVENT_EVENT	0x91
+#define RP_GATT_MSG_EVENT		0xB0
+#define RP_GAP_MSG_EVENT		0xD0
+#define RP_GAP_DEVICE_INFO		0x0D
+#define RP_ADRPT_NONCONN_IND	0x03
+#define RP_ATT_MTU_UPDATED		0x7F
+
+// keep in step with evrs_tx_main.c
+#define RP_APP_STATE_CHG_EVT	0x20
+#define RP_APP_STATE_ACTIVE		2
+
+static const struct {
+	uint8_t event;
+	const char *pName;
+} appNames[] = {
+	{ 0x01, "app gap state" }, { 0x02, "app char change" },
+	{ 0x04, "app char enquire" }, { 0x10, "app key press" },
+	{ 0x20, "app state" }, { 0x40, "app inactivity" },
+	{ 0x80, "app adv fallback" }, { 0x09, "app scan" },
+	{ 0x0A, "app vote retry" }, { 0x0B, "app slot" }, { 0x0C, "app monitor" },
+	{ 0x0D, "app watchdog" }
+};
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct RpRec_t {
+	uint32_t time;
+	uint32_t duration;
+	uint8_t msgClass;
+	uint8_t event;
+	uint8_t status;
+	uint8_t len;
+	uint8_t summary[RP_MAX_SUMMARY];
+	int handler;
+} RpRec_t;
+
+typedef struct RpHandler_t {
+	char name[32];
+	uint32_t count;
+	uint64_t targetSum;
+	uint32_t targetMax;
+	uint64_t hostNs;
+} RpHandler_t;
+
+// What the handlers of the app keep between messages
+typedef struct RpState_t {
+	uint8_t bsID;
+	uint16_t sessionToken;
+	uint32_t beaconCount;
+	uint8_t questionNum;
+	bool isQuestionOpen;
+	bool isSlotted;
+	bool isActive;
+	uint8_t voteSeq;
+	uint8_t voteRetries;
+	uint16_t mtu;
+	EtxProtoTime_t bsTime;
+	uint32_t acked;
+	uint32_t missed;
+} RpState_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static RpRec_t *pRecs;
+static size_t numRecs;
+static RpHandler_t handlers[RP_MAX_HANDLERS];
+static int numHandlers;
+
+static EtxAes_t beaconAes;
+static const EtxProtoKey_t beaconKey = { ETX_Aes_encrypt, &beaconAes };
+static bool isBeaconKeySet = false;
+static int bsID = -1;
+static uint8_t devID[ETX_PROTO_DEVID_LEN];
+static uint32_t freq = 65536;
+
+/*****************************************************************************
+ * @TAG Capture
+ */
+static int Rp_handler(const RpRec_t *pRec) {
+	char name[32];
+	int i;
+
+	switch (pRec->msgClass) {
+		case RP_CLASS_STACK_EVT:
+			snprintf(name, sizeof(name), "stack event");
+		break;
+
+		case RP_CLASS_STACK:
+			if (pRec->event == RP_GATT_MSG_EVENT)
+				snprintf(name, sizeof(name), "gatt 0x%02x%s",
+						(pRec->len > 2) ? pRec->summary[2] : 0,
+						(pRec->status != 0) ? " pending" : "");
+			else if ((pRec->event == RP_GAP_MSG_EVENT) && (pRec->len > 1)
+					&& (pRec->summary[0] == RP_GAP_DEVICE_INFO))
+				snprintf(name, sizeof(name), "gap report 0x%02x",
+						pRec->summary[1]);
+			else if (pRec->event == RP_GAP_MSG_EVENT)
+				snprintf(name, sizeof(name), "gap 0x%02x",
+						(pRec->len > 0) ? pRec->summary[0] : 0);
+			else if (pRec->event == RP_HCI_GAP_EVENT_EVENT)
+				snprintf(name, sizeof(name), "hci 0x%02x", pRec->status);
+			else
+				snprintf(name, sizeof(name), "stack 0x%02x", pRec->event);
+		break;
+
+		default:
+			snprintf(name, sizeof(name), "app 0x%02x", pRec->event);
+			for (i = 0; i < (int) (sizeof(appNames) / sizeof(appNames[0]));
+					i++) {
+				if (appNames[i].event == pRec->event)
+					snprintf(name, sizeof(name), "%s", appNames[i].pName);
+			}
+		break;
+	}
+
+	for (i = 0; i < numHandlers; i++) {
+		if (strcmp(handlers[i].name, name) == 0)
+			return i;
+	}
+	if (numHandlers == RP_MAX_HANDLERS)
+		return RP_MAX_HANDLERS - 1;
+	strcpy(handlers[numHandlers].name, name);
+	return numHandlers++;
+}
+
+/** read the records of a capture, other lines are ignored **/
+static bool Rp_load(FILE *pIn) {
+	char line[RP_MAX_LINE];
+	size_t size = 0;
+
+	while (fgets(line, sizeof(line), pIn)) {
+		char *pStart = strstr(line, "capture ");
+		char *pRec = line + strspn(line, " \t\f\r");
+		char hex[2 * RP_MAX_SUMMARY + 2] = "";
+		unsigned int time, duration, head;
+		RpRec_t *pNew;
+		size_t i;
+
+		if ((pStart != NULL) && (strstr(pStart, "freq") != NULL)) {
+			sscanf(strstr(pStart, "freq"), "freq %u", &freq);
+			continue;
+		}
+		if ((strncmp(pRec, "C ", 2) != 0) || (sscanf(pRec, "C %8x %8x %6x %129s", &time,
+				&duration, &head, hex) < 3))
+			continue;
+
+		if (numRecs == size) {
+			size = size ? size * 2 : 256;
+			pRecs = realloc(pRecs, size * sizeof(RpRec_t));
+		}
+		pNew = &pRecs[numRecs++];
+		memset(pNew, 0, sizeof(RpRec_t));
+		pNew->time = time;
+		pNew->duration = duration;
+		pNew->msgClass = (uint8_t) (head >> 16);
+		pNew->event = (uint8_t) (head >> 8);
+		pNew->status = (uint8_t) head;
+		for (i = 0; (i < RP_MAX_SUMMARY) && hex[2 * i] && hex[2 * i + 1]; i++) {
+			unsigned int byte;
+			sscanf(&hex[2 * i], "%2x", &byte);
+			pNew->summary[i] = (uint8_t) byte;
+		}
+		pNew->len = (uint8_t) i;
+		pNew->handler = Rp_handler(pNew);
+	}
+	return numRecs > 0;
+}
+
+/*****************************************************************************
+ * @TAG Handlers
+ */
+/** ETX_Beacon_verify **/
+static bool Rp_verify(RpState_t *pState, const uint8_t *pBeacon,
+		uint8_t countPos, uint8_t tagPos) {
+	if (!isBeaconKeySet || (pBeacon == NULL) || (pBeacon[0] != pState->bsID))
+		return false;
+	return ETX_Link_beacon(pBeacon, countPos, tagPos, &beaconKey,
+			pState->bsID, &pState->sessionToken, &pState->beaconCount)
+			<= ETX_LINK_BEACON_JOINED;
+}
+
+/** ETX_Beacon_process and ETX_Ack_process on a scan report **/
+static void Rp_report(RpState_t *pState, const RpRec_t *pRec, uint32_t tick) {
+	const uint8_t *pData = &pRec->summary[11];
+	uint8_t dataLen = pRec->summary[10];
+	const uint8_t *pBeacon, *pAck;
+	int32_t error;
+
+	if ((pRec->len < 11) || (pRec->summary[1] != RP_ADRPT_NONCONN_IND))
+		return;
+	if (dataLen > pRec->len - 11)
+		dataLen = pRec->len - 11;
+
+	pBeacon = ETX_Proto_findAD(pData, dataLen, ETX_ADTYPE_BEACON,
+			ETX_BEACON_LEN);
+	if (Rp_verify(pState, pBeacon, ETX_BEACON_COUNT_POS, ETX_BEACON_TAG_POS)) {
+		pState->questionNum = pBeacon[3];
+		pState->isQuestionOpen = (pBeacon[4] & ETX_BEACON_FLAG_OPEN) != 0;
+		ETX_Proto_timeSync(&pState->bsTime, pBeacon[11] | (pBeacon[12] << 8)
+				| (pBeacon[13] << 16) | ((uint32_t) pBeacon[14] << 24), tick,
+				1000000 / freq, &error);
+		pState->isSlotted = (pBeacon[4] & ETX_BEACON_FLAG_SLOTTED)
+				&& (pBeacon[8] | pBeacon[9]) && pBeacon[10];
+		if (pState->isActive && pState->isSlotted)
+			(void) ETX_Proto_slot(devID, pBeacon[7],
+					pBeacon[8] | (pBeacon[9] << 8));
+	}
+
+	if (!pState->isActive)
+		return;
+	pAck = ETX_Proto_findAD(pData, dataLen, ETX_ADTYPE_ACK, ETX_ACK_LEN);
+	if (!Rp_verify(pState, pAck, ETX_ACK_COUNT_POS, ETX_ACK_TAG_POS))
+		return;
+	switch (ETX_Proto_ackCheck(pAck, devID, pState->voteSeq)) {
+		case ETX_PROTO_ACK_HIT:
+			pState->acked++;
+			pState->isActive = false;
+		break;
+
+		case ETX_PROTO_ACK_MISSED:
+			if (!pState->isSlotted)
+				(void) ETX_Proto_backoff(pState->voteRetries++, tick);
+			pState->missed++;
+		break;
+
+		default:
+		break;
+	}
+}
+
+/** the host side of one record **/
+static void Rp_handle(RpState_t *pState, const RpRec_t *pRec) {
+	switch (pRec->msgClass) {
+		case RP_CLASS_STACK:
+			if ((pRec->event == RP_GAP_MSG_EVENT) && (pRec->len > 0)
+					&& (pRec->summary[0] == RP_GAP_DEVICE_INFO))
+				Rp_report(pState, pRec, pRec->time);
+			else if ((pRec->event == RP_GATT_MSG_EVENT) && (pRec->len >= 5)
+					&& (pRec->summary[2] == RP_ATT_MTU_UPDATED))
+				pState->mtu = pRec->summary[3] | (pRec->summary[4] << 8);
+		break;
+
+		case RP_CLASS_APP:
+			if (pRec->event == RP_APP_STATE_CHG_EVT) {
+				pState->isActive = (pRec->status == RP_APP_STATE_ACTIVE);
+				if (pState->isActive) {
+					pState->voteSeq++;
+					pState->voteRetries = 0;
+				}
+			}
+		break;
+
+		default:
+		break;
+	}
+}
+
+static void Rp_reset(RpState_t *pState) {
+	size_t i;
+
+	memset(pState, 0, sizeof(RpState_t));
+	pState->mtu = 23;
+	if (bsID >= 0) {
+		pState->bsID = (uint8_t) bsID;
+		return;
+	}
+	// the BS of the first beacon in the capture
+	for (i = 0; i < numRecs; i++) {
+		const RpRec_t *pRec = &pRecs[i];
+		const uint8_t *pBeacon;
+
+		if ((pRec->msgClass != RP_CLASS_STACK)
+				|| (pRec->event != RP_GAP_MSG_EVENT) || (pRec->len < 11)
+				|| (pRec->summary[0] != RP_GAP_DEVICE_INFO))
+			continue;
+		pBeacon = ETX_Proto_findAD(&pRec->summary[11], pRec->len - 11,
+				ETX_ADTYPE_BEACON, ETX_BEACON_LEN);
+		if (pBeacon != NULL) {
+			pState->bsID = pBeacon[0];
+			return;
+		}
+	}
+}
+
+static uint64_t Rp_nowNs(void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+	return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/*****************************************************************************
+ * @TAG Main
+ */
+int main(int argc, char **argv) {
+	RpState_t state;
+	FILE *pIn;
+	int passes = 1000;
+	uint64_t overhead, busy = 0;
+	uint32_t span;
+	int opt, p, h;
+	size_t i;
+
+	while ((opt = getopt(argc, argv, "r:k:b:d:h")) != -1) {
+		switch (opt) {
+			case 'r': passes = atoi(optarg); break;
+			case 'k': {
+				uint8_t key[ETX_PROTO_KEY_LEN];
+				int j;
+
+				for (j = 0; j < ETX_PROTO_KEY_LEN; j++) {
+					unsigned int b;
+
+					if (sscanf(&optarg[2 * j], "%2x", &b) != 1)
+						break;
+					key[j] = (uint8_t) b;
+				}
+				if ((j != ETX_PROTO_KEY_LEN) || (optarg[2 * j] != 0)) {
+					fprintf(stderr, "the key is 32 hex digits\n");
+					return 1;
+				}
+				ETX_Aes_init(&beaconAes, key);
+				isBeaconKeySet = true;
+			}
+			break;
+			case 'b': bsID = (int) strtol(optarg, NULL, 0); break;
+			case 'd': {
+				uint32_t id = strtoul(optarg, NULL, 16);
+				devID[0] = (uint8_t) (id >> 24);
+				devID[1] = (uint8_t) (id >> 16);
+				devID[2] = (uint8_t) (id >> 8);
+				devID[3] = (uint8_t) id;
+			}
+			break;
+			default:
+				printf("usage: etx_replay [-r passes] [-k beacon key, hex] [-b bsID]"
+						" [-d devID, hex] [dump.txt]\n");
+				return (opt == 'h') ? 0 : 1;
+		}
+	}
+	if (passes < 1)
+		return 1;
+
+	pIn = (optind < argc) ? fopen(argv[optind], "r") : stdin;
+	if (pIn == NULL) {
+		perror(argv[optind]);
+		return 1;
+	}
+	if (!Rp_load(pIn)) {
+		fprintf(stderr, "no capture records\n");
+		return 1;
+	}
+	if (pIn != stdin)
+		fclose(pIn);
+
+	for (i = 0; i < numRecs; i++) {
+		RpHandler_t *pHandler = &handlers[pRecs[i].handler];
+
+		pHandler->count++;
+		pHandler->targetSum += pRecs[i].duration;
+		if (pRecs[i].duration > pHandler->targetMax)
+			pHandler->targetMax = pRecs[i].duration;
+		busy += pRecs[i].duration;
+	}
+
+	// the cost of reading the clock, taken off every call
+	overhead = Rp_nowNs();
+	for (i = 0; i < 100000; i++)
+		(void) Rp_nowNs();
+	overhead = (Rp_nowNs() - overhead) / 100000;
+
+	for (p = 0; p < passes; p++) {
+		Rp_reset(&state);
+		for (i = 0; i < numRecs; i++) {
+			uint64_t start = Rp_nowNs();
+			uint64_t ns;
+
+			Rp_handle(&state, &pRecs[i]);
+			ns = Rp_nowNs() - start;
+			handlers[pRecs[i].handler].hostNs += (ns > overhead) ?
+					ns - overhead : 0;
+		}
+	}
+
+	span = pRecs[numRecs - 1].time - pRecs[0].time;
+	printf("# %zu records over %.3f s, target busy %.2f%%, %d passes\n",
+			numRecs, (double) span / freq,
+			span ? 100.0 * busy / span : 0.0, passes);
+	printf("# replay: %u acked, %u missed, mtu %u\n", state.acked, state.missed,
+			state.mtu);
+	printf("# %-20s %7s %12s %12s %12s\n", "handler", "count", "target us",
+			"target max", "host ns");
+	for (h = 0; h < numHandlers; h++) {
+		RpHandler_t *pHandler = &handlers[h];
+
+		printf("  %-20s %7u %12.1f %12.1f %12.1f\n", pHandler->name,
+				pHandler->count,
+				1e6 * pHandler->targetSum / pHandler->count / freq,
+				1e6 * pHandler->targetMax / freq,
+				(double) pHandler->hostNs / pHandler->count / passes);
+	}
+
+	free(pRecs);
+	return 0;
+}
@@ -0,0 +1,1138 @@
+/*****************************************************************************
+ *
+ * @filepath    /tools/etx_sim/etx_sim.c
+ *
+ * @project     evrs tools
+ *
+ * @brief       discrete-event simulator of a classroom of ETX clickers and
+ *              one base station on the BLE advertising channels. The
+ *              protocol decisions (ack lookup, partitions, slots, back-off)
+ *              are made by the firmware's own etx_proto.c built for the host.
+ *
+ *              Model: every device presses once at a uniform random time in
+ *              the press window and advertises its vote on channels 37-39
+ *              every advertising interval plus the 0-10 ms BLE delay. Packets
+ *              overlapping on a channel are lost. The BS scans continuously,
+ *              one channel per scan interval, and is deaf while it sends a
+ *              beacon. Every ack period it sends an ack beacon for the next
+ *              partition. A device hears it only while its own scan window
+ *              is open on that channel. With a connection capacity, the BS
+ *              also connects to devices it heard, up to that many at a time,
+ *              and the read finishes the vote. In slotted mode the devices
+ *              are assumed synced to the frame beacons and only advertise in
+ *              their slot. With -C every point runs with random access
+ *              and then with the TDMA slots, and both tables are printed.
+ *
+ *              With -M there are several rooms in range of each other, each
+ *              with -n devices and a BS of its own, which connects to every
+ *              device it hears. A BS of another room finds the vote isn't
+ *              for it and leaves, the device has lost the time of the link.
+ *              Every point runs without the connection filter and then with
+ *              it. The devices are assumed to have learnt the address of
+ *              their BS from its beacons, so with the filter only it gets a
+ *              link, see ETX_Link_isAccepted. The ack beacons and TDMA slots
+ *              are off.
+ *
+ *              With -R the reconnect of one device to the BS it knows is
+ *              sampled instead, for directed advertising with the
+ *              firmware's fallback (etx_link.c) and for undirected
+ *              advertising. The other devices of the room only count as
+ *              background advertising which destroys the packets it
+ *              overlaps, and the BS scans a window of every scan interval.
+ *
+ *              The connection data channels, capture effect, interference
+ *              from other 2.4 GHz traffic and clock drift are not modelled.
+ *
+ * build        cc -O2 -std=gnu99 -pthread -I../../evrs_tx_cc2650etx_app/src
+ *                  -o etx_sim etx_sim.c ../../evrs_tx_cc2650etx_app/src/etx_proto.c
+ *                  ../../evrs_tx_cc2650etx_app/src/etx_link.c -lm
+ *
+ * usage        ./etx_sim -n 100,500,1000,2000 -r 8 -a 100 -k 500
+ *              ./etx_sim -n 100,300,1000 -w 0          random access, then
+ *              ./etx_sim -n 100,300,1000 -w 0 -S 100,10  TDMA slots, with
+ *                  every key pressed at once
+ *              ./etx_sim -n 100,300,1000 -w 0 -S 100,10 -C  both, one after
+ *                  the other
+ *              ./etx_sim -n 30,100 -M 3 -c 4 -k 0  three rooms, with and
+ *                  without the filter
+ *              ./etx_sim -n 1,100,300 -R 10000 -i 100 -W 30  reconnect
+ *                  latency to a BS scanning 30 ms of every 100 ms
+ *              ./etx_sim -h for all the settings
+ *
+ * @date        18 Oct. 2026
+ *
+ * @author      Ziyi@outlook.com.au
+ *
+ ****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "etx_proto.h"
+#include "etx_link.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define SIM_MAX_POINTS			32
+#define SIM_CHANNELS			3
+// Slots of -C without -S
+#define SIM_COMPARE_SLOTS		100
+
+// BLE 1M advertising packet with 31 bytes of AD, 47 bytes on air
+#define SIM_PKT_US				376
+// Time from one advertising channel to the next
+#define SIM_HOP_US				600
+// Random advertising delay added by the link layer
+#define SIM_ADV_DELAY_US		10000
+// High duty cycle directed advertising, ADV_DIRECT_IND is 22 bytes on air,
+// one on every channel every 3.75 ms, for at most 1.28 s
+#define SIM_HDC_PKT_US			176
+#define SIM_HDC_US				3750
+#define SIM_HDC_LIMIT_US		1280000
+// CONNECT_IND after T_IFS, 44 bytes on air
+#define SIM_CONNECT_US			(150 + 352)
+
+// Energy model, CC2650 at 3 V, 0 dBm
+#define SIM_VOLT				3.0
+#define SIM_TX_MA				6.1
+#define SIM_RX_MA				5.9
+#define SIM_WAKE_MA				3.0		// radio setup around an event
+#define SIM_WAKE_US				1000
+#define SIM_CONN_US				3000	// radio on time of a vote read
+#define SIM_SLEEP_UA			1.0
+
+// Events
+enum {
+	EVT_PRESS,
+	EVT_ADV,
+	EVT_PKT_START,
+	EVT_PKT_END,
+	EVT_SCAN_START,
+	EVT_SCAN_END,
+	EVT_BACKOFF_END,
+	EVT_CONN_END,
+	EVT_ACK,
+	EVT_FRAME
+};
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// Settings, all times in ms
+typedef struct SimCfg_t {
+	int points[SIM_MAX_POINTS];		// device counts to run
+	int numPoints;
+	int runs;
+	int threads;
+	int advInterval;
+	int pressWindow;
+	int tail;					// run on after the press window
+	int bsScanInterval;
+	int bsScanWindow;			// 0 for the whole interval
+	int ackPeriod;
+	int partitions;				// 0 for one per 16 devices
+	int hashes;
+	int scanPeriod;
+	int scanDuration;
+	int connCapacity;			// 0 for acks only
+	int connTime;
+	int slots;					// 0 for no TDMA
+	int slotLen;
+	bool isCompare;				// random access, then the slots
+	int reconnects;				// reconnects sampled, 0 for the room
+	int rooms;					// BSs, 1 for one room
+	bool isFilter;				// only the BS of the room may connect
+	uint64_t seed;
+} SimCfg_t;
+
+typedef struct SimEvt_t {
+	int64_t t;					// us
+	uint32_t idx;
+	uint32_t seq;
+	uint8_t type;
+	uint8_t ch;
+} SimEvt_t;
+
+typedef struct SimDev_t {
+	uint8_t devID[ETX_PROTO_DEVID_LEN];
+	uint8_t partition;
+	uint8_t retries;
+	bool isPressed;
+	bool isDone;
+	bool isInConn;
+	bool isBackoff;
+	bool isScanning;
+	uint8_t scanCh;
+	uint16_t room;				// the BS of the vote
+	uint16_t strays;			// links of BSs of other rooms
+	uint32_t advSeq;			// stale advertising events are dropped
+	int64_t slotEnd;
+	int64_t pressAt;
+	int64_t collectedAt;		// heard by the BS, -1 if not
+	int64_t doneAt;				// stopped, -1 if not
+	double energy;				// uJ, radio only
+} SimDev_t;
+
+// Packet in flight on a channel, sender n is the BS
+typedef struct SimPkt_t {
+	uint32_t sender;
+	int64_t start;
+	bool isCollided;
+} SimPkt_t;
+
+typedef struct SimChan_t {
+	SimPkt_t *pActive;
+	int numActive;
+	int maxActive;
+	int64_t busyUs;
+} SimChan_t;
+
+// Result of a run or the mean of several
+typedef struct SimResult_t {
+	double collected;			// fraction
+	double t95, t100;			// ms from the start
+	double p50, p90, p99;		// press to BS, ms
+	double done99;				// press to device stopped, ms
+	double airtime;				// offered load, fraction, mean of the channels
+	double collisions;			// fraction of the vote packets
+	double energy;				// mean uJ per device
+	double strays;				// mean links of BSs of other rooms per device
+} SimResult_t;
+
+typedef struct Sim_t {
+	const SimCfg_t *pCfg;
+	int n;
+	uint64_t rng;
+	SimEvt_t *pHeap;
+	size_t heapLen;
+	size_t heapSize;
+	SimDev_t *pDev;
+	uint32_t **ppPart;			// devices of each partition
+	uint32_t *pPartLen;
+	int partitions;
+	SimChan_t chan[SIM_CHANNELS];
+	int64_t bsTxStart, bsTxEnd;
+	int *pConns;				// links of every BS
+	int64_t *pPhase;			// scan schedule of every BS
+	uint8_t ack[ETX_ACK_LEN];
+	uint8_t ackPart;
+	uint8_t frame;
+	uint64_t votePkts, votePktsLost;
+} Sim_t;
+
+typedef struct SimJob_t {
+	const SimCfg_t *pCfg;
+	int n;
+	int run;
+	SimResult_t result;
+} SimJob_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static SimJob_t *pJobs;
+static int numJobs;
+static int nextJob = 0;
+static pthread_mutex_t jobLock = PTHREAD_MUTEX_INITIALIZER;
+
+/*****************************************************************************
+ * @TAG Helpers
+ */
+/** xorshift64* **/
+static uint32_t Sim_rand(Sim_t *pSim) {
+	pSim->rng ^= pSim->rng >> 12;
+	pSim->rng ^= pSim->rng << 25;
+	pSim->rng ^= pSim->rng >> 27;
+	return (uint32_t) ((pSim->rng * 2685821657736338717ull) >> 32);
+}
+
+static int64_t Sim_randUs(Sim_t *pSim, int64_t maxUs) {
+	return (maxUs > 0) ? (int64_t) (Sim_rand(pSim) % (uint32_t) maxUs) : 0;
+}
+
+static void Sim_push(Sim_t *pSim, int64_t t, uint8_t type, uint32_t idx,
+		uint32_t seq, uint8_t ch) {
+	SimEvt_t evt = { t, idx, seq, type, ch };
+	size_t i;
+
+	if (pSim->heapLen == pSim->heapSize) {
+		pSim->heapSize = pSim->heapSize ? pSim->heapSize * 2 : 1024;
+		pSim->pHeap = realloc(pSim->pHeap, pSim->heapSize * sizeof(SimEvt_t));
+	}
+	i = pSim->heapLen++;
+	while (i > 0) {
+		size_t up = (i - 1) / 2;
+		if (pSim->pHeap[up].t <= t)
+			break;
+		pSim->pHeap[i] = pSim->pHeap[up];
+		i = up;
+	}
+	pSim->pHeap[i] = evt;
+}
+
+static SimEvt_t Sim_pop(Sim_t *pSim) {
+	SimEvt_t top = pSim->pHeap[0];
+	SimEvt_t last = pSim->pHeap[--pSim->heapLen];
+	size_t i = 0;
+
+	for (;;) {
+		size_t c = 2 * i + 1;
+		if (c >= pSim->heapLen)
+			break;
+		if ((c + 1 < pSim->heapLen) && (pSim->pHeap[c + 1].t < pSim->pHeap[c].t))
+			c++;
+		if (last.t <= pSim->pHeap[c].t)
+			break;
+		pSim->pHeap[i] = pSim->pHeap[c];
+		i = c;
+	}
+	if (pSim->heapLen > 0)
+		pSim->pHeap[i] = last;
+	return top;
+}
+
+static int Sim_cmpDouble(const void *a, const void *b) {
+	double x = *(const double *) a, y = *(const double *) b;
+	return (x > y) - (x < y);
+}
+
+static double Sim_percentile(double *pVal, size_t len, double p) {
+	if (len == 0)
+		return NAN;
+	return pVal[(size_t) (p * (len - 1) + 0.5)];
+}
+
+/*****************************************************************************
+ * @TAG Channel
+ */
+/** a packet starts, everything overlapping it on the channel is lost **/
+static void Sim_pktStart(Sim_t *pSim, uint32_t sender, uint8_t ch, int64_t t) {
+	SimChan_t *pChan = &pSim->chan[ch];
+	SimPkt_t *pPkt;
+	bool isCollided = pChan->numActive > 0;
+	int i;
+
+	for (i = 0; i < pChan->numActive; i++)
+		pChan->pActive[i].isCollided = true;
+	if (pChan->numActive == pChan->maxActive) {
+		pChan->maxActive = pChan->maxActive ? pChan->maxActive * 2 : 8;
+		pChan->pActive = realloc(pChan->pActive,
+				pChan->maxActive * sizeof(SimPkt_t));
+	}
+	pPkt = &pChan->pActive[pChan->numActive++];
+	pPkt->sender = sender;
+	pPkt->start = t;
+	pPkt->isCollided = isCollided;
+	pChan->busyUs += SIM_PKT_US;
+	Sim_push(pSim, t + SIM_PKT_US, EVT_PKT_END, sender, 0, ch);
+}
+
+/** a packet ends, take it off the channel **/
+static SimPkt_t Sim_pktEnd(Sim_t *pSim, uint32_t sender, uint8_t ch) {
+	SimChan_t *pChan = &pSim->chan[ch];
+	SimPkt_t pkt = { 0 };
+	int i;
+
+	for (i = 0; i < pChan->numActive; i++) {
+		if (pChan->pActive[i].sender == sender) {
+			pkt = pChan->pActive[i];
+			pChan->pActive[i] = pChan->pActive[--pChan->numActive];
+			break;
+		}
+	}
+	return pkt;
+}
+
+/** three packets, one per advertising channel **/
+static void Sim_advEvent(Sim_t *pSim, uint32_t sender, int64_t t) {
+	uint8_t ch;
+
+	for (ch = 0; ch < SIM_CHANNELS; ch++)
+		Sim_push(pSim, t + ch * SIM_HOP_US, EVT_PKT_START, sender, 0, ch);
+}
+
+/*****************************************************************************
+ * @TAG Devices
+ */
+static void Sim_devDone(Sim_t *pSim, SimDev_t *pDev, int64_t t) {
+	if (pDev->isDone)
+		return;
+	pDev->isDone = true;
+	pDev->doneAt = t;
+	pDev->advSeq++;
+	(void) pSim;
+}
+
+/** start a chain of advertising events **/
+static void Sim_devAdvertise(Sim_t *pSim, uint32_t idx, int64_t t) {
+	SimDev_t *pDev = &pSim->pDev[idx];
+
+	pDev->advSeq++;
+	Sim_push(pSim, t + Sim_randUs(pSim, SIM_ADV_DELAY_US), EVT_ADV, idx,
+			pDev->advSeq, 0);
+}
+
+static void Sim_onAdv(Sim_t *pSim, const SimEvt_t *pEvt) {
+	const SimCfg_t *pCfg = pSim->pCfg;
+	SimDev_t *pDev = &pSim->pDev[pEvt->idx];
+	int64_t next;
+
+	if ((pEvt->seq != pDev->advSeq) || pDev->isDone || pDev->isInConn
+			|| pDev->isBackoff)
+		return;
+
+	Sim_advEvent(pSim, pEvt->idx, pEvt->t);
+	pDev->energy += SIM_VOLT * (SIM_CHANNELS * SIM_PKT_US * SIM_TX_MA
+			+ SIM_WAKE_US * SIM_WAKE_MA) / 1000.0;
+	pSim->votePkts += SIM_CHANNELS;
+
+	next = pEvt->t + (int64_t) pCfg->advInterval * 1000
+			+ Sim_randUs(pSim, SIM_ADV_DELAY_US);
+	if ((pCfg->slots != 0) && (next + SIM_CHANNELS * SIM_HOP_US > pDev->slotEnd))
+		return;
+	Sim_push(pSim, next, EVT_ADV, pEvt->idx, pDev->advSeq, 0);
+}
+
+/** the device hears an ack beacon **/
+static void Sim_onAck(Sim_t *pSim, uint32_t idx, int64_t t) {
+	SimDev_t *pDev = &pSim->pDev[idx];
+
+	switch (ETX_Proto_ackCheck(pSim->ack, pDev->devID, 0)) {
+		case ETX_PROTO_ACK_HIT:
+			Sim_devDone(pSim, pDev, t);
+		break;
+
+		case ETX_PROTO_ACK_MISSED:
+			// the firmware leaves the retries to the slots in TDMA mode
+			if ((pSim->pCfg->slots == 0) && !pDev->isBackoff) {
+				pDev->isBackoff = true;
+				pDev->advSeq++;
+				Sim_push(pSim, t + (int64_t) ETX_Proto_backoff(pDev->retries,
+						Sim_rand(pSim)) * 1000, EVT_BACKOFF_END, idx, 0, 0);
+				pDev->retries++;
+			}
+		break;
+
+		default:
+		break;
+	}
+}
+
+/*****************************************************************************
+ * @TAG Base station
+ */
+/** BS bs hears a vote, connect for the read if there is room. The BS
+ * of another room leaves the link once it sees the vote isn't for it, the
+ * filter keeps it out **/
+static void Sim_bsReceive(Sim_t *pSim, int bs, uint32_t idx, int64_t t) {
+	const SimCfg_t *pCfg = pSim->pCfg;
+	SimDev_t *pDev = &pSim->pDev[idx];
+	bool isOurs = (pDev->room == bs);
+
+	if (isOurs && (pDev->collectedAt < 0))
+		pDev->collectedAt = t;
+	if (!isOurs && pCfg->isFilter)
+		return;
+
+	if ((pCfg->connCapacity > 0) && (pSim->pConns[bs] < pCfg->connCapacity)
+			&& !pDev->isDone && !pDev->isInConn) {
+		pSim->pConns[bs]++;
+		pDev->isInConn = true;
+		pDev->advSeq++;
+		if (!isOurs)
+			pDev->strays++;
+		Sim_push(pSim, t + (int64_t) pCfg->connTime * 1000, EVT_CONN_END, idx,
+				bs, 0);
+	}
+}
+
+/** is the scan window of the BS open on a channel for a whole packet **/
+static bool Sim_bsScans(const SimCfg_t *pCfg, uint8_t ch, int64_t start,
+		int64_t end) {
+	int64_t interval = (int64_t) pCfg->bsScanInterval * 1000;
+	int64_t window = pCfg->bsScanWindow ?
+			(int64_t) pCfg->bsScanWindow * 1000 : interval;
+
+	return ((start / interval) == (end / interval))
+			&& ((start / interval) % SIM_CHANNELS == ch)
+			&& (end % interval <= window);
+}
+
+/** is BS bs listening on a channel for a whole packet **/
+static bool Sim_bsHears(Sim_t *pSim, int bs, uint8_t ch, int64_t start,
+		int64_t end) {
+	if ((start < pSim->bsTxEnd) && (end > pSim->bsTxStart))
+		return false;
+	return Sim_bsScans(pSim->pCfg, ch, start + pSim->pPhase[bs],
+			end + pSim->pPhase[bs]);
+}
+
+/** bits set in the filter of the ack beacon **/
+static int Sim_ackBits(const uint8_t *pAck) {
+	int bits = 0;
+	int i;
+
+	for (i = 0; i < ETX_ACK_FILTER_BITS; i++)
+		bits += (pAck[ETX_ACK_FILTER_POS + i / 8] >> (i % 8)) & 1;
+	return bits;
+}
+
+/** fill the ack beacon of the next partition, a vote which would fill it
+ * past ETX_ACK_MAX_BITS waits for a later one, from a random start so
+ * every vote gets its turn **/
+static void Sim_bsAck(Sim_t *pSim, int64_t t) {
+	uint8_t part = pSim->ackPart;
+	uint32_t len = pSim->pPartLen[part];
+	uint32_t start = len ? Sim_rand(pSim) % len : 0;
+	uint32_t i;
+
+	pSim->ackPart = (pSim->ackPart + 1) % pSim->partitions;
+	memset(pSim->ack, 0, sizeof(pSim->ack));
+	pSim->ack[3] = part;
+	pSim->ack[4] = pSim->partitions;
+	pSim->ack[5] = pSim->pCfg->hashes;
+	for (i = 0; i < len; i++) {
+		SimDev_t *pDev = &pSim->pDev[pSim->ppPart[part][(start + i) % len]];
+		uint8_t before[ETX_ACK_LEN];
+
+		if (pDev->collectedAt < 0)
+			continue;
+		memcpy(before, pSim->ack, sizeof(before));
+		ETX_Proto_ackAdd(pSim->ack, pDev->devID, 0);
+		if (Sim_ackBits(pSim->ack) > ETX_ACK_MAX_BITS) {
+			memcpy(pSim->ack, before, sizeof(before));
+			break;
+		}
+	}
+
+	pSim->bsTxStart = t;
+	pSim->bsTxEnd = t + SIM_CHANNELS * SIM_HOP_US;
+	Sim_advEvent(pSim, pSim->n, t);
+}
+
+/** a frame starts, devices advertise in their slot only **/
+static void Sim_bsFrame(Sim_t *pSim, int64_t t) {
+	const SimCfg_t *pCfg = pSim->pCfg;
+	int64_t slotUs = (int64_t) pCfg->slotLen * 1000;
+	uint32_t i;
+
+	pSim->frame++;
+	pSim->bsTxStart = t;
+	pSim->bsTxEnd = t + SIM_CHANNELS * SIM_HOP_US;
+	Sim_advEvent(pSim, pSim->n, t);
+
+	for (i = 0; i < (uint32_t) pSim->n; i++) {
+		SimDev_t *pDev = &pSim->pDev[i];
+		int64_t start;
+
+		if (!pDev->isPressed || pDev->isDone || pDev->isInConn)
+			continue;
+		start = t + SIM_CHANNELS * SIM_HOP_US
+				+ ETX_Proto_slot(pDev->devID, pSim->frame, pCfg->slots) * slotUs;
+		pDev->slotEnd = start + slotUs;
+		pDev->advSeq++;
+		Sim_push(pSim, start + Sim_randUs(pSim, slotUs - SIM_CHANNELS * SIM_HOP_US),
+				EVT_ADV, i, pDev->advSeq, 0);
+	}
+}
+
+/*****************************************************************************
+ * @TAG Run
+ */
+static void Sim_onPktEnd(Sim_t *pSim, const SimEvt_t *pEvt) {
+	SimPkt_t pkt = Sim_pktEnd(pSim, pEvt->idx, pEvt->ch);
+	uint32_t i;
+
+	if (pEvt->idx < (uint32_t) pSim->n) {
+		int bs;
+
+		if (pkt.isCollided) {
+			pSim->votePktsLost++;
+			return;
+		}
+		for (bs = 0; bs < pSim->pCfg->rooms; bs++) {
+			if (Sim_bsHears(pSim, bs, pEvt->ch, pkt.start, pEvt->t))
+				Sim_bsReceive(pSim, bs, pEvt->idx, pEvt->t);
+		}
+		return;
+	}
+
+	// ack beacon, only its partition can make use of it
+	if (pkt.isCollided || (pSim->ack[4] == 0))
+		return;
+	for (i = 0; i < pSim->pPartLen[pSim->ack[3]]; i++) {
+		uint32_t idx = pSim->ppPart[pSim->ack[3]][i];
+		SimDev_t *pDev = &pSim->pDev[idx];
+
+		if (pDev->isScanning && (pDev->scanCh == pEvt->ch) && !pDev->isDone)
+			Sim_onAck(pSim, idx, pEvt->t);
+	}
+}
+
+/** a run of perRoom devices in every room **/
+static void Sim_run(const SimCfg_t *pCfg, int perRoom, int run,
+		SimResult_t *pRes) {
+	Sim_t sim;
+	Sim_t *pSim = &sim;
+	int n = perRoom * pCfg->rooms;
+	int64_t endUs = (int64_t) (pCfg->pressWindow + pCfg->tail) * 1000;
+	double *pLat = malloc(n * sizeof(double));
+	double *pDone = malloc(n * sizeof(double));
+	double *pAt = malloc(n * sizeof(double));
+	size_t numLat = 0, numDone = 0;
+	double energy = 0;
+	uint64_t strays = 0;
+	uint32_t i;
+	int ch;
+
+	memset(pSim, 0, sizeof(sim));
+	pSim->pCfg = pCfg;
+	pSim->n = n;
+	pSim->rng = (pCfg->seed ^ ((uint64_t) n << 32) ^ (uint64_t) run)
+			* 0x9E3779B97F4A7C15ull + 1;
+	pSim->bsTxStart = pSim->bsTxEnd = -1;
+	pSim->partitions = pCfg->partitions ? pCfg->partitions : (n + 15) / 16;
+	if (pSim->partitions > 255)
+		pSim->partitions = 255;
+	if (pSim->partitions < 1)
+		pSim->partitions = 1;
+
+	// the BSs scan at their own phase
+	pSim->pConns = calloc(pCfg->rooms, sizeof(int));
+	pSim->pPhase = calloc(pCfg->rooms, sizeof(int64_t));
+	for (i = 1; i < (uint32_t) pCfg->rooms; i++)
+		pSim->pPhase[i] = Sim_randUs(pSim,
+				(int64_t) pCfg->bsScanInterval * 1000 * SIM_CHANNELS);
+
+	pSim->pDev = calloc(n, sizeof(SimDev_t));
+	pSim->ppPart = calloc(pSim->partitions, sizeof(uint32_t *));
+	pSim->pPartLen = calloc(pSim->partitions, sizeof(uint32_t));
+	for (i = 0; i < (uint32_t) n; i++) {
+		SimDev_t *pDev = &pSim->pDev[i];
+		uint32_t id = Sim_rand(pSim);
+
+		pDev->devID[0] = 0x95;
+		pDev->devID[1] = (uint8_t) id;
+		pDev->devID[2] = (uint8_t) (id >> 8);
+		pDev->devID[3] = (uint8_t) (id >> 16);
+		pDev->partition = ETX_Proto_partition(pDev->devID, pSim->partitions);
+		pDev->room = i % pCfg->rooms;
+		pDev->collectedAt = -1;
+		pDev->doneAt = -1;
+		pDev->pressAt = Sim_randUs(pSim, (int64_t) pCfg->pressWindow * 1000);
+		Sim_push(pSim, pDev->pressAt, EVT_PRESS, i, 0, 0);
+	}
+	for (i = 0; i < (uint32_t) n; i++) {
+		uint8_t p = pSim->pDev[i].partition;
+		pSim->ppPart[p] = realloc(pSim->ppPart[p],
+				(pSim->pPartLen[p] + 1) * sizeof(uint32_t));
+		pSim->ppPart[p][pSim->pPartLen[p]++] = i;
+	}
+
+	if (pCfg->ackPeriod > 0)
+		Sim_push(pSim, Sim_randUs(pSim, (int64_t) pCfg->ackPeriod * 1000),
+				EVT_ACK, 0, 0, 0);
+	if (pCfg->slots > 0)
+		Sim_push(pSim, 0, EVT_FRAME, 0, 0, 0);
+
+	while (pSim->heapLen > 0) {
+		SimEvt_t evt = Sim_pop(pSim);
+		SimDev_t *pDev = &pSim->pDev[evt.idx < (uint32_t) n ? evt.idx : 0];
+
+		if (evt.t > endUs)
+			break;
+
+		switch (evt.type) {
+			case EVT_PRESS:
+				pDev->isPressed = true;
+				if (pCfg->slots == 0)
+					Sim_devAdvertise(pSim, evt.idx, evt.t);
+				if ((pCfg->scanPeriod > 0) && (pCfg->ackPeriod > 0))
+					Sim_push(pSim, evt.t + Sim_randUs(pSim,
+							(int64_t) pCfg->scanPeriod * 1000), EVT_SCAN_START,
+							evt.idx, 0, 0);
+			break;
+
+			case EVT_ADV:
+				Sim_onAdv(pSim, &evt);
+			break;
+
+			case EVT_PKT_START:
+				Sim_pktStart(pSim, evt.idx, evt.ch, evt.t);
+			break;
+
+			case EVT_PKT_END:
+				Sim_onPktEnd(pSim, &evt);
+			break;
+
+			case EVT_SCAN_START:
+				if (pDev->isDone)
+					break;
+				pDev->isScanning = true;
+				pDev->scanCh = (pDev->scanCh + 1) % SIM_CHANNELS;
+				pDev->energy += SIM_VOLT * (pCfg->scanDuration * SIM_RX_MA
+						+ SIM_WAKE_US * SIM_WAKE_MA / 1000.0);
+				Sim_push(pSim, evt.t + (int64_t) pCfg->scanDuration * 1000,
+						EVT_SCAN_END, evt.idx, 0, 0);
+				Sim_push(pSim, evt.t + (int64_t) pCfg->scanPeriod * 1000,
+						EVT_SCAN_START, evt.idx, 0, 0);
+			break;
+
+			case EVT_SCAN_END:
+				pDev->isScanning = false;
+			break;
+
+			case EVT_BACKOFF_END:
+				pDev->isBackoff = false;
+				if (!pDev->isDone && !pDev->isInConn)
+					Sim_devAdvertise(pSim, evt.idx, evt.t);
+			break;
+
+			case EVT_CONN_END:
+				// seq is the BS, one of another room leaves without the vote
+				pSim->pConns[evt.seq]--;
+				pDev->isInConn = false;
+				pDev->energy += SIM_VOLT * SIM_CONN_US * SIM_RX_MA / 1000.0;
+				if (pDev->room == evt.seq)
+					Sim_devDone(pSim, pDev, evt.t);
+				else if (!pDev->isDone && !pDev->isBackoff)
+					Sim_devAdvertise(pSim, evt.idx, evt.t);
+			break;
+
+			case EVT_ACK:
+				Sim_bsAck(pSim, evt.t);
+				Sim_push(pSim, evt.t + (int64_t) pCfg->ackPeriod * 1000, EVT_ACK,
+						0, 0, 0);
+			break;
+
+			case EVT_FRAME:
+				Sim_bsFrame(pSim, evt.t);
+				Sim_push(pSim, evt.t + SIM_CHANNELS * SIM_HOP_US
+						+ (int64_t) pCfg->slots * pCfg->slotLen * 1000,
+						EVT_FRAME, 0, 0, 0);
+			break;
+		}
+	}
+
+	// results
+	for (i = 0; i < (uint32_t) n; i++) {
+		SimDev_t *pDev = &pSim->pDev[i];
+		int64_t stop = (pDev->doneAt >= 0) ? pDev->doneAt : endUs;
+
+		if (pDev->collectedAt >= 0) {
+			pAt[numLat] = pDev->collectedAt / 1000.0;
+			pLat[numLat++] = (pDev->collectedAt - pDev->pressAt) / 1000.0;
+		}
+		if (pDev->doneAt >= 0)
+			pDone[numDone++] = (pDev->doneAt - pDev->pressAt) / 1000.0;
+		energy += pDev->energy + SIM_VOLT * SIM_SLEEP_UA * stop / 1e6;
+		strays += pDev->strays;
+	}
+	qsort(pLat, numLat, sizeof(double), Sim_cmpDouble);
+	qsort(pDone, numDone, sizeof(double), Sim_cmpDouble);
+	qsort(pAt, numLat, sizeof(double), Sim_cmpDouble);
+
+	pRes->collected = (double) numLat / n;
+	pRes->t95 = (numLat >= (size_t) ceil(0.95 * n)) ?
+			pAt[(size_t) ceil(0.95 * n) - 1] : NAN;
+	pRes->t100 = (numLat == (size_t) n) ? pAt[n - 1] : NAN;
+	pRes->p50 = Sim_percentile(pLat, numLat, 0.50);
+	pRes->p90 = Sim_percentile(pLat, numLat, 0.90);
+	pRes->p99 = Sim_percentile(pLat, numLat, 0.99);
+	pRes->done99 = (numDone >= (size_t) ceil(0.99 * n)) ?
+			Sim_percentile(pDone, numDone, 0.99) : NAN;
+	pRes->airtime = 0;
+	for (ch = 0; ch < SIM_CHANNELS; ch++)
+		pRes->airtime += (double) pSim->chan[ch].busyUs / endUs / SIM_CHANNELS;
+	pRes->collisions = pSim->votePkts ?
+			(double) pSim->votePktsLost / pSim->votePkts : 0;
+	pRes->energy = energy / n;
+	pRes->strays = (double) strays / n;
+
+	for (i = 0; i < (uint32_t) pSim->partitions; i++)
+		free(pSim->ppPart[i]);
+	for (ch = 0; ch < SIM_CHANNELS; ch++)
+		free(pSim->chan[ch].pActive);
+	free(pSim->ppPart);
+	free(pSim->pPartLen);
+	free(pSim->pDev);
+	free(pSim->pConns);
+	free(pSim->pPhase);
+	free(pSim->pHeap);
+	free(pLat);
+	free(pDone);
+	free(pAt);
+}
+
+/*****************************************************************************
+ * @TAG Reconnect
+ */
+/** a packet of a device survives the background advertising **/
+static bool Sim_survives(Sim_t *pSim, int64_t pktUs, double bgRate) {
+	double loss = 1.0 - exp(-bgRate * (pktUs + SIM_PKT_US));
+
+	return Sim_rand(pSim) / 4294967296.0 >= loss;
+}
+
+/** us from the start of advertising to the CONNECT_IND, -1 if the BS
+ * didn't connect within the tail. bgRate is the background packets per us
+ * on a channel **/
+static int64_t Sim_reconnect(Sim_t *pSim, bool isDirected, double bgRate) {
+	const SimCfg_t *pCfg = pSim->pCfg;
+	int64_t endUs = (int64_t) pCfg->tail * 1000;
+	// the BS schedule is at a random phase to the device
+	int64_t phase = Sim_randUs(pSim,
+			(int64_t) pCfg->bsScanInterval * 1000 * SIM_CHANNELS);
+	int64_t t = 0;
+	uint8_t ch;
+
+	if (isDirected) {
+		uint32_t fallback;
+		int64_t directEnd;
+
+		// the controller stops first if the app's fallback comes later,
+		// nothing is sent until the fallback then
+		ETX_Link_advFallback(ETX_ADV_DIRECTED, &fallback);
+		directEnd = (int64_t) fallback * 1000;
+		if (directEnd > SIM_HDC_LIMIT_US)
+			directEnd = SIM_HDC_LIMIT_US;
+		for (t = 0; t < directEnd; t += SIM_HDC_US) {
+			for (ch = 0; ch < SIM_CHANNELS; ch++) {
+				int64_t start = t + ch * (SIM_HDC_US / SIM_CHANNELS);
+
+				if (Sim_bsScans(pCfg, ch, phase + start,
+						phase + start + SIM_HDC_PKT_US)
+						&& Sim_survives(pSim, SIM_HDC_PKT_US, bgRate))
+					return start + SIM_HDC_PKT_US + SIM_CONNECT_US;
+			}
+		}
+		t = (int64_t) fallback * 1000;
+	}
+
+	t += Sim_randUs(pSim, SIM_ADV_DELAY_US);
+	while (t < endUs) {
+		for (ch = 0; ch < SIM_CHANNELS; ch++) {
+			int64_t start = t + ch * SIM_HOP_US;
+
+			if (Sim_bsScans(pCfg, ch, phase + start, phase + start + SIM_PKT_US)
+					&& Sim_survives(pSim, SIM_PKT_US, bgRate))
+				return start + SIM_PKT_US + SIM_CONNECT_US;
+		}
+		t += (int64_t) pCfg->advInterval * 1000
+				+ Sim_randUs(pSim, SIM_ADV_DELAY_US);
+	}
+	return -1;
+}
+
+/** sample the reconnects in a room of n devices, the latencies in ms go
+ * to pLat, returns how many connected **/
+static size_t Sim_reconnects(const SimCfg_t *pCfg, int n, bool isDirected,
+		double *pLat) {
+	Sim_t sim;
+	// the others advertise every interval plus half the delay on average
+	double bgRate = (n - 1) / ((double) pCfg->advInterval * 1000
+			+ SIM_ADV_DELAY_US / 2);
+	size_t num = 0;
+	int i;
+
+	memset(&sim, 0, sizeof(sim));
+	sim.pCfg = pCfg;
+	sim.rng = (pCfg->seed ^ ((uint64_t) n << 32) ^ isDirected)
+			* 0x9E3779B97F4A7C15ull + 1;
+	for (i = 0; i < pCfg->reconnects; i++) {
+		int64_t us = Sim_reconnect(&sim, isDirected, bgRate);
+
+		if (us >= 0)
+			pLat[num++] = us / 1000.0;
+	}
+	qsort(pLat, num, sizeof(double), Sim_cmpDouble);
+	return num;
+}
+
+static void *Sim_worker(void *arg) {
+	(void) arg;
+	for (;;) {
+		int job;
+
+		pthread_mutex_lock(&jobLock);
+		job = nextJob++;
+		pthread_mutex_unlock(&jobLock);
+		if (job >= numJobs)
+			return NULL;
+		Sim_run(pJobs[job].pCfg, pJobs[job].n, pJobs[job].run,
+				&pJobs[job].result);
+	}
+}
+
+/*****************************************************************************
+ * @TAG Main
+ */
+static void Sim_usage(const SimCfg_t *pCfg) {
+	printf("usage: etx_sim [options], times in ms\n"
+			"  -n list   device counts, comma separated (100,500,1000)\n"
+			"  -r runs   runs per device count, averaged (%d)\n"
+			"  -j n      threads (%d, the online CPUs)\n"
+			"  -a ms     advertising interval (%d)\n"
+			"  -w ms     press window (%d)\n"
+			"  -T ms     run on after the press window (%d)\n"
+			"  -i ms     BS scan interval per channel (%d)\n"
+			"  -W ms     BS scan window, 0 for the whole interval (%d)\n"
+			"  -k ms     ack beacon period, 0 for none (%d)\n"
+			"  -p n      ack partitions, 0 for one per 16 devices (%d)\n"
+			"  -H n      ack filter hashes (%d)\n"
+			"  -s p,d    device scan period and duration (%d,%d)\n"
+			"  -c n      BS connection capacity, 0 for acks only (%d)\n"
+			"  -t ms     time of a vote read over a connection (%d)\n"
+			"  -S n,len  TDMA slots and slot length, 0 for none (%d,%d)\n"
+			"  -C        compare random access against the slots, %d,%d\n"
+			"            unless -S says otherwise\n"
+			"  -M rooms  rooms of -n devices in range of each other, without\n"
+			"            and with the connection filter, needs -c (%d)\n"
+			"  -R n      sample n reconnects to the known BS, directed and\n"
+			"            undirected, in rooms of -n devices, -T is the limit\n"
+			"  -x seed   random seed\n", pCfg->runs, pCfg->threads,
+			pCfg->advInterval, pCfg->pressWindow, pCfg->tail,
+			pCfg->bsScanInterval, pCfg->bsScanWindow, pCfg->ackPeriod,
+			pCfg->partitions,
+			pCfg->hashes, pCfg->scanPeriod, pCfg->scanDuration,
+			pCfg->connCapacity, pCfg->connTime, pCfg->slots, pCfg->slotLen,
+			SIM_COMPARE_SLOTS, pCfg->slotLen, pCfg->rooms);
+}
+
+static void Sim_print(double val) {
+	if (isnan(val))
+		printf(" %8s", "-");
+	else
+		printf(" %8.0f", val);
+}
+
+static void Sim_printMs(double val) {
+	if (isnan(val))
+		printf(" %8s", "-");
+	else
+		printf(" %8.1f", val);
+}
+
+/** percentile of all the samples, the ones which didn't connect are slower
+ * than the num that did **/
+static double Sim_latency(const double *pLat, size_t num, size_t total,
+		double p) {
+	size_t i = (size_t) (p * (total - 1) + 0.5);
+
+	return (i < num) ? pLat[i] : NAN;
+}
+
+/** reconnect latency percentiles of every point **/
+static void Sim_printReconnects(const SimCfg_t *pCfg) {
+	double *pLat = malloc(pCfg->reconnects * sizeof(double));
+	uint32_t fallback;
+	int p, d;
+
+	ETX_Link_advFallback(ETX_ADV_DIRECTED, &fallback);
+	printf("# reconnect, adv %d ms, BS scan %d/%d ms, directed %d ms then "
+			"undirected, %d samples, %d ms limit\n", pCfg->advInterval,
+			pCfg->bsScanWindow ? pCfg->bsScanWindow : pCfg->bsScanInterval,
+			pCfg->bsScanInterval, fallback, pCfg->reconnects, pCfg->tail);
+	printf("# %6s %10s %8s %8s %8s %8s %8s\n", "devs", "adv", "conn%",
+			"p50", "p90", "p99", "max");
+	for (p = 0; p < pCfg->numPoints; p++) {
+		for (d = 1; d >= 0; d--) {
+			size_t num = Sim_reconnects(pCfg, pCfg->points[p], d, pLat);
+			double max = num ? pLat[num - 1] : NAN;
+
+			printf("  %6d %10s %8.2f", pCfg->points[p],
+					d ? "directed" : "undirected",
+					100.0 * num / pCfg->reconnects);
+			Sim_printMs(Sim_latency(pLat, num, pCfg->reconnects, 0.50));
+			Sim_printMs(Sim_latency(pLat, num, pCfg->reconnects, 0.90));
+			Sim_printMs(Sim_latency(pLat, num, pCfg->reconnects, 0.99));
+			Sim_printMs((num == (size_t) pCfg->reconnects) ? max : NAN);
+			printf("\n");
+		}
+	}
+	free(pLat);
+}
+
+/** the mean of the runs of every point, pJob holds the runs of pCfg **/
+static void Sim_printTable(const SimCfg_t *pCfg, const SimJob_t *pJob) {
+	int p;
+
+	printf("# adv %d ms, ack %d ms, scan %d/%d ms, conns %d, slots %dx%d ms, "
+			"press window %d ms, %d runs\n", pCfg->advInterval, pCfg->ackPeriod,
+			pCfg->scanPeriod, pCfg->scanDuration, pCfg->connCapacity, pCfg->slots,
+			pCfg->slotLen, pCfg->pressWindow, pCfg->runs);
+	printf("# %6s %8s %8s %8s %8s %8s %8s %8s %8s %8s %8s", "devs",
+			"coll%", "t95", "t100", "p50", "p90", "p99", "done99", "load%",
+			"lost%", "uJ/dev");
+	// devices per room, the links of other BSs they took
+	if (pCfg->rooms > 1)
+		printf(" %8s", "strays");
+	printf("\n");
+	for (p = 0; p < pCfg->numPoints; p++) {
+		SimResult_t mean = { 0 };
+		int r;
+
+		// NaN, a run which didn't get there, stays NaN in the mean
+		for (r = 0; r < pCfg->runs; r++) {
+			const SimResult_t *pRes = &pJob[p * pCfg->runs + r].result;
+			mean.collected += pRes->collected / pCfg->runs;
+			mean.t95 += pRes->t95 / pCfg->runs;
+			mean.t100 += pRes->t100 / pCfg->runs;
+			mean.p50 += pRes->p50 / pCfg->runs;
+			mean.p90 += pRes->p90 / pCfg->runs;
+			mean.p99 += pRes->p99 / pCfg->runs;
+			mean.done99 += pRes->done99 / pCfg->runs;
+			mean.airtime += pRes->airtime / pCfg->runs;
+			mean.collisions += pRes->collisions / pCfg->runs;
+			mean.energy += pRes->energy / pCfg->runs;
+			mean.strays += pRes->strays / pCfg->runs;
+		}
+		printf("  %6d", pCfg->points[p]);
+		printf(" %8.2f", mean.collected * 100);
+		Sim_print(mean.t95);
+		Sim_print(mean.t100);
+		Sim_print(mean.p50);
+		Sim_print(mean.p90);
+		Sim_print(mean.p99);
+		Sim_print(mean.done99);
+		printf(" %8.2f %8.2f", mean.airtime * 100, mean.collisions * 100);
+		Sim_print(mean.energy);
+		if (pCfg->rooms > 1)
+			printf(" %8.2f", mean.strays);
+		printf("\n");
+	}
+}
+
+int main(int argc, char **argv) {
+	SimCfg_t cfg = {
+		.points = { 100, 500, 1000 }, .numPoints = 3, .runs = 4,
+		.advInterval = 100, .pressWindow = 10000, .tail = 30000,
+		.bsScanInterval = 100, .bsScanWindow = 0, .ackPeriod = 500, .partitions = 0, .hashes = 4,
+		.scanPeriod = 2000, .scanDuration = 100, .connCapacity = 0,
+		.connTime = 30, .slots = 0, .slotLen = 10, .isCompare = false,
+		.reconnects = 0, .rooms = 1, .isFilter = false, .seed = 1
+	};
+	SimCfg_t modes[2];			// random access, slots
+	int numModes = 1;
+	int jobsPerMode;
+	pthread_t *pThreads;
+	int opt;
+	int i, p;
+
+	cfg.threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	if (cfg.threads < 1)
+		cfg.threads = 1;
+
+	while ((opt = getopt(argc, argv, "n:r:j:a:w:T:i:W:k:p:H:s:c:t:S:CM:R:x:h")) != -1) {
+		switch (opt) {
+			case 'n': {
+				char *pTok = strtok(optarg, ",");
+				cfg.numPoints = 0;
+				while (pTok && (cfg.numPoints < SIM_MAX_POINTS)) {
+					cfg.points[cfg.numPoints++] = atoi(pTok);
+					pTok = strtok(NULL, ",");
+				}
+			}
+			break;
+			case 'r': cfg.runs = atoi(optarg); break;
+			case 'j': cfg.threads = atoi(optarg); break;
+			case 'a': cfg.advInterval = atoi(optarg); break;
+			case 'w': cfg.pressWindow = atoi(optarg); break;
+			case 'T': cfg.tail = atoi(optarg); break;
+			case 'i': cfg.bsScanInterval = atoi(optarg); break;
+			case 'W': cfg.bsScanWindow = atoi(optarg); break;
+			case 'k': cfg.ackPeriod = atoi(optarg); break;
+			case 'p': cfg.partitions = atoi(optarg); break;
+			case 'H': cfg.hashes = atoi(optarg); break;
+			case 's': sscanf(optarg, "%d,%d", &cfg.scanPeriod,
+					&cfg.scanDuration); break;
+			case 'c': cfg.connCapacity = atoi(optarg); break;
+			case 't': cfg.connTime = atoi(optarg); break;
+			case 'S': sscanf(optarg, "%d,%d", &cfg.slots, &cfg.slotLen); break;
+			case 'C': cfg.isCompare = true; break;
+			case 'M': cfg.rooms = atoi(optarg); break;
+			case 'R': cfg.reconnects = atoi(optarg); break;
+			case 'x': cfg.seed = strtoull(optarg, NULL, 0); break;
+			default:
+				Sim_usage(&cfg);
+				return (opt == 'h') ? 0 : 1;
+		}
+	}
+	if ((cfg.runs < 1) || (cfg.threads < 1) || (cfg.advInterval < 20)
+			|| (cfg.bsScanInterval < 1) || (cfg.hashes < 1)
+			|| (cfg.hashes > ETX_ACK_MAX_HASHES)
+			|| ((cfg.slots > 0) && (cfg.slotLen < 1))
+			|| (cfg.bsScanWindow < 0) || (cfg.bsScanWindow > cfg.bsScanInterval)
+			|| (cfg.reconnects < 0) || (cfg.rooms < 1)
+			|| ((cfg.rooms > 1) && ((cfg.connCapacity < 1) || cfg.isCompare))) {
+		Sim_usage(&cfg);
+		return 1;
+	}
+	for (p = 0; p < cfg.numPoints; p++) {
+		if (cfg.points[p] < 1) {
+			Sim_usage(&cfg);
+			return 1;
+		}
+	}
+
+	if (cfg.reconnects > 0) {
+		Sim_printReconnects(&cfg);
+		return 0;
+	}
+
+	// the same seed, so both modes see the same devices and presses
+	modes[0] = cfg;
+	if (cfg.rooms > 1) {
+		// the votes are read over the links, nothing else goes on the air
+		modes[0].ackPeriod = 0;
+		modes[0].slots = 0;
+		modes[1] = modes[0];
+		modes[1].isFilter = true;
+		numModes = 2;
+	} else if (cfg.isCompare) {
+		modes[0].slots = 0;
+		modes[1] = cfg;
+		if (modes[1].slots == 0)
+			modes[1].slots = SIM_COMPARE_SLOTS;
+		numModes = 2;
+	}
+
+	jobsPerMode = cfg.numPoints * cfg.runs;
+	numJobs = numModes * jobsPerMode;
+	pJobs = calloc(numJobs, sizeof(SimJob_t));
+	for (i = 0; i < numJobs; i++) {
+		int j = i % jobsPerMode;
+
+		pJobs[i].pCfg = &modes[i / jobsPerMode];
+		pJobs[i].n = cfg.points[j / cfg.runs];
+		pJobs[i].run = j % cfg.runs;
+	}
+	pThreads = calloc(cfg.threads, sizeof(pthread_t));
+	for (i = 0; i < cfg.threads; i++)
+		pthread_create(&pThreads[i], NULL, Sim_worker, NULL);
+	for (i = 0; i < cfg.threads; i++)
+		pthread_join(pThreads[i], NULL);
+
+	for (i = 0; i < numModes; i++) {
+		if (cfg.rooms > 1)
+			printf("%s# %d rooms, filter %s\n", i ? "\n" : "", cfg.rooms,
+					modes[i].isFilter ? "on" : "off");
+		else if (cfg.isCompare)
+			printf("%s# %s access\n", i ? "\n" : "", i ? "slotted" : "random");
+		Sim_printTable(&modes[i], &pJobs[i * jobsPerMode]);
+	}
+
+	free(pThreads);
+	free(pJobs);
+	return 0;
+}
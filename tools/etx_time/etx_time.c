@@ -0,0 +1,325 @@
+/*****************************************************************************
+ *
+ * @filepath    /tools/etx_time/etx_time.c
+ *
+ * @project     evrs tools
+ *
+ * @brief       checks the BS time sync and the vote stamps of etx_proto.c
+ *              on a host, over a lecture with a drifting ETX crystal.
+ *
+ *              The BS time is the reference. The ETX Clock ticks every
+ *              10 us off a crystal running drift ppm fast, plus a warm-up
+ *              which adds up to warm ppm over the first 30 minutes. The
+ *              BS time reaches the ETX truncated to ms and late by up to
+ *              the latency, by beacons every period ms while it scans, or
+ *              by SET_TIME. Keys are pressed at random, every press is
+ *              stamped with ETX_Proto_timeGet at its tick and compared with
+ *              the BS time of the press.
+ *
+ *              Syncs of a scenario:
+ *                beacons    a beacon every period all along
+ *                gap        beacons, none from 60 to 70 minutes in, as
+ *                           in a long link or with the scan turned off
+ *                set        SET_TIME every 10 minutes only
+ *
+ *              Errors, exit with 1:
+ *              - a sync stepping the time after the first one, the drift
+ *                and latency are far below ETX_TIME_STEP
+ *              - a stamp further off than the bound (-e) with beacons
+ *              - a stamp going back in time between two presses
+ *
+ *              The Clock starts 10 minutes before its 32 bit wrap, so every
+ *              scenario runs through it.
+ *
+ * build        cc -O2 -std=gnu99 -I../../evrs_tx_cc2650etx_app/src
+ *                  -o etx_time etx_time.c ../../evrs_tx_cc2650etx_app/src/etx_proto.c
+ *
+ * usage        ./etx_time                    2 hours, drifts of -100 to 100
+ *              ./etx_time -d 40 -w 10 -v     one crystal, every sync printed
+ *
+ * @date        18 Oct. 2026
+ *
+ * @author      Ziyi@outlook.com.au
+ *
+ ****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "etx_proto.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Clock_tickPeriod of the ETX, us
+#define TIME_TICK_PERIOD	10
+
+#define TIME_MINUTE			60000000LL	// us
+#define TIME_WARMUP			(30 * TIME_MINUTE)
+#define TIME_GAP_START		(60 * TIME_MINUTE)
+#define TIME_GAP_END		(70 * TIME_MINUTE)
+#define TIME_SET_PERIOD		(10 * TIME_MINUTE)
+
+// Clock ticks left before the wrap at the start
+#define TIME_TICK_START		(0xFFFFFFFFu - (uint32_t) (10 * TIME_MINUTE \
+		/ TIME_TICK_PERIOD))
+
+enum {
+	SYNC_BEACONS,
+	SYNC_GAP,
+	SYNC_SET,
+	SYNC_MODES
+};
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct TimeCfg_t {
+	int minutes;
+	int drifts[8];
+	int numDrifts;
+	int warm;			// ppm added over the warm-up
+	int period;			// beacon period, ms
+	int latency;		// ms
+	int pressEvery;		// mean time between presses, ms
+	int bound;			// ms
+} TimeCfg_t;
+
+typedef struct TimeRun_t {
+	uint32_t syncs[ETX_PROTO_TIME_SKIP + 1];
+	uint32_t steps;		// after the first sync
+	uint32_t presses;
+	uint32_t backwards;
+	int32_t *pErr;		// stamp errors, ms
+	int32_t driftPpm;	// estimate at the end
+} TimeRun_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static const char *modeNames[SYNC_MODES] = { "beacons", "gap", "set" };
+
+static uint32_t rng = 1;
+static bool isVerbose = false;
+
+/*****************************************************************************
+ * @TAG Lecture
+ */
+static uint32_t Time_random(void) {
+	rng = rng * 1103515245 + 12345;
+	return rng >> 16;
+}
+
+/** ppm of the crystal at a time **/
+static double Time_ppm(const TimeCfg_t *pCfg, int drift, int64_t t) {
+	double warm = (t < TIME_WARMUP) ? (double) t / TIME_WARMUP : 1.0;
+
+	return drift + pCfg->warm * warm;
+}
+
+/** BS time of a time, ms, the BS counts from a while before the lecture **/
+static uint32_t Time_bs(int64_t t) {
+	return (uint32_t) (3600000 + t / 1000);
+}
+
+static bool Time_isSync(const TimeCfg_t *pCfg, uint8_t mode, int64_t t) {
+	switch (mode) {
+		case SYNC_GAP:
+			if ((t >= TIME_GAP_START) && (t < TIME_GAP_END))
+				return false;
+			// fall through
+		case SYNC_BEACONS:
+			return true;
+
+		default:
+			return (t % TIME_SET_PERIOD) < (int64_t) pCfg->period * 1000;
+	}
+}
+
+static int Time_cmp(const void *a, const void *b) {
+	int32_t x = *(const int32_t *) a, y = *(const int32_t *) b;
+	return (x > y) - (x < y);
+}
+
+/** one lecture, in steps of a beacon period **/
+static void Time_run(const TimeCfg_t *pCfg, int drift, uint8_t mode,
+		TimeRun_t *pRun) {
+	EtxProtoTime_t time = { 0 };
+	int64_t end = pCfg->minutes * TIME_MINUTE;
+	int64_t step = (int64_t) pCfg->period * 1000;
+	int64_t t, nextPress;
+	double ticks = TIME_TICK_START;
+	uint32_t lastStamp = 0;
+
+	memset(pRun, 0, sizeof(TimeRun_t));
+	pRun->pErr = malloc(sizeof(int32_t) * (end / 1000 + 1));
+	nextPress = (Time_random() % pCfg->pressEvery) * 1000LL;
+
+	for (t = 0; t < end; t += step) {
+		// the BS sends off its own ms, the ETX hears it a little later
+		int64_t tx = t + Time_random() % 1000;
+		int64_t rx = tx + (Time_random() % (pCfg->latency * 1000 + 1));
+		double rate = (1.0 + Time_ppm(pCfg, drift, t) * 1e-6)
+				/ TIME_TICK_PERIOD;
+
+		// presses before the beacon is taken in
+		while (nextPress < rx) {
+			uint32_t tick = (uint32_t) (int64_t) (ticks + (nextPress - t) * rate);
+			uint32_t stamp = ETX_Proto_timeGet(&time, tick, TIME_TICK_PERIOD);
+
+			if (time.isSynced) {
+				pRun->pErr[pRun->presses++] = (int32_t) (stamp
+						- Time_bs(nextPress));
+				if ((pRun->presses > 1) && ((int32_t) (stamp - lastStamp) < 0))
+					pRun->backwards++;
+				lastStamp = stamp;
+			}
+			nextPress += 1000LL * (1 + Time_random() % (2 * pCfg->pressEvery));
+		}
+
+		if (Time_isSync(pCfg, mode, t)) {
+			int32_t error;
+			uint8_t result = ETX_Proto_timeSync(&time, Time_bs(tx),
+					(uint32_t) (int64_t) (ticks + (rx - t) * rate),
+					TIME_TICK_PERIOD, &error);
+
+			pRun->syncs[result]++;
+			if ((result == ETX_PROTO_TIME_STEP) && (pRun->syncs[0] != 0))
+				pRun->steps++;
+			if (isVerbose && (result != ETX_PROTO_TIME_SKIP))
+				printf("%8.1f s  %-7s drift %4d ppm  %d  error %d ms, "
+						"estimate %d ppm\n", t / 1e6, modeNames[mode], drift,
+						result, error, time.driftPpm);
+		}
+
+		ticks += step * rate;
+		if (ticks >= 4294967296.0)
+			ticks -= 4294967296.0;
+	}
+	pRun->driftPpm = time.driftPpm;
+}
+
+/*****************************************************************************
+ * @TAG Main
+ */
+static bool Time_list(const char *pArg, TimeCfg_t *pCfg) {
+	char *pEnd;
+
+	pCfg->numDrifts = 0;
+	while (*pArg && (pCfg->numDrifts < 8)) {
+		pCfg->drifts[pCfg->numDrifts++] = (int) strtol(pArg, &pEnd, 10);
+		if (pEnd == pArg)
+			return false;
+		pArg = (*pEnd == ',') ? pEnd + 1 : pEnd;
+	}
+	return pCfg->numDrifts > 0;
+}
+
+static void Time_usage(const TimeCfg_t *pCfg) {
+	printf("usage: etx_time [options]\n"
+			"  -m min    length of the lecture (%d)\n"
+			"  -d list   crystal drifts, ppm, comma separated "
+			"(-100,-40,-20,0,20,40,100)\n"
+			"  -w ppm    drift added over the warm-up (%d)\n"
+			"  -p ms     beacon period (%d)\n"
+			"  -l ms     latency of a sync, at most (%d)\n"
+			"  -k ms     mean time between presses (%d)\n"
+			"  -e ms     stamp error bound with beacons (%d)\n"
+			"  -x seed   random seed\n"
+			"  -v        print every sync\n", pCfg->minutes, pCfg->warm,
+			pCfg->period, pCfg->latency, pCfg->pressEvery, pCfg->bound);
+}
+
+int main(int argc, char **argv) {
+	TimeCfg_t cfg = { .minutes = 120, .drifts = { -100, -40, -20, 0, 20, 40,
+			100 }, .numDrifts = 7, .warm = 5, .period = 2000, .latency = 2,
+			.pressEvery = 20000, .bound = 10 };
+	int errors = 0;
+	int opt, d, mode;
+
+	while ((opt = getopt(argc, argv, "m:d:w:p:l:k:e:x:vh")) != -1) {
+		switch (opt) {
+			case 'm': cfg.minutes = atoi(optarg); break;
+			case 'd':
+				if (!Time_list(optarg, &cfg)) {
+					Time_usage(&cfg);
+					return 1;
+				}
+			break;
+			case 'w': cfg.warm = atoi(optarg); break;
+			case 'p': cfg.period = atoi(optarg); break;
+			case 'l': cfg.latency = atoi(optarg); break;
+			case 'k': cfg.pressEvery = atoi(optarg); break;
+			case 'e': cfg.bound = atoi(optarg); break;
+			case 'x': rng = (uint32_t) strtoul(optarg, NULL, 0); break;
+			case 'v': isVerbose = true; break;
+			default:
+				Time_usage(&cfg);
+				return (opt == 'h') ? 0 : 1;
+		}
+	}
+	if ((cfg.minutes < 1) || (cfg.period < 1) || (cfg.latency < 0)
+			|| (cfg.pressEvery < 1) || (cfg.bound < 1)) {
+		Time_usage(&cfg);
+		return 1;
+	}
+
+	printf("# %d min, warm-up %+d ppm, beacons every %d ms, latency up to "
+			"%d ms, tick %d us\n", cfg.minutes, cfg.warm, cfg.period,
+			cfg.latency, TIME_TICK_PERIOD);
+	printf("# %-7s %5s %6s %6s %6s %8s %8s %8s %8s\n", "sync", "ppm",
+			"syncs", "drift", "steps", "presses", "p50 ms", "p99 ms",
+			"max ms");
+	for (d = 0; d < cfg.numDrifts; d++) {
+		for (mode = 0; mode < SYNC_MODES; mode++) {
+			TimeRun_t run;
+			uint32_t i;
+			int32_t p50 = 0, p99 = 0, max = 0;
+
+			Time_run(&cfg, cfg.drifts[d], (uint8_t) mode, &run);
+			for (i = 0; i < run.presses; i++) {
+				if (run.pErr[i] < 0)
+					run.pErr[i] = -run.pErr[i];
+			}
+			if (run.presses != 0) {
+				qsort(run.pErr, run.presses, sizeof(int32_t), Time_cmp);
+				p50 = run.pErr[run.presses / 2];
+				p99 = run.pErr[(run.presses - 1) * 99 / 100];
+				max = run.pErr[run.presses - 1];
+			}
+			// the estimate is of the BS against the ETX, the other way
+			printf("  %-7s %5d %6u %6d %6u %8u %8d %8d %8d\n", modeNames[mode],
+					cfg.drifts[d], run.syncs[ETX_PROTO_TIME_FIRST]
+					+ run.syncs[ETX_PROTO_TIME_STEP]
+					+ run.syncs[ETX_PROTO_TIME_DRIFT], -run.driftPpm,
+					run.steps, run.presses, p50, p99, max);
+
+			if (run.steps != 0) {
+				printf("%s, %d ppm: time stepped %u times\n", modeNames[mode],
+						cfg.drifts[d], run.steps);
+				errors++;
+			}
+			if (run.backwards != 0) {
+				printf("%s, %d ppm: %u stamps went back\n", modeNames[mode],
+						cfg.drifts[d], run.backwards);
+				errors++;
+			}
+			if ((mode == SYNC_BEACONS) && (max > cfg.bound)) {
+				printf("%s, %d ppm: stamp %d ms off\n", modeNames[mode],
+						cfg.drifts[d], max);
+				errors++;
+			}
+			free(run.pErr);
+		}
+	}
+
+	printf("%d errors\n", errors);
+	return errors ? 1 : 0;
+}
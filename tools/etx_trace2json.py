@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+"""Turn an ETX trace dump into a Chrome trace viewer JSON timeline.
+
+The dump is the UART output of a firmware built with ETX_TRACE, captured
+after writing the dump page (0xFF) to the diagnostics characteristic:
+
+    trace 3 records, tick 10us
+    T 0001a2b4 03 04 0110
+    ...
+    trace end
+
+Other lines in the capture are ignored. Open the output in
+chrome://tracing or https://ui.perfetto.dev.
+
+usage: etx_trace2json.py [dump.txt] > trace.json
+"""
+
+import json
+import re
+import sys
+
+# keep in step with drv/etx_board_trace.h
+THREADS = {0x00: "Hwi", 0x01: "Swi", 0x02: "other task",
+           0x03: "ETX task", 0x04: "GAPRole task"}
+
+BEGIN = {0x02: "stack event", 0x03: "stack msg", 0x04: "app msg"}
+END = 0x05
+INSTANT = {0x01: "wake", 0x10: "key isr", 0x11: "key",
+           0x20: "led", 0x21: "led flash", 0x30: "adv", 0x31: "conn",
+           0x32: "scan", 0x33: "adc", 0x34: "load", 0x40: "vote",
+           0x41: "question"}
+
+HEADER = re.compile(r"trace (\d+) records, tick (\d+)us")
+RECORD = re.compile(r"T ([0-9a-fA-F]{8}) ([0-9a-fA-F]{2}) "
+                    r"([0-9a-fA-F]{2}) ([0-9a-fA-F]{4})")
+
+
+def convert(lines):
+    tick_us = 10
+    events = []
+    last_tick = None
+    wraps = 0
+
+    for line in lines:
+        m = HEADER.search(line)
+        if m:
+            tick_us = int(m.group(2))
+            continue
+        m = RECORD.search(line)
+        if not m:
+            continue
+
+        tick, thread, rec_id, arg = (int(g, 16) for g in m.groups())
+        # Clock ticks are 32 bits, keep the timeline going across a wrap
+        if last_tick is not None and tick < last_tick:
+            wraps += 1
+        last_tick = tick
+        ts = ((wraps << 32) + tick) * tick_us
+
+        event = {"ts": ts, "pid": 1, "tid": thread,
+                 "args": {"arg": "0x%04x" % arg}}
+        if rec_id in BEGIN:
+            event.update(ph="B", name="%s 0x%02x" % (BEGIN[rec_id], arg & 0xFF))
+        elif rec_id == END:
+            event.update(ph="E")
+        else:
+            event.update(ph="i", s="t",
+                         name=INSTANT.get(rec_id, "id 0x%02x" % rec_id))
+        events.append(event)
+
+    for thread, name in THREADS.items():
+        events.append({"ph": "M", "pid": 1, "tid": thread,
+                       "name": "thread_name", "args": {"name": name}})
+    return {"traceEvents": events, "displayTimeUnit": "ms"}
+
+
+def main():
+    src = open(sys.argv[1]) if len(sys.argv) > 1 else sys.stdin
+    with src:
+        json.dump(convert(src), sys.stdout, indent=1)
+    sys.stdout.write("\n")
+
+
+if __name__ == "__main__":
+    main()